@@ -0,0 +1,107 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "allocationcounter.h"
+#include "benchmark.h"
+#include "callbackformat.h"
+
+#include <filesystem>
+#include <sstream>
+#include <vector>
+
+using Actions = NtfyToastActions::Actions;
+
+namespace {
+const std::filesystem::path pipe = L"\\\\.\\pipe\\ntfy-desktop";
+const std::filesystem::path application =
+        L"C:\\Program Files\\ntfy-desktop\\ntfy-desktop.exe";
+const std::wstring id = L"4711";
+const std::wstring version = L"0.9.0";
+
+// formatAction before the prefix was cached, every field through a wstringstream
+std::wstring streamAction(Actions action, std::wstring_view button)
+{
+    const auto pipeName = pipe.wstring();
+    const auto app = application.wstring();
+    std::vector<std::pair<std::wstring_view, std::wstring_view>> data = {
+        { L"action", NtfyToastActions::getActionString(action) },
+        { L"notificationId", id },
+        { L"pipe", pipeName },
+        { L"application", app },
+        { L"button", button }
+    };
+    std::wstringstream out;
+    for (const auto &p : data) {
+        if (!p.second.empty()) {
+            out << p.first << L"=" << p.second << L";";
+        }
+    }
+    out << L"version=" << version << L";";
+    return out.str();
+}
+
+std::wstring prefix()
+{
+    std::wstring out;
+    CallbackFormat::appendField(out, L"notificationId", id);
+    CallbackFormat::appendField(out, L"pipe", pipe.wstring());
+    CallbackFormat::appendField(out, L"application", application.wstring());
+    CallbackFormat::appendField(out, L"version", version);
+    return out;
+}
+
+template<typename F>
+void run(const char *name, size_t iterations, F &&f)
+{
+    NtfyBench::report(name, NtfyBench::measure(iterations, f), "ns");
+    const auto before = AllocationCounter::current().allocations;
+    for (size_t i = 0; i < 1000; ++i) {
+        f();
+    }
+    NtfyBench::report((std::string(name) + ", allocations").c_str(),
+                      static_cast<double>(AllocationCounter::current().allocations - before)
+                              / 1000,
+                      "per call");
+}
+}
+
+int main()
+{
+    const auto shared = prefix();
+    ToastCallbackFormatter formatter(id, shared, L"183274928", {}, false);
+    formatter.setShownAt(std::chrono::steady_clock::now());
+
+    run("button argument, wstringstream", 200000,
+        [&] { NtfyBench::keep(streamAction(Actions::ButtonClicked, L"Acknowledge")); });
+    std::wstring buffer;
+    run("button argument, cached prefix", 200000, [&] {
+        buffer.clear();
+        CallbackFormat::appendAction(buffer, Actions::ButtonClicked, shared, L"183274928", 0,
+                                     { { L"button", L"Acknowledge" } }, false);
+        NtfyBench::keep(buffer);
+    });
+    run("callback, wstringstream", 200000,
+        [&] { NtfyBench::keep(streamAction(Actions::Clicked, {})); });
+    run("callback, ToastCallbackFormatter", 200000,
+        [&] { NtfyBench::keep(formatter.formatAction(Actions::Clicked)); });
+    return 0;
+}
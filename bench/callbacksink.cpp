@@ -0,0 +1,65 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "callbacksink.h"
+
+#include <string>
+
+namespace {
+// a button callback as NtfyToasts formats it, with the filter fields of -notify and -fields
+std::wstring callback(const std::wstring &filter)
+{
+    return L"action=buttonClicked;notificationId=4711;pipe=\\\\.\\pipe\\ntfy-desktop;"
+           L"application=C:\\Program Files\\ntfy-desktop\\ntfy-desktop.exe;"
+           + filter
+           + L"version=0.9.0;submittedAt=183274928;shownAt=183275011;actedAt=183279640;"
+             L"button=Acknowledge;";
+}
+
+void run(const char *name, const std::wstring &data)
+{
+    std::wstring out;
+    NtfyBench::report(name, NtfyBench::measure(200000, [&] {
+                          NtfyBench::keep(CallbackFilter::apply(data, out));
+                          NtfyBench::keep(out);
+                      }),
+                      "ns");
+}
+}
+
+int main()
+{
+    run("CallbackFilter::apply, no filter", callback(L""));
+    run("CallbackFilter::apply, notified action",
+        callback(L"notify=clicked,buttonClicked,textEntered;"));
+    run("CallbackFilter::apply, action not notified", callback(L"notify=clicked,dismissed;"));
+    run("CallbackFilter::apply, notify and 3 fields",
+        callback(L"notify=buttonClicked;fields=notificationId,button,actedAt;"));
+
+    const auto data = callback(L"");
+    NtfyBench::report("JsonLinesCallbackSink::format", NtfyBench::measure(200000, [&] {
+                          NtfyBench::keep(JsonLinesCallbackSink::format(data));
+                      }),
+                      "ns");
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "callbackspool.h"
+
+#include <filesystem>
+#include <string>
+
+namespace {
+const std::wstring pipe = L"\\\\.\\pipe\\ntfy-desktop";
+const std::wstring callback =
+        L"action=buttonClicked;notificationId=4711;pipe=\\\\.\\pipe\\ntfy-desktop;"
+        L"application=C:\\Program Files\\ntfy-desktop\\ntfy-desktop.exe;version=0.9.0;"
+        L"submittedAt=183274928;shownAt=183275011;actedAt=183279640;button=Acknowledge;";
+}
+
+int main()
+{
+    const auto path = std::filesystem::temp_directory_path() / "ntfytoast-bench.spool";
+    std::filesystem::remove(path);
+    {
+        const CallbackSpool spool(path);
+    }
+
+    // what writeCallback pays before every callback while the consumer is up
+    NtfyBench::report("empty spool, hasPending", NtfyBench::measure(20000, [&] {
+                          NtfyBench::keep(CallbackSpool::hasPending(path));
+                      }),
+                      "ns");
+    NtfyBench::report("empty spool, open and map", NtfyBench::measure(2000, [&] {
+                          const CallbackSpool spool(path);
+                          NtfyBench::keep(spool);
+                      }),
+                      "ns");
+
+    // the consumer is down: every callback is spooled, then all of them are delivered
+    CallbackSpool spool(path);
+    const double bytes = static_cast<double>(callback.size() * sizeof(wchar_t));
+    const auto append = NtfyBench::measure(2000, [&] {
+        spool.append(pipe, callback, PipeEncoding::Utf8);
+    });
+    NtfyBench::report("append", append, "ns");
+    NtfyBench::report("append throughput", bytes / append * 1e9 / (1 << 20), "MiB/s");
+
+    size_t delivered = 0;
+    const auto deliver = NtfyBench::measure(1, [&] {
+        for (int i = 0; i < 2000; ++i) {
+            spool.append(pipe, callback, PipeEncoding::Utf8);
+        }
+        delivered = spool.deliver([](const CallbackSpool::Callback &c) {
+            NtfyBench::keep(c);
+            return true;
+        });
+    });
+    NtfyBench::report("append and deliver 2000 callbacks", deliver / 2000, "ns per callback");
+    NtfyBench::keep(delivered);
+
+    std::filesystem::remove(path);
+    return 0;
+}
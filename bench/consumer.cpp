@@ -0,0 +1,151 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "callbackclient.h"
+#include "ntfytoastconsumer.h"
+
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NtfyToastConsumer;
+using namespace std::chrono_literals;
+
+namespace {
+constexpr size_t Messages = 10000;
+constexpr size_t ChunkSize = 4096;
+
+const std::string Callback =
+        "action=buttonClicked;notificationId=4711;pipe=/tmp/ntfy-desktop.sock;"
+        "application=/usr/bin/ntfy-desktop;version=0.9.0;submittedAt=183274928;"
+        "shownAt=183275011;actedAt=183279640;button=Acknowledge;";
+
+template<typename Char>
+std::basic_string<Char> stream()
+{
+    std::basic_string<Char> out;
+    for (size_t i = 0; i < Messages; ++i) {
+        out.append(Callback.cbegin(), Callback.cend());
+        out.push_back(0);
+    }
+    return out;
+}
+
+// what consumers did before: copy the message and split it into a map
+std::map<std::string, std::string> splitIntoMap(const std::string &message)
+{
+    std::map<std::string, std::string> out;
+    size_t start = 0;
+    while (start < message.size()) {
+        size_t end = message.find(';', start);
+        if (end == std::string::npos) {
+            end = message.size();
+        }
+        const std::string field = message.substr(start, end - start);
+        const size_t pos = field.find('=');
+        if (pos != std::string::npos) {
+            out[field.substr(0, pos)] = field.substr(pos + 1);
+        }
+        start = end + 1;
+    }
+    return out;
+}
+
+template<typename Char>
+void decode(const char *name)
+{
+    const auto data = stream<Char>();
+    const char *bytes = reinterpret_cast<const char *>(data.data());
+    const size_t size = data.size() * sizeof(Char);
+    size_t buttons = 0;
+    const double ns = NtfyBench::measure(20, [&] {
+        CallbackDecoder<Char> decoder;
+        // chunks as a read of the pipe returns them, most messages span two of them
+        for (size_t offset = 0; offset < size; offset += ChunkSize) {
+            decoder.feed(bytes + offset, std::min(ChunkSize, size - offset),
+                         [&](const CallbackMessage<Char> &message) {
+                             buttons += message.action()
+                                     == NtfyToastActions::Actions::ButtonClicked;
+                             NtfyBench::keep(message.value("button"));
+                         });
+        }
+    });
+    NtfyBench::keep(buttons);
+    const std::string prefix = std::string("decode ") + name;
+    NtfyBench::report((prefix + ", messages").c_str(), Messages / ns * 1e9 / 1e6, "M/s");
+    NtfyBench::report((prefix + ", bytes").c_str(), static_cast<double>(size) / ns * 1e9 / 1e6,
+                      "MB/s");
+}
+}
+
+int main()
+{
+    decode<char>("utf8");
+    decode<char16_t>("utf16");
+
+    {
+        const double ns = NtfyBench::measure(100000, [] {
+            const auto fields = splitIntoMap(Callback);
+            NtfyBench::keep(fields.find("button")->second);
+        });
+        NtfyBench::report("split into a map", ns, "ns/message");
+        const double view = NtfyBench::measure(100000, [] {
+            const CallbackMessage<char> message(Callback);
+            NtfyBench::keep(message.action());
+            NtfyBench::keep(message.value("button"));
+        });
+        NtfyBench::report("CallbackMessage action and button", view, "ns/message");
+    }
+
+#ifndef _WIN32
+    // one connection per callback like ntfytoast writes them
+    {
+        const auto address =
+                (std::filesystem::temp_directory_path() / "ntfytoast-bench-consumer.sock")
+                        .string();
+        std::atomic<size_t> received { 0 };
+        CallbackServer<char> server(address, [&](const CallbackMessage<char> &) { ++received; });
+        std::thread thread([&] { server.run(); });
+        while (!sendCallback(address, "action=clicked;", 16)) {
+            std::this_thread::sleep_for(1ms);
+        }
+        const auto start = NtfyBench::Clock::now();
+        for (size_t i = 0; i < Messages; ++i) {
+            sendCallback(address, Callback.c_str(), Callback.size() + 1);
+        }
+        while (received < Messages + 1) {
+            std::this_thread::yield();
+        }
+        const double seconds =
+                std::chrono::duration<double>(NtfyBench::Clock::now() - start).count();
+        server.stop();
+        thread.join();
+        NtfyBench::report("CallbackServer, a connection per callback", Messages / seconds / 1e3,
+                          "k/s");
+    }
+#endif
+    return 0;
+}
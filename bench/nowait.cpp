@@ -0,0 +1,160 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "loopbackbackend.h"
+#include "toastxml.h"
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+    The resident memory -nowait saves: every toast is shown by its own process, which either
+    waits for the user like ntfytoast does by default or exits right after show(). The
+    notification platform is simulated by LoopbackBackend, so the numbers only cover the
+    portable part of the process, not the Windows Runtime; on Windows ntfytoast logs its
+    working set on exit, see logResourceUsage() in main.cpp.
+*/
+
+using namespace std::chrono_literals;
+
+namespace {
+constexpr int Processes = 50;
+
+class WaitingSink : public ToastEventSink
+{
+public:
+    void activated(const std::wstring &) override { done(); }
+    void dismissed(NtfyToastActions::Actions) override { done(); }
+    void failed() override { done(); }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_done; });
+    }
+
+private:
+    void done()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+        m_condition.notify_all();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_done = false;
+};
+
+[[noreturn]] void showToast(int id, bool wait)
+{
+    LoopbackBackend::Options options;
+    // the user does not react, the toast times out after 7s
+    options.clicks = options.buttons = options.replies = options.dismissals = 0;
+    LoopbackBackend backend(options);
+
+    ToastXmlWriter xml;
+    xml.startElement(L"toast");
+    xml.attribute(L"launch", L"action=clicked;notificationId=" + std::to_wstring(id) + L";");
+    xml.startElement(L"visual");
+    xml.startElement(L"binding");
+    xml.attribute(L"template", L"ToastGeneric");
+    xml.startElement(L"text");
+    xml.text(L"Disk full");
+    xml.endElement();
+    xml.endElement();
+    xml.endElement();
+    xml.endElement();
+
+    auto sink = std::make_shared<WaitingSink>();
+    backend.show({ L"NtfyToast", std::to_wstring(id), L"NtfyToast", xml.xml(), {} }, sink);
+    if (wait) {
+        sink->wait();
+    }
+    _exit(0);
+}
+
+// field is Rss or Pss, the proportional share does not count the shared pages of each
+// process in full
+size_t memoryKiB(pid_t pid, const std::string &field)
+{
+    std::ifstream status("/proc/" + std::to_string(pid) + "/smaps_rollup");
+    for (std::string line; std::getline(status, line);) {
+        if (line.rfind(field + ":", 0) == 0) {
+            return std::stoul(line.substr(field.size() + 1));
+        }
+    }
+    return 0;
+}
+
+void run(const char *name, bool wait)
+{
+    std::vector<pid_t> children;
+    for (int i = 0; i < Processes; ++i) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            showToast(i, wait);
+        }
+        children.push_back(pid);
+    }
+    // all toasts are on screen, the processes that exit after show() are gone by now
+    std::this_thread::sleep_for(500ms);
+
+    size_t alive = 0;
+    size_t resident = 0;
+    size_t proportional = 0;
+    for (const pid_t pid : children) {
+        if (waitpid(pid, nullptr, WNOHANG) == 0) {
+            ++alive;
+            resident += memoryKiB(pid, "Rss");
+            proportional += memoryKiB(pid, "Pss");
+        }
+    }
+    for (const pid_t pid : children) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+
+    std::printf("%s: %zu of %d processes alive, %zu KiB Rss, %zu KiB Pss", name, alive,
+                Processes, resident, proportional);
+    if (alive > 0) {
+        std::printf(", %zu KiB Rss and %zu KiB Pss per process", resident / alive,
+                    proportional / alive);
+    }
+    std::printf("\n");
+}
+}
+
+int main()
+{
+    run("waiting", true);
+    run("nowait", false);
+    return 0;
+}
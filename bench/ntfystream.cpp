@@ -0,0 +1,70 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "ntfystream.h"
+
+#include <algorithm>
+#include <string>
+
+int main()
+{
+    // a message as ntfy.sh sends it, with tags and an action
+    const std::string message =
+            R"({"id":"sPs71M8A2T","time":1700000000,"expires":1700043200,"event":"message",)"
+            R"("topic":"backups","title":"Backup finished","message":"The backup of /srv/data )"
+            R"(finished in 42 minutes, 1.2 TB were written.","priority":4,)"
+            R"("tags":["white_check_mark","backup"],"click":"https://example.com/backups",)"
+            R"("actions":[{"action":"view","label":"Open","url":"https://example.com"}]})"
+            "\n";
+    constexpr size_t messages = 10000;
+    std::string stream;
+    for (size_t i = 0; i < messages; ++i) {
+        stream += message;
+    }
+
+    NtfyStreamParser parser;
+    size_t parsed = 0;
+    const auto ns = NtfyBench::measure(1, [&] {
+        // the chunks of a socket read, most messages are split somewhere
+        for (size_t pos = 0; pos < stream.size(); pos += 4096) {
+            parsed += parser.feed(stream.data() + pos, std::min<size_t>(4096, stream.size() - pos),
+                                  [](const NtfyMessage &m) { NtfyBench::keep(m); });
+        }
+    });
+    NtfyBench::report("feed, 4 KiB chunks", messages / ns * 1e3, "M messages/s");
+    NtfyBench::report("feed, 4 KiB chunks, throughput", stream.size() / ns * 1e3, "MB/s");
+    NtfyBench::keep(parsed);
+
+    NtfyMessage m;
+    NtfyStreamParser::parse(message, m);
+    NtfyBench::report("text of the message", NtfyBench::measure(200000, [&] {
+                          NtfyBench::keep(NtfyMessage::text(m.message));
+                      }),
+                      "ns");
+    const std::string escaped = R"(Caf\u00e9 \"Zur Sonne\"\nTisch 4 \ud83d\udd14)";
+    NtfyBench::report("text with escapes", NtfyBench::measure(200000, [&] {
+                          NtfyBench::keep(NtfyMessage::text(escaped));
+                      }),
+                      "ns");
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "packedresources.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace {
+std::string read(const std::filesystem::path &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+}
+
+int main()
+{
+    // the resources embedded in ntfytoast, packed like ntfytoast-pack does at build time
+    for (const auto *name : { "help.txt", "ntfytoast.svg", "ntfytoast.ico", "logo.png",
+                              "512-512-ntfytoast.png", "16-16-ntfytoast.png" }) {
+        const auto data = read(std::filesystem::path(NTFYTOAST_DATA_DIR) / name);
+        const auto packed = PackedResources::pack(data);
+        const auto lookup = [&](const std::string &) { return std::string_view(packed); };
+
+        const std::string prefix = name;
+        NtfyBench::report((prefix + ", size").c_str(), static_cast<double>(data.size()), "bytes");
+        NtfyBench::report((prefix + ", packed").c_str(), static_cast<double>(packed.size()),
+                          "bytes");
+        // a new instance per iteration, every open is the first one
+        NtfyBench::report((prefix + ", first open").c_str(), NtfyBench::measure(200, [&] {
+                              PackedResources resources(lookup);
+                              NtfyBench::keep(resources.open(name));
+                          }),
+                          "ns");
+        PackedResources resources(lookup);
+        resources.open(name);
+        NtfyBench::report((prefix + ", cached open").c_str(), NtfyBench::measure(200000, [&] {
+                              NtfyBench::keep(resources.open(name));
+                          }),
+                          "ns");
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "callbackclient.h"
+#include "ntfytoastconsumer.h"
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+using namespace NtfyToastConsumer;
+using namespace std::chrono_literals;
+
+namespace {
+constexpr size_t Messages = 10000;
+
+const std::string Callback =
+        "action=buttonClicked;notificationId=4711;pipe=/tmp/ntfy-desktop.sock;"
+        "application=/usr/bin/ntfy-desktop;version=0.9.0;submittedAt=183274928;"
+        "shownAt=183275011;actedAt=183279640;button=Acknowledge;";
+
+// sends Messages callbacks with send() and returns the callbacks a second the server received
+template<typename Server, typename Send>
+double deliver(Server &server, const std::atomic<size_t> &received, Send &&send)
+{
+    std::thread thread([&] { server.run(); });
+    while (!send()) {
+        std::this_thread::sleep_for(1ms);
+    }
+    const auto start = NtfyBench::Clock::now();
+    for (size_t i = 0; i < Messages; ++i) {
+        while (!send()) {
+            std::this_thread::yield();
+        }
+    }
+    while (received < Messages + 1) {
+        std::this_thread::yield();
+    }
+    const double seconds = std::chrono::duration<double>(NtfyBench::Clock::now() - start).count();
+    server.stop();
+    thread.join();
+    return Messages / seconds;
+}
+}
+
+int main()
+{
+    const auto directory = std::filesystem::temp_directory_path();
+    const SharedRing::Address address = (directory / "ntfytoast-bench-ring.sock").native();
+
+    {
+        const auto consumer = SharedRing::create(address);
+        const auto producer = SharedRing::open(address);
+        const double ns = NtfyBench::measure(100000, [&] {
+            producer->push(Callback.data(), Callback.size());
+            consumer->drain([](const char *data, size_t) { NtfyBench::keep(data); });
+        });
+        NtfyBench::report("push and drain", ns, "ns/callback");
+    }
+    {
+        const double ns = NtfyBench::measure(1000, [&] {
+            NtfyBench::keep(SharedRing::open((directory / "ntfytoast-bench-none.sock").native()));
+        });
+        NtfyBench::report("open without a consumer", ns, "ns");
+    }
+
+    // ntfytoast is a process per callback, it opens the ring or connects for each of them
+    {
+        std::atomic<size_t> received { 0 };
+        RingCallbackServer<char> server(address,
+                                        [&](const CallbackMessage<char> &) { ++received; });
+        const double rate = deliver(server, received, [&] {
+            const auto ring = SharedRing::open(address);
+            return ring && ring->push(Callback.data(), Callback.size());
+        });
+        NtfyBench::report("RingCallbackServer, open and push per callback", rate / 1e3, "k/s");
+    }
+    {
+        std::atomic<size_t> received { 0 };
+        RingCallbackServer<char> server(address,
+                                        [&](const CallbackMessage<char> &) { ++received; });
+        std::unique_ptr<SharedRing> ring;
+        const double rate = deliver(server, received, [&] {
+            if (!ring) {
+                ring = SharedRing::open(address);
+            }
+            return ring && ring->push(Callback.data(), Callback.size());
+        });
+        NtfyBench::report("RingCallbackServer, one producer", rate / 1e3, "k/s");
+    }
+#ifndef _WIN32
+    {
+        const auto socket = (directory / "ntfytoast-bench-ring-socket.sock").string();
+        std::atomic<size_t> received { 0 };
+        CallbackServer<char> server(socket, [&](const CallbackMessage<char> &) { ++received; });
+        const double rate = deliver(server, received, [&] {
+            return sendCallback(socket, Callback.c_str(), Callback.size() + 1);
+        });
+        NtfyBench::report("CallbackServer, a connection per callback", rate / 1e3, "k/s");
+    }
+#endif
+#ifdef __linux__
+    std::filesystem::remove("/dev/shm/ntfytoast-ring-ntfytoast-bench-ring.sock");
+#endif
+    return 0;
+}
@@ -0,0 +1,172 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "loopbackbackend.h"
+#include "submissionqueue.h"
+#include "toastdispatcher.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+// one consumer pops while the producers submit total toasts between them
+double throughput(size_t producers, size_t total, DropPolicy policy)
+{
+    SubmissionQueue<std::wstring> queue(1024, policy);
+    const size_t perProducer = total / producers;
+    const auto start = NtfyBench::Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, perProducer, p] {
+            const std::wstring key = L"source-" + std::to_wstring(p % 4);
+            for (size_t i = 0; i < perProducer; ++i) {
+                while (!queue.push(L"-t Alert -m Disk full", SubmissionPriority::Normal, key)
+                                .accepted()) {
+                    queue.waitForRoom(10ms);
+                }
+            }
+        });
+    }
+    size_t received = 0;
+    while (received + queue.stats().coalesced < perProducer * producers) {
+        if (queue.pop(1ms)) {
+            ++received;
+        }
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    const double seconds =
+            std::chrono::duration<double>(NtfyBench::Clock::now() - start).count();
+    return static_cast<double>(perProducer * producers) / seconds;
+}
+
+// the producers submit to a ToastDispatcher that is busy showing toasts, the full path of a
+// submission: the handle, the ticket, the queue and waking the dispatcher thread
+double dispatcherThroughput(size_t producers, size_t total)
+{
+    LoopbackBackend::Options user;
+    user.clicks = 1;
+    user.buttons = 0;
+    user.replies = 0;
+    user.dismissals = 0;
+    user.reaction = LoopbackBackend::Distribution::fixed(0us);
+    ToastDispatcher dispatcher(std::make_shared<LoopbackBackend>(user));
+    dispatcher.start();
+
+    const size_t perProducer = total / producers;
+    const auto start = NtfyBench::Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&dispatcher, perProducer, p] {
+            for (size_t i = 0; i < perProducer; ++i) {
+                ToastSubmission toast;
+                toast.request = { L"NtfyToast.Bench", L"source-" + std::to_wstring(p), L"bench",
+                                  L"<toast><visual/></toast>", {} };
+                NtfyBench::keep(dispatcher.submit(std::move(toast)).handle);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    const double seconds =
+            std::chrono::duration<double>(NtfyBench::Clock::now() - start).count();
+    dispatcher.stop();
+    return static_cast<double>(perProducer * producers) / seconds;
+}
+}
+
+int main()
+{
+    {
+        SubmissionQueue<std::wstring> queue(1024);
+        const std::wstring toast = L"-t Alert -m Disk full";
+        const double ns = NtfyBench::measure(1000000, [&] {
+            queue.push(toast);
+            NtfyBench::keep(queue.tryPop());
+        });
+        NtfyBench::report("push+pop uncontended", ns, "ns");
+    }
+
+    for (const size_t producers : { 1, 4, 16 }) {
+        const std::string name = "throughput " + std::to_string(producers) + " producer(s)";
+        NtfyBench::report(name.c_str(), throughput(producers, 400000, DropPolicy::DropNewest),
+                          "toasts/s");
+    }
+    NtfyBench::report("throughput 4 producers, coalesce on 4 keys",
+                      throughput(4, 400000, DropPolicy::Coalesce), "toasts/s");
+
+    for (const size_t producers : { 1, 4, 16 }) {
+        const std::string name =
+                "dispatcher submit " + std::to_string(producers) + " producer(s)";
+        NtfyBench::report(name.c_str(), dispatcherThroughput(producers, 400000), "toasts/s");
+    }
+
+    // alert storm: a slow notifier, chatter from 8 threads and an occasional page
+    {
+        SubmissionQueue<int> queue(64, DropPolicy::DropOldest);
+        std::atomic<bool> running { true };
+        std::vector<std::thread> threads;
+        for (int p = 0; p < 8; ++p) {
+            threads.emplace_back([&] {
+                while (running) {
+                    queue.push(0);
+                }
+            });
+        }
+        size_t pages = 0;
+        size_t shownPages = 0;
+        size_t shown = 0;
+        const auto end = NtfyBench::Clock::now() + 1s;
+        while (NtfyBench::Clock::now() < end) {
+            if (shown % 10 == 0) {
+                queue.push(1, SubmissionPriority::High);
+                ++pages;
+            }
+            if (const auto toast = queue.pop(10ms)) {
+                shownPages += *toast;
+                ++shown;
+            }
+            // showing a toast takes a while
+            std::this_thread::sleep_for(100us);
+        }
+        running = false;
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        while (const auto toast = queue.tryPop()) {
+            shownPages += *toast;
+        }
+        const auto stats = queue.stats();
+        NtfyBench::report("storm submitted", static_cast<double>(stats.accepted), "toasts");
+        NtfyBench::report("storm evicted", static_cast<double>(stats.evicted), "toasts");
+        NtfyBench::report("storm pages delivered",
+                          100.0 * static_cast<double>(shownPages) / static_cast<double>(pages),
+                          "%");
+    }
+    return 0;
+}
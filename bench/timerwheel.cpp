@@ -0,0 +1,131 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "timerwheel.h"
+
+#include <filesystem>
+#include <map>
+#include <random>
+
+using namespace std::chrono_literals;
+
+namespace {
+constexpr size_t TimerCount = 10000;
+
+std::vector<std::chrono::milliseconds> deadlines()
+{
+    // scheduled reminders spread over a day
+    std::mt19937_64 random(26);
+    std::vector<std::chrono::milliseconds> out(TimerCount);
+    for (auto &deadline : out) {
+        deadline = std::chrono::milliseconds(1 + random() % (24 * 3600 * 1000));
+    }
+    return out;
+}
+}
+
+int main()
+{
+    std::chrono::milliseconds now = 0ms;
+    const auto clock = [&now] { return now; };
+    const auto times = deadlines();
+
+    // schedule and cancel a pool of pending timers, as the dispatcher does for expiry
+    {
+        TimerWheel wheel(clock);
+        std::vector<TimerWheel::TimerId> ids(TimerCount);
+        const double ns = NtfyBench::measure(100, [&] {
+            for (size_t i = 0; i < TimerCount; ++i) {
+                ids[i] = wheel.schedule(times[i], TimerWheel::Kind::Expire);
+            }
+            for (const auto id : ids) {
+                wheel.cancel(id);
+            }
+        });
+        NtfyBench::report("wheel schedule+cancel", ns / TimerCount, "ns/timer");
+    }
+
+    // the same with an ordered map, what a heap or tree based scheduler pays
+    {
+        std::multimap<std::chrono::milliseconds, size_t> timers;
+        std::vector<std::multimap<std::chrono::milliseconds, size_t>::iterator> ids(TimerCount);
+        const double ns = NtfyBench::measure(100, [&] {
+            for (size_t i = 0; i < TimerCount; ++i) {
+                ids[i] = timers.emplace(times[i], i);
+            }
+            for (const auto &id : ids) {
+                timers.erase(id);
+            }
+        });
+        NtfyBench::report("multimap insert+erase", ns / TimerCount, "ns/timer");
+    }
+
+    // firing: advance over a day in one second steps with all timers pending
+    {
+        TimerWheel wheel(clock, 100ms);
+        for (const auto time : times) {
+            wheel.schedule(time, TimerWheel::Kind::Display);
+        }
+        size_t fired = 0;
+        const auto start = NtfyBench::Clock::now();
+        for (now = 0ms; now <= 24h; now += 1s) {
+            fired += wheel.advance().size();
+        }
+        const double ns =
+                std::chrono::duration<double, std::nano>(NtfyBench::Clock::now() - start).count();
+        NtfyBench::report("advance over a day", ns / 1e6, "ms");
+        NtfyBench::report("advance per fired timer", ns / static_cast<double>(fired), "ns");
+        now = 0ms;
+    }
+
+    // how long the scheduler thread spends computing its sleep
+    {
+        TimerWheel wheel(clock);
+        for (const auto time : times) {
+            wheel.schedule(time, TimerWheel::Kind::Display);
+        }
+        const double ns = NtfyBench::measure(10000, [&] { NtfyBench::keep(wheel.nextDeadline()); });
+        NtfyBench::report("nextDeadline with 10000 pending", ns, "ns");
+    }
+
+    // snapshot of the pending timers, written on every change of the schedule
+    {
+        const auto path =
+                std::filesystem::temp_directory_path() / "ntfytoast-bench-timerwheel.bin";
+        TimerWheel wheel(clock);
+        for (const auto time : times) {
+            wheel.schedule(time, TimerWheel::Kind::Display, L"-t Reminder -m Stand up");
+        }
+        const double save = NtfyBench::measure(20, [&] { wheel.save(path); });
+        NtfyBench::report("save 10000 timers", save / 1e3, "us");
+        NtfyBench::report("snapshot size",
+                          static_cast<double>(std::filesystem::file_size(path)) / 1024, "KiB");
+        const double load = NtfyBench::measure(20, [&] {
+            TimerWheel restored(clock);
+            restored.load(path);
+        });
+        NtfyBench::report("load 10000 timers", load / 1e3, "us");
+        std::filesystem::remove(path);
+    }
+    return 0;
+}
@@ -0,0 +1,148 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "loopbackbackend.h"
+#include "toastaggregator.h"
+#include "toastdispatcher.h"
+
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace {
+constexpr size_t StormSize = 10000;
+
+std::vector<std::wstring> groupNames(size_t count)
+{
+    std::vector<std::wstring> out;
+    for (size_t i = 0; i < count; ++i) {
+        out.push_back(L"build-farm-" + std::to_wstring(i));
+    }
+    return out;
+}
+
+// the toasts of a storm through the dispatcher, until the backend showed all of them
+double throughDispatcher(bool aggregate, size_t &onScreen)
+{
+    LoopbackBackend::Options user;
+    user.clicks = 0;
+    user.buttons = 0;
+    user.replies = 0;
+    user.dismissals = 0;
+    const auto backend = std::make_shared<LoopbackBackend>(user);
+
+    ToastDispatcher::Options options;
+    options.timeout.reset();
+    options.queueCapacity = StormSize;
+    options.maxOutstanding = StormSize;
+    if (aggregate) {
+        options.aggregation = ToastAggregator::Policy();
+    }
+    ToastDispatcher dispatcher(backend, options);
+    dispatcher.start();
+
+    const auto start = NtfyBench::Clock::now();
+    for (size_t i = 0; i < StormSize; ++i) {
+        ToastSubmission toast;
+        const auto id = std::to_wstring(i);
+        toast.request = { L"NtfyToast.Bench", id, L"build-farm",
+                          L"<toast><visual><binding template=\"ToastGeneric\"><text>build " + id
+                                  + L" failed</text></binding></visual></toast>",
+                          {} };
+        dispatcher.submit(std::move(toast));
+    }
+    while (backend->stats().shown < StormSize) {
+        std::this_thread::yield();
+    }
+    const double ns =
+            std::chrono::duration<double, std::nano>(NtfyBench::Clock::now() - start).count();
+    onScreen = backend->active();
+    dispatcher.stop();
+    return ns;
+}
+}
+
+int main()
+{
+    std::chrono::milliseconds now = 0ms;
+    const auto clock = [&now] { return now; };
+
+    // one group storming, a toast every millisecond
+    {
+        ToastAggregator aggregator(ToastAggregator::Policy(), clock);
+        const double ns = NtfyBench::measure(10, [&] {
+            for (size_t i = 0; i < StormSize; ++i) {
+                now += 1ms;
+                NtfyBench::keep(aggregator.add(L"build-farm"));
+            }
+        });
+        NtfyBench::report("add, one storming group", ns / StormSize, "ns/toast");
+    }
+
+    // calm groups, every group stays below the threshold
+    {
+        const auto groups = groupNames(1000);
+        ToastAggregator aggregator(ToastAggregator::Policy(), clock);
+        const double ns = NtfyBench::measure(10, [&] {
+            for (size_t i = 0; i < StormSize; ++i) {
+                now += 1s;
+                NtfyBench::keep(aggregator.add(groups[i % groups.size()]));
+            }
+        });
+        NtfyBench::report("add, 1000 calm groups", ns / StormSize, "ns/toast");
+    }
+
+    // a few groups storming in bursts among many calm ones
+    {
+        const auto groups = groupNames(1000);
+        std::mt19937_64 random(38);
+        std::vector<size_t> picks(StormSize);
+        for (auto &pick : picks) {
+            pick = random() % 4 == 0 ? random() % groups.size() : random() % 4;
+        }
+        ToastAggregator aggregator(ToastAggregator::Policy(), clock);
+        size_t summarized = 0;
+        const double ns = NtfyBench::measure(10, [&] {
+            summarized = 0;
+            for (const auto pick : picks) {
+                now += 10ms;
+                summarized += aggregator.add(groups[pick]);
+            }
+        });
+        NtfyBench::report("add, 4 storming of 1000 groups", ns / StormSize, "ns/toast");
+        NtfyBench::report("share summarized", 100.0 * summarized / StormSize, "%");
+    }
+
+    // the whole storm through the dispatcher and LoopbackBackend
+    for (const bool aggregate : { false, true }) {
+        size_t onScreen = 0;
+        const double ns = throughDispatcher(aggregate, onScreen);
+        const std::string name = aggregate ? "dispatcher with aggregation" : "dispatcher";
+        NtfyBench::report((name + ", storm of 10000").c_str(), ns / StormSize, "ns/toast");
+        NtfyBench::report((name + ", toasts on screen").c_str(), static_cast<double>(onScreen),
+                          "toasts");
+    }
+    return 0;
+}
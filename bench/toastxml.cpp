@@ -0,0 +1,125 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "toastxml.h"
+
+#include <string>
+
+namespace {
+// what ToastXmlWriter did before the runs were found with SSE2, not inlined like the
+// escape of the library
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((noinline))
+#elif defined(_MSC_VER)
+__declspec(noinline)
+#endif
+void escapeLoop(std::wstring &out, std::wstring_view value)
+{
+    for (const wchar_t c : value) {
+        switch (c) {
+        case L'<':
+            out += L"&lt;";
+            break;
+        case L'>':
+            out += L"&gt;";
+            break;
+        case L'&':
+            out += L"&amp;";
+            break;
+        case L'"':
+            out += L"&quot;";
+            break;
+        case L'\'':
+            out += L"&apos;";
+            break;
+        default:
+            out += c < 0x20 && c != L'\t' && c != L'\n' && c != L'\r' ? wchar_t(0xFFFD) : c;
+        }
+    }
+}
+
+std::wstring repeat(std::wstring_view text, size_t size)
+{
+    std::wstring out;
+    while (out.size() < size) {
+        out.append(text);
+    }
+    out.resize(size);
+    return out;
+}
+
+template<typename Escape>
+double throughput(const std::wstring &value, size_t iterations, Escape &&escape)
+{
+    std::wstring out;
+    out.reserve(value.size() * 2);
+    const double ns = NtfyBench::measure(iterations, [&] {
+        out.clear();
+        escape(out, value);
+        NtfyBench::keep(out);
+    });
+    return static_cast<double>(value.size() * sizeof(wchar_t)) / ns * 1e9 / (1 << 20);
+}
+
+void run(const char *name, const std::wstring &value, size_t iterations)
+{
+    const std::string prefix = name;
+    NtfyBench::report((prefix + ", ToastXmlWriter::escape").c_str(),
+                      throughput(value, iterations,
+                                 [](std::wstring &out, std::wstring_view v) {
+                                     ToastXmlWriter::escape(out, v);
+                                 }),
+                      "MiB/s");
+    NtfyBench::report((prefix + ", character loop").c_str(),
+                      throughput(value, iterations, escapeLoop), "MiB/s");
+}
+}
+
+int main()
+{
+    // the labels of buttons and titles, below the 16 characters the vectors start at
+    std::wstring out;
+    NtfyBench::report("short labels, ToastXmlWriter::escape", NtfyBench::measure(1000000, [&] {
+                          out.clear();
+                          for (const auto *label : { L"OK", L"Later", L"Acknowledge", L"R&D" }) {
+                              ToastXmlWriter::escape(out, label);
+                          }
+                          NtfyBench::keep(out);
+                      }),
+                      "ns");
+    NtfyBench::report("short labels, character loop", NtfyBench::measure(1000000, [&] {
+                          out.clear();
+                          for (const auto *label : { L"OK", L"Later", L"Acknowledge", L"R&D" }) {
+                              escapeLoop(out, label);
+                          }
+                          NtfyBench::keep(out);
+                      }),
+                      "ns");
+
+    run("64 KiB plain body",
+        repeat(L"The backup of /srv/data finished in 42 minutes.\n", 32768), 2000);
+    run("64 KiB body, a special character per line",
+        repeat(L"Build #42 of \"ntfytoast\" failed: 3 < 5 tests passed.\n", 32768), 2000);
+    run("64 KiB markup", repeat(L"<b>&amp;</b>", 32768), 500);
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "benchmark.h"
+#include "referenceutf8.h"
+#include "utf8.h"
+
+#include <string>
+
+namespace {
+std::u16string repeat(std::u16string_view text, size_t size)
+{
+    std::u16string out;
+    while (out.size() < size) {
+        out.append(text);
+    }
+    return out;
+}
+
+void run(const char *name, const std::u16string &text, size_t iterations)
+{
+    const auto utf8 = Utf8::fromUtf16(text);
+    const double bytes = static_cast<double>(text.size() * sizeof(char16_t));
+    const auto throughput = [bytes](double ns) { return bytes / ns * 1e9 / (1 << 20); };
+
+    const std::string encode = std::string(name) + " encode";
+    const std::string decode = std::string(name) + " decode";
+    NtfyBench::report((encode + ", Utf8").c_str(),
+                      throughput(NtfyBench::measure(iterations, [&] {
+                          NtfyBench::keep(Utf8::fromUtf16(text));
+                      })),
+                      "MiB/s");
+    NtfyBench::report((encode + ", code point loop").c_str(),
+                      throughput(NtfyBench::measure(iterations, [&] {
+                          NtfyBench::keep(ReferenceUtf8::fromUtf16(text));
+                      })),
+                      "MiB/s");
+    NtfyBench::report((decode + ", Utf8").c_str(),
+                      throughput(NtfyBench::measure(iterations, [&] {
+                          NtfyBench::keep(Utf8::toUtf16(utf8));
+                      })),
+                      "MiB/s");
+    NtfyBench::report((decode + ", code point loop").c_str(),
+                      throughput(NtfyBench::measure(iterations, [&] {
+                          NtfyBench::keep(ReferenceUtf8::toUtf16(utf8));
+                      })),
+                      "MiB/s");
+}
+}
+
+int main()
+{
+    // a typical callback, ASCII only
+    const std::u16string callback =
+            u"action=buttonClicked;notificationId=4711;pipe=\\\\.\\pipe\\ntfy-desktop;"
+            u"application=C:\\Program Files\\ntfy-desktop\\ntfy-desktop.exe;version=0.9.0;"
+            u"submittedAt=183274928;shownAt=183275011;actedAt=183279640;button=Acknowledge;";
+    run("callback", callback, 200000);
+    run("64 KiB ASCII", repeat(u"The backup of /srv/data finished in 42 minutes. ", 32768), 200);
+    run("64 KiB German", repeat(u"Größere Änderungen wurden übernommen. ", 32768), 200);
+    run("64 KiB Japanese", repeat(u"バックアップが完了しました。", 32768), 200);
+    return 0;
+}
@@ -29,8 +29,10 @@
 #include <QTimer>
 
 #include <iostream>
+#include <memory>
 
 #include <ntfytoastactions.h>
+#include <ntfytoastconsumer.h>
 
 namespace {
     constexpr int NOTIFICATION_COUNT = 10;
@@ -43,45 +45,52 @@ int main(int argc, char *argv[])
 
     QObject::connect(server, &QLocalServer::newConnection, server, [server]() {
         auto sock = server->nextPendingConnection();
-        sock->waitForReadyRead();
-        const QByteArray rawData = sock->readAll();
-        sock->deleteLater();
-
-        const QString data =
-                QString::fromWCharArray(reinterpret_cast<const wchar_t *>(rawData.constData()),
-                                        rawData.size() / static_cast<int>(sizeof(wchar_t)));
-        qDebug() << data;
-        QMap<QString, QString> map;
-        for (const auto &str : data.split(QLatin1Char(';'))) {
-            const auto index = str.indexOf(QLatin1Char('='));
-            if (index > 0) {
-                map[str.mid(0, index)] = str.mid(index + 1);
+
+        // a callback may arrive in several reads, keep one decoder per connection
+        using Message = NtfyToastConsumer::CallbackMessage<char>;
+        auto decoder = std::make_shared<NtfyToastConsumer::CallbackDecoder<char>>();
+        const auto onMessage = [](const Message &message) {
+            const QString data =
+                    QString::fromUtf8(message.raw().data(), static_cast<int>(message.raw().size()));
+            const auto actionName = message.value("action");
+            const QString action =
+                    QString::fromUtf8(actionName.data(), static_cast<int>(actionName.size()));
+            const auto ntfyAction = message.action();
+
+            qDebug() << data;
+            std::wcout << qPrintable(data) << std::endl;
+            std::wcout << "Action: " << qPrintable(action) << " " << static_cast<int>(ntfyAction)
+                       << std::endl;
+
+            switch (ntfyAction) {
+                case NtfyToastActions::Actions::Clicked:
+                    break;
+                case NtfyToastActions::Actions::Hidden:
+                    break;
+                case NtfyToastActions::Actions::Dismissed:
+                    break;
+                case NtfyToastActions::Actions::Timedout:
+                    break;
+                case NtfyToastActions::Actions::ButtonClicked:
+                    break;
+                case NtfyToastActions::Actions::TextEntered:
+                    break;
+                case NtfyToastActions::Actions::Error:
+                    break;
             }
-        }
-        const QString action = map["action"];
-
-        const auto ntfyAction = NtfyToastActions::getAction(action.toStdWString());
-
-        std::wcout << qPrintable(data) << std::endl;
-        std::wcout << "Action: " << qPrintable(action) << " " << static_cast<int>(ntfyAction)
-                   << std::endl;
-
-        switch (ntfyAction) {
-            case NtfyToastActions::Actions::Clicked:
-                break;
-            case NtfyToastActions::Actions::Hidden:
-                break;
-            case NtfyToastActions::Actions::Dismissed:
-                break;
-            case NtfyToastActions::Actions::Timedout:
-                break;
-            case NtfyToastActions::Actions::ButtonClicked:
-                break;
-            case NtfyToastActions::Actions::TextEntered:
-                break;
-            case NtfyToastActions::Actions::Error:
-                break;
-        }
+        };
+
+        const auto read = [sock, decoder, onMessage] {
+            const QByteArray chunk = sock->readAll();
+            decoder->feed(chunk.constData(), static_cast<size_t>(chunk.size()), onMessage);
+        };
+        QObject::connect(sock, &QLocalSocket::readyRead, sock, read);
+        QObject::connect(sock, &QLocalSocket::disconnected, sock, [sock, decoder, onMessage] {
+            // NtfyToast closes the pipe after the callback
+            decoder->finish(onMessage);
+            sock->deleteLater();
+        });
+        read();
     });
 
     server->listen("foo");
@@ -108,9 +117,9 @@ int main(int argc, char *argv[])
 
         auto proc = new QProcess(&app);
         proc->start("NtfyToast.exe",
-                    { "-t", "test", "-m", "message", "-pipename", server->fullServerName(), "-id",
-                      QString::number(id++), "-appId", appId, "-application",
-                      app.applicationFilePath() });
+                    { "-t", "test", "-m", "message", "-pipename", server->fullServerName(),
+                      "-pipeEncoding", "utf8", "-id", QString::number(id++), "-appId", appId,
+                      "-application", app.applicationFilePath() });
 
         int currentId = id;
         proc->connect(proc, QOverload<int>::of(&QProcess::finished), proc, [proc, currentId, &app] {
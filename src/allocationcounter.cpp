@@ -0,0 +1,87 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "allocationcounter.h"
+#include "metrics.h"
+
+#ifdef NTFYTOAST_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local AllocationCount t_allocations;
+}
+
+/*
+    The array and nothrow versions call these, aligned allocations are not counted.
+*/
+
+void *operator new(std::size_t size)
+{
+    ++t_allocations.allocations;
+    t_allocations.bytes += size;
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+AllocationCount AllocationCounter::current()
+{
+#ifdef NTFYTOAST_COUNT_ALLOCATIONS
+    return t_allocations;
+#else
+    return {};
+#endif
+}
+
+AllocationScope::AllocationScope(AllocationPath path)
+    : m_path(path), m_start(AllocationCounter::current())
+{
+}
+
+AllocationScope::~AllocationScope()
+{
+    finish();
+}
+
+void AllocationScope::finish()
+{
+    if (!AllocationCounter::enabled() || m_finished) {
+        return;
+    }
+    m_finished = true;
+    const auto now = AllocationCounter::current();
+    Metrics::instance().recordAllocations(
+            m_path, { now.allocations - m_start.allocations, now.bytes - m_start.bytes });
+}
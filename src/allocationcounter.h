@@ -0,0 +1,81 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+/*
+    Allocation counting for the paths that should stay cheap.
+
+    Built with the COUNT_ALLOCATIONS option the global operator new and delete are
+    replaced by counting versions. The counters are thread local, an AllocationScope adds
+    the allocations its thread made while it was alive to the Metrics, which export them
+    per path. Divided by the number of scopes this is the allocation budget of a path.
+    In a normal build nothing is replaced and a scope does nothing.
+*/
+
+enum class AllocationPath {
+    SplitData,
+    FormatAction,
+    ParseArguments,
+    Render,
+    Callback
+};
+
+struct AllocationCount
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+namespace AllocationCounter {
+constexpr bool enabled()
+{
+#ifdef NTFYTOAST_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+// the allocations made by the calling thread so far
+AllocationCount current();
+}
+
+class AllocationScope
+{
+public:
+    explicit AllocationScope(AllocationPath path);
+    ~AllocationScope();
+
+    AllocationScope(const AllocationScope &) = delete;
+    AllocationScope &operator=(const AllocationScope &) = delete;
+
+    // records the allocations so far, later allocations are not counted
+    void finish();
+
+private:
+    AllocationPath m_path;
+    AllocationCount m_start;
+    bool m_finished = false;
+};
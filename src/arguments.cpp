@@ -0,0 +1,174 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "arguments.h"
+
+#include <ctime>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <utility>
+
+namespace {
+std::tm localTime(std::time_t time)
+{
+    std::tm tm = {};
+#ifdef _WIN32
+    localtime_s(&tm, &time);
+#else
+    localtime_r(&time, &tm);
+#endif
+    return tm;
+}
+}
+
+namespace Arguments {
+std::optional<std::chrono::milliseconds> parseDuration(std::wstring_view value)
+{
+    if (value.empty()) {
+        return {};
+    }
+
+    // parsed in place, the command line is parsed on a path without allocations
+    constexpr long long max = std::numeric_limits<long long>::max();
+    long long out = 0;
+    size_t pos = 0;
+    while (pos < value.size()) {
+        long long amount = 0;
+        const size_t start = pos;
+        for (; pos < value.size() && value[pos] >= L'0' && value[pos] <= L'9'; ++pos) {
+            const int digit = value[pos] - L'0';
+            if (amount > (max - digit) / 10) {
+                return {};
+            }
+            amount = amount * 10 + digit;
+        }
+        if (pos == start) {
+            return {};
+        }
+        const wchar_t unit = pos < value.size() ? value[pos++] : L's';
+        long long unitMs;
+        switch (unit) {
+        case L's':
+            unitMs = 1000;
+            break;
+        case L'm':
+            unitMs = 60 * 1000;
+            break;
+        case L'h':
+            unitMs = 60 * 60 * 1000;
+            break;
+        case L'd':
+            unitMs = 24 * 60 * 60 * 1000;
+            break;
+        default:
+            return {};
+        }
+        // a duration that does not fit in milliseconds is rejected like one with too many digits
+        if (amount > (max - out) / unitMs) {
+            return {};
+        }
+        out += amount * unitMs;
+    }
+    return std::chrono::milliseconds(out);
+}
+
+std::optional<std::chrono::milliseconds> parseTime(const std::wstring &value)
+{
+    // get_time stops without an error when the value ends before the format, the
+    // separators of the value tell which format it has to match completely
+    std::wstring separators;
+    for (const wchar_t c : value) {
+        if (c < L'0' || c > L'9') {
+            separators.push_back(c);
+        }
+    }
+    const std::time_t now = std::time(nullptr);
+    for (const auto &[format, formatSeparators] :
+         { std::pair(L"%Y-%m-%dT%H:%M:%S", L"--T::"), std::pair(L"%Y-%m-%dT%H:%M", L"--T:"),
+           std::pair(L"%H:%M:%S", L"::"), std::pair(L"%H:%M", L":") }) {
+        if (separators != formatSeparators) {
+            continue;
+        }
+        std::tm tm = localTime(now);
+        tm.tm_sec = 0;
+
+        std::wistringstream in(value);
+        in >> std::get_time(&tm, format);
+        if (in.fail() || in.peek() != std::wistringstream::traits_type::eof()) {
+            continue;
+        }
+
+        tm.tm_isdst = -1;
+        std::time_t out = std::mktime(&tm);
+        if (out == -1) {
+            return {};
+        }
+        // a time of day that already passed today means tomorrow
+        if (value.find(L'T') == std::wstring::npos && out <= now) {
+            out += 24 * 60 * 60;
+        }
+        return std::chrono::seconds(out);
+    }
+    return {};
+}
+
+std::wstring formatTime(const std::chrono::milliseconds &time)
+{
+    const std::tm tm = localTime(std::chrono::duration_cast<std::chrono::seconds>(time).count());
+    std::wstringstream out;
+    out << std::put_time(&tm, L"%Y-%m-%dT%H:%M:%S");
+    return out.str();
+}
+
+bool isTagPattern(std::wstring_view value)
+{
+    return value.find_first_of(L"*?") != std::wstring_view::npos;
+}
+
+bool matchesTagPattern(std::wstring_view pattern, std::wstring_view tag)
+{
+    // greedy with backtracking to the last *, linear in the common cases
+    size_t p = 0;
+    size_t t = 0;
+    size_t star = std::wstring_view::npos;
+    size_t starTag = 0;
+    while (t < tag.size()) {
+        if (p < pattern.size() && (pattern[p] == L'?' || pattern[p] == tag[t])) {
+            ++p;
+            ++t;
+        } else if (p < pattern.size() && pattern[p] == L'*') {
+            star = p++;
+            starTag = t;
+        } else if (star != std::wstring_view::npos) {
+            p = star + 1;
+            t = ++starTag;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == L'*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+}
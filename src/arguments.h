@@ -0,0 +1,61 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/*
+    Values of the command line of ntfytoast that are more than a plain string.
+
+    Durations are given as a sequence of numbers with a unit
+        90      90 seconds
+        90s     90 seconds
+        5m      5 minutes
+        1h30m   1 hour and 30 minutes
+        2d      2 days
+
+    Points in time are given in local time
+        HH:MM[:SS]                  the next time the clock shows this time
+        YYYY-MM-DDTHH:MM[:SS]       a specific date
+
+    and returned as time since the epoch of the system clock, like TimerWheel::systemClock.
+
+    Tags given to -close may be patterns, * matches any sequence of characters and ? a
+    single one
+        build-*     every tag starting with build-
+        job-??      job-01 but not job-1
+*/
+
+namespace Arguments {
+std::optional<std::chrono::milliseconds> parseDuration(std::wstring_view value);
+std::optional<std::chrono::milliseconds> parseTime(const std::wstring &value);
+
+// YYYY-MM-DDTHH:MM:SS in local time, accepted by parseTime
+std::wstring formatTime(const std::chrono::milliseconds &time);
+
+bool isTagPattern(std::wstring_view value);
+bool matchesTagPattern(std::wstring_view pattern, std::wstring_view tag);
+}
@@ -0,0 +1,187 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "callbackformat.h"
+#include "allocationcounter.h"
+#include "callbacksink.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+namespace {
+constexpr size_t TimestampDigits = 20;
+
+std::wstring_view formatTimestamp(wchar_t (&digits)[TimestampDigits],
+                                  std::chrono::steady_clock::time_point time)
+{
+    const auto ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+    size_t start = std::size(digits);
+    auto value = static_cast<uint64_t>(std::max<decltype(ms)>(ms, 0));
+    do {
+        digits[--start] = static_cast<wchar_t>(L'0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    return std::wstring_view(digits + start, std::size(digits) - start);
+}
+}
+
+namespace CallbackFormat {
+void appendField(std::wstring &out, std::wstring_view key, std::wstring_view value)
+{
+    // empty values are skipped, the consumer reads a missing field as empty
+    if (!value.empty()) {
+        out.append(key);
+        out.push_back(L'=');
+        out.append(value);
+        out.push_back(L';');
+    }
+}
+
+void appendListItem(std::wstring &list, std::wstring_view item)
+{
+    if (!list.empty()) {
+        list.push_back(L',');
+    }
+    list.append(item);
+}
+
+void appendTimestamp(std::wstring &out, std::wstring_view key,
+                     std::chrono::steady_clock::time_point time)
+{
+    wchar_t digits[TimestampDigits];
+    appendField(out, key, formatTimestamp(digits, time));
+}
+
+std::wstring timestamp(std::chrono::steady_clock::time_point time)
+{
+    wchar_t digits[TimestampDigits];
+    return std::wstring(formatTimestamp(digits, time));
+}
+
+std::unordered_map<std::wstring_view, std::wstring_view> splitData(std::wstring_view data)
+{
+    const AllocationScope scope(AllocationPath::SplitData);
+    std::unordered_map<std::wstring_view, std::wstring_view> out;
+    size_t start = 0;
+    for (size_t end = data.find(L";", start); end != std::wstring::npos;
+        start = end + 1, end = data.find(L";", start)) {
+
+        if (start == end) {
+            end = data.size();
+        }
+
+        const std::wstring_view tmp(data.data() + start, end - start);
+        const auto pos = tmp.find(L"=");
+
+        if (pos > 0) {
+            out[tmp.substr(0, pos)] = tmp.substr(pos + 1);
+        }
+    }
+    return out;
+}
+
+bool notifies(const std::vector<NtfyToastActions::Actions> &notifiedActions,
+              NtfyToastActions::Actions action)
+{
+    return notifiedActions.empty()
+            || std::find(notifiedActions.cbegin(), notifiedActions.cend(), action)
+            != notifiedActions.cend();
+}
+
+void appendAction(std::wstring &out, NtfyToastActions::Actions action, std::wstring_view prefix,
+                  std::wstring_view submittedAt, std::chrono::steady_clock::rep shownAtTicks,
+                  ActionData extraData, bool callback)
+{
+    const auto &name = NtfyToastActions::getActionString(action);
+
+    // reserve once, the data is appended in place. "action=" and ';', a timestamp field
+    // takes up to 32 characters
+    size_t size = out.size() + name.size() + prefix.size() + 8 + (callback ? 3 : 1) * 32;
+    for (const auto &p : extraData) {
+        size += p.first.size() + p.second.size() + 2;
+    }
+    out.reserve(size);
+
+    appendField(out, L"action", name);
+    out.append(prefix);
+    appendField(out, L"submittedAt", submittedAt);
+    if (callback) {
+        if (shownAtTicks != 0) {
+            appendTimestamp(out, L"shownAt",
+                            std::chrono::steady_clock::time_point(
+                                    std::chrono::steady_clock::duration(shownAtTicks)));
+        }
+        appendTimestamp(out, L"actedAt", std::chrono::steady_clock::now());
+    }
+    for (const auto &p : extraData) {
+        appendField(out, p.first, p.second);
+    }
+}
+}
+
+ToastCallbackFormatter::ToastCallbackFormatter(
+        std::wstring id, std::wstring actionPrefix, std::wstring submittedAt,
+        std::vector<NtfyToastActions::Actions> notifiedActions, bool fallbackMode)
+    : m_id(std::move(id)),
+      m_actionPrefix(std::move(actionPrefix)),
+      m_submittedAt(std::move(submittedAt)),
+      m_notifiedActions(std::move(notifiedActions)),
+      m_fallbackMode(fallbackMode)
+{
+}
+
+const std::wstring &ToastCallbackFormatter::id() const
+{
+    return m_id;
+}
+
+bool ToastCallbackFormatter::fallbackMode() const
+{
+    return m_fallbackMode;
+}
+
+bool ToastCallbackFormatter::notifies(NtfyToastActions::Actions action) const
+{
+    return CallbackFormat::notifies(m_notifiedActions, action);
+}
+
+void ToastCallbackFormatter::setShownAt(std::chrono::steady_clock::time_point shownAt)
+{
+    m_shownAtTicks.store(shownAt.time_since_epoch().count(), std::memory_order_release);
+}
+
+std::wstring ToastCallbackFormatter::formatAction(NtfyToastActions::Actions action) const
+{
+    const AllocationScope scope(AllocationPath::FormatAction);
+    std::wstring out;
+    CallbackFormat::appendAction(out, action, m_actionPrefix, m_submittedAt,
+                                 m_shownAtTicks.load(std::memory_order_acquire), {}, true);
+    return out;
+}
+
+bool ToastCallbackFormatter::write(NtfyToastActions::Actions action, CallbackSink &sink) const
+{
+    const AllocationScope scope(AllocationPath::Callback);
+    return !notifies(action) || sink.write(formatAction(action));
+}
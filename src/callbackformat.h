@@ -0,0 +1,114 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "ntfytoastactions.h"
+
+#include <atomic>
+#include <chrono>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class CallbackSink;
+
+/*
+    The data of an action, a list of key=value; fields. It is the launch or action argument
+    of the toast xml, and with the timestamps added the callback written to the consumer.
+
+    Fields with an empty value are left out. Everything is appended in place after a single
+    reserve, timestamps are formatted on the stack, so formatting a callback only allocates
+    the returned string.
+*/
+
+namespace CallbackFormat {
+using ActionData = std::initializer_list<std::pair<std::wstring_view, std::wstring_view>>;
+
+void appendField(std::wstring &out, std::wstring_view key, std::wstring_view value);
+// a comma separated list, the items must not contain ',' or ';'
+void appendListItem(std::wstring &list, std::wstring_view item);
+
+/**
+ * Milliseconds on the monotonic clock of the system, comparable between processes
+ * until the next reboot. Times before the epoch of the clock are written as 0.
+ */
+void appendTimestamp(std::wstring &out, std::wstring_view key,
+                     std::chrono::steady_clock::time_point time);
+// the value of appendTimestamp() alone
+std::wstring timestamp(std::chrono::steady_clock::time_point time);
+
+// the fields of data by key, the views point into data
+std::unordered_map<std::wstring_view, std::wstring_view> splitData(std::wstring_view data);
+
+// an empty list notifies every action
+bool notifies(const std::vector<NtfyToastActions::Actions> &notifiedActions,
+              NtfyToastActions::Actions action);
+
+/**
+ * The action field, the prefix shared by all actions of a toast, submittedAt and the extra
+ * fields. A callback also carries shownAt, if shownAtTicks is not 0, and actedAt.
+ */
+void appendAction(std::wstring &out, NtfyToastActions::Actions action, std::wstring_view prefix,
+                  std::wstring_view submittedAt, std::chrono::steady_clock::rep shownAtTicks,
+                  ActionData extraData, bool callback);
+}
+
+/*
+    What the events of a shown toast need to report back, copied from the NtfyToasts when
+    the toast is shown. The events arrive on threads of the notification platform and may
+    arrive after the NtfyToasts is gone, e.g. with -nowait, or while it is reconfigured for
+    the next toast.
+*/
+
+class ToastCallbackFormatter
+{
+public:
+    ToastCallbackFormatter(std::wstring id, std::wstring actionPrefix, std::wstring submittedAt,
+                           std::vector<NtfyToastActions::Actions> notifiedActions,
+                           bool fallbackMode);
+
+    const std::wstring &id() const;
+    bool fallbackMode() const;
+    bool notifies(NtfyToastActions::Actions action) const;
+    void setShownAt(std::chrono::steady_clock::time_point shownAt);
+
+    // see NtfyToasts::formatAction
+    std::wstring formatAction(NtfyToastActions::Actions action) const;
+
+    /**
+     * Writes the callback of action to sink, unless the consumer did not ask for it.
+     * Returns false if the sink failed.
+     */
+    bool write(NtfyToastActions::Actions action, CallbackSink &sink) const;
+
+private:
+    const std::wstring m_id;
+    const std::wstring m_actionPrefix;
+    const std::wstring m_submittedAt;
+    const std::vector<NtfyToastActions::Actions> m_notifiedActions;
+    const bool m_fallbackMode;
+    std::atomic<std::chrono::steady_clock::rep> m_shownAtTicks { 0 };
+};
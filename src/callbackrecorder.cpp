@@ -0,0 +1,337 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "callbackrecorder.h"
+#include "ntfytoastconsumer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr char LOG_MAGIC[8] = { 'N', 'T', 'C', 'B', 'L', 'O', 'G', 1 };
+// larger records are malformed, a callback is a few hundred bytes
+constexpr uint64_t MAX_RECORD = 16 * 1024 * 1024;
+
+bool parseVarint(const char *&p, const char *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && p != end; shift += 7) {
+        const auto byte = static_cast<uint8_t>(*p++);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void appendVarint(std::string &out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint64_t microseconds(std::chrono::steady_clock::duration duration)
+{
+    const auto out = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    return out > 0 ? static_cast<uint64_t>(out) : 0;
+}
+
+std::shared_ptr<CallbackRecorder> &processRecorder()
+{
+    static std::shared_ptr<CallbackRecorder> recorder;
+    return recorder;
+}
+
+#ifdef _WIN32
+class FileLock
+{
+public:
+    explicit FileLock(void *file) : m_file(file)
+    {
+        OVERLAPPED overlapped {};
+        LockFileEx(m_file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped);
+    }
+
+    ~FileLock()
+    {
+        OVERLAPPED overlapped {};
+        UnlockFileEx(m_file, 0, MAXDWORD, MAXDWORD, &overlapped);
+    }
+
+private:
+    void *m_file;
+};
+#else
+class FileLock
+{
+public:
+    explicit FileLock(int file) : m_file(file) { flock(m_file, LOCK_EX); }
+    ~FileLock() { flock(m_file, LOCK_UN); }
+
+private:
+    int m_file;
+};
+#endif
+}
+
+std::shared_ptr<CallbackRecorder> CallbackRecorder::instance()
+{
+    return std::atomic_load(&processRecorder());
+}
+
+void CallbackRecorder::setInstance(std::shared_ptr<CallbackRecorder> recorder)
+{
+    std::atomic_store(&processRecorder(), std::move(recorder));
+}
+
+CallbackRecorder::CallbackRecorder(const std::filesystem::path &path)
+{
+    if (path.has_parent_path()) {
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+    }
+#ifdef _WIN32
+    const HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    m_file = file;
+    const FileLock lock(m_file);
+    LARGE_INTEGER size;
+    const bool empty = GetFileSizeEx(m_file, &size) && size.QuadPart == 0;
+#else
+    m_file = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (m_file < 0) {
+        return;
+    }
+    const FileLock lock(m_file);
+    struct stat info;
+    const bool empty = fstat(m_file, &info) == 0 && info.st_size == 0;
+#endif
+    // another process may have created the file, only the first one writes the magic
+    if (empty && !write(std::string(LOG_MAGIC, sizeof(LOG_MAGIC)))) {
+#ifdef _WIN32
+        CloseHandle(m_file);
+        m_file = nullptr;
+#else
+        close(m_file);
+        m_file = -1;
+#endif
+    }
+}
+
+CallbackRecorder::~CallbackRecorder()
+{
+#ifdef _WIN32
+    if (m_file) {
+        CloseHandle(m_file);
+    }
+#else
+    if (m_file >= 0) {
+        close(m_file);
+    }
+#endif
+}
+
+bool CallbackRecorder::isOpen() const
+{
+#ifdef _WIN32
+    return m_file != nullptr;
+#else
+    return m_file >= 0;
+#endif
+}
+
+bool CallbackRecorder::record(const std::wstring &pipe, const std::wstring &data,
+                              PipeEncoding encoding, bool delivered, Clock::time_point start,
+                              Clock::duration writeTime)
+{
+    if (!isOpen()) {
+        return false;
+    }
+    const bool samePipe = NtfyToastConsumer::CallbackMessage<wchar_t>(data).value("pipe") == pipe;
+    uint8_t flags = 0;
+    flags |= encoding == PipeEncoding::Utf8 ? Utf8Encoding : 0;
+    flags |= delivered ? Delivered : 0;
+    flags |= samePipe ? SamePipe : 0;
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_body.clear();
+    appendVarint(m_body, microseconds(start.time_since_epoch()));
+    appendVarint(m_body, microseconds(writeTime));
+    m_body.push_back(static_cast<char>(flags));
+    if (!samePipe) {
+        const auto name = Utf8::fromWide(pipe);
+        appendVarint(m_body, name.size());
+        m_body.append(name);
+    }
+    m_body.append(Utf8::fromWide(data));
+
+    m_record.clear();
+    appendVarint(m_record, m_body.size());
+    m_record.append(m_body);
+    const FileLock lock(m_file);
+    if (!write(m_record)) {
+        return false;
+    }
+    ++m_recorded;
+    return true;
+}
+
+uint64_t CallbackRecorder::recorded() const
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_recorded;
+}
+
+// the file must be locked
+bool CallbackRecorder::write(const std::string &bytes)
+{
+#ifdef _WIN32
+    LARGE_INTEGER end {};
+    if (!SetFilePointerEx(m_file, end, nullptr, FILE_END)) {
+        return false;
+    }
+    DWORD written = 0;
+    return WriteFile(m_file, bytes.data(), static_cast<DWORD>(bytes.size()), &written, nullptr)
+            && written == bytes.size();
+#else
+    return ::write(m_file, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size());
+#endif
+}
+
+CallbackRecording::CallbackRecording(const std::filesystem::path &path)
+{
+#ifdef _WIN32
+    m_file = _wfopen(path.c_str(), L"rb");
+#else
+    m_file = std::fopen(path.c_str(), "rb");
+#endif
+    if (m_file && !(fill(sizeof(LOG_MAGIC))
+                    && std::memcmp(m_buffer.data(), LOG_MAGIC, sizeof(LOG_MAGIC)) == 0)) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    m_position = sizeof(LOG_MAGIC);
+}
+
+CallbackRecording::~CallbackRecording()
+{
+    if (m_file) {
+        std::fclose(m_file);
+    }
+}
+
+bool CallbackRecording::isOpen() const
+{
+    return m_file != nullptr;
+}
+
+bool CallbackRecording::next(Callback &callback)
+{
+    // nothing left is the regular end of the log
+    if (!m_file || m_truncated || !fill(1)) {
+        return false;
+    }
+    uint64_t size = 0;
+    if (!readVarint(size) || size == 0 || size > MAX_RECORD
+        || !fill(static_cast<size_t>(size))) {
+        m_truncated = true;
+        return false;
+    }
+    const char *p = m_buffer.data() + m_position;
+    const char *const end = p + size;
+    m_position += static_cast<size_t>(size);
+
+    uint64_t time = 0;
+    uint64_t writeTime = 0;
+    uint64_t pipeSize = 0;
+    if (!parseVarint(p, end, time) || !parseVarint(p, end, writeTime) || p == end) {
+        m_truncated = true;
+        return false;
+    }
+    const auto flags = static_cast<uint8_t>(*p++);
+    const bool samePipe = flags & CallbackRecorder::SamePipe;
+    if (!samePipe && (!parseVarint(p, end, pipeSize) || pipeSize > uint64_t(end - p))) {
+        m_truncated = true;
+        return false;
+    }
+    callback.time = std::chrono::microseconds(time);
+    callback.writeTime = std::chrono::microseconds(writeTime);
+    callback.encoding =
+            flags & CallbackRecorder::Utf8Encoding ? PipeEncoding::Utf8 : PipeEncoding::Utf16;
+    callback.delivered = flags & CallbackRecorder::Delivered;
+    callback.pipe.assign(p, static_cast<size_t>(pipeSize));
+    p += pipeSize;
+    callback.data.assign(p, end);
+    if (samePipe) {
+        callback.pipe = NtfyToastConsumer::CallbackMessage<char>(callback.data).value("pipe");
+    }
+    return true;
+}
+
+bool CallbackRecording::truncated() const
+{
+    return m_truncated;
+}
+
+// makes sure size bytes are buffered from the current position on
+bool CallbackRecording::fill(size_t size)
+{
+    if (m_buffer.size() - m_position >= size) {
+        return true;
+    }
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_position);
+    m_position = 0;
+    const size_t have = m_buffer.size();
+    const size_t want = std::max<size_t>(size, 64 * 1024);
+    m_buffer.resize(have + want);
+    const size_t read = std::fread(m_buffer.data() + have, 1, want, m_file);
+    m_buffer.resize(have + read);
+    return m_buffer.size() >= size;
+}
+
+bool CallbackRecording::readVarint(uint64_t &value)
+{
+    // a varint has at most 10 bytes, the end of the file may come first
+    fill(10);
+    const char *p = m_buffer.data() + m_position;
+    if (!parseVarint(p, m_buffer.data() + m_buffer.size(), value)) {
+        return false;
+    }
+    m_position = static_cast<size_t>(p - m_buffer.data());
+    return true;
+}
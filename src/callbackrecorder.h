@@ -0,0 +1,143 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "utf8.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+    A log of the callbacks written to the consumer pipes, to replay real traffic against a
+    consumer, see tools/replay.
+
+    The file starts with the 8 byte magic "NTCBLOG" and a version byte, followed by records
+    of the form
+        varint  size of the rest of the record
+        varint  time the write started, microseconds of the steady clock
+        varint  microseconds the write took
+        uint8   flags, see Flag
+        varint  length of the pipe name, followed by the name, both only without SamePipe
+        data    the rest of the record
+    Varints are LEB128, strings are UTF-8 and the data is stored in UTF-8 whatever the pipe
+    encoding was.
+
+    The steady clock runs since boot on Windows and Linux, the times of several processes
+    recording to the same file can be compared. Each record is written in one go while the
+    file is locked, their order follows the end of the writes, so the times of concurrent
+    writers may be slightly out of order. A record torn by a full disk ends the log.
+*/
+
+class CallbackRecorder
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Flag : uint8_t {
+        Utf8Encoding = 0x1,
+        Delivered = 0x2,
+        // the pipe is the pipe field of the data and not stored separately
+        SamePipe = 0x4
+    };
+
+    /**
+     * Records the callbacks written by Utils::writePipe, none by default.
+     */
+    static std::shared_ptr<CallbackRecorder> instance();
+    static void setInstance(std::shared_ptr<CallbackRecorder> recorder);
+
+    // appends to an existing log
+    explicit CallbackRecorder(const std::filesystem::path &path);
+    ~CallbackRecorder();
+
+    CallbackRecorder(const CallbackRecorder &) = delete;
+    CallbackRecorder &operator=(const CallbackRecorder &) = delete;
+
+    bool isOpen() const;
+
+    bool record(const std::wstring &pipe, const std::wstring &data, PipeEncoding encoding,
+                bool delivered, Clock::time_point start, Clock::duration writeTime);
+
+    uint64_t recorded() const;
+
+private:
+    bool write(const std::string &bytes);
+
+    mutable std::mutex m_mutex;
+    std::string m_record;
+    std::string m_body;
+    uint64_t m_recorded = 0;
+#ifdef _WIN32
+    void *m_file = nullptr;
+#else
+    int m_file = -1;
+#endif
+};
+
+/*
+    Reads a log written by CallbackRecorder.
+*/
+
+class CallbackRecording
+{
+public:
+    struct Callback
+    {
+        std::chrono::microseconds time;
+        std::chrono::microseconds writeTime;
+        PipeEncoding encoding = PipeEncoding::Utf16;
+        bool delivered = false;
+        std::string pipe;
+        std::string data;
+    };
+
+    explicit CallbackRecording(const std::filesystem::path &path);
+    ~CallbackRecording();
+
+    CallbackRecording(const CallbackRecording &) = delete;
+    CallbackRecording &operator=(const CallbackRecording &) = delete;
+
+    // false if the file could not be opened or is no callback log
+    bool isOpen() const;
+
+    // false at the end of the log
+    bool next(Callback &callback);
+
+    // the log ends with an incomplete or malformed record
+    bool truncated() const;
+
+private:
+    bool fill(size_t size);
+    bool readVarint(uint64_t &value);
+
+    FILE *m_file = nullptr;
+    std::vector<char> m_buffer;
+    size_t m_position = 0;
+    bool m_truncated = false;
+};
@@ -0,0 +1,242 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "callbacksink.h"
+#include "callbackformat.h"
+#include "ntfytoastconsumer.h"
+#include "utf8.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include "callbackrecorder.h"
+#include "utils.h"
+
+#include <chrono>
+#endif
+
+namespace {
+void appendJsonString(std::wstring &out, std::wstring_view value)
+{
+    static constexpr wchar_t hex[] = L"0123456789abcdef";
+    out.push_back(L'"');
+    for (const wchar_t c : value) {
+        switch (c) {
+        case L'"':
+            out.append(L"\\\"");
+            break;
+        case L'\\':
+            out.append(L"\\\\");
+            break;
+        case L'\n':
+            out.append(L"\\n");
+            break;
+        case L'\r':
+            out.append(L"\\r");
+            break;
+        case L'\t':
+            out.append(L"\\t");
+            break;
+        default:
+            if (static_cast<uint32_t>(c) < 0x20) {
+                out.append(L"\\u00");
+                out.push_back(hex[(c >> 4) & 0xf]);
+                out.push_back(hex[c & 0xf]);
+            } else {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back(L'"');
+}
+}
+
+namespace CallbackFilter {
+bool apply(const std::wstring &data, std::wstring &out)
+{
+    using Message = NtfyToastConsumer::CallbackMessage<wchar_t>;
+    const Message message(data);
+    const auto notify = message.value("notify");
+    const auto fields = message.value("fields");
+    if (notify.empty() && fields.empty()) {
+        out = data;
+        return true;
+    }
+
+    const auto contains = [](std::wstring_view list, std::wstring_view item) {
+        for (size_t start = 0; start <= list.size();) {
+            const size_t end = std::min(list.find(L',', start), list.size());
+            if (list.substr(start, end - start) == item) {
+                return true;
+            }
+            start = end + 1;
+        }
+        return false;
+    };
+    if (!notify.empty() && !contains(notify, message.value("action"))) {
+        return false;
+    }
+
+    out.clear();
+    out.reserve(data.size());
+    message.forEach([&](Message::View key, Message::View value) {
+        if (key == L"notify" || key == L"fields"
+            || (!fields.empty() && key != L"action" && !contains(fields, key))) {
+            return true;
+        }
+        out.append(key);
+        out.push_back(L'=');
+        out.append(value);
+        // the text reply is the last field and has no terminator
+        if (key != L"text") {
+            out.push_back(L';');
+        }
+        return true;
+    });
+    return true;
+}
+}
+
+JsonLinesCallbackSink::JsonLinesCallbackSink(FILE *out) : m_out(out) { }
+
+std::string JsonLinesCallbackSink::format(const std::wstring &data)
+{
+    std::wstring line;
+    line.reserve(data.size() + 64);
+    line.push_back(L'{');
+    NtfyToastConsumer::CallbackMessage<wchar_t>(data).forEach(
+            [&line](std::wstring_view key, std::wstring_view value) {
+                if (line.size() > 1) {
+                    line.push_back(L',');
+                }
+                appendJsonString(line, key);
+                line.push_back(L':');
+                appendJsonString(line, value);
+                return true;
+            });
+    line.push_back(L'}');
+    return Utf8::fromWide(line);
+}
+
+bool JsonLinesCallbackSink::write(const std::wstring &data)
+{
+    std::wstring filtered;
+    if (!CallbackFilter::apply(data, filtered)) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_line = format(filtered);
+    m_line.push_back('\n');
+    const bool written = fwrite(m_line.data(), 1, m_line.size(), m_out) == m_line.size();
+    return fflush(m_out) == 0 && written;
+}
+
+bool JsonLinesCallbackSink::usesStdout() const
+{
+    return m_out == stdout;
+}
+
+#ifdef _WIN32
+bool PipeCallbackSink::write(const std::wstring &data)
+{
+    const auto dataMap = CallbackFormat::splitData(data);
+    const auto pipe = dataMap.find(L"pipe");
+    if (pipe == dataMap.cend()) {
+        return false;
+    }
+    const auto encodingIt = dataMap.find(L"encoding");
+    const auto encoding = encodingIt != dataMap.cend() && encodingIt->second == L"utf8"
+            ? PipeEncoding::Utf8
+            : PipeEncoding::Utf16;
+    std::wstring filtered;
+    if (!CallbackFilter::apply(data, filtered)) {
+        return true;
+    }
+    const auto app = dataMap.find(L"application");
+    return Utils::writeCallback(pipe->second, filtered, encoding,
+                                app != dataMap.cend() ? app->second : std::wstring_view());
+}
+
+RingCallbackSink::RingCallbackSink(std::shared_ptr<CallbackSink> fallback)
+    : m_fallback(std::move(fallback))
+{
+}
+
+RingCallbackSink::~RingCallbackSink() = default;
+
+bool RingCallbackSink::write(const std::wstring &data)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const auto dataMap = CallbackFormat::splitData(data);
+    const auto pipe = dataMap.find(L"pipe");
+    if (pipe == dataMap.cend()) {
+        return m_fallback->write(data);
+    }
+    const auto encodingIt = dataMap.find(L"encoding");
+    const auto encoding = encodingIt != dataMap.cend() && encodingIt->second == L"utf8"
+            ? PipeEncoding::Utf8
+            : PipeEncoding::Utf16;
+    std::wstring filtered;
+    if (!CallbackFilter::apply(data, filtered)) {
+        return true;
+    }
+
+    bool pushed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto ring = m_rings.find(pipe->second);
+        if (ring != m_rings.end() && !ring->second->attached()) {
+            m_rings.erase(ring);
+            ring = m_rings.end();
+        }
+        // a consumer without a ring would cost a failed open per callback, it is asked again
+        // after a second
+        const auto retry = m_retryAt.find(pipe->second);
+        if (ring == m_rings.end() && (retry == m_retryAt.end() || start >= retry->second)) {
+            if (auto opened = NtfyToastConsumer::SharedRing::open(std::wstring(pipe->second))) {
+                ring = m_rings.emplace(std::wstring(pipe->second), std::move(opened)).first;
+                if (retry != m_retryAt.end()) {
+                    m_retryAt.erase(retry);
+                }
+            } else {
+                m_retryAt[std::wstring(pipe->second)] = start + std::chrono::seconds(1);
+            }
+        }
+        if (ring != m_rings.end()) {
+            if (encoding == PipeEncoding::Utf8) {
+                const std::string utf8 = Utf8::fromWide(filtered);
+                pushed = ring->second->push(utf8.data(), utf8.size());
+            } else {
+                pushed = ring->second->push(filtered.data(), filtered.size() * sizeof(wchar_t));
+            }
+        }
+    }
+    if (!pushed) {
+        return m_fallback->write(data);
+    }
+    if (const auto recorder = CallbackRecorder::instance()) {
+        recorder->record(std::wstring(pipe->second), filtered, encoding, true, start,
+                         std::chrono::steady_clock::now() - start);
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,129 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/*
+    The actions and fields a consumer asked for with -notify and -fields.
+
+    They travel in the data as notify=clicked,buttonClicked; and fields=notificationId,button;
+    so callbacks written by the activator for the Action Center are filtered like the others.
+    The action is always kept, the notify and fields fields themselves are always removed.
+*/
+
+namespace CallbackFilter {
+/**
+ * Returns false if the consumer did not ask for the action of data. Otherwise out receives
+ * the fields of data the consumer asked for, in their original order.
+ */
+bool apply(const std::wstring &data, std::wstring &out);
+}
+
+/*
+    Receives the callbacks of the toasts of this process.
+
+    The data is in the key=value; format of NtfyToasts::formatAction, a text reply is
+    appended as the last field. Sinks may be called from any thread and pass the data
+    through CallbackFilter before they write it.
+*/
+
+class CallbackSink
+{
+public:
+    virtual ~CallbackSink() = default;
+
+    virtual bool write(const std::wstring &data) = 0;
+
+    // the sink owns stdout, nothing else may be printed there
+    virtual bool usesStdout() const { return false; }
+};
+
+/*
+    Writes every callback as one JSON object per line, e.g.
+        {"action":"buttonClicked","notificationId":"42","button":"OK","version":"0.9.0"}
+
+    All values are strings, the output is UTF-8. A line is written and flushed in one go.
+*/
+
+class JsonLinesCallbackSink : public CallbackSink
+{
+public:
+    explicit JsonLinesCallbackSink(FILE *out = stdout);
+
+    bool write(const std::wstring &data) override;
+    bool usesStdout() const override;
+
+    // the line written for data, without the trailing newline
+    static std::string format(const std::wstring &data);
+
+private:
+    FILE *m_out;
+    std::mutex m_mutex;
+    std::string m_line;
+};
+
+#ifdef _WIN32
+/*
+    Writes callbacks to the pipe named in their data, see Utils::writeCallback.
+    Callbacks without pipe are ignored.
+*/
+
+class PipeCallbackSink : public CallbackSink
+{
+public:
+    bool write(const std::wstring &data) override;
+};
+
+namespace NtfyToastConsumer {
+class SharedRing;
+}
+
+/*
+    Writes callbacks to the SharedRing of the consumer listening on the pipe named in their
+    data, for consumers receiving a high rate of callbacks with a RingCallbackServer.
+    If the consumer has no ring attached, or it is full, the callback goes to fallback.
+*/
+
+class RingCallbackSink : public CallbackSink
+{
+public:
+    explicit RingCallbackSink(std::shared_ptr<CallbackSink> fallback);
+    ~RingCallbackSink() override;
+
+    bool write(const std::wstring &data) override;
+
+private:
+    std::shared_ptr<CallbackSink> m_fallback;
+    std::mutex m_mutex;
+    // the rings stay mapped, a consumer that restarts attaches to the same memory
+    std::map<std::wstring, std::unique_ptr<NtfyToastConsumer::SharedRing>, std::less<>> m_rings;
+    // pipes without an attached ring are not opened again before this time
+    std::map<std::wstring, std::chrono::steady_clock::time_point, std::less<>> m_retryAt;
+};
+#endif
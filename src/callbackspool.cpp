@@ -0,0 +1,527 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "callbackspool.h"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr uint32_t SPOOL_MAGIC = 0x4c4f4f50; // "POOL"
+constexpr uint32_t RECORD_MAGIC = 0x44524345; // "ECRD"
+constexpr uint32_t SPOOL_VERSION = 1;
+// the records start after the header
+constexpr uint64_t DATA_OFFSET = 64;
+
+enum RecordState : uint32_t {
+    Pending = 1,
+    Delivered = 2,
+    // the rest of the ring is unused, the next record is at the start
+    Wrap = 3
+};
+
+uint32_t crc32(const uint8_t *data, size_t size)
+{
+    static const auto table = [] {
+        std::array<uint32_t, 256> out {};
+        for (uint32_t i = 0; i < out.size(); ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            out[i] = c;
+        }
+        return out;
+    }();
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+}
+
+uint64_t align(uint64_t size)
+{
+    return (size + 7) & ~uint64_t(7);
+}
+}
+
+struct CallbackSpool::Header
+{
+    uint32_t magic;
+    uint32_t version;
+    // size of the ring after the header
+    uint64_t capacity;
+    // the oldest record and its sequence number, headSeq == nextSeq if the spool is empty
+    uint64_t head;
+    uint64_t headSeq;
+    uint64_t tail;
+    uint64_t nextSeq;
+};
+
+/*
+    Followed by the payload:
+        uint32_t encoding
+        uint32_t length of the pipe name
+        wchar_t pipe[]
+        wchar_t data[]
+*/
+
+struct CallbackSpool::Record
+{
+    uint32_t magic;
+    uint32_t state;
+    uint64_t seq;
+    uint32_t size;
+    uint32_t crc;
+};
+
+class CallbackSpool::Lock
+{
+public:
+    explicit Lock(const CallbackSpool &spool) : m_spool(spool)
+    {
+#ifdef _WIN32
+        OVERLAPPED overlapped {};
+        LockFileEx(m_spool.m_file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped);
+#else
+        flock(m_spool.m_file, LOCK_EX);
+#endif
+    }
+
+    ~Lock()
+    {
+#ifdef _WIN32
+        OVERLAPPED overlapped {};
+        UnlockFileEx(m_spool.m_file, 0, MAXDWORD, MAXDWORD, &overlapped);
+#else
+        flock(m_spool.m_file, LOCK_UN);
+#endif
+    }
+
+private:
+    const CallbackSpool &m_spool;
+};
+
+std::filesystem::path CallbackSpool::defaultPath()
+{
+#ifdef _WIN32
+    wchar_t base[MAX_PATH];
+    const std::filesystem::path dir = GetEnvironmentVariableW(L"LOCALAPPDATA", base, MAX_PATH) > 0
+            ? std::filesystem::path(base)
+            : std::filesystem::temp_directory_path();
+#else
+    const char *base = std::getenv("HOME");
+    const std::filesystem::path dir = base ? std::filesystem::path(base) / ".cache"
+                                           : std::filesystem::temp_directory_path();
+#endif
+    return dir / "ntfytoast" / "callbacks.spool";
+}
+
+bool CallbackSpool::hasPending(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    Header h {};
+    if (!file.read(reinterpret_cast<char *>(&h), sizeof(h))) {
+        return false;
+    }
+    // a header torn by a concurrent append errs on the side of opening the spool
+    return h.magic != SPOOL_MAGIC || h.version != SPOOL_VERSION || h.headSeq != h.nextSeq;
+}
+
+CallbackSpool::CallbackSpool(const std::filesystem::path &path, size_t capacity)
+{
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+#ifdef _WIN32
+    const HANDLE file =
+            CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    m_file = file;
+#else
+    m_file = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (m_file < 0) {
+        return;
+    }
+#endif
+
+    const Lock lock(*this);
+    if (map(capacity)) {
+        recover();
+    }
+}
+
+CallbackSpool::~CallbackSpool()
+{
+    unmap();
+#ifdef _WIN32
+    if (m_file) {
+        CloseHandle(m_file);
+    }
+#else
+    if (m_file >= 0) {
+        close(m_file);
+    }
+#endif
+}
+
+bool CallbackSpool::isOpen() const
+{
+    return m_header != nullptr;
+}
+
+bool CallbackSpool::map(size_t capacity)
+{
+    static_assert(sizeof(Header) <= DATA_OFFSET, "the header does not fit");
+    uint64_t size = 0;
+#ifdef _WIN32
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(m_file, &fileSize)) {
+        size = static_cast<uint64_t>(fileSize.QuadPart);
+    }
+#else
+    struct stat info;
+    if (fstat(m_file, &info) == 0) {
+        size = static_cast<uint64_t>(info.st_size);
+    }
+#endif
+    // a new spool, or one that was never initialised completely
+    const bool create = size <= DATA_OFFSET;
+    if (create) {
+        size = DATA_OFFSET + align(capacity);
+    }
+
+#ifdef _WIN32
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE,
+                                   static_cast<DWORD>(size >> 32), static_cast<DWORD>(size),
+                                   nullptr);
+    if (!m_mapping) {
+        return false;
+    }
+    m_header = static_cast<Header *>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+#else
+    if (create && ftruncate(m_file, static_cast<off_t>(size)) != 0) {
+        return false;
+    }
+    void *view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+    m_header = view == MAP_FAILED ? nullptr : static_cast<Header *>(view);
+#endif
+    if (!m_header) {
+        unmap();
+        return false;
+    }
+    m_size = static_cast<size_t>(size);
+
+    auto &h = *m_header;
+    if (create || h.magic != SPOOL_MAGIC || h.version != SPOOL_VERSION
+        || h.capacity != size - DATA_OFFSET) {
+        h.capacity = size - DATA_OFFSET;
+        h.head = h.tail = 0;
+        h.headSeq = h.nextSeq = 1;
+        h.version = SPOOL_VERSION;
+        h.magic = SPOOL_MAGIC;
+    }
+    return true;
+}
+
+void CallbackSpool::unmap()
+{
+#ifdef _WIN32
+    if (m_header) {
+        UnmapViewOfFile(m_header);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+#else
+    if (m_header) {
+        munmap(m_header, m_size);
+    }
+#endif
+    m_header = nullptr;
+    m_size = 0;
+}
+
+void CallbackSpool::recover()
+{
+    auto &h = *m_header;
+    uint64_t offset = h.head < h.capacity ? skipWrap(h.head) : 0;
+
+    // a torn update of the head leaves it behind headSeq, skip the consumed records
+    if (isValid(offset) && record(offset)->seq < h.headSeq) {
+        for (uint64_t seq = record(offset)->seq; seq < h.headSeq; ++seq) {
+            if (!isValid(offset) || record(offset)->seq != seq) {
+                break;
+            }
+            offset = next(offset);
+        }
+    }
+
+    uint64_t seq = h.headSeq;
+    h.head = offset;
+    while (isValid(offset) && record(offset)->seq == seq) {
+        offset = next(offset);
+        ++seq;
+    }
+    h.tail = offset;
+    h.nextSeq = seq;
+}
+
+uint8_t *CallbackSpool::data() const
+{
+    return reinterpret_cast<uint8_t *>(m_header) + DATA_OFFSET;
+}
+
+CallbackSpool::Record *CallbackSpool::record(uint64_t offset) const
+{
+    return reinterpret_cast<Record *>(data() + offset);
+}
+
+bool CallbackSpool::isValid(uint64_t offset) const
+{
+    const auto capacity = m_header->capacity;
+    if (offset % 8 != 0 || offset + sizeof(Record) > capacity) {
+        return false;
+    }
+    const auto r = record(offset);
+    if (r->magic != RECORD_MAGIC) {
+        return false;
+    }
+    if (r->state == Wrap) {
+        return r->size == 0;
+    }
+    if ((r->state != Pending && r->state != Delivered) || r->size < 8
+        || r->size > capacity - offset - sizeof(Record)) {
+        return false;
+    }
+    const auto payload = reinterpret_cast<const uint8_t *>(r + 1);
+    uint32_t pipeSize;
+    std::memcpy(&pipeSize, payload + 4, sizeof(pipeSize));
+    return pipeSize <= (r->size - 8) / sizeof(wchar_t) && crc32(payload, r->size) == r->crc;
+}
+
+uint64_t CallbackSpool::skipWrap(uint64_t offset) const
+{
+    // too little space left for a record
+    return m_header->capacity - offset < sizeof(Record) ? 0 : offset;
+}
+
+uint64_t CallbackSpool::next(uint64_t offset) const
+{
+    const auto r = record(offset);
+    if (r->state == Wrap) {
+        return 0;
+    }
+    return skipWrap(offset + align(sizeof(Record) + r->size));
+}
+
+bool CallbackSpool::reserve(uint64_t size, uint64_t &offset)
+{
+    auto &h = *m_header;
+    if (h.headSeq == h.nextSeq) {
+        h.head = h.tail = offset = 0;
+        return true;
+    }
+    if (h.tail > h.head) {
+        if (h.capacity - h.tail >= size) {
+            offset = h.tail;
+            return true;
+        }
+        if (h.head < size) {
+            return false;
+        }
+        const auto wrap = record(h.tail);
+        wrap->state = Wrap;
+        wrap->seq = h.nextSeq;
+        wrap->size = 0;
+        wrap->crc = 0;
+        wrap->magic = RECORD_MAGIC;
+        ++h.nextSeq;
+        h.tail = offset = 0;
+        return true;
+    }
+    // the tail equals the head if the ring is full
+    if (h.tail < h.head && h.head - h.tail >= size) {
+        offset = h.tail;
+        return true;
+    }
+    return false;
+}
+
+void CallbackSpool::dropHead()
+{
+    auto &h = *m_header;
+    const auto r = record(h.head);
+    if (r->state == Pending) {
+        ++m_dropped;
+    }
+    h.headSeq = r->seq + 1;
+    h.head = next(h.head);
+}
+
+void CallbackSpool::advanceHead()
+{
+    auto &h = *m_header;
+    while (h.headSeq != h.nextSeq && record(h.head)->state != Pending) {
+        dropHead();
+    }
+}
+
+bool CallbackSpool::append(const std::wstring &pipe, const std::wstring &data,
+                           PipeEncoding encoding)
+{
+    if (!isOpen()) {
+        return false;
+    }
+    const auto payloadSize = 8 + (pipe.size() + data.size()) * sizeof(wchar_t);
+    const auto size = align(sizeof(Record) + payloadSize);
+    // a wrap record has to fit behind every record
+    if (size + sizeof(Record) > m_header->capacity) {
+        return false;
+    }
+
+    const Lock lock(*this);
+    auto &h = *m_header;
+    uint64_t offset = 0;
+    while (!reserve(size, offset)) {
+        dropHead();
+    }
+
+    const auto r = record(offset);
+    auto payload = reinterpret_cast<uint8_t *>(r + 1);
+    const uint32_t fields[] = { static_cast<uint32_t>(encoding),
+                                static_cast<uint32_t>(pipe.size()) };
+    std::memcpy(payload, fields, sizeof(fields));
+    std::memcpy(payload + sizeof(fields), pipe.data(), pipe.size() * sizeof(wchar_t));
+    std::memcpy(payload + sizeof(fields) + pipe.size() * sizeof(wchar_t), data.data(),
+                data.size() * sizeof(wchar_t));
+
+    // the magic comes last, a record torn by a crash is not valid
+    r->magic = 0;
+    r->state = Pending;
+    r->seq = h.nextSeq;
+    r->size = static_cast<uint32_t>(payloadSize);
+    r->crc = crc32(payload, payloadSize);
+    r->magic = RECORD_MAGIC;
+
+    ++h.nextSeq;
+    h.tail = next(offset);
+    return true;
+}
+
+size_t CallbackSpool::deliver(const std::function<bool(const Callback &)> &deliver,
+                              const std::wstring &pipe)
+{
+    if (!isOpen()) {
+        return 0;
+    }
+    const Lock lock(*this);
+    auto &h = *m_header;
+
+    size_t delivered = 0;
+    // the order per pipe is kept, a pipe is skipped once a callback could not be delivered
+    std::unordered_set<std::wstring> failed;
+    uint64_t offset = h.head;
+    for (uint64_t seq = h.headSeq; seq != h.nextSeq; ++seq, offset = next(offset)) {
+        const auto r = record(offset);
+        if (r->state != Pending) {
+            continue;
+        }
+        const auto payload = reinterpret_cast<const uint8_t *>(r + 1);
+        uint32_t fields[2];
+        std::memcpy(fields, payload, sizeof(fields));
+
+        Callback callback;
+        callback.pipe.resize(fields[1]);
+        std::memcpy(&callback.pipe[0], payload + sizeof(fields), fields[1] * sizeof(wchar_t));
+        if ((!pipe.empty() && callback.pipe != pipe) || failed.count(callback.pipe)) {
+            continue;
+        }
+        callback.encoding = static_cast<PipeEncoding>(fields[0]);
+        callback.data.resize((r->size - sizeof(fields)) / sizeof(wchar_t) - fields[1]);
+        std::memcpy(&callback.data[0],
+                    payload + sizeof(fields) + fields[1] * sizeof(wchar_t),
+                    callback.data.size() * sizeof(wchar_t));
+
+        if (deliver(callback)) {
+            r->state = Delivered;
+            ++delivered;
+        } else {
+            failed.insert(callback.pipe);
+        }
+    }
+    advanceHead();
+    return delivered;
+}
+
+size_t CallbackSpool::pending()
+{
+    if (!isOpen()) {
+        return 0;
+    }
+    const Lock lock(*this);
+    const auto &h = *m_header;
+    size_t out = 0;
+    uint64_t offset = h.head;
+    for (uint64_t seq = h.headSeq; seq != h.nextSeq; ++seq, offset = next(offset)) {
+        if (record(offset)->state == Pending) {
+            ++out;
+        }
+    }
+    return out;
+}
+
+uint64_t CallbackSpool::dropped() const
+{
+    return m_dropped;
+}
+
+void CallbackSpool::flush()
+{
+    if (!isOpen()) {
+        return;
+    }
+#ifdef _WIN32
+    FlushViewOfFile(m_header, m_size);
+    FlushFileBuffers(m_file);
+#else
+    msync(m_header, m_size, MS_SYNC);
+#endif
+}
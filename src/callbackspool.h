@@ -0,0 +1,128 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "utf8.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+/*
+    Callbacks that could not be written to their pipe, kept until the consumer is back.
+
+    The spool is an append-only ring in a memory mapped file. Every record is framed with
+    its length, a sequence number and a crc32 of its payload. Nothing is flushed to disk
+    explicitly, the mapped pages survive a crash of the process and the file is checked
+    when it is opened: records are accepted from the head as long as their sequence
+    numbers follow each other and their crc matches, a torn record ends the spool.
+
+    A callback is delivered at least once. It is marked delivered after deliver() reported
+    success for it and the head moves past all delivered records. If the ring is full the
+    oldest callbacks are dropped.
+
+    Several processes may use the same file, every call locks it.
+*/
+
+class CallbackSpool
+{
+public:
+    static constexpr size_t DefaultCapacity = 1024 * 1024;
+
+    struct Callback
+    {
+        std::wstring pipe;
+        PipeEncoding encoding = PipeEncoding::Utf16;
+        std::wstring data;
+    };
+
+    // %LOCALAPPDATA%\ntfytoast\callbacks.spool, $HOME/.cache/ntfytoast/callbacks.spool elsewhere
+    static std::filesystem::path defaultPath();
+
+    /**
+     * Whether the spool at path may hold callbacks, read from its header without creating,
+     * mapping or locking the file. Cheap enough to ask before every callback, the record
+     * of an append that was interrupted by a crash is only found by opening the spool.
+     */
+    static bool hasPending(const std::filesystem::path &path = defaultPath());
+
+    /**
+     * Opens or creates the spool, the capacity of an existing spool is kept.
+     */
+    explicit CallbackSpool(const std::filesystem::path &path = defaultPath(),
+                           size_t capacity = DefaultCapacity);
+    ~CallbackSpool();
+
+    CallbackSpool(const CallbackSpool &) = delete;
+    CallbackSpool &operator=(const CallbackSpool &) = delete;
+
+    bool isOpen() const;
+
+    bool append(const std::wstring &pipe, const std::wstring &data, PipeEncoding encoding);
+
+    /**
+     * Hands the pending callbacks of pipe, of all pipes if it is empty, to deliver in the
+     * order they were spooled. Stops at the first callback deliver returns false for.
+     * Returns the number of delivered callbacks.
+     */
+    size_t deliver(const std::function<bool(const Callback &)> &deliver,
+                   const std::wstring &pipe = {});
+
+    size_t pending();
+
+    // callbacks dropped by this instance because the ring was full
+    uint64_t dropped() const;
+
+    // writes the mapped pages to disk, only needed to survive a crash of the system
+    void flush();
+
+private:
+    struct Header;
+    struct Record;
+    class Lock;
+
+    bool map(size_t capacity);
+    void unmap();
+    void recover();
+
+    uint8_t *data() const;
+    Record *record(uint64_t offset) const;
+    bool isValid(uint64_t offset) const;
+    uint64_t skipWrap(uint64_t offset) const;
+    uint64_t next(uint64_t offset) const;
+    bool reserve(uint64_t size, uint64_t &offset);
+    void dropHead();
+    void advanceHead();
+
+    Header *m_header = nullptr;
+    size_t m_size = 0;
+    uint64_t m_dropped = 0;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+};
@@ -0,0 +1,441 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "loopbackbackend.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace {
+constexpr auto ShortDuration = std::chrono::seconds(7);
+constexpr auto LongDuration = std::chrono::seconds(25);
+
+void unescape(std::wstring &value)
+{
+    static constexpr std::pair<std::wstring_view, wchar_t> entities[] = {
+        { L"&amp;", L'&' }, { L"&lt;", L'<' }, { L"&gt;", L'>' }, { L"&quot;", L'"' },
+        { L"&apos;", L'\'' }, { L"&#9;", L'\t' }, { L"&#10;", L'\n' }, { L"&#13;", L'\r' }
+    };
+    for (size_t pos = value.find(L'&'); pos != std::wstring::npos;
+         pos = value.find(L'&', pos + 1)) {
+        for (const auto &entity : entities) {
+            if (value.compare(pos, entity.first.size(), entity.first) == 0) {
+                value.replace(pos, entity.first.size(), 1, entity.second);
+                break;
+            }
+        }
+    }
+}
+
+template<typename Key>
+const Key &keyOf(const Key &key)
+{
+    return key;
+}
+
+template<typename Key, typename Value>
+const Key &keyOf(const std::pair<const Key, Value> &entry)
+{
+    return entry.first;
+}
+
+template<typename Container, typename Predicate>
+void eraseIf(Container &container, const Predicate &matches)
+{
+    for (auto it = container.begin(); it != container.end();) {
+        it = matches(keyOf(*it)) ? container.erase(it) : std::next(it);
+    }
+}
+}
+
+LoopbackBackend::Distribution LoopbackBackend::Distribution::fixed(std::chrono::microseconds value)
+{
+    Distribution out;
+    out.m_a = static_cast<double>(value.count());
+    return out;
+}
+
+LoopbackBackend::Distribution LoopbackBackend::Distribution::uniform(std::chrono::microseconds min,
+                                                                   std::chrono::microseconds max)
+{
+    Distribution out;
+    out.m_kind = Kind::Uniform;
+    out.m_a = static_cast<double>(min.count());
+    out.m_b = static_cast<double>(std::max(min, max).count());
+    return out;
+}
+
+LoopbackBackend::Distribution
+LoopbackBackend::Distribution::exponential(std::chrono::microseconds mean)
+{
+    Distribution out;
+    out.m_kind = mean.count() > 0 ? Kind::Exponential : Kind::Fixed;
+    out.m_a = static_cast<double>(mean.count());
+    return out;
+}
+
+LoopbackBackend::Distribution
+LoopbackBackend::Distribution::logNormal(std::chrono::microseconds median, double sigma)
+{
+    Distribution out;
+    out.m_kind = median.count() > 0 ? Kind::LogNormal : Kind::Fixed;
+    out.m_a = static_cast<double>(median.count());
+    out.m_b = sigma;
+    return out;
+}
+
+std::chrono::microseconds LoopbackBackend::Distribution::sample(std::mt19937_64 &random) const
+{
+    double out = m_a;
+    switch (m_kind) {
+    case Kind::Fixed:
+        break;
+    case Kind::Uniform:
+        out = std::uniform_real_distribution<double>(m_a, m_b)(random);
+        break;
+    case Kind::Exponential:
+        out = std::exponential_distribution<double>(1 / m_a)(random);
+        break;
+    case Kind::LogNormal:
+        out = std::lognormal_distribution<double>(std::log(m_a), m_b)(random);
+        break;
+    }
+    return std::chrono::microseconds(static_cast<int64_t>(out));
+}
+
+LoopbackBackend::LoopbackBackend() : LoopbackBackend(Options()) { }
+
+LoopbackBackend::LoopbackBackend(Options options)
+    : m_options(std::move(options)), m_random(m_options.seed), m_thread([this] { run(); })
+{
+}
+
+LoopbackBackend::~LoopbackBackend()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+    }
+    m_wakeup.notify_one();
+    m_thread.join();
+}
+
+bool LoopbackBackend::initializeRuntime()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_counters.runtimeInitializations == 0) {
+        ++m_counters.runtimeInitializations;
+    }
+    return true;
+}
+
+bool LoopbackBackend::registerActivator()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_counters.activatorRegistrations == 0) {
+        ++m_counters.activatorRegistrations;
+    }
+    return true;
+}
+
+bool LoopbackBackend::isRegistered(const std::wstring &appID)
+{
+    // cached per app id like the shell lookup of WinToastBackend
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_registered.insert(appID).second) {
+        ++m_counters.registrationChecks;
+    }
+    return m_options.registered;
+}
+
+ToastSetting LoopbackBackend::setting(const std::wstring &)
+{
+    return m_options.setting;
+}
+
+bool LoopbackBackend::show(const ToastRequest &request, std::shared_ptr<ToastEventSink> sink)
+{
+    std::chrono::microseconds latency;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        latency = m_options.showLatency.sample(m_random);
+    }
+    if (latency.count() > 0) {
+        std::this_thread::sleep_for(latency);
+    }
+
+    const Key key { request.appID, request.group, request.tag };
+    std::optional<Event> event;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const uint64_t serial = ++m_nextSerial;
+        // a toast with the same tag and group replaces the shown one
+        m_active[key] = { serial, std::move(sink) };
+        m_history.insert(key);
+        // one notifier per app id, like WinToastBackend keeps them
+        if (m_notifiers.insert(request.appID).second) {
+            ++m_counters.notifierCreations;
+        }
+        ++m_stats.shown;
+        event = react(request, key, serial);
+    }
+    if (event) {
+        post(std::move(*event));
+    }
+    return true;
+}
+
+std::optional<LoopbackBackend::Event>
+LoopbackBackend::react(const ToastRequest &request, const Key &key, uint64_t serial)
+{
+    const auto &xml = request.xml;
+    std::optional<std::chrono::microseconds> onScreen;
+    const auto scenario = attribute(xml, L"scenario");
+    if (scenario != L"incomingCall" && scenario != L"alarm") {
+        onScreen = attribute(xml, L"duration") == L"long" ? LongDuration : ShortDuration;
+    }
+
+    Event out;
+    out.serial = serial;
+    out.key = key;
+    const auto delay = m_options.reaction.sample(m_random);
+    const double choice = std::uniform_real_distribution<double>(0, 1)(m_random);
+
+    // the actions of the toast, a reply is the action bound to the text box
+    std::vector<std::wstring> buttons;
+    std::wstring reply;
+    for (size_t pos = xml.find(L"<action "); pos != std::wstring::npos;
+         pos = xml.find(L"<action ", pos + 1)) {
+        const size_t end = xml.find(L'>', pos);
+        const std::wstring_view element = std::wstring_view(xml).substr(pos, end - pos);
+        const auto arguments = attribute(element, L"arguments");
+        if (element.find(L"hint-inputId") != std::wstring_view::npos) {
+            reply = arguments;
+        } else {
+            buttons.push_back(arguments);
+        }
+    }
+
+    double bound = m_options.clicks;
+    if (choice < bound) {
+        out.arguments = attribute(xml, L"launch");
+    } else if (choice < (bound += m_options.buttons)) {
+        out.arguments = buttons.empty()
+                ? attribute(xml, L"launch")
+                : buttons[std::uniform_int_distribution<size_t>(0, buttons.size() - 1)(m_random)];
+    } else if (choice < (bound += m_options.replies)) {
+        out.arguments = reply.empty() ? attribute(xml, L"launch") : reply;
+    } else if (choice < (bound += m_options.dismissals)) {
+        out.reason = NtfyToastActions::Actions::Dismissed;
+    } else {
+        // ignored, an incoming call stays until it is hidden
+        if (!onScreen) {
+            return {};
+        }
+        out.reason = NtfyToastActions::Actions::Timedout;
+    }
+
+    if (onScreen && (out.reason == NtfyToastActions::Actions::Timedout || delay > *onScreen)) {
+        out.reason = NtfyToastActions::Actions::Timedout;
+        out.arguments.clear();
+        out.due = std::chrono::steady_clock::now() + scaled(*onScreen);
+    } else {
+        out.due = std::chrono::steady_clock::now() + scaled(delay);
+    }
+    return out;
+}
+
+bool LoopbackBackend::hide(const std::wstring &appID, const std::wstring &tag,
+                           const std::wstring &group)
+{
+    const Key key { appID, group, tag };
+    Event event;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_active.find(key);
+        if (it == m_active.cend()) {
+            return false;
+        }
+        event.sink = std::move(it->second.sink);
+        m_active.erase(it);
+        m_history.erase(key);
+        ++m_stats.hidden;
+    }
+    // the event arrives asynchronously, like ApplicationHidden
+    event.due = std::chrono::steady_clock::now();
+    event.key = key;
+    event.reason = NtfyToastActions::Actions::Hidden;
+    post(std::move(event));
+    return true;
+}
+
+void LoopbackBackend::openHistory()
+{
+    // counted once like the history object of WinToastBackend, the calls reuse it
+    if (m_counters.historyLookups == 0) {
+        ++m_counters.historyLookups;
+    }
+}
+
+bool LoopbackBackend::remove(const std::wstring &appID, const std::wstring &tag,
+                             const std::wstring &group)
+{
+    const Key key { appID, group, tag };
+    std::lock_guard<std::mutex> lock(m_mutex);
+    openHistory();
+    m_active.erase(key);
+    return m_history.erase(key) > 0;
+}
+
+std::vector<std::wstring> LoopbackBackend::tags(const std::wstring &appID,
+                                                const std::wstring &group)
+{
+    std::vector<std::wstring> out;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    openHistory();
+    for (const auto &key : m_history) {
+        if (std::get<0>(key) == appID && std::get<1>(key) == group) {
+            out.push_back(std::get<2>(key));
+        }
+    }
+    return out;
+}
+
+bool LoopbackBackend::removeGroup(const std::wstring &appID, const std::wstring &group)
+{
+    const auto matches = [&](const Key &key) {
+        return std::get<0>(key) == appID && std::get<1>(key) == group;
+    };
+    std::lock_guard<std::mutex> lock(m_mutex);
+    openHistory();
+    eraseIf(m_active, matches);
+    eraseIf(m_history, matches);
+    return true;
+}
+
+bool LoopbackBackend::clear(const std::wstring &appID)
+{
+    const auto matches = [&](const Key &key) { return std::get<0>(key) == appID; };
+    std::lock_guard<std::mutex> lock(m_mutex);
+    openHistory();
+    eraseIf(m_active, matches);
+    eraseIf(m_history, matches);
+    return true;
+}
+
+size_t LoopbackBackend::active() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_active.size();
+}
+
+size_t LoopbackBackend::history(const std::wstring &appID) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::count_if(m_history.cbegin(), m_history.cend(),
+                         [&](const Key &key) { return std::get<0>(key) == appID; });
+}
+
+LoopbackBackend::Stats LoopbackBackend::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::wstring LoopbackBackend::attribute(std::wstring_view xml, std::wstring_view name)
+{
+    std::wstring pattern = L" ";
+    pattern.append(name);
+    pattern.append(L"=\"");
+    const size_t start = xml.find(pattern);
+    if (start == std::wstring_view::npos) {
+        return {};
+    }
+    const size_t begin = start + pattern.size();
+    const size_t end = xml.find(L'"', begin);
+    if (end == std::wstring_view::npos) {
+        return {};
+    }
+    std::wstring out(xml.substr(begin, end - begin));
+    unescape(out);
+    return out;
+}
+
+std::chrono::steady_clock::duration LoopbackBackend::scaled(std::chrono::microseconds value) const
+{
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            value * m_options.timeScale);
+}
+
+void LoopbackBackend::post(Event event)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_events.push(std::move(event));
+    }
+    m_wakeup.notify_one();
+}
+
+void LoopbackBackend::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopped) {
+        if (m_events.empty()) {
+            m_wakeup.wait(lock);
+            continue;
+        }
+        // a copy, the queue may grow while we wait
+        const auto due = m_events.top().due;
+        if (m_wakeup.wait_until(lock, due) != std::cv_status::timeout) {
+            continue;
+        }
+        Event event = m_events.top();
+        m_events.pop();
+
+        if (!event.sink) {
+            // the toast might have been hidden, removed or replaced in the meantime
+            const auto it = m_active.find(event.key);
+            if (it == m_active.cend() || it->second.serial != event.serial) {
+                continue;
+            }
+            event.sink = std::move(it->second.sink);
+            m_active.erase(it);
+            if (event.reason == NtfyToastActions::Actions::Timedout) {
+                // it moves to the Action Center
+                ++m_stats.timedOut;
+            } else {
+                m_history.erase(event.key);
+                ++(event.arguments.empty() ? m_stats.dismissed : m_stats.activated);
+            }
+        }
+
+        lock.unlock();
+        if (event.reason == NtfyToastActions::Actions::Clicked) {
+            event.sink->activated(event.arguments);
+        } else {
+            event.sink->dismissed(event.reason);
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,185 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "toastbackend.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+/*
+    ToastBackend that simulates the notification platform in memory.
+
+    A shown toast stays on screen for 7 seconds, 25 with duration="long", incoming calls
+    until they are hidden. A simulated user reacts to it after a delay drawn from the
+    reaction distribution: clicks it, presses one of its buttons, replies in its text box
+    or dismisses it. A toast the user does not react to in time times out. Buttons and the
+    text box are taken from the xml, the events carry the same arguments Windows would
+    pass, so the rest of the pipeline runs unchanged.
+
+    The events arrive on a thread of the backend like the WinRT events do. All random
+    choices use one seeded generator, with timeScale the whole lifecycle runs faster than
+    real time.
+*/
+
+class LoopbackBackend : public ToastBackend
+{
+public:
+    class Distribution
+    {
+    public:
+        static Distribution fixed(std::chrono::microseconds value);
+        static Distribution uniform(std::chrono::microseconds min, std::chrono::microseconds max);
+        static Distribution exponential(std::chrono::microseconds mean);
+        // a long tail, sigma is the standard deviation of the logarithm
+        static Distribution logNormal(std::chrono::microseconds median, double sigma);
+
+        std::chrono::microseconds sample(std::mt19937_64 &random) const;
+
+    private:
+        enum class Kind {
+            Fixed,
+            Uniform,
+            Exponential,
+            LogNormal
+        };
+
+        Kind m_kind = Kind::Fixed;
+        double m_a = 0;
+        double m_b = 0;
+    };
+
+    struct Options
+    {
+        // how long show() blocks, it is not scaled
+        Distribution showLatency = Distribution::fixed(std::chrono::microseconds(0));
+        // the time until the user reacts
+        Distribution reaction = Distribution::exponential(std::chrono::seconds(3));
+        // the share of the toasts per reaction, the user ignores the rest
+        double clicks = 0.3;
+        double buttons = 0.2;
+        double replies = 0.1;
+        double dismissals = 0.3;
+        // 1 is real time, with 0.01 a long toast times out after 250ms
+        double timeScale = 1;
+        uint64_t seed = 42;
+        ToastSetting setting = ToastSetting::Enabled;
+        bool registered = true;
+    };
+
+    struct Stats
+    {
+        uint64_t shown = 0;
+        uint64_t activated = 0;
+        uint64_t dismissed = 0;
+        uint64_t timedOut = 0;
+        uint64_t hidden = 0;
+    };
+
+    LoopbackBackend();
+    explicit LoopbackBackend(Options options);
+    ~LoopbackBackend() override;
+
+    bool initializeRuntime() override;
+    bool registerActivator() override;
+    bool isRegistered(const std::wstring &appID) override;
+    ToastSetting setting(const std::wstring &appID) override;
+    bool show(const ToastRequest &request, std::shared_ptr<ToastEventSink> sink) override;
+    bool hide(const std::wstring &appID, const std::wstring &tag,
+              const std::wstring &group) override;
+    bool remove(const std::wstring &appID, const std::wstring &tag,
+                const std::wstring &group) override;
+    std::vector<std::wstring> tags(const std::wstring &appID,
+                                   const std::wstring &group) override;
+    bool removeGroup(const std::wstring &appID, const std::wstring &group) override;
+    bool clear(const std::wstring &appID) override;
+
+    // toasts on screen
+    size_t active() const;
+    // toasts in the Action Center of the app id, shown ones included
+    size_t history(const std::wstring &appID) const;
+    Stats stats() const;
+
+    // the value of an attribute of the first element that has it, unescaped
+    static std::wstring attribute(std::wstring_view xml, std::wstring_view name);
+
+private:
+    using Key = std::tuple<std::wstring, std::wstring, std::wstring>;
+
+    struct Toast
+    {
+        uint64_t serial = 0;
+        std::shared_ptr<ToastEventSink> sink;
+    };
+
+    struct Event
+    {
+        std::chrono::steady_clock::time_point due;
+        uint64_t serial = 0;
+        Key key;
+        NtfyToastActions::Actions reason = NtfyToastActions::Actions::Clicked;
+        // the arguments of an activation
+        std::wstring arguments;
+        // set if the toast is already gone, e.g. for Hidden
+        std::shared_ptr<ToastEventSink> sink;
+
+        bool operator>(const Event &other) const { return due > other.due; }
+    };
+
+    std::chrono::steady_clock::duration scaled(std::chrono::microseconds value) const;
+    std::optional<Event> react(const ToastRequest &request, const Key &key, uint64_t serial);
+    void post(Event event);
+    void run();
+    // call with m_mutex held
+    void openHistory();
+
+    const Options m_options;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::mt19937_64 m_random;
+    std::map<Key, Toast> m_active;
+    std::set<Key> m_history;
+    // the app ids isRegistered() was asked for
+    std::set<std::wstring> m_registered;
+    // the app ids show() created a notifier for
+    std::set<std::wstring> m_notifiers;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> m_events;
+    uint64_t m_nextSerial = 0;
+    Stats m_stats;
+    bool m_stopped = false;
+    std::thread m_thread;
+};
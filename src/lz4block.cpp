@@ -0,0 +1,197 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "lz4block.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 65535;
+// the format requires the last 5 bytes to be literals and the last match to start 12
+// bytes before the end
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MATCH_LIMIT = 12;
+constexpr size_t HASH_BITS = 16;
+constexpr size_t MAX_CHAIN = 256;
+
+uint32_t read32(const char *p)
+{
+    uint32_t out;
+    std::memcpy(&out, p, sizeof(out));
+    return out;
+}
+
+uint32_t hash(const char *p)
+{
+    return (read32(p) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void appendLength(std::string &out, size_t length)
+{
+    for (; length >= 255; length -= 255) {
+        out.push_back(static_cast<char>(255));
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+void appendSequence(std::string &out, const char *literals, size_t literalLength,
+                    size_t offset, size_t matchLength)
+{
+    const size_t matchCode = matchLength > 0 ? matchLength - MIN_MATCH : 0;
+    out.push_back(static_cast<char>((std::min<size_t>(literalLength, 15) << 4)
+                                    | std::min<size_t>(matchCode, 15)));
+    if (literalLength >= 15) {
+        appendLength(out, literalLength - 15);
+    }
+    out.append(literals, literalLength);
+    if (matchLength == 0) {
+        return;
+    }
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (matchCode >= 15) {
+        appendLength(out, matchCode - 15);
+    }
+}
+}
+
+namespace Lz4Block {
+std::string compress(std::string_view in)
+{
+    std::string out;
+    out.reserve(in.size() / 2 + 16);
+    const char *const data = in.data();
+    const size_t size = in.size();
+
+    size_t anchor = 0;
+    if (size > MATCH_LIMIT) {
+        const size_t matchLimit = size - MATCH_LIMIT;
+        const size_t matchEnd = size - LAST_LITERALS;
+        std::vector<int64_t> head(size_t(1) << HASH_BITS, -1);
+        std::vector<int64_t> chain(size, -1);
+        const auto insert = [&](size_t pos) {
+            const auto h = hash(data + pos);
+            chain[pos] = head[h];
+            head[h] = static_cast<int64_t>(pos);
+        };
+
+        size_t pos = 0;
+        while (pos <= matchLimit) {
+            size_t bestLength = 0;
+            size_t bestOffset = 0;
+            int64_t candidate = head[hash(data + pos)];
+            for (size_t depth = 0; candidate >= 0 && depth < MAX_CHAIN;
+                 ++depth, candidate = chain[candidate]) {
+                const size_t offset = pos - static_cast<size_t>(candidate);
+                if (offset > MAX_OFFSET) {
+                    break;
+                }
+                size_t length = 0;
+                while (pos + length < matchEnd && data[candidate + length] == data[pos + length]) {
+                    ++length;
+                }
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestOffset = offset;
+                }
+            }
+            if (bestLength < MIN_MATCH) {
+                insert(pos++);
+                continue;
+            }
+            appendSequence(out, data + anchor, pos - anchor, bestOffset, bestLength);
+            for (const size_t end = pos + bestLength; pos < end; ++pos) {
+                if (pos <= matchLimit) {
+                    insert(pos);
+                }
+            }
+            anchor = pos;
+        }
+    }
+    appendSequence(out, data + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+bool decompress(std::string_view in, char *out, size_t size)
+{
+    const auto *p = reinterpret_cast<const uint8_t *>(in.data());
+    const auto *const end = p + in.size();
+    size_t written = 0;
+    const auto readLength = [&](size_t &length) {
+        uint8_t byte;
+        do {
+            if (p == end) {
+                return false;
+            }
+            byte = *p++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (p != end) {
+        const uint8_t token = *p++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(literalLength)) {
+            return false;
+        }
+        if (literalLength > static_cast<size_t>(end - p) || literalLength > size - written) {
+            return false;
+        }
+        std::memcpy(out + written, p, literalLength);
+        p += literalLength;
+        written += literalLength;
+        // the last sequence has no match
+        if (p == end) {
+            break;
+        }
+
+        if (end - p < 2) {
+            return false;
+        }
+        const size_t offset = p[0] | (size_t(p[1]) << 8);
+        p += 2;
+        size_t matchLength = token & 0xf;
+        if (matchLength == 15 && !readLength(matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (offset == 0 || offset > written || matchLength > size - written) {
+            return false;
+        }
+        // the match may overlap its own output, copy it byte by byte then
+        const char *from = out + written - offset;
+        if (offset >= matchLength) {
+            std::memcpy(out + written, from, matchLength);
+        } else {
+            for (size_t i = 0; i < matchLength; ++i) {
+                out[written + i] = from[i];
+            }
+        }
+        written += matchLength;
+    }
+    return written == size;
+}
+}
@@ -22,6 +22,7 @@
 */
 
 #include "ntfytoasts.h"
+#include "arguments.h"
 #include "config.h"
 
 #include "toasteventhandler.h"
@@ -29,7 +30,16 @@
 #include "ntfytoastactioncenterintegration.h"
 
 #include "linkhelper.h"
+#include "metrics.h"
+#include "callbacksink.h"
+#include "callbackrecorder.h"
+#include "ntfysubscriber.h"
+#include "packedresources.h"
+#include "timerwheel.h"
+#include "toastcommands.h"
 #include "utils.h"
+#include "winhttptransport.h"
+#include "wintoastbackend.h"
 
 #include <cmrc/cmrc.hpp>
 
@@ -38,15 +48,32 @@
 #include <roapi.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <vector>
 
 CMRC_DECLARE(NtfyToastResource);
 
+// the embedded resources, packed at build time
+PackedResources &resources()
+{
+    static PackedResources resources([](const std::string &name) {
+        const auto filesystem = cmrc::NtfyToastResource::get_filesystem();
+        if (!filesystem.is_file(name)) {
+            return std::string_view();
+        }
+        const auto file = filesystem.open(name);
+        return std::string_view(file.begin(), file.size());
+    });
+    return resources;
+}
+
 std::wstring getAppId(const std::wstring &pid, const std::wstring &fallbackAppID)
 {
     if (pid.empty()) {
@@ -86,35 +113,12 @@ std::wstring getAppId(const std::wstring &pid, const std::wstring &fallbackAppID
 
 void help(const std::wstring &error)
 {
-    if (!error.empty()) {
-        std::wcerr << error << std::endl;
-    } else {
-        std::wcerr << L"Welcome to NtfyToast " << NtfyToasts::version() << "." << std::endl
-                   << L"A command line application capable of creating Windows Toast notifications."
-                   << std::endl;
-    }
-    const auto filesystem = cmrc::NtfyToastResource::get_filesystem();
-    const auto help = filesystem.open("help.txt");
-    std::wcerr << help.begin() << std::endl;
+    ToastCommands::help(std::wcerr, error, Utf8::toWide(resources().open("help.txt")));
 }
 
 void version()
 {
-    std::wcerr  << std::endl
-                << std::endl
-                << L"---------------------------------------------------------------------" << std::endl
-                << L" Version ................ v" << NtfyToasts::version() << std::endl
-                << L" ToastActivatorCLSID .... " << NTFYTOAST_CALLBACK_GUID << std::endl
-                << L"---------------------------------------------------------------------" << std::endl
-                << std::endl
-                << L" Copyright 2024-2024 Aetherinox" << std::endl
-                << L" Copyright 2013-2019 Hannah von Reth <vonreth@kde.org>" << std::endl
-                << std::endl
-                << L" NtfyToast is free software: you can redistribute it and/or modify" << std::endl
-                << L" it under the terms of the GNU Lesser General Public License as published by"
-                << std::endl
-                << L" the Free Software Foundation, either version 3 of the License, or" << std::endl
-                << L" any later version." << std::endl;
+    ToastCommands::version(std::wcerr);
 }
 
 std::filesystem::path getIcon()
@@ -137,34 +141,269 @@ std::filesystem::path getIcon()
 
     if (!std::filesystem::exists(image)) {
         std::filesystem::create_directories(image.parent_path());
-        const auto filesystem = cmrc::NtfyToastResource::get_filesystem();
-        const auto img = filesystem.open("256-256-ntfytoast.png");
+        const auto img = resources().open("256-256-ntfytoast.png");
         std::ofstream out(image, std::ios::binary);
-        out.write(const_cast<char *>(img.begin()), img.size());
+        out.write(img.data(), img.size());
         out.close();
     }
     return image;
 }
 
+// quote according to the rules of CommandLineToArgvW
+std::wstring quoteArgument(const std::wstring &arg)
+{
+    std::wstring out = L"\"";
+    size_t backslashes = 0;
+    for (const wchar_t c : arg) {
+        if (c == L'\\') {
+            ++backslashes;
+        } else if (c == L'"') {
+            out.append(backslashes * 2 + 1, L'\\');
+            backslashes = 0;
+        } else {
+            out.append(backslashes, L'\\');
+            backslashes = 0;
+        }
+        if (c != L'\\') {
+            out.push_back(c);
+        }
+    }
+    out.append(backslashes * 2, L'\\');
+    out.push_back(L'"');
+    return out;
+}
+
+std::filesystem::path scheduleDir()
+{
+    return std::filesystem::temp_directory_path() / "ntfytoast" / NtfyToasts::version()
+            / "scheduled";
+}
+
+bool isProcessRunning(DWORD pid)
+{
+    const HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, false, pid);
+    if (!process) {
+        return false;
+    }
+    DWORD status = 0;
+    GetExitCodeProcess(process, &status);
+    CloseHandle(process);
+    return status == STILL_ACTIVE;
+}
+
+/*
+    Every process waiting for a scheduled display keeps a snapshot of its timers named after
+    its pid. If the process is gone, e.g. it was killed or the user logged off, the toast is
+    relaunched with its original deadline. Overdue toasts are displayed right away.
+*/
+
+void resumeScheduled()
+{
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(scheduleDir(), error)) {
+        if (entry.path().extension() != L".bin") {
+            continue;
+        }
+        const auto pid =
+                static_cast<DWORD>(std::wcstoul(entry.path().stem().c_str(), nullptr, 10));
+        if (pid == GetCurrentProcessId() || isProcessRunning(pid)) {
+            continue;
+        }
+
+        TimerWheel wheel;
+        if (wheel.load(entry.path())) {
+            for (const auto &timer : wheel.pending()) {
+                if (timer.kind == TimerWheel::Kind::Display) {
+                    tLog << L"Resuming scheduled toast of" << pid << L":" << timer.payload;
+                    Utils::startProcess(Utils::selfLocate(),
+                                        timer.payload + L" -at "
+                                                + Arguments::formatTime(timer.deadline));
+                }
+            }
+        } else {
+            tLog << L"Dropping invalid schedule:" << entry.path();
+        }
+        std::filesystem::remove(entry.path(), error);
+    }
+}
+
+/*
+    Wait until a scheduled toast is due.
+    Returns false if the toast was closed with -close <id> before it was displayed.
+*/
+
+bool waitForSchedule(const std::chrono::milliseconds &showAt, const std::wstring &id,
+                     const std::wstring &arguments)
+{
+    resumeScheduled();
+
+    TimerWheel wheel;
+    wheel.schedule(showAt, TimerWheel::Kind::Display, arguments);
+
+    std::error_code error;
+    const auto snapshot = scheduleDir() / (std::to_wstring(GetCurrentProcessId()) + L".bin");
+    std::filesystem::create_directories(snapshot.parent_path(), error);
+    if (!wheel.save(snapshot)) {
+        tLog << L"Failed to save schedule:" << snapshot;
+    }
+
+    // -close signals the same event as it does for a displayed toast
+    const std::wstring eventName =
+            L"ToastEvent" + (id.empty() ? std::to_wstring(GetCurrentProcessId()) : id);
+    const HANDLE closeEvent = CreateEventW(nullptr, true, false, eventName.c_str());
+
+    bool closed = false;
+    while (!wheel.empty() && !closed) {
+        const auto next = wheel.nextDeadline();
+        const auto timeout =
+                static_cast<DWORD>(std::max<int64_t>(0, (*next - wheel.now()).count()));
+        closed = WaitForSingleObject(closeEvent, timeout) == WAIT_OBJECT_0;
+        wheel.advance();
+    }
+
+    CloseHandle(closeEvent);
+    std::filesystem::remove(snapshot, error);
+    return !closed;
+}
+
+// records the callbacks written by this process, see Utils::writePipe
+bool startRecording(const std::filesystem::path &file)
+{
+    auto recorder = std::make_shared<CallbackRecorder>(file);
+    if (!recorder->isOpen()) {
+        tLog << L"Failed to open" << file << L"for recording";
+        return false;
+    }
+    CallbackRecorder::setInstance(std::move(recorder));
+    return true;
+}
+
+// read by the console control handler, which runs on a thread of its own
+std::atomic<NtfySubscriber *> activeSubscriber { nullptr };
+
+BOOL WINAPI stopSubscriber(DWORD)
+{
+    if (const auto subscriber = activeSubscriber.load()) {
+        subscriber->stop();
+        return true;
+    }
+    return false;
+}
+
+/*
+    Show the messages of ntfy topics until the process is stopped with Ctrl+C.
+    Every message becomes a toast set up like a toast of the command line, its id is the id
+    of the message and priority 4 and 5 messages skip the queue. The toasts have no timeout,
+    a click on a toast that stayed on screen for minutes still reaches this process.
+    More than 10 messages within 30 seconds collapse into a summary toast of the group, the
+    messages of the summary are completed together once it is clicked or dismissed.
+*/
+
+NtfyToastActions::Actions subscribe(NtfySubscriber &subscriber,
+                                    const std::shared_ptr<ToastBackend> &backend,
+                                    const std::wstring &appID, const std::filesystem::path &image,
+                                    const std::function<void(NtfyToasts &)> &configure)
+{
+    // without a registered app id only this process can report the activations
+    const bool fallback = !backend->isRegistered(appID);
+
+    ToastDispatcher::Options options;
+    options.timeout.reset();
+    options.aggregation = ToastAggregator::Policy();
+    ToastDispatcher dispatcher(backend, std::move(options));
+    dispatcher.start();
+
+    activeSubscriber = &subscriber;
+    SetConsoleCtrlHandler(stopSubscriber, true);
+
+    const bool ok = subscriber.run([&](const NtfyMessage &message) {
+        if (message.event != "message") {
+            return;
+        }
+        const auto toast = std::make_shared<NtfyToasts>(appID, backend);
+        configure(*toast);
+        toast->setId(NtfyMessage::text(message.id));
+        if (message.priority <= 2) {
+            toast->setSilent(true);
+        }
+
+        const auto topic = NtfyMessage::text(message.topic);
+        const auto title = message.title.empty() ? topic : NtfyMessage::text(message.title);
+        auto submission = toast->submission(title, NtfyMessage::text(message.message), image);
+        if (message.priority >= 4) {
+            submission.priority = SubmissionPriority::High;
+        }
+        submission.completion = [toast, fallback, click = NtfyMessage::text(message.click)](
+                                        ToastHandle, const ToastResult &result) {
+            if (result.shownAt) {
+                toast->setShownAt(*result.shownAt);
+            }
+            switch (result.action) {
+            case NtfyToastActions::Actions::Clicked:
+                if (!click.empty()) {
+                    ShellExecuteW(nullptr, L"open", click.c_str(), nullptr, nullptr,
+                                  SW_SHOWNORMAL);
+                }
+                [[fallthrough]];
+            case NtfyToastActions::Actions::ButtonClicked:
+            case NtfyToastActions::Actions::TextEntered:
+                // otherwise the activator receives the callback
+                if (fallback) {
+                    NtfyToasts::callbackSink()->write(toast->formatAction(result.action));
+                }
+                break;
+            case NtfyToastActions::Actions::Error:
+                tLog << L"No result for the message" << toast->id();
+                break;
+            default:
+                NtfyToasts::callbackSink()->write(toast->formatAction(result.action));
+            }
+        };
+        dispatcher.submit(std::move(submission));
+    });
+
+    SetConsoleCtrlHandler(stopSubscriber, false);
+    activeSubscriber = nullptr;
+    dispatcher.stop();
+    return ok ? NtfyToastActions::Actions::Clicked : NtfyToastActions::Actions::Error;
+}
+
 NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
 {
     HRESULT hr = S_OK;
 
+    // nothing is initialised until an argument needs it, -v and -h stay cheap
+    const auto backend = std::make_shared<WinToastBackend>();
+
     std::wstring appID;
     std::wstring pid;
     std::filesystem::path pipe;
+    PipeEncoding pipeEncoding = PipeEncoding::Utf16;
     std::filesystem::path application;
+    std::vector<NtfyToastActions::Actions> notifiedActions;
+    std::vector<std::wstring> callbackFields;
     std::wstring title;
     std::wstring body;
     std::filesystem::path image;
     std::wstring id;
+    std::wstring correlationId;
+    std::wstring group;
+    std::vector<std::wstring> closeIds;
+    std::wstring closeGroup;
+    std::wstring subscribeServer;
+    std::vector<std::wstring> subscribeTopics;
     std::wstring sound(L"Notification.Default");
     std::wstring buttons;
     Duration duration = Duration::Short;
+    std::optional<std::chrono::milliseconds> showAt;
+    std::optional<std::chrono::milliseconds> expireAfter;
+    std::wstring scheduledArguments;
     bool silent = false;
     bool persistent = false;
     bool closeNotify = false;
+    bool clearAll = false;
     bool isTextBoxEnabled = false;
+    bool noWait = false;
 
     auto nextArg = [&](std::vector<wchar_t *>::const_iterator &it,
                        const std::wstring &helpText) -> std::wstring {
@@ -176,8 +415,10 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
         }
     };
 
+    AllocationScope parsing(AllocationPath::ParseArguments);
     auto it = args.begin() + 1;
     while (it != args.end()) {
+        const auto argStart = it;
         std::wstring arg(nextArg(it, L""));
         std::transform(arg.begin(), arg.end(), arg.begin(),
                        [](int i) -> int { return ::tolower(i); });
@@ -255,6 +496,58 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
                 return NtfyToastActions::Actions::Error;
             }
 
+        /*
+            Argument > At
+            Display the notification at a given local time instead of right away
+
+                -at <HH:MM[:SS] || YYYY-MM-DDTHH:MM[:SS]>
+        */
+
+        } else if (arg == L"-at") {
+            const std::wstring _at = nextArg(it,
+                                             L"Missing argument to -at.\n"
+                                             L"Supply argument as -at \"HH:MM\"");
+            showAt = Arguments::parseTime(_at);
+            if (!showAt) {
+                help(_at + L" is not a valid time");
+                return NtfyToastActions::Actions::Error;
+            }
+
+        /*
+            Argument > In
+            Display the notification after a delay instead of right away
+
+                -in <duration [90s || 5m || 1h30m]>
+        */
+
+        } else if (arg == L"-in") {
+            const std::wstring _in = nextArg(it,
+                                             L"Missing argument to -in.\n"
+                                             L"Supply argument as -in \"5m\"");
+            const auto delay = Arguments::parseDuration(_in);
+            if (!delay) {
+                help(_in + L" is not a valid duration");
+                return NtfyToastActions::Actions::Error;
+            }
+            showAt = TimerWheel::systemClock() + *delay;
+
+        /*
+            Argument > Expire
+            Hide the notification if the user did not interact with it in time
+
+                -expire <duration [90s || 5m || 1h30m]>
+        */
+
+        } else if (arg == L"-expire") {
+            const std::wstring _expire = nextArg(it,
+                                                 L"Missing argument to -expire.\n"
+                                                 L"Supply argument as -expire \"5m\"");
+            expireAfter = Arguments::parseDuration(_expire);
+            if (!expireAfter) {
+                help(_expire + L" is not a valid duration");
+                return NtfyToastActions::Actions::Error;
+            }
+
         /*
             Argument > ID
             Sets id for a notification to be able to close it later
@@ -267,6 +560,35 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
                          L"Missing argument to -id.\n"
                          L"Supply argument as -id \"id\"");
 
+        /*
+            Argument > Correlation ID
+            An id of the producer, passed on in every callback of the notification
+
+                -correlationId <id>
+        */
+
+        } else if (arg == L"-correlationid") {
+            correlationId = nextArg(it,
+                                    L"Missing argument to -correlationId.\n"
+                                    L"Supply argument as -correlationId \"id\"");
+            if (correlationId.find(L';') != std::wstring::npos) {
+                help(L"-correlationId must not contain ';'");
+                return NtfyToastActions::Actions::Error;
+            }
+
+        /*
+            Argument > Group
+            Sets the group of a notification, the notifications of a group can be closed
+            together with -closeGroup
+
+                -group <group>
+        */
+
+        } else if (arg == L"-group") {
+            group = nextArg(it,
+                            L"Missing argument to -group.\n"
+                            L"Supply argument as -group \"group\"");
+
         /*
             Argument > Silent
             Disable playing sound when notification appears
@@ -287,6 +609,19 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
         } else if (arg == L"-persistent") {
             persistent = true;
 
+        /*
+            Argument > No Wait
+            Exit as soon as the notification is shown instead of waiting for the user.
+            Only activations through the Action Center are delivered to -pipeName, by the
+            registered activator. Dismissals and timeouts are reported to this process only
+            and are lost.
+
+                -nowait
+        */
+
+        } else if (arg == L"-nowait") {
+            noWait = true;
+
         /*
             Argument > App ID
             Don't create a shortcut but use the provided app id
@@ -324,6 +659,104 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
                            L"Missing argument to -pipeName.\n"
                            L"Supply argument as -pipeName \"\\.\\pipe\\foo\\\"");
 
+        /*
+            Argument > Pipe Encoding
+            Encoding of the callbacks written to -pipeName
+
+                -pipeEncoding <string [utf16 || utf8]>
+
+            utf16 is the default and writes the raw wchar_t data terminated by a null wchar_t.
+            utf8 halves the traffic for mostly ASCII data and is terminated by a null byte.
+        */
+
+        } else if (arg == L"-pipeencoding") {
+            const std::wstring encoding =
+                    nextArg(it,
+                            L"Missing argument to -pipeEncoding.\n"
+                            L"Supply argument as -pipeEncoding (utf16 | utf8)");
+            if (encoding == L"utf16") {
+                pipeEncoding = PipeEncoding::Utf16;
+            } else if (encoding == L"utf8") {
+                pipeEncoding = PipeEncoding::Utf8;
+            } else {
+                help(encoding + L" is not a valid encoding");
+                return NtfyToastActions::Actions::Error;
+            }
+
+        /*
+            Argument > Callbacks
+            Where the callbacks of the notification are written to
+
+                -callbacks <string [pipe || stdout || ring]>
+
+            pipe is the default and writes to -pipeName.
+            stdout writes every callback as one JSON object per line, so scripts can read
+            the result without a pipe server. It replaces the button name printed on click.
+            ring writes to the shared memory ring of a consumer of -pipeName that uses a
+            RingCallbackServer, and to the pipe if it has none.
+        */
+
+        } else if (arg == L"-callbacks") {
+            const std::wstring callbacks =
+                    nextArg(it,
+                            L"Missing argument to -callbacks.\n"
+                            L"Supply argument as -callbacks (pipe | stdout | ring)");
+            if (callbacks == L"pipe") {
+                NtfyToasts::setCallbackSink({});
+            } else if (callbacks == L"stdout") {
+                NtfyToasts::setCallbackSink(std::make_shared<JsonLinesCallbackSink>(stdout));
+            } else if (callbacks == L"ring") {
+                NtfyToasts::setCallbackSink(
+                        std::make_shared<RingCallbackSink>(std::make_shared<PipeCallbackSink>()));
+            } else {
+                help(callbacks + L" is not a valid callback sink");
+                return NtfyToastActions::Actions::Error;
+            }
+
+        /*
+            Argument > Notify
+            The actions written to the consumer, all of them by default
+
+                -notify <clicked,buttonClicked,textEntered>
+
+            Valid actions are clicked, hidden, dismissed, timedout, buttonClicked and
+            textEntered. Toasts still wait for the other actions, they are only not written.
+        */
+
+        } else if (arg == L"-notify") {
+            std::wstringstream actions(
+                    nextArg(it,
+                            L"Missing argument to -notify.\n"
+                            L"Supply argument as -notify \"clicked,buttonClicked\""));
+            std::wstring name;
+            while (std::getline(actions, name, L',')) {
+                const auto action = NtfyToastActions::getAction(name);
+                if (action == NtfyToastActions::Actions::Error) {
+                    help(name + L" is not a valid action");
+                    return NtfyToastActions::Actions::Error;
+                }
+                notifiedActions.push_back(action);
+            }
+
+        /*
+            Argument > Fields
+            The fields of the callbacks besides action, all of them by default
+
+                -fields <notificationId,button,text>
+        */
+
+        } else if (arg == L"-fields") {
+            std::wstringstream fields(
+                    nextArg(it,
+                            L"Missing argument to -fields.\n"
+                            L"Supply argument as -fields \"notificationId,button,text\""));
+            std::wstring field;
+            while (std::getline(fields, field, L',')) {
+                if (!field.empty()) {
+                    callbackFields.push_back(field);
+                }
+            }
+
         /*
             Argument > Application
             App to start if the pipe does not exist
@@ -336,6 +769,39 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
                                   L"Missing argument to -application.\n"
                                   L"Supply argument as -application \"C:\\foo.exe\"");
 
+        /*
+            Argument > Metrics
+            Add the counters and latency histograms of this process to a file in the
+            prometheus text format, defaults to the environment variable NTFYTOAST_METRICS
+
+                -metrics <C:\foo\ntfytoast.prom>
+        */
+
+        } else if (arg == L"-metrics") {
+            Metrics::instance().setOutputFile(
+                    nextArg(it,
+                            L"Missing argument to -metrics.\n"
+                            L"Supply argument as -metrics \"C:\\ntfytoast.prom\""));
+
+        /*
+            Argument > Record
+            Append every callback written to a pipe to a binary log, it can be replayed
+            against a consumer with ntfytoast-replay. Defaults to the environment variable
+            NTFYTOAST_RECORD, several processes may record to the same file.
+
+                -record <C:\foo\callbacks.ntcb>
+        */
+
+        } else if (arg == L"-record") {
+            const std::wstring file =
+                    nextArg(it,
+                            L"Missing argument to -record.\n"
+                            L"Supply argument as -record \"C:\\callbacks.ntcb\"");
+            if (!startRecording(file)) {
+                help(L"Failed to open " + file + L" for recording");
+                return NtfyToastActions::Actions::Error;
+            }
+
         /*
             Argument > Buttons
             Buttons - List multiple buttons separated by `;`
@@ -383,27 +849,88 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
                             L"Supply argument as -install \"path to your shortcut\" \"path to the "
                             L"application the shortcut should point to\" \"App.ID\"");
 
+            backend->initializeRuntime();
             return SUCCEEDED(LinkHelper::tryCreateShortcut(
                            shortcut, exe, appID, NtfyToastActionCenterIntegration::uuid()))
                     ? NtfyToastActions::Actions::Clicked
                     : NtfyToastActions::Actions::Error;
 
+        /*
+            Argument > Subscribe
+            Show the messages of ntfy topics until the process is stopped, several topics
+            are separated by ,
+
+                -subscribe <server> <topic>
+                -subscribe ntfy.sh "<topic>,<topic>"
+
+            All other arguments apply to every toast, -t and -m are taken from the message.
+            The last message is remembered, messages sent while not subscribed are shown on
+            the next start. A storm of messages is shown as one summary toast of the -group.
+        */
+
+        } else if (arg == L"-subscribe") {
+            subscribeServer = nextArg(it,
+                                      L"Missing argument to -subscribe.\n"
+                                      L"Supply argument as -subscribe \"ntfy.sh\" \"topic\"");
+            std::wstringstream topics(
+                    nextArg(it,
+                            L"Missing argument to -subscribe.\n"
+                            L"Supply argument as -subscribe \"ntfy.sh\" \"topic\""));
+            std::wstring topic;
+            while (std::getline(topics, topic, L',')) {
+                if (!topic.empty()) {
+                    subscribeTopics.push_back(topic);
+                }
+            }
+
         /*
             Argument > Close Notification
-            Close an existing notification.
+            Close existing notifications, several ids are separated by ;
+            All of them are closed by this process. An id with * or ? closes every
+            notification of the group whose id matches.
 
                 -close <id>
+                -close "<id>;<id>;<id>"
+                -close "build-*"
 
             Assign an ID to a notification using:
                 -id <id>
         */
 
         } else if (arg == L"-close") {
-            id = nextArg(it,
-                         L"Missing agument to -close"
-                         L"Supply argument as -close \"id\"");
+            std::wstringstream ids(nextArg(it,
+                                           L"Missing agument to -close"
+                                           L"Supply argument as -close \"id\""));
+            std::wstring closeId;
+            while (std::getline(ids, closeId, L';')) {
+                if (!closeId.empty()) {
+                    closeIds.push_back(closeId);
+                }
+            }
             closeNotify = true;
 
+        /*
+            Argument > Close Group
+            Remove all notifications of a group, see -group
+
+                -closeGroup <group>
+        */
+
+        } else if (arg == L"-closegroup") {
+            closeGroup = nextArg(it,
+                                 L"Missing argument to -closeGroup.\n"
+                                 L"Supply argument as -closeGroup \"group\"");
+
+        /*
+            Argument > Clear
+            Remove all notifications of the application id
+
+                -clear
+        */
+
+        } else if (arg == L"-clear") {
+            clearAll = true;
+
         /*
             Argument > Version
             Returns version information
@@ -436,7 +963,15 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
             help(ws.str());
             return NtfyToastActions::Actions::Error;
         }
+
+        // remember everything but the schedule, in case the toast needs to be relaunched
+        if (arg != L"-at" && arg != L"-in") {
+            for (auto a = argStart; a != it; ++a) {
+                scheduledArguments += quoteArgument(*a) + L" ";
+            }
+        }
     }
+    parsing.finish();
 
     appID = getAppId(pid, appID);
 
@@ -444,6 +979,7 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
         std::wstringstream _appID;
         _appID << L"Ntfy.DesktopToasts." << NtfyToasts::version();
         appID = _appID.str();
+        backend->initializeRuntime();
         hr = LinkHelper::tryCreateShortcut(std::filesystem::path(L"NtfyToast")
                                                    / NtfyToasts::version() / L"NtfyToast",
                                            appID, NtfyToastActionCenterIntegration::uuid());
@@ -453,15 +989,61 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
         }
     }
 
-    if (closeNotify) {
-        if (!id.empty()) {
-            NtfyToasts app(appID);
-            app.setId(id);
-            if (app.closeNotification()) {
-                return NtfyToastActions::Actions::Clicked;
-            }
+    const auto configure = [&](NtfyToasts &app) {
+        app.setPipeName(pipe);
+        app.setPipeEncoding(pipeEncoding);
+        app.setApplication(application);
+        app.setNotifiedActions(notifiedActions);
+        app.setCallbackFields(callbackFields);
+        app.setSilent(silent);
+        app.setPersistent(persistent);
+        app.setSound(sound);
+        app.setId(id);
+        app.setCorrelationId(correlationId);
+        app.setGroup(group);
+        app.setButtons(buttons);
+        app.setTextBoxEnabled(isTextBoxEnabled);
+        app.setDuration(duration);
+        if (expireAfter) {
+            app.setExpirationTime(std::chrono::system_clock::now() + *expireAfter);
+        }
+    };
+
+    if (!subscribeServer.empty()) {
+        if (subscribeTopics.empty()) {
+            help(L"-subscribe needs at least one topic.");
+            return NtfyToastActions::Actions::Error;
+        }
+        if (!pipe.empty()) {
+            Utils::deliverSpooledCallbacks(pipe);
+        }
+        NtfySubscriber::Options options;
+        options.log = [](const std::wstring &line) { tLog << line; };
+        NtfySubscriber subscriber(subscribeServer, subscribeTopics,
+                                  std::make_shared<WinHttpTransport>(), std::move(options));
+        return subscribe(subscriber, backend, appID, image.empty() ? getIcon() : image,
+                         configure);
+    } else if (closeNotify || !closeGroup.empty() || clearAll) {
+        // one instance, so the history is only opened once
+        NtfyToasts app(appID, backend);
+        app.setGroup(group);
+        bool closed = true;
+        if (clearAll) {
+            closed = app.clearNotifications();
         } else {
-            help(L"Close only works if an -id id was provided.");
+            if (!closeGroup.empty()) {
+                closed = app.closeGroup(closeGroup);
+            }
+            if (closeNotify) {
+                if (closeIds.empty()) {
+                    help(L"Close only works if an -id id was provided.");
+                    return NtfyToastActions::Actions::Error;
+                }
+                closed = app.closeNotifications(closeIds) == closeIds.size() && closed;
+            }
+        }
+        if (closed) {
+            return NtfyToastActions::Actions::Clicked;
         }
     } else {
         hr = (title.length() > 0 && body.length() > 0) ? S_OK : E_FAIL;
@@ -483,17 +1065,28 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
                 image = getIcon();
             }
 
-            NtfyToasts app(appID);
-            app.setPipeName(pipe);
-            app.setApplication(application);
-            app.setSilent(silent);
-            app.setPersistent(persistent);
-            app.setSound(sound);
-            app.setId(id);
-            app.setButtons(buttons);
-            app.setTextBoxEnabled(isTextBoxEnabled);
-            app.setDuration(duration);
-            app.displayToast(title, body, image);
+            if (showAt && !waitForSchedule(*showAt, id, scheduledArguments)) {
+                tLog << L"The scheduled toast was closed before it was displayed";
+                return NtfyToastActions::Actions::Hidden;
+            }
+
+            // the consumer is back, hand it the callbacks it missed
+            if (!pipe.empty()) {
+                Utils::deliverSpooledCallbacks(pipe);
+            }
+
+            NtfyToasts app(appID, backend);
+            configure(app);
+            hr = app.displayToast(title, body, image);
+
+            if (noWait && SUCCEEDED(hr)) {
+                // without a registered activator only this process can report back
+                if (app.useFalbackMode() && !pipe.empty()) {
+                    tLog << L"-nowait is ignored, callbacks require a registered app id";
+                } else {
+                    return NtfyToastActions::Actions::Clicked;
+                }
+            }
             return app.userAction();
         } else {
             help(L"");
@@ -504,8 +1097,48 @@ NtfyToastActions::Actions parse(std::vector<wchar_t *> args)
     return NtfyToastActions::Actions::Error;
 }
 
+// compare the footprint of waiting and -nowait processes
+void logResourceUsage()
+{
+    PROCESS_MEMORY_COUNTERS counters = {};
+    FILETIME creation, exit, kernel, user;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))
+        && GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        const auto toInt = [](const FILETIME &t) {
+            return (static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+        };
+        tLog << L"Lifetime:" << (toInt(now) - toInt(creation)) / 10000 << L"ms"
+             << L"Working set:" << counters.WorkingSetSize / 1024 << L"KiB"
+             << L"Peak working set:" << counters.PeakWorkingSetSize / 1024 << L"KiB";
+    }
+}
+
+void writeMetrics()
+{
+    auto &metrics = Metrics::instance();
+    if (metrics.outputFile().empty()) {
+        return;
+    }
+    // all ntfytoast processes add to the same file
+    const HANDLE mutex = CreateMutexW(nullptr, false, L"NtfyToastMetrics");
+    if (mutex) {
+        WaitForSingleObject(mutex, INFINITE);
+    }
+    if (!metrics.mergeInto(metrics.outputFile())) {
+        tLog << L"Failed to write metrics to:" << metrics.outputFile();
+    }
+    if (mutex) {
+        ReleaseMutex(mutex);
+        CloseHandle(mutex);
+    }
+}
+
 NtfyToastActions::Actions handleEmbedded()
 {
+    WinToastBackend backend;
+    backend.initializeRuntime();
     NtfyToasts::waitForCallbackActivation();
     return NtfyToastActions::Actions::Clicked;
 }
@@ -534,17 +1167,25 @@ int WINAPI wWinMain(HINSTANCE, HINSTANCE, wchar_t *, int)
     tLog << commandLine;
 
     NtfyToastActions::Actions action = NtfyToastActions::Actions::Clicked;
-    HRESULT hr = Windows::Foundation::Initialize(RO_INIT_MULTITHREADED);
 
-    if (SUCCEEDED(hr)) {
-        if (std::wstring(commandLine).find(L"-Embedding") != std::wstring::npos) {
-            action = handleEmbedded();
-        } else {
-            action = parse(std::vector<wchar_t *>(argv, argv + argc));
-        }
+    wchar_t metricsFile[MAX_PATH];
+    if (GetEnvironmentVariableW(L"NTFYTOAST_METRICS", metricsFile, MAX_PATH) > 0) {
+        Metrics::instance().setOutputFile(metricsFile);
+    }
 
-        Windows::Foundation::Uninitialize();
+    wchar_t recordFile[MAX_PATH];
+    if (GetEnvironmentVariableW(L"NTFYTOAST_RECORD", recordFile, MAX_PATH) > 0) {
+        startRecording(recordFile);
     }
 
+    if (std::wstring(commandLine).find(L"-Embedding") != std::wstring::npos) {
+        action = handleEmbedded();
+    } else {
+        action = parse(std::vector<wchar_t *>(argv, argv + argc));
+    }
+
+    writeMetrics();
+    logResourceUsage();
+
     return static_cast<int>(action);
 }
@@ -0,0 +1,370 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "metrics.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+// buckets exposed to prometheus, 2^7us (128us) up to 2^35us (about 9.5h)
+constexpr size_t FIRST_EXPOSED_BIT = 7;
+constexpr size_t LAST_EXPOSED_BIT = 35;
+
+constexpr std::array<NtfyToastActions::Actions, 7> ACTIONS = {
+    NtfyToastActions::Actions::Error,         NtfyToastActions::Actions::Clicked,
+    NtfyToastActions::Actions::Hidden,        NtfyToastActions::Actions::Dismissed,
+    NtfyToastActions::Actions::Timedout,      NtfyToastActions::Actions::ButtonClicked,
+    NtfyToastActions::Actions::TextEntered
+};
+
+constexpr std::array<const char *, 4> DISABLED_REASONS = { "DisabledForApplication",
+                                                           "DisabledForUser",
+                                                           "DisabledByGroupPolicy",
+                                                           "DisabledByManifest" };
+
+constexpr std::array<const char *, 5> ALLOCATION_PATHS = { "split_data", "format_action",
+                                                           "parse_arguments", "render",
+                                                           "callback" };
+
+size_t actionIndex(NtfyToastActions::Actions action)
+{
+    // Error is -1
+    return static_cast<size_t>(static_cast<int>(action) + 1);
+}
+
+std::string actionLabel(NtfyToastActions::Actions action)
+{
+    if (action == NtfyToastActions::Actions::Error) {
+        return "error";
+    }
+    const auto &name = NtfyToastActions::getActionString(action);
+    return std::string(name.cbegin(), name.cend());
+}
+
+size_t highestBit(uint64_t value)
+{
+    size_t out = 0;
+    while (value >>= 1) {
+        ++out;
+    }
+    return out;
+}
+
+class Writer
+{
+public:
+    explicit Writer(const std::unordered_map<std::string, double> &base) : m_base(base)
+    {
+        m_out << std::setprecision(15);
+    }
+
+    void header(const std::string &name, const char *type, const char *help)
+    {
+        m_out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+    }
+
+    void sample(const std::string &series, double value)
+    {
+        const auto it = m_base.find(series);
+        if (it != m_base.cend()) {
+            value += it->second;
+        }
+        m_out << series << " " << value << "\n";
+    }
+
+    void histogram(const std::string &name, const std::string &labels, const Histogram &h)
+    {
+        const std::string prefix = labels.empty() ? "{" : "{" + labels + ",";
+        const std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+        for (size_t bit = FIRST_EXPOSED_BIT; bit <= LAST_EXPOSED_BIT; ++bit) {
+            std::ostringstream le;
+            le << std::setprecision(12) << static_cast<double>(uint64_t(1) << bit) / 1e6;
+            sample(name + "_bucket" + prefix + "le=\"" + le.str() + "\"}",
+                   static_cast<double>(h.countBelow(bit)));
+        }
+        sample(name + "_bucket" + prefix + "le=\"+Inf\"}", static_cast<double>(h.count()));
+        sample(name + "_sum" + suffix, static_cast<double>(h.sum().count()) / 1e6);
+        sample(name + "_count" + suffix, static_cast<double>(h.count()));
+    }
+
+    std::string str() const { return m_out.str(); }
+
+private:
+    const std::unordered_map<std::string, double> &m_base;
+    std::ostringstream m_out;
+};
+}
+
+size_t Histogram::bucketIndex(uint64_t value)
+{
+    if (value < SubBucketCount) {
+        return static_cast<size_t>(value);
+    }
+    const size_t bit = highestBit(value);
+    if (bit > MaxBit) {
+        return BucketCount - 1;
+    }
+    const auto sub = static_cast<size_t>(value >> (bit - SubBucketBits)) - SubBucketCount;
+    return (bit - SubBucketBits + 1) * SubBucketCount + sub;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t index)
+{
+    if (index < SubBucketCount) {
+        return index;
+    }
+    const size_t bit = index / SubBucketCount + SubBucketBits - 1;
+    const uint64_t sub = index % SubBucketCount;
+    return ((SubBucketCount + sub + 1) << (bit - SubBucketBits)) - 1;
+}
+
+void Histogram::record(std::chrono::microseconds value)
+{
+    const auto v = static_cast<uint64_t>(std::max<int64_t>(value.count(), 0));
+    m_buckets[bucketIndex(v)].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(v, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+std::chrono::microseconds Histogram::sum() const
+{
+    return std::chrono::microseconds(m_sum.load(std::memory_order_relaxed));
+}
+
+std::chrono::microseconds Histogram::percentile(double p) const
+{
+    const uint64_t total = count();
+    if (total == 0) {
+        return std::chrono::microseconds(0);
+    }
+    const auto wanted = static_cast<uint64_t>(std::max(1.0, p / 100.0 * total + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketCount; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= wanted) {
+            return std::chrono::microseconds(bucketUpperBound(i));
+        }
+    }
+    return std::chrono::microseconds(bucketUpperBound(BucketCount - 1));
+}
+
+uint64_t Histogram::countBelow(size_t bit) const
+{
+    const size_t end = bit > MaxBit ? BucketCount : bucketIndex(uint64_t(1) << bit);
+    uint64_t out = 0;
+    for (size_t i = 0; i < end; ++i) {
+        out += m_buckets[i].load(std::memory_order_relaxed);
+    }
+    return out;
+}
+
+Metrics &Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+void Metrics::recordShow(std::chrono::microseconds latency)
+{
+    m_showLatency.record(latency);
+}
+
+void Metrics::recordAction(NtfyToastActions::Actions action, std::chrono::microseconds latency)
+{
+    m_actionLatency[actionIndex(action)].record(latency);
+}
+
+void Metrics::recordPipeWrite(std::chrono::microseconds latency, bool success)
+{
+    m_pipeWriteLatency.record(latency);
+    if (!success) {
+        m_pipeWriteFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::recordFallbackMode()
+{
+    m_fallbackMode.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::recordDisabled(DisabledReason reason)
+{
+    m_disabled[static_cast<size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::recordAllocations(AllocationPath path, const AllocationCount &count)
+{
+    const auto i = static_cast<size_t>(path);
+    m_allocationScopes[i].fetch_add(1, std::memory_order_relaxed);
+    m_allocations[i].fetch_add(count.allocations, std::memory_order_relaxed);
+    m_allocatedBytes[i].fetch_add(count.bytes, std::memory_order_relaxed);
+}
+
+const Histogram &Metrics::showLatency() const
+{
+    return m_showLatency;
+}
+
+const Histogram &Metrics::actionLatency(NtfyToastActions::Actions action) const
+{
+    return m_actionLatency[actionIndex(action)];
+}
+
+const Histogram &Metrics::pipeWriteLatency() const
+{
+    return m_pipeWriteLatency;
+}
+
+uint64_t Metrics::pipeWriteFailures() const
+{
+    return m_pipeWriteFailures.load(std::memory_order_relaxed);
+}
+
+uint64_t Metrics::fallbackModeActivations() const
+{
+    return m_fallbackMode.load(std::memory_order_relaxed);
+}
+
+uint64_t Metrics::disabled(DisabledReason reason) const
+{
+    return m_disabled[static_cast<size_t>(reason)].load(std::memory_order_relaxed);
+}
+
+uint64_t Metrics::allocationScopes(AllocationPath path) const
+{
+    return m_allocationScopes[static_cast<size_t>(path)].load(std::memory_order_relaxed);
+}
+
+AllocationCount Metrics::allocations(AllocationPath path) const
+{
+    const auto i = static_cast<size_t>(path);
+    return { m_allocations[i].load(std::memory_order_relaxed),
+             m_allocatedBytes[i].load(std::memory_order_relaxed) };
+}
+
+std::string Metrics::prometheus() const
+{
+    return render({});
+}
+
+std::string Metrics::render(const std::unordered_map<std::string, double> &base) const
+{
+    Writer out(base);
+
+    out.header("ntfytoast_show_latency_seconds", "histogram",
+               "Time from displayToast() until the toast was handed to the notifier.");
+    out.histogram("ntfytoast_show_latency_seconds", {}, m_showLatency);
+
+    out.header("ntfytoast_action_latency_seconds", "histogram",
+               "Time from showing the toast until the user acted on it, by action.");
+    for (const auto action : ACTIONS) {
+        out.histogram("ntfytoast_action_latency_seconds",
+                      "action=\"" + actionLabel(action) + "\"", actionLatency(action));
+    }
+
+    out.header("ntfytoast_pipe_write_latency_seconds", "histogram",
+               "Time spent writing a callback to the named pipe.");
+    out.histogram("ntfytoast_pipe_write_latency_seconds", {}, m_pipeWriteLatency);
+
+    out.header("ntfytoast_pipe_write_failures_total", "counter",
+               "Callbacks that could not be written to the named pipe.");
+    out.sample("ntfytoast_pipe_write_failures_total", static_cast<double>(pipeWriteFailures()));
+
+    out.header("ntfytoast_fallback_mode_total", "counter",
+               "Toasts shown in fallback mode because the app id is not registered.");
+    out.sample("ntfytoast_fallback_mode_total", static_cast<double>(fallbackModeActivations()));
+
+    out.header("ntfytoast_notifications_disabled_total", "counter",
+               "Toasts that could not be shown because notifications are disabled, by reason.");
+    for (size_t i = 0; i < DISABLED_REASONS.size(); ++i) {
+        out.sample(std::string("ntfytoast_notifications_disabled_total{reason=\"")
+                           + DISABLED_REASONS[i] + "\"}",
+                   static_cast<double>(m_disabled[i].load(std::memory_order_relaxed)));
+    }
+
+    if (AllocationCounter::enabled()) {
+        const auto perPath = [&](const char *name, const char *help, const auto &value) {
+            out.header(name, "counter", help);
+            for (size_t i = 0; i < ALLOCATION_PATHS.size(); ++i) {
+                out.sample(std::string(name) + "{path=\"" + ALLOCATION_PATHS[i] + "\"}",
+                           static_cast<double>(value(static_cast<AllocationPath>(i))));
+            }
+        };
+        perPath("ntfytoast_allocation_scopes_total", "Times a counted path was run, by path.",
+                [this](AllocationPath p) { return allocationScopes(p); });
+        perPath("ntfytoast_allocations_total", "Heap allocations made by a path, by path.",
+                [this](AllocationPath p) { return allocations(p).allocations; });
+        perPath("ntfytoast_allocated_bytes_total", "Bytes allocated by a path, by path.",
+                [this](AllocationPath p) { return allocations(p).bytes; });
+    }
+
+    return out.str();
+}
+
+bool Metrics::mergeInto(const std::filesystem::path &path) const
+{
+    std::unordered_map<std::string, double> base;
+    {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            const auto pos = line.rfind(' ');
+            if (line.empty() || line[0] == '#' || pos == std::string::npos) {
+                continue;
+            }
+            try {
+                base[line.substr(0, pos)] = std::stod(line.substr(pos + 1));
+            } catch (const std::exception &) {
+            }
+        }
+    }
+
+    auto tmp = path;
+    tmp += L".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << render(base);
+        if (!out) {
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tmp, path, error);
+    return !error;
+}
+
+const std::filesystem::path &Metrics::outputFile() const
+{
+    return m_outputFile;
+}
+
+void Metrics::setOutputFile(const std::filesystem::path &path)
+{
+    m_outputFile = path;
+}
@@ -0,0 +1,139 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "allocationcounter.h"
+#include "ntfytoastactions.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+/*
+    HDR style latency histogram.
+
+    Values are recorded in microseconds into log-linear buckets, every power of two is
+    split into 16 linear sub buckets which keeps the relative error below 6.25%.
+    Recording is a single relaxed atomic increment, so it is safe to use on the hot path
+    and from the WinRT callback threads.
+*/
+
+class Histogram
+{
+public:
+    static constexpr size_t SubBucketBits = 4;
+    static constexpr size_t SubBucketCount = 1 << SubBucketBits;
+    // 2^40 microseconds are about 12 days, larger values end up in the last bucket
+    static constexpr size_t MaxBit = 40;
+    static constexpr size_t BucketCount = (MaxBit - SubBucketBits + 2) * SubBucketCount;
+
+    void record(std::chrono::microseconds value);
+
+    uint64_t count() const;
+    std::chrono::microseconds sum() const;
+    std::chrono::microseconds percentile(double p) const;
+
+    // number of recorded values below 2^bit microseconds
+    uint64_t countBelow(size_t bit) const;
+
+private:
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(size_t index);
+
+    std::array<std::atomic<uint64_t>, BucketCount> m_buckets {};
+    std::atomic<uint64_t> m_count { 0 };
+    std::atomic<uint64_t> m_sum { 0 };
+};
+
+class Metrics
+{
+public:
+    enum class DisabledReason {
+        ForApplication,
+        ForUser,
+        ByGroupPolicy,
+        ByManifest
+    };
+
+    static Metrics &instance();
+
+    void recordShow(std::chrono::microseconds latency);
+    void recordAction(NtfyToastActions::Actions action, std::chrono::microseconds latency);
+    void recordPipeWrite(std::chrono::microseconds latency, bool success);
+    void recordFallbackMode();
+    void recordDisabled(DisabledReason reason);
+    void recordAllocations(AllocationPath path, const AllocationCount &count);
+
+    const Histogram &showLatency() const;
+    const Histogram &actionLatency(NtfyToastActions::Actions action) const;
+    const Histogram &pipeWriteLatency() const;
+    uint64_t pipeWriteFailures() const;
+    uint64_t fallbackModeActivations() const;
+    uint64_t disabled(DisabledReason reason) const;
+
+    /**
+     * Only counted when built with COUNT_ALLOCATIONS, see allocationcounter.h.
+     */
+    uint64_t allocationScopes(AllocationPath path) const;
+    AllocationCount allocations(AllocationPath path) const;
+
+    /**
+     * Prometheus text exposition format.
+     */
+    std::string prometheus() const;
+
+    /**
+     * Adds the metrics of this process to the ones already stored in the file, so a
+     * textfile collector sees the totals of all ntfytoast processes.
+     * The caller is responsible for serialising concurrent writers.
+     */
+    bool mergeInto(const std::filesystem::path &path) const;
+
+    const std::filesystem::path &outputFile() const;
+    void setOutputFile(const std::filesystem::path &path);
+
+private:
+    Metrics() = default;
+
+    std::string render(const std::unordered_map<std::string, double> &base) const;
+
+    static constexpr size_t ActionCount = 7;
+
+    Histogram m_showLatency;
+    std::array<Histogram, ActionCount> m_actionLatency;
+    Histogram m_pipeWriteLatency;
+    std::atomic<uint64_t> m_pipeWriteFailures { 0 };
+    std::atomic<uint64_t> m_fallbackMode { 0 };
+    std::array<std::atomic<uint64_t>, 4> m_disabled {};
+
+    static constexpr size_t AllocationPathCount = 5;
+    std::array<std::atomic<uint64_t>, AllocationPathCount> m_allocationScopes {};
+    std::array<std::atomic<uint64_t>, AllocationPathCount> m_allocations {};
+    std::array<std::atomic<uint64_t>, AllocationPathCount> m_allocatedBytes {};
+
+    std::filesystem::path m_outputFile;
+};
@@ -0,0 +1,278 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "ntfystream.h"
+#include "utf8.h"
+
+#include <charconv>
+
+namespace {
+class Reader
+{
+public:
+    explicit Reader(std::string_view data) : m_data(data) { }
+
+    void skipSpace()
+    {
+        while (m_pos < m_data.size()
+               && (m_data[m_pos] == ' ' || m_data[m_pos] == '\t' || m_data[m_pos] == '\r'
+                   || m_data[m_pos] == '\n')) {
+            ++m_pos;
+        }
+    }
+
+    bool consume(char c)
+    {
+        skipSpace();
+        if (m_pos < m_data.size() && m_data[m_pos] == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    char peek()
+    {
+        skipSpace();
+        return m_pos < m_data.size() ? m_data[m_pos] : '\0';
+    }
+
+    // the content of a string, still escaped
+    bool string(std::string_view &out)
+    {
+        if (!consume('"')) {
+            return false;
+        }
+        const size_t start = m_pos;
+        while (m_pos < m_data.size()) {
+            const char c = m_data[m_pos];
+            if (c == '"') {
+                out = m_data.substr(start, m_pos - start);
+                ++m_pos;
+                return true;
+            }
+            m_pos += c == '\\' ? 2 : 1;
+        }
+        return false;
+    }
+
+    // a number, true, false or null
+    bool literal(std::string_view &out)
+    {
+        skipSpace();
+        const size_t start = m_pos;
+        while (m_pos < m_data.size() && m_data[m_pos] != ',' && m_data[m_pos] != '}'
+               && m_data[m_pos] != ']' && m_data[m_pos] != ' ') {
+            ++m_pos;
+        }
+        out = m_data.substr(start, m_pos - start);
+        return !out.empty();
+    }
+
+    // an object or array, strings are respected
+    bool skipNested()
+    {
+        size_t depth = 0;
+        while (m_pos < m_data.size()) {
+            const char c = m_data[m_pos];
+            if (c == '"') {
+                std::string_view ignored;
+                if (!string(ignored)) {
+                    return false;
+                }
+                continue;
+            }
+            ++m_pos;
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::string_view m_data;
+    size_t m_pos = 0;
+};
+
+template<typename T>
+void toInt(std::string_view value, T &out)
+{
+    std::from_chars(value.data(), value.data() + value.size(), out);
+}
+
+void appendUtf8(std::string &out, uint32_t cp)
+{
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else {
+        out.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+}
+
+bool hex4(std::string_view s, size_t pos, uint32_t &out)
+{
+    if (pos + 4 > s.size()) {
+        return false;
+    }
+    const auto result = std::from_chars(s.data() + pos, s.data() + pos + 4, out, 16);
+    return result.ptr == s.data() + pos + 4;
+}
+}
+
+std::wstring NtfyMessage::text(std::string_view escaped)
+{
+    if (escaped.find('\\') == std::string_view::npos) {
+        return Utf8::toWide(escaped);
+    }
+    std::string utf8;
+    utf8.reserve(escaped.size());
+    for (size_t i = 0; i < escaped.size(); ++i) {
+        const char c = escaped[i];
+        if (c != '\\' || i + 1 == escaped.size()) {
+            utf8.push_back(c);
+            continue;
+        }
+        switch (const char e = escaped[++i]) {
+        case 'b':
+            utf8.push_back('\b');
+            break;
+        case 'f':
+            utf8.push_back('\f');
+            break;
+        case 'n':
+            utf8.push_back('\n');
+            break;
+        case 'r':
+            utf8.push_back('\r');
+            break;
+        case 't':
+            utf8.push_back('\t');
+            break;
+        case 'u': {
+            uint32_t cp = 0;
+            if (!hex4(escaped, i + 1, cp)) {
+                utf8.push_back('u');
+                break;
+            }
+            i += 4;
+            uint32_t low = 0;
+            if (cp >= 0xd800 && cp < 0xdc00 && i + 2 < escaped.size() && escaped[i + 1] == '\\'
+                && escaped[i + 2] == 'u' && hex4(escaped, i + 3, low) && low >= 0xdc00
+                && low < 0xe000) {
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                i += 6;
+            } else if (cp >= 0xd800 && cp < 0xe000) {
+                // an unpaired surrogate
+                cp = 0xfffd;
+            }
+            appendUtf8(utf8, cp);
+            break;
+        }
+        default:
+            // \" \\ \/
+            utf8.push_back(e);
+        }
+    }
+    return Utf8::toWide(utf8);
+}
+
+bool NtfyStreamParser::parse(std::string_view line, NtfyMessage &message)
+{
+    Reader reader(line);
+    if (!reader.consume('{')) {
+        return false;
+    }
+    if (reader.consume('}')) {
+        return true;
+    }
+    do {
+        std::string_view key;
+        if (!reader.string(key) || !reader.consume(':')) {
+            return false;
+        }
+        std::string_view value;
+        switch (reader.peek()) {
+        case '"':
+            if (!reader.string(value)) {
+                return false;
+            }
+            if (key == "id") {
+                message.id = value;
+            } else if (key == "event") {
+                message.event = value;
+            } else if (key == "topic") {
+                message.topic = value;
+            } else if (key == "title") {
+                message.title = value;
+            } else if (key == "message") {
+                message.message = value;
+            } else if (key == "click") {
+                message.click = value;
+            }
+            break;
+        case '{':
+        case '[':
+            if (!reader.skipNested()) {
+                return false;
+            }
+            break;
+        default:
+            if (!reader.literal(value)) {
+                return false;
+            }
+            if (key == "time") {
+                toInt(value, message.time);
+            } else if (key == "priority") {
+                toInt(value, message.priority);
+            }
+        }
+    } while (reader.consume(','));
+    return reader.consume('}');
+}
+
+void NtfyStreamParser::reset()
+{
+    m_pending.clear();
+}
+
+uint64_t NtfyStreamParser::invalid() const
+{
+    return m_invalid;
+}
+
+bool NtfyStreamParser::isBlank(std::string_view line)
+{
+    return line.find_first_not_of(" \t\r") == std::string_view::npos;
+}
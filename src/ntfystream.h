@@ -0,0 +1,107 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/*
+    A message of an ntfy subscription, see https://docs.ntfy.sh/subscribe/api/
+
+    The strings are views into the stream and still JSON escaped, they are only valid in
+    the handler that received the message. Use text() to decode the ones that are needed.
+*/
+
+struct NtfyMessage
+{
+    std::string_view id;
+    // open, keepalive, message or poll_request
+    std::string_view event;
+    std::string_view topic;
+    std::string_view title;
+    std::string_view message;
+    std::string_view click;
+    int64_t time = 0;
+    // 1 (min) to 5 (max)
+    int priority = 3;
+
+    static std::wstring text(std::string_view escaped);
+};
+
+/*
+    Incremental reader for the JSON stream of a subscription, one object per line.
+
+    Complete lines are parsed where they are in the fed data, only a line that is split
+    between two chunks is copied. Only the fields of NtfyMessage are read, nested values are
+    skipped without being parsed.
+*/
+
+class NtfyStreamParser
+{
+public:
+    /**
+     * void handler(const NtfyMessage &) is called for every message in data.
+     * Returns the number of messages.
+     */
+    template<typename Handler>
+    size_t feed(const char *data, size_t size, Handler &&handler)
+    {
+        size_t messages = 0;
+        const std::string_view chunk(data, size);
+        size_t start = 0;
+        for (size_t end = chunk.find('\n'); end != std::string_view::npos;
+             start = end + 1, end = chunk.find('\n', start)) {
+            std::string_view line = chunk.substr(start, end - start);
+            if (!m_pending.empty()) {
+                m_pending.append(line);
+                line = m_pending;
+            }
+            NtfyMessage message;
+            if (parse(line, message)) {
+                handler(static_cast<const NtfyMessage &>(message));
+                ++messages;
+            } else if (!isBlank(line)) {
+                ++m_invalid;
+            }
+            m_pending.clear();
+        }
+        m_pending.append(chunk.substr(start));
+        return messages;
+    }
+
+    // drops a partial line, e.g. after a reconnect
+    void reset();
+
+    // lines that were not a JSON object
+    uint64_t invalid() const;
+
+    static bool parse(std::string_view line, NtfyMessage &message);
+
+private:
+    static bool isBlank(std::string_view line);
+
+    std::string m_pending;
+    uint64_t m_invalid = 0;
+};
@@ -0,0 +1,273 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "ntfysubscriber.h"
+#include "utf8.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+constexpr size_t ReadSize = 64 * 1024;
+
+std::filesystem::path subscriptionsDir()
+{
+#ifdef _WIN32
+    const wchar_t *base = _wgetenv(L"LOCALAPPDATA");
+#else
+    const char *base = std::getenv("XDG_STATE_HOME");
+#endif
+    const std::filesystem::path dir =
+            base && *base ? std::filesystem::path(base) : std::filesystem::temp_directory_path();
+    return dir / "ntfytoast" / "subscriptions";
+}
+
+// fnv-1a, stable between runs so a subscription finds its cursor again
+std::wstring hashName(const std::wstring &value)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const wchar_t c : value) {
+        hash = (hash ^ static_cast<uint64_t>(c)) * 0x100000001b3ull;
+    }
+    std::wstringstream out;
+    out << std::hex << std::setw(16) << std::setfill(L'0') << hash;
+    return out.str();
+}
+
+// http[s]://host[:port][/path], the host is empty if the url is not valid
+NtfyTransport::Endpoint parseUrl(const std::wstring &url, std::wstring &path)
+{
+    NtfyTransport::Endpoint out;
+    const auto schemeEnd = url.find(L"://");
+    const auto scheme = url.substr(0, schemeEnd);
+    if (scheme != L"http" && scheme != L"https") {
+        return out;
+    }
+    const auto authorityStart = schemeEnd + 3;
+    const auto slash = url.find(L'/', authorityStart);
+    const auto authority = url.substr(authorityStart, slash - authorityStart);
+    path = slash == std::wstring::npos ? std::wstring() : url.substr(slash);
+
+    // [::1]:8080
+    std::wstring host = authority;
+    std::wstring port;
+    const auto bracket = authority.find(L']');
+    const auto colon = authority.rfind(L':');
+    if (!authority.empty() && authority.front() == L'[' && bracket != std::wstring::npos) {
+        host = authority.substr(1, bracket - 1);
+        if (bracket + 1 < authority.size()) {
+            if (authority[bracket + 1] != L':') {
+                return out;
+            }
+            port = authority.substr(bracket + 2);
+        }
+    } else if (colon != std::wstring::npos) {
+        host = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+    }
+
+    out.secure = scheme == L"https";
+    out.port = out.secure ? 443 : 80;
+    if (!port.empty()) {
+        const auto digit = [](wchar_t c) { return c >= L'0' && c <= L'9'; };
+        if (port.size() > 5 || !std::all_of(port.cbegin(), port.cend(), digit)) {
+            return out;
+        }
+        const auto value = std::stoul(port);
+        if (value == 0 || value > 65535) {
+            return out;
+        }
+        out.port = static_cast<uint16_t>(value);
+    }
+    out.host = host;
+    return out;
+}
+}
+
+NtfySubscriber::NtfySubscriber(const std::wstring &server, const std::vector<std::wstring> &topics,
+                               std::shared_ptr<NtfyTransport> transport)
+    : NtfySubscriber(server, topics, std::move(transport), Options())
+{
+}
+
+NtfySubscriber::NtfySubscriber(const std::wstring &server, const std::vector<std::wstring> &topics,
+                               std::shared_ptr<NtfyTransport> transport, Options options)
+    : m_transport(std::move(transport)), m_options(std::move(options))
+{
+    std::wstring url = server;
+    if (url.find(L"://") == std::wstring::npos) {
+        url = L"https://" + url;
+    }
+    while (!url.empty() && url.back() == L'/') {
+        url.pop_back();
+    }
+    m_endpoint = parseUrl(url, m_path);
+    if (m_endpoint.host.empty()) {
+        log(L"Invalid ntfy server: " + server);
+    }
+
+    std::wstring joined;
+    for (const auto &topic : topics) {
+        joined += (joined.empty() ? L"" : L",") + topic;
+    }
+    m_path += L"/" + joined + L"/json";
+    const auto dir = m_options.cursorDir.empty() ? subscriptionsDir() : m_options.cursorDir;
+    m_cursorFile = dir / (hashName(url + L"/" + joined) + L".cursor");
+
+    std::ifstream in(m_cursorFile);
+    std::getline(in, m_cursor);
+}
+
+NtfySubscriber::~NtfySubscriber() = default;
+
+bool NtfySubscriber::run(const Handler &handler)
+{
+    if (m_endpoint.host.empty()) {
+        return false;
+    }
+
+    auto backoff = m_options.minBackoff;
+    while (!m_stopped) {
+        const auto connected = std::chrono::steady_clock::now();
+        switch (read(handler)) {
+        case Result::Stopped:
+            return true;
+        case Result::Failed:
+            return false;
+        case Result::Reconnect:
+            break;
+        }
+        // a connection that lasted a while was fine, start over with a short delay
+        if (std::chrono::steady_clock::now() - connected > m_options.maxBackoff) {
+            backoff = m_options.minBackoff;
+        }
+        log(L"Reconnecting to " + m_endpoint.host + m_path + L" in "
+            + std::to_wstring(backoff.count()) + L"ms");
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait_for(lock, backoff, [this] { return m_stopped.load(); });
+        backoff = std::min(backoff * 2, m_options.maxBackoff);
+    }
+    return true;
+}
+
+NtfySubscriber::Result NtfySubscriber::read(const Handler &handler)
+{
+    const std::wstring path =
+            m_cursor.empty() ? m_path : m_path + L"?since=" + Utf8::toWide(m_cursor);
+    const auto request = m_transport->open(m_endpoint, path);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopped) {
+            return Result::Stopped;
+        }
+        m_request = request.get();
+    }
+    // stop() aborts the request, which returns from a blocking call
+    const auto release = [&](Result result) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_request = nullptr;
+        return m_stopped ? Result::Stopped : result;
+    };
+
+    const int status = request->send();
+    if (status == 0) {
+        log(request->error());
+        return release(Result::Reconnect);
+    }
+    if (status != 200) {
+        log(m_endpoint.host + path + L" returned " + std::to_wstring(status));
+        // a 4xx won't change by asking again, except for rate limiting
+        return release(status >= 400 && status < 500 && status != 429 ? Result::Failed
+                                                                      : Result::Reconnect);
+    }
+
+    m_parser.reset();
+    std::string buffer(ReadSize, '\0');
+    while (const size_t read = request->read(buffer.data(), buffer.size())) {
+        const std::string previous = m_cursor;
+        m_parser.feed(buffer.data(), read, [&](const NtfyMessage &message) {
+            if (message.event == "message" && !message.id.empty()) {
+                m_cursor = message.id;
+            }
+            handler(message);
+        });
+        if (m_cursor != previous) {
+            saveCursor();
+        }
+    }
+    if (!request->error().empty()) {
+        log(request->error());
+    }
+    if (m_parser.invalid() > 0) {
+        log(std::to_wstring(m_parser.invalid()) + L" lines of " + m_endpoint.host + path
+            + L" were not valid");
+    }
+    return release(Result::Reconnect);
+}
+
+void NtfySubscriber::stop()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+    if (m_request) {
+        m_request->abort();
+    }
+    m_wake.notify_all();
+}
+
+std::string NtfySubscriber::cursor() const
+{
+    return m_cursor;
+}
+
+std::filesystem::path NtfySubscriber::cursorFile() const
+{
+    return m_cursorFile;
+}
+
+void NtfySubscriber::saveCursor()
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_cursorFile.parent_path(), error);
+    // replace the file at once, a torn cursor would skip or repeat messages
+    auto temp = m_cursorFile;
+    temp += L".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        out << m_cursor;
+        if (!out) {
+            log(L"Failed to save the cursor to " + temp.wstring());
+            return;
+        }
+    }
+    std::filesystem::rename(temp, m_cursorFile, error);
+}
+
+void NtfySubscriber::log(const std::wstring &line) const
+{
+    if (m_options.log) {
+        m_options.log(line);
+    }
+}
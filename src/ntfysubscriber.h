@@ -0,0 +1,113 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "ntfystream.h"
+#include "ntfytransport.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+    Subscribes to ntfy topics, see https://docs.ntfy.sh/subscribe/api/
+
+    All topics share one long lived HTTP connection to <server>/<topic,topic>/json which is
+    read as it arrives. If the connection drops it is opened again, with a growing delay if
+    the server is not reachable. The id of the last message is kept in a cursor file and
+    passed as since=<id>, so no message is lost between two connections or two runs.
+*/
+
+class NtfySubscriber
+{
+public:
+    using Handler = std::function<void(const NtfyMessage &message)>;
+
+    struct Options
+    {
+        // the directory of the cursor files, by default %LOCALAPPDATA%\ntfytoast\subscriptions
+        std::filesystem::path cursorDir;
+        // the delay before the first reconnect, it doubles up to maxBackoff
+        std::chrono::milliseconds minBackoff = std::chrono::seconds(1);
+        std::chrono::milliseconds maxBackoff = std::chrono::seconds(60);
+        // receives why a connection failed or dropped
+        std::function<void(const std::wstring &line)> log;
+    };
+
+    // the server defaults to https if it has no scheme, e.g. ntfy.sh
+    NtfySubscriber(const std::wstring &server, const std::vector<std::wstring> &topics,
+                   std::shared_ptr<NtfyTransport> transport);
+    NtfySubscriber(const std::wstring &server, const std::vector<std::wstring> &topics,
+                   std::shared_ptr<NtfyTransport> transport, Options options);
+    ~NtfySubscriber();
+
+    NtfySubscriber(const NtfySubscriber &) = delete;
+    NtfySubscriber &operator=(const NtfySubscriber &) = delete;
+
+    /**
+     * Calls the handler for every event of the subscription until stop() is called.
+     * Returns false if the subscription can not work, e.g. the url is invalid or the
+     * server refused it with a 4xx status.
+     */
+    bool run(const Handler &handler);
+
+    // may be called from any thread, e.g. a console control handler
+    void stop();
+
+    // the id of the last message received
+    std::string cursor() const;
+    std::filesystem::path cursorFile() const;
+
+private:
+    enum class Result {
+        Stopped,
+        Reconnect,
+        Failed
+    };
+
+    Result read(const Handler &handler);
+    void saveCursor();
+    void log(const std::wstring &line) const;
+
+    const std::shared_ptr<NtfyTransport> m_transport;
+    const Options m_options;
+    NtfyTransport::Endpoint m_endpoint;
+    // /<topic,topic>/json
+    std::wstring m_path;
+    std::filesystem::path m_cursorFile;
+    std::string m_cursor;
+    NtfyStreamParser m_parser;
+
+    std::atomic<bool> m_stopped { false };
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    // the request in flight, aborted by stop()
+    NtfyTransport::Request *m_request = nullptr;
+};
@@ -0,0 +1,307 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "ntfytoastcmanager.h"
+#include "utf8.h"
+#include "config.h"
+
+#ifdef _WIN32
+#include "ntfytoasts.h"
+#include "wintoastbackend.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+struct ntfytoast_manager
+{
+    std::wstring appID;
+    ToastRenderer renderer;
+    std::unique_ptr<ToastDispatcher> dispatcher;
+
+    // prefix of the generated ids, toasts with the same tag replace each other
+    std::wstring idPrefix;
+    std::atomic<uint64_t> nextId { 0 };
+
+    std::mutex mutex;
+    std::condition_variable completed;
+    std::deque<std::pair<ToastHandle, ToastResult>> results;
+    // handles ntfytoast_wait is blocked on, their results are never discarded
+    std::unordered_map<ToastHandle, size_t> waiting;
+};
+
+namespace {
+std::wstring toWide(const char *value)
+{
+    return value ? Utf8::toWide(value) : std::wstring();
+}
+
+// the caller's struct must hold every field of this version, later fields are optional
+bool validResult(const ntfytoast_result *result)
+{
+    return result && result->struct_size >= sizeof(ntfytoast_result);
+}
+
+void fillResult(ntfytoast_result *out, ToastHandle handle, const ToastResult &result)
+{
+    out->handle = handle;
+    out->action = static_cast<ntfytoast_action>(result.action);
+    out->arguments = nullptr;
+    if (!result.arguments.empty()) {
+        const auto utf8 = Utf8::fromWide(result.arguments);
+        out->arguments = new char[utf8.size() + 1];
+        std::memcpy(out->arguments, utf8.c_str(), utf8.size() + 1);
+    }
+}
+
+// called with the mutex held
+void discardUnclaimed(ntfytoast_manager *manager)
+{
+    auto &results = manager->results;
+    auto it = results.begin();
+    while (results.size() > NTFYTOAST_MAX_RESULTS && it != results.end()) {
+        if (manager->waiting.count(it->first)) {
+            ++it;
+        } else {
+            it = results.erase(it);
+        }
+    }
+}
+
+#ifdef _WIN32
+ToastSubmission renderToast(const std::shared_ptr<ToastBackend> &backend,
+                            const std::wstring &appID, const std::wstring &id,
+                            const ntfytoast_toast &toast)
+{
+    NtfyToasts ntfyToast(appID, backend);
+    ntfyToast.setId(id);
+    if (toast.sound) {
+        ntfyToast.setSound(toWide(toast.sound));
+    }
+    ntfyToast.setSilent(toast.silent != 0);
+    ntfyToast.setPersistent(toast.persistent != 0);
+    ntfyToast.setButtons(toWide(toast.buttons));
+    ntfyToast.setDuration(toast.long_duration ? Duration::Long : Duration::Short);
+    if (toast.expire_ms > 0) {
+        ntfyToast.setExpirationTime(std::chrono::system_clock::now()
+                                    + std::chrono::milliseconds(toast.expire_ms));
+    }
+    const std::wstring image = toWide(toast.image);
+    return ntfyToast.submission(toWide(toast.title), toWide(toast.body),
+                                image.empty() ? std::filesystem::path()
+                                              : std::filesystem::path(image));
+}
+#endif
+}
+
+ntfytoast_manager *createToastManager(const std::wstring &appID,
+                                      std::shared_ptr<ToastBackend> backend,
+                                      ToastRenderer renderer)
+{
+    auto manager = std::make_unique<ntfytoast_manager>();
+    manager->appID = appID;
+    manager->renderer = std::move(renderer);
+    manager->idPrefix = std::to_wstring(
+            std::chrono::system_clock::now().time_since_epoch().count() & 0xFFFFFFFF);
+    manager->dispatcher = std::make_unique<ToastDispatcher>(std::move(backend));
+    manager->dispatcher->start();
+    return manager.release();
+}
+
+extern "C" {
+
+uint32_t ntfytoast_abi_version(void)
+{
+    return NTFYTOAST_ABI_VERSION;
+}
+
+const char *ntfytoast_version(void)
+{
+    static const std::string version = Utf8::fromWide(NTFYTOAST_VERSION);
+    return version.c_str();
+}
+
+ntfytoast_status ntfytoast_manager_create(const char *app_id, ntfytoast_manager **manager)
+{
+    if (!app_id || !*app_id || !manager) {
+        return NTFYTOAST_ERROR_INVALID_ARGUMENT;
+    }
+#ifdef _WIN32
+    try {
+        const auto backend = std::make_shared<WinToastBackend>();
+        *manager = createToastManager(
+                toWide(app_id), backend,
+                [backend](const std::wstring &appID, const std::wstring &id,
+                          const ntfytoast_toast &toast) {
+                    return renderToast(backend, appID, id, toast);
+                });
+        return NTFYTOAST_OK;
+    } catch (...) {
+        return NTFYTOAST_ERROR_INTERNAL;
+    }
+#else
+    *manager = nullptr;
+    return NTFYTOAST_ERROR_UNSUPPORTED;
+#endif
+}
+
+void ntfytoast_manager_free(ntfytoast_manager *manager)
+{
+    if (manager) {
+        try {
+            manager->dispatcher->stop();
+            delete manager;
+        } catch (...) {
+            // leaked, destroying it with a running dispatcher thread would terminate
+        }
+    }
+}
+
+void ntfytoast_toast_init(ntfytoast_toast *toast)
+{
+    if (toast) {
+        std::memset(toast, 0, sizeof(ntfytoast_toast));
+        toast->struct_size = sizeof(ntfytoast_toast);
+    }
+}
+
+ntfytoast_status ntfytoast_submit(ntfytoast_manager *manager, const ntfytoast_toast *toast,
+                                  ntfytoast_handle *handle)
+{
+    if (!manager || !toast || !handle || toast->struct_size < sizeof(ntfytoast_toast)
+        || !toast->title || !toast->body) {
+        return NTFYTOAST_ERROR_INVALID_ARGUMENT;
+    }
+    try {
+        const std::wstring id = toast->id && *toast->id
+                ? toWide(toast->id)
+                : manager->idPrefix + L"-" + std::to_wstring(++manager->nextId);
+
+        ToastSubmission submission = manager->renderer(manager->appID, id, *toast);
+        submission.completion = [manager](ToastHandle handle, const ToastResult &result) {
+            {
+                std::lock_guard<std::mutex> lock(manager->mutex);
+                manager->results.emplace_back(handle, result);
+                discardUnclaimed(manager);
+            }
+            manager->completed.notify_all();
+        };
+
+        auto ticket = manager->dispatcher->submit(std::move(submission));
+        *handle = ticket.handle;
+        return ticket.admission.accepted() ? NTFYTOAST_OK : NTFYTOAST_ERROR_REJECTED;
+    } catch (...) {
+        return NTFYTOAST_ERROR_INTERNAL;
+    }
+}
+
+ntfytoast_status ntfytoast_cancel(ntfytoast_manager *manager, ntfytoast_handle handle)
+{
+    if (!manager) {
+        return NTFYTOAST_ERROR_INVALID_ARGUMENT;
+    }
+    try {
+        manager->dispatcher->cancel(handle);
+        return NTFYTOAST_OK;
+    } catch (...) {
+        return NTFYTOAST_ERROR_INTERNAL;
+    }
+}
+
+ntfytoast_status ntfytoast_poll(ntfytoast_manager *manager, ntfytoast_result *result)
+{
+    if (!manager || !validResult(result)) {
+        return NTFYTOAST_ERROR_INVALID_ARGUMENT;
+    }
+    try {
+        std::lock_guard<std::mutex> lock(manager->mutex);
+        if (manager->results.empty()) {
+            return NTFYTOAST_NOT_READY;
+        }
+        const auto &front = manager->results.front();
+        fillResult(result, front.first, front.second);
+        manager->results.pop_front();
+        return NTFYTOAST_OK;
+    } catch (...) {
+        return NTFYTOAST_ERROR_INTERNAL;
+    }
+}
+
+ntfytoast_status ntfytoast_wait(ntfytoast_manager *manager, ntfytoast_handle handle,
+                                uint32_t timeout_ms, ntfytoast_result *result)
+{
+    if (!manager || !validResult(result)) {
+        return NTFYTOAST_ERROR_INVALID_ARGUMENT;
+    }
+    try {
+        std::unique_lock<std::mutex> lock(manager->mutex);
+        auto it = manager->results.end();
+        const auto ready = [&] {
+            it = std::find_if(manager->results.begin(), manager->results.end(),
+                              [handle](const auto &r) { return r.first == handle; });
+            return it != manager->results.end();
+        };
+        ++manager->waiting[handle];
+        bool found;
+        if (timeout_ms == NTFYTOAST_WAIT_INFINITE) {
+            manager->completed.wait(lock, ready);
+            found = true;
+        } else {
+            found = manager->completed.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                                ready);
+        }
+        if (--manager->waiting[handle] == 0) {
+            manager->waiting.erase(handle);
+        }
+        if (!found) {
+            return NTFYTOAST_NOT_READY;
+        }
+        fillResult(result, it->first, it->second);
+        manager->results.erase(it);
+        return NTFYTOAST_OK;
+    } catch (...) {
+        return NTFYTOAST_ERROR_INTERNAL;
+    }
+}
+
+void ntfytoast_result_init(ntfytoast_result *result)
+{
+    if (result) {
+        std::memset(result, 0, sizeof(ntfytoast_result));
+        result->struct_size = sizeof(ntfytoast_result);
+    }
+}
+
+void ntfytoast_result_free(ntfytoast_result *result)
+{
+    if (result) {
+        delete[] result->arguments;
+        result->arguments = nullptr;
+    }
+}
+}
@@ -0,0 +1,154 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+/*
+    C interface of NtfyToast for in-process use from other languages.
+
+    Strings are UTF-8 and only borrowed for the duration of a call. Structs passed in
+    start with struct_size so fields can be appended without breaking older callers,
+    initialize them with the matching _init function.
+
+        ntfytoast_manager *manager;
+        ntfytoast_manager_create("My.App.Id", &manager);
+
+        ntfytoast_toast toast;
+        ntfytoast_toast_init(&toast);
+        toast.title = "Title";
+        toast.body = "Message";
+
+        ntfytoast_handle handle;
+        ntfytoast_submit(manager, &toast, &handle);
+
+        ntfytoast_result result;
+        ntfytoast_result_init(&result);
+        if (ntfytoast_wait(manager, handle, NTFYTOAST_WAIT_INFINITE, &result) == NTFYTOAST_OK) {
+            ...
+            ntfytoast_result_free(&result);
+        }
+        ntfytoast_manager_free(manager);
+
+    The results of completed toasts are kept until they are polled or waited for. Of more
+    than NTFYTOAST_MAX_RESULTS unclaimed results the oldest are discarded, unless a thread
+    waits for them, so poll regularly or wait for every handle.
+*/
+
+#include "ntfytoastc_export.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* incremented on incompatible changes */
+#define NTFYTOAST_ABI_VERSION 1
+
+#define NTFYTOAST_WAIT_INFINITE 0xFFFFFFFFu
+
+/* completed toasts whose results are kept for ntfytoast_poll and ntfytoast_wait */
+#define NTFYTOAST_MAX_RESULTS 1024
+
+typedef struct ntfytoast_manager ntfytoast_manager;
+typedef uint64_t ntfytoast_handle;
+
+typedef enum ntfytoast_status {
+    NTFYTOAST_OK = 0,
+    /* no result is available yet */
+    NTFYTOAST_NOT_READY = 1,
+    NTFYTOAST_ERROR_INVALID_ARGUMENT = -1,
+    /* there is no notification backend on this platform */
+    NTFYTOAST_ERROR_UNSUPPORTED = -2,
+    /* the submission queue is full or shutting down */
+    NTFYTOAST_ERROR_REJECTED = -3,
+    NTFYTOAST_ERROR_INTERNAL = -4
+} ntfytoast_status;
+
+/* the values match NtfyToastActions::Actions and the exit codes of ntfytoast.exe */
+typedef enum ntfytoast_action {
+    NTFYTOAST_ACTION_CLICKED = 0,
+    NTFYTOAST_ACTION_HIDDEN = 1,
+    NTFYTOAST_ACTION_DISMISSED = 2,
+    NTFYTOAST_ACTION_TIMEDOUT = 3,
+    NTFYTOAST_ACTION_BUTTON_CLICKED = 4,
+    NTFYTOAST_ACTION_TEXT_ENTERED = 5,
+    NTFYTOAST_ACTION_ERROR = -1
+} ntfytoast_action;
+
+typedef struct ntfytoast_toast {
+    uint32_t struct_size;
+    const char *title;
+    const char *body;
+    /* optional, path to an image */
+    const char *image;
+    /* optional, used to replace or close the toast, generated if not set */
+    const char *id;
+    /* optional, e.g. "Notification.Default" */
+    const char *sound;
+    /* optional, buttons separated by ';' */
+    const char *buttons;
+    int silent;
+    int persistent;
+    int long_duration;
+    /* hide the toast after this many milliseconds, 0 to keep the default */
+    uint32_t expire_ms;
+} ntfytoast_toast;
+
+/* struct_size is set by the caller, fields beyond it are not written */
+typedef struct ntfytoast_result {
+    uint32_t struct_size;
+    ntfytoast_handle handle;
+    ntfytoast_action action;
+    /* the arguments of the activated element, release with ntfytoast_result_free */
+    char *arguments;
+} ntfytoast_result;
+
+NTFYTOASTC_EXPORT uint32_t ntfytoast_abi_version(void);
+NTFYTOASTC_EXPORT const char *ntfytoast_version(void);
+
+NTFYTOASTC_EXPORT ntfytoast_status ntfytoast_manager_create(const char *app_id,
+                                                            ntfytoast_manager **manager);
+/* outstanding toasts are completed with NTFYTOAST_ACTION_ERROR */
+NTFYTOASTC_EXPORT void ntfytoast_manager_free(ntfytoast_manager *manager);
+
+NTFYTOASTC_EXPORT void ntfytoast_toast_init(ntfytoast_toast *toast);
+NTFYTOASTC_EXPORT ntfytoast_status ntfytoast_submit(ntfytoast_manager *manager,
+                                                    const ntfytoast_toast *toast,
+                                                    ntfytoast_handle *handle);
+NTFYTOASTC_EXPORT ntfytoast_status ntfytoast_cancel(ntfytoast_manager *manager,
+                                                    ntfytoast_handle handle);
+
+/* the result of any completed toast, NTFYTOAST_NOT_READY if there is none */
+NTFYTOASTC_EXPORT ntfytoast_status ntfytoast_poll(ntfytoast_manager *manager,
+                                                  ntfytoast_result *result);
+/* waits for the result of handle, NTFYTOAST_NOT_READY after the timeout */
+NTFYTOASTC_EXPORT ntfytoast_status ntfytoast_wait(ntfytoast_manager *manager,
+                                                  ntfytoast_handle handle, uint32_t timeout_ms,
+                                                  ntfytoast_result *result);
+NTFYTOASTC_EXPORT void ntfytoast_result_init(ntfytoast_result *result);
+NTFYTOASTC_EXPORT void ntfytoast_result_free(ntfytoast_result *result);
+
+#ifdef __cplusplus
+}
+#endif
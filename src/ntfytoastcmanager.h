@@ -0,0 +1,45 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "ntfytoastc.h"
+#include "toastdispatcher.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+/*
+    Not part of the C interface.
+
+    ntfytoast_manager_create() uses the backend of the platform, createToastManager() runs
+    the C interface on top of any ToastBackend. The renderer turns the C description of a
+    toast, with its resolved id, into a submission.
+*/
+
+using ToastRenderer = std::function<ToastSubmission(
+        const std::wstring &appID, const std::wstring &id, const ntfytoast_toast &toast)>;
+
+ntfytoast_manager *createToastManager(const std::wstring &appID,
+                                      std::shared_ptr<ToastBackend> backend,
+                                      ToastRenderer renderer);
@@ -0,0 +1,880 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "ntfytoastactions.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+/*
+    Header only helpers for applications receiving NtfyToast callbacks.
+
+    The callbacks written to -pipeName are "key=value;" lists terminated by a null
+    character, a text reply is appended as the last field "text=..." and may contain any
+    character. With -pipeEncoding utf16 (the default) the characters are UTF-16 code
+    units, with utf8 they are bytes.
+
+        NtfyToastConsumer::CallbackDecoder<char> decoder;
+        decoder.feed(buffer, size, [](const NtfyToastConsumer::CallbackMessage<char> &msg) {
+            if (msg.action() == NtfyToastActions::Actions::ButtonClicked) {
+                handleButton(msg.value("button"));
+            }
+        });
+*/
+
+namespace NtfyToastConsumer {
+
+/*
+    A decoded callback.
+    The message does not own its data, the views are valid until the next call to the
+    decoder that produced it.
+*/
+
+template<typename Char>
+class CallbackMessage
+{
+public:
+    using View = std::basic_string_view<Char>;
+
+    explicit CallbackMessage(View raw) : m_raw(raw) { }
+
+    View raw() const { return m_raw; }
+
+    // bool f(View key, View value) is called for every field, return false to stop
+    template<typename F>
+    void forEach(F &&f) const
+    {
+        size_t start = 0;
+        while (start < m_raw.size()) {
+            const View rest = m_raw.substr(start);
+            // the text reply is the last field and is not escaped
+            if (startsWith(rest, "text=")) {
+                f(rest.substr(0, 4), rest.substr(5));
+                return;
+            }
+            size_t end = rest.find(Char(';'));
+            if (end == View::npos) {
+                end = rest.size();
+            }
+            const View field = rest.substr(0, end);
+            const size_t pos = field.find(Char('='));
+            if (pos != View::npos && pos > 0) {
+                if (!f(field.substr(0, pos), field.substr(pos + 1))) {
+                    return;
+                }
+            }
+            start += end + 1;
+        }
+    }
+
+    // an empty view if the key is not part of the message
+    View value(std::string_view key) const
+    {
+        View out;
+        forEach([&](View k, View v) {
+            if (equals(k, key)) {
+                out = v;
+                return false;
+            }
+            return true;
+        });
+        return out;
+    }
+
+    NtfyToastActions::Actions action() const
+    {
+        static constexpr NtfyToastActions::Actions actions[] = {
+            NtfyToastActions::Actions::Clicked,       NtfyToastActions::Actions::Hidden,
+            NtfyToastActions::Actions::Dismissed,     NtfyToastActions::Actions::Timedout,
+            NtfyToastActions::Actions::ButtonClicked, NtfyToastActions::Actions::TextEntered
+        };
+        const View name = value("action");
+        for (const auto a : actions) {
+            if (equals(name, NtfyToastActions::getActionString(a))) {
+                return a;
+            }
+        }
+        return NtfyToastActions::Actions::Error;
+    }
+
+    View notificationId() const { return value("notificationId"); }
+    View correlationId() const { return value("correlationId"); }
+
+    /**
+     * The submittedAt, shownAt or actedAt field, milliseconds on the monotonic clock of the
+     * system, comparable between processes until the next reboot. Empty if the callback
+     * does not carry it, callbacks from the Action Center have no shownAt.
+     */
+    std::optional<std::chrono::milliseconds> timestamp(std::string_view key) const
+    {
+        const View digits = value(key);
+        if (digits.empty() || digits.size() > 18) {
+            return {};
+        }
+        int64_t ms = 0;
+        for (const Char c : digits) {
+            if (c < Char('0') || c > Char('9')) {
+                return {};
+            }
+            ms = ms * 10 + (c - Char('0'));
+        }
+        return std::chrono::milliseconds(ms);
+    }
+
+private:
+    // keys and action names are ASCII, compare them code unit by code unit
+    template<typename String>
+    static bool equals(View a, const String &b)
+    {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (static_cast<uint32_t>(a[i]) != static_cast<uint32_t>(b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool startsWith(View a, std::string_view prefix)
+    {
+        return a.size() >= prefix.size() && equals(a.substr(0, prefix.size()), prefix);
+    }
+
+    View m_raw;
+};
+
+/*
+    Incremental decoder for the callback stream.
+
+    Feed it the bytes in whatever chunks they arrive, complete messages are handed to the
+    handler as views into the chunk, only a message split between two chunks is copied.
+    Char is char for utf8 and char16_t, or wchar_t on Windows, for utf16.
+*/
+
+template<typename Char>
+class CallbackDecoder
+{
+    static_assert(sizeof(Char) <= 2, "callbacks are either UTF-8 or UTF-16");
+
+public:
+    using Message = CallbackMessage<Char>;
+    using View = typename Message::View;
+
+    // returns the number of messages passed to onMessage
+    template<typename Handler>
+    size_t feed(const void *data, size_t size, Handler &&onMessage)
+    {
+        const char *bytes = static_cast<const char *>(data);
+        size_t count = 0;
+
+        // complete the message started by an earlier chunk
+        if (!m_pending.empty()) {
+            while (size > 0) {
+                m_pending.push_back(*bytes++);
+                --size;
+                if (m_pending.size() % sizeof(Char) == 0 && isTerminator(pendingTail())) {
+                    deliver(m_pending.data(), m_pending.size() - sizeof(Char), onMessage);
+                    ++count;
+                    m_pending.clear();
+                    break;
+                }
+            }
+        }
+
+        // the views must be aligned, copy the rest if they are not
+        if (reinterpret_cast<uintptr_t>(bytes) % alignof(Char) != 0) {
+            m_pending.insert(m_pending.end(), bytes, bytes + size);
+            return count + drainPending(onMessage);
+        }
+
+        const Char *chars = reinterpret_cast<const Char *>(bytes);
+        const size_t length = size / sizeof(Char);
+        size_t start = 0;
+        for (size_t i = 0; i < length; ++i) {
+            if (chars[i] == Char(0)) {
+                if (i > start) {
+                    const Message message(View(chars + start, i - start));
+                    onMessage(message);
+                    ++count;
+                }
+                start = i + 1;
+            }
+        }
+        m_pending.insert(m_pending.end(), bytes + start * sizeof(Char), bytes + size);
+        return count;
+    }
+
+    /*
+        The end of the connection.
+        NtfyToast closes the pipe after each callback, a message without terminator is
+        complete at this point.
+    */
+    template<typename Handler>
+    size_t finish(Handler &&onMessage)
+    {
+        size_t count = 0;
+        const size_t length = m_pending.size() - m_pending.size() % sizeof(Char);
+        if (length > 0) {
+            deliver(m_pending.data(), length, onMessage);
+            count = 1;
+        }
+        m_pending.clear();
+        return count;
+    }
+
+    // bytes of an incomplete message
+    size_t buffered() const { return m_pending.size(); }
+
+private:
+    static bool isTerminator(const char *c)
+    {
+        for (size_t i = 0; i < sizeof(Char); ++i) {
+            if (c[i] != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const char *pendingTail() const { return m_pending.data() + m_pending.size() - sizeof(Char); }
+
+    template<typename Handler>
+    void deliver(const char *data, size_t size, Handler &onMessage)
+    {
+        // m_pending is allocated by new and therefore suitably aligned
+        const View view(reinterpret_cast<const Char *>(data), size / sizeof(Char));
+        if (!view.empty()) {
+            const Message message(view);
+            onMessage(message);
+        }
+    }
+
+    template<typename Handler>
+    size_t drainPending(Handler &onMessage)
+    {
+        size_t count = 0;
+        size_t start = 0;
+        for (size_t i = 0; i + sizeof(Char) <= m_pending.size(); i += sizeof(Char)) {
+            if (isTerminator(m_pending.data() + i)) {
+                if (i > start) {
+                    deliver(m_pending.data() + start, i - start, onMessage);
+                    ++count;
+                }
+                start = i + sizeof(Char);
+            }
+        }
+        m_pending.erase(m_pending.begin(), m_pending.begin() + start);
+        return count;
+    }
+
+    std::vector<char> m_pending;
+};
+
+/*
+    Accepts the connections of NtfyToast and decodes the callbacks.
+
+    On Windows the address is the name passed to -pipeName, e.g. \\.\pipe\myapp,
+    elsewhere it is the path of a Unix domain socket.
+    run() blocks until stop() is called from another thread or a handler.
+*/
+
+template<typename Char>
+class CallbackServer
+{
+public:
+    using Message = CallbackMessage<Char>;
+    using Handler = std::function<void(const Message &)>;
+#ifdef _WIN32
+    using Address = std::wstring;
+#else
+    using Address = std::string;
+#endif
+
+    CallbackServer(Address address, Handler handler)
+        : m_address(std::move(address)), m_handler(std::move(handler))
+    {
+    }
+
+    ~CallbackServer() { stop(); }
+
+    bool run()
+    {
+#ifdef _WIN32
+        while (!m_stopped) {
+            HANDLE pipe = CreateNamedPipeW(m_address.c_str(), PIPE_ACCESS_INBOUND,
+                                           PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+                                           PIPE_UNLIMITED_INSTANCES, BufferSize, BufferSize, 0,
+                                           nullptr);
+            if (pipe == INVALID_HANDLE_VALUE) {
+                return false;
+            }
+            if (ConnectNamedPipe(pipe, nullptr) || GetLastError() == ERROR_PIPE_CONNECTED) {
+                if (!m_stopped) {
+                    readConnection(pipe);
+                }
+            }
+            CloseHandle(pipe);
+        }
+        return true;
+#else
+        const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (server < 0) {
+            return false;
+        }
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        if (m_address.size() >= sizeof(address.sun_path)) {
+            close(server);
+            return false;
+        }
+        std::memcpy(address.sun_path, m_address.c_str(), m_address.size() + 1);
+        unlink(m_address.c_str());
+        if (bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+            || listen(server, SOMAXCONN) != 0) {
+            close(server);
+            return false;
+        }
+        m_socket = server;
+        while (!m_stopped) {
+            const int client = accept(server, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            readConnection(client);
+            close(client);
+        }
+        m_socket = -1;
+        close(server);
+        unlink(m_address.c_str());
+        return true;
+#endif
+    }
+
+    void stop()
+    {
+        if (m_stopped.exchange(true)) {
+            return;
+        }
+#ifdef _WIN32
+        // wake up ConnectNamedPipe
+        HANDLE pipe = CreateFileW(m_address.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0,
+                                  nullptr);
+        if (pipe != INVALID_HANDLE_VALUE) {
+            CloseHandle(pipe);
+        }
+#else
+        const int server = m_socket;
+        if (server >= 0) {
+            // wake up accept
+            shutdown(server, SHUT_RDWR);
+        }
+#endif
+    }
+
+private:
+    static constexpr size_t BufferSize = 4096;
+
+    template<typename Connection>
+    void readConnection(Connection connection)
+    {
+        CallbackDecoder<Char> decoder;
+        const auto onMessage = [this](const Message &message) { m_handler(message); };
+        // keep the buffer aligned for the views of the decoder
+        alignas(alignof(std::max_align_t)) char buffer[BufferSize];
+        while (true) {
+#ifdef _WIN32
+            DWORD read = 0;
+            if (!ReadFile(connection, buffer, BufferSize, &read, nullptr) || read == 0) {
+                break;
+            }
+#else
+            const ssize_t read = ::read(connection, buffer, BufferSize);
+            if (read <= 0) {
+                break;
+            }
+#endif
+            decoder.feed(buffer, static_cast<size_t>(read), onMessage);
+        }
+        decoder.finish(onMessage);
+    }
+
+    Address m_address;
+    Handler m_handler;
+    std::atomic<bool> m_stopped { false };
+#ifndef _WIN32
+    std::atomic<int> m_socket { -1 };
+#endif
+};
+
+/*
+    A ring in shared memory for consumers that receive thousands of callbacks, it saves
+    the connection, the syscalls and the copies of the pipe per callback. ntfytoast writes
+    to it with -callbacks ring, the consumer creates it with the address it would listen on
+    otherwise. Without a consumer attached to the ring the callbacks go to the pipe.
+
+    The ring holds records of a uint32 size and the callback without terminator, aligned
+    to 8 bytes. The write index is owned by the producer and the read index by the consumer,
+    each in its own cache line. A consumer that found the ring empty sets waiting and
+    sleeps on a futex, respectively a named event on Windows, the producer only signals it
+    then. A batch of callbacks costs the consumer a single wakeup.
+
+    The ring has one producer at a time: several ntfytoast processes may write to it, they
+    take a spin lock in the shared memory around a push. A push fails if the ring is full
+    or the lock is not free within a few milliseconds, the callback is written to the pipe
+    instead then.
+*/
+
+class SharedRing
+{
+public:
+#ifdef _WIN32
+    using Address = std::wstring;
+#else
+    using Address = std::string;
+#endif
+    static constexpr size_t DefaultCapacity = 1024 * 1024;
+
+    /**
+     * For the consumer. Opens the ring of address a previous consumer left behind, so the
+     * callbacks it did not read are not lost, or creates it. The capacity is a power of two.
+     * On POSIX systems the ring stays in /dev/shm, it is reused by the next consumer.
+     */
+    static std::unique_ptr<SharedRing> create(const Address &address,
+                                              size_t capacity = DefaultCapacity)
+    {
+        if (capacity < 4096 || (capacity & (capacity - 1)) != 0) {
+            return {};
+        }
+        std::unique_ptr<SharedRing> ring(new SharedRing(true));
+        if (!ring->map(address, capacity)) {
+            return {};
+        }
+        Header *header = ring->m_header;
+        if (header->magic != Magic || header->capacity != capacity) {
+            header->head = 0;
+            header->tail = 0;
+            header->capacity = capacity;
+            header->magic = Magic;
+        }
+        header->producerLock = 0;
+        header->attached = 1;
+        return ring;
+    }
+
+    // for the producer, fails if no consumer is attached
+    static std::unique_ptr<SharedRing> open(const Address &address)
+    {
+        std::unique_ptr<SharedRing> ring(new SharedRing(false));
+        if (!ring->map(address, 0) || ring->m_header->magic != Magic || !ring->attached()) {
+            return {};
+        }
+        return ring;
+    }
+
+    ~SharedRing()
+    {
+        if (m_owner && m_header) {
+            m_header->attached = 0;
+        }
+#ifdef _WIN32
+        if (m_header) {
+            UnmapViewOfFile(m_header);
+        }
+        if (m_mapping) {
+            CloseHandle(m_mapping);
+        }
+        if (m_event) {
+            CloseHandle(m_event);
+        }
+#else
+        if (m_header) {
+            munmap(m_header, m_size);
+        }
+#endif
+    }
+
+    SharedRing(const SharedRing &) = delete;
+    SharedRing &operator=(const SharedRing &) = delete;
+
+    // false once the consumer left or replaced the ring with one of another capacity
+    bool attached() const
+    {
+        return m_header->attached.load(std::memory_order_relaxed) != 0
+                && m_header->capacity == m_capacity;
+    }
+
+    // returns false if the ring is full, no consumer is attached or the lock is busy
+    bool push(const void *data, size_t size)
+    {
+        Header *header = m_header;
+        const uint64_t capacity = m_capacity;
+        const uint64_t need = align(RecordHeader + size);
+        if (need > capacity / 2 || !attached() || !lock()) {
+            return false;
+        }
+        uint64_t head = header->head.load(std::memory_order_relaxed);
+        const uint64_t tail = header->tail.load(std::memory_order_acquire);
+        const uint64_t position = head & (capacity - 1);
+        // a record does not wrap, the rest of the ring is skipped instead
+        const uint64_t skip = capacity - position < need ? capacity - position : 0;
+        if (head + skip + need - tail > capacity) {
+            unlock();
+            return false;
+        }
+        if (skip > 0) {
+            const uint32_t wrap = WrapMarker;
+            std::memcpy(m_data + position, &wrap, sizeof(wrap));
+            head += skip;
+        }
+        const auto recordSize = static_cast<uint32_t>(size);
+        char *record = m_data + (head & (capacity - 1));
+        std::memcpy(record, &recordSize, sizeof(recordSize));
+        std::memcpy(record + RecordHeader, data, size);
+        header->head.store(head + need, std::memory_order_release);
+        unlock();
+
+        // pairs with the fence in wait(), either the consumer sees the record or we see it
+        // waiting. Only the first producer to see it waiting wakes it.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (header->waiting.load(std::memory_order_relaxed)
+            && header->waiting.exchange(0, std::memory_order_relaxed)) {
+            wake();
+        }
+        return true;
+    }
+
+    /**
+     * Hands every record to f(const char *data, size_t size), the data is valid until f
+     * returns. Returns the number of records.
+     * Every process may write to the ring, a record that does not fit in the ring ends the
+     * drain and the records after it are dropped.
+     */
+    template<typename F>
+    size_t drain(F &&f)
+    {
+        Header *header = m_header;
+        const uint64_t capacity = m_capacity;
+        uint64_t tail = header->tail.load(std::memory_order_relaxed);
+        const uint64_t head = header->head.load(std::memory_order_acquire);
+        if (head - tail > capacity) {
+            header->tail.store(head, std::memory_order_release);
+            return 0;
+        }
+        size_t count = 0;
+        while (tail != head) {
+            const uint64_t position = tail & (capacity - 1);
+            uint32_t size;
+            std::memcpy(&size, m_data + position, sizeof(size));
+            if (size == WrapMarker && capacity - position <= head - tail) {
+                tail += capacity - position;
+                continue;
+            }
+            if (size > capacity - position - RecordHeader
+                || align(RecordHeader + size) > head - tail) {
+                tail = head;
+                break;
+            }
+            f(static_cast<const char *>(m_data + position + RecordHeader), size_t(size));
+            tail += align(RecordHeader + size);
+            ++count;
+        }
+        header->tail.store(tail, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * Sleeps until a record is pushed, the timeout passed or wake() was called.
+     * Returns true if the ring is not empty.
+     */
+    bool wait(std::chrono::milliseconds timeout)
+    {
+        Header *header = m_header;
+        // a producer sending a burst is usually back within microseconds, that is cheaper
+        // than a wakeup per record. On a single core the spin would only delay it.
+        static const bool multicore = std::thread::hardware_concurrency() > 1;
+        const auto spinUntil = std::chrono::steady_clock::now() + std::chrono::microseconds(50);
+        for (size_t spin = 1; multicore && empty(); ++spin) {
+            if (spin % 64 == 0 && std::chrono::steady_clock::now() > spinUntil) {
+                break;
+            }
+        }
+        const uint32_t signal = header->signal.load(std::memory_order_acquire);
+        header->waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!empty()) {
+            header->waiting.store(0, std::memory_order_relaxed);
+            return true;
+        }
+#ifdef _WIN32
+        (void)signal;
+        WaitForSingleObject(m_event, static_cast<DWORD>(timeout.count()));
+#elif defined(__linux__)
+        timespec time { static_cast<time_t>(timeout.count() / 1000),
+                        static_cast<long>(timeout.count() % 1000) * 1000000 };
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&header->signal), FUTEX_WAIT, signal,
+                &time, nullptr, 0);
+#else
+        const auto until = std::chrono::steady_clock::now() + timeout;
+        while (header->signal.load(std::memory_order_acquire) == signal
+               && std::chrono::steady_clock::now() < until) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+#endif
+        header->waiting.store(0, std::memory_order_relaxed);
+        return !empty();
+    }
+
+    // wakes up a consumer in wait()
+    void wake()
+    {
+        m_header->signal.fetch_add(1, std::memory_order_release);
+#ifdef _WIN32
+        SetEvent(m_event);
+#elif defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&m_header->signal), FUTEX_WAKE, 1,
+                nullptr, nullptr, 0);
+#endif
+    }
+
+    bool empty() const
+    {
+        return m_header->head.load(std::memory_order_acquire)
+                == m_header->tail.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint32_t Magic = 0x474e4952; // "RING"
+    static constexpr uint32_t WrapMarker = 0xffffffff;
+    static constexpr size_t RecordHeader = sizeof(uint32_t);
+    static constexpr size_t CacheLine = 64;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t reserved;
+        uint64_t capacity;
+        std::atomic<uint32_t> attached;
+        std::atomic<uint32_t> producerLock;
+        alignas(CacheLine) std::atomic<uint64_t> head;
+        alignas(CacheLine) std::atomic<uint64_t> tail;
+        alignas(CacheLine) std::atomic<uint32_t> waiting;
+        std::atomic<uint32_t> signal;
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free
+                          && std::atomic<uint32_t>::is_always_lock_free,
+                  "the indices are shared between processes");
+    static constexpr size_t DataOffset = (sizeof(Header) + CacheLine - 1) / CacheLine * CacheLine;
+
+    explicit SharedRing(bool owner) : m_owner(owner) { }
+
+    static uint64_t align(uint64_t size) { return (size + 7) & ~uint64_t(7); }
+
+    bool lock()
+    {
+        const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(5);
+        for (size_t spin = 0;; ++spin) {
+            uint32_t expected = 0;
+            if (m_header->producerLock.compare_exchange_weak(expected, 1,
+                                                             std::memory_order_acquire)) {
+                return true;
+            }
+            if (spin % 64 == 63) {
+                if (std::chrono::steady_clock::now() > until) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void unlock() { m_header->producerLock.store(0, std::memory_order_release); }
+
+    // the last component of the address, usable as name of a shared memory object
+    static Address ringName(const Address &address)
+    {
+        Address name = address.substr(address.find_last_of(Address::value_type('/')) + 1);
+        name = name.substr(name.find_last_of(Address::value_type('\\')) + 1);
+        for (auto &c : name) {
+            if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                  || c == '-' || c == '.')) {
+                c = '_';
+            }
+        }
+        return name;
+    }
+
+    bool map(const Address &address, size_t capacity)
+    {
+#ifdef _WIN32
+        const std::wstring name = L"Local\\ntfytoast-ring-" + ringName(address);
+        if (m_owner) {
+            const uint64_t size = DataOffset + capacity;
+            m_mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                           static_cast<DWORD>(size >> 32),
+                                           static_cast<DWORD>(size), name.c_str());
+        } else {
+            m_mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, false, name.c_str());
+        }
+        if (!m_mapping) {
+            return false;
+        }
+        m_header = static_cast<Header *>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+        m_event = CreateEventW(nullptr, false, false, (name + L"-wake").c_str());
+        MEMORY_BASIC_INFORMATION info;
+        if (!m_header || !m_event || !VirtualQuery(m_header, &info, sizeof(info))) {
+            return false;
+        }
+        // an existing mapping keeps its size
+        const size_t size = info.RegionSize;
+#else
+        const std::string name = "/ntfytoast-ring-" + ringName(address);
+        const int fd = shm_open(name.c_str(), m_owner ? O_RDWR | O_CREAT : O_RDWR, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            return false;
+        }
+        m_size = m_owner ? DataOffset + capacity : static_cast<size_t>(info.st_size);
+        if ((m_owner && static_cast<size_t>(info.st_size) != m_size
+             && ftruncate(fd, static_cast<off_t>(m_size)) != 0)
+            || m_size < DataOffset + 4096) {
+            close(fd);
+            return false;
+        }
+        void *memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        m_header = static_cast<Header *>(memory);
+        const size_t size = m_size;
+#endif
+        m_capacity = m_owner ? capacity : m_header->capacity;
+        if (m_capacity + DataOffset > size) {
+            return false;
+        }
+        m_data = reinterpret_cast<char *>(m_header) + DataOffset;
+        return true;
+    }
+
+    const bool m_owner;
+    Header *m_header = nullptr;
+    char *m_data = nullptr;
+    uint64_t m_capacity = 0;
+#ifdef _WIN32
+    HANDLE m_mapping = nullptr;
+    HANDLE m_event = nullptr;
+#else
+    size_t m_size = 0;
+#endif
+};
+
+/*
+    Receives the callbacks of -callbacks ring, see SharedRing.
+    run() blocks until stop() is called from another thread or a handler.
+*/
+
+template<typename Char>
+class RingCallbackServer
+{
+public:
+    using Message = CallbackMessage<Char>;
+    using Handler = std::function<void(const Message &)>;
+
+    RingCallbackServer(SharedRing::Address address, Handler handler,
+                       size_t capacity = SharedRing::DefaultCapacity)
+        : m_address(std::move(address)), m_handler(std::move(handler)), m_capacity(capacity)
+    {
+    }
+
+    ~RingCallbackServer() { stop(); }
+
+    bool run()
+    {
+        const std::shared_ptr<SharedRing> ring = SharedRing::create(m_address, m_capacity);
+        if (!ring) {
+            return false;
+        }
+        std::atomic_store(&m_ring, ring);
+        while (!m_stopped) {
+            ring->drain([this](const char *data, size_t size) {
+                // records are aligned to 8 bytes, the views are aligned for Char
+                m_handler(Message(typename Message::View(reinterpret_cast<const Char *>(data),
+                                                         size / sizeof(Char))));
+            });
+            if (!m_stopped) {
+                ring->wait(std::chrono::milliseconds(100));
+            }
+        }
+        std::atomic_store(&m_ring, std::shared_ptr<SharedRing>());
+        return true;
+    }
+
+    void stop()
+    {
+        m_stopped = true;
+        if (const auto ring = std::atomic_load(&m_ring)) {
+            ring->wake();
+        }
+    }
+
+private:
+    SharedRing::Address m_address;
+    Handler m_handler;
+    const size_t m_capacity;
+    std::atomic<bool> m_stopped { false };
+    std::shared_ptr<SharedRing> m_ring;
+};
+}
@@ -21,82 +21,114 @@
     SOFTWARE.
 */
 
+
 #include "ntfytoasts.h"
 #include "toasteventhandler.h"
+#include "wintoastbackend.h"
+#include "toastcontent.h"
 #include "linkhelper.h"
 #include "utils.h"
+#include "timerwheel.h"
+#include "metrics.h"
+#include "allocationcounter.h"
+#include "callbackformat.h"
+#include "callbacksink.h"
+#include "toastcommands.h"
 #include "config.h"
 
-#include <wrl\wrappers\corewrappers.h>
+#include <algorithm>
+#include <atomic>
 #include <sstream>
 #include <iostream>
 
-using namespace Microsoft::WRL;
-using namespace ABI::Windows::UI;
-using namespace ABI::Windows::UI::Notifications;
-using namespace ABI::Windows::Data::Xml::Dom;
-using namespace Windows::Foundation;
-using namespace Wrappers;
-
 namespace {
 constexpr DWORD EVENT_TIMEOUT = 60 * 1000; // one minute should be more than enough
+constexpr wchar_t TOAST_GROUP[] = L"NtfyToast";
+
+using CallbackFormat::appendField;
+using CallbackFormat::appendListItem;
 }
 
 class NtfyToastsPrivate
 {
 public:
-    NtfyToastsPrivate(NtfyToasts *parent, const std::wstring &appID)
-        : m_parent(parent), m_appID(appID), m_id(std::to_wstring(GetCurrentProcessId()))
+    NtfyToastsPrivate(NtfyToasts *parent, const std::wstring &appID,
+                      std::shared_ptr<ToastBackend> backend)
+        : m_parent(parent),
+          m_appID(appID),
+          m_id(std::to_wstring(GetCurrentProcessId())),
+          m_backend(backend ? std::move(backend) : std::make_shared<WinToastBackend>())
     {
-
-        ComPtr<IShellItem> app;
-        if (FAILED(SHCreateItemFromParsingName(std::wstring(L"shell:AppsFolder\\" + m_appID).data(),
-                                               nullptr, IID_PPV_ARGS(&app)))) {
-            m_useFallbackMode = true;
-            tLog << "AppUserModelId:" << m_appID
-                 << " is not properly registered. Using fallback mode. Only click actions will be "
-                    "availible";
-        }
-
-        HRESULT hr = GetActivationFactory(
-                HStringReference(RuntimeClass_Windows_UI_Notifications_ToastNotificationManager)
-                        .Get(),
-                &m_toastManager);
-        if (!SUCCEEDED(hr)) {
-            std::wcerr << L"NtfyToasts: Failed to register com Factory, please make sure you "
-                          L"correctly initialised with RO_INIT_MULTITHREADED"
-                       << std::endl;
-            m_action = NtfyToastActions::Actions::Error;
-        }
     }
     NtfyToasts *m_parent;
 
     std::wstring m_appID;
     std::filesystem::path m_pipeName;
+    PipeEncoding m_pipeEncoding = PipeEncoding::Utf16;
     std::filesystem::path m_application;
+    std::wstring m_correlationId;
+    // empty for all actions and fields
+    std::vector<NtfyToastActions::Actions> m_notifiedActions;
+    std::vector<std::wstring> m_callbackFields;
 
     std::wstring m_title;
     std::wstring m_body;
     std::filesystem::path m_image;
     std::wstring m_sound = L"Notification.Default";
     std::wstring m_id;
+    std::wstring m_group = TOAST_GROUP;
     std::wstring m_buttons;
     bool m_silent = false;
     bool m_textbox = false;
     bool m_persistent = false;
 
-    bool m_useFallbackMode = false;
-
     Duration m_duration = Duration::Short;
+    std::optional<std::chrono::system_clock::time_point> m_expirationTime;
+
+    TimerWheel m_timers;
+    std::chrono::steady_clock::time_point m_shownAt;
+    // the timestamps of the callbacks, empty if unknown. shownAt is read by the callbacks,
+    // which may arrive before displayToast() returns.
+    std::wstring m_submittedAt;
+    std::atomic<std::chrono::steady_clock::rep> m_shownAtTicks { 0 };
 
     NtfyToastActions::Actions m_action = NtfyToastActions::Actions::Clicked;
 
-    ComPtr<IXmlDocument> m_toastXml;
-    ComPtr<IToastNotificationManagerStatics> m_toastManager;
-    ComPtr<IToastNotifier> m_notifier;
-    ComPtr<IToastNotification> m_notification;
+    std::shared_ptr<ToastBackend> m_backend;
+    std::shared_ptr<ToastEventHandler> m_eventHanlder;
+    // shared with the event handler of the shown toast
+    std::shared_ptr<ToastCallbackFormatter> m_callbacks;
+
+    // notificationId, correlationId, pipe, application, encoding, notify, fields and version,
+    // cleared by their setters
+    std::wstring m_actionPrefix;
 
-    ComPtr<ToastEventHandler> m_eventHanlder;
+    const std::wstring &actionPrefix()
+    {
+        if (m_actionPrefix.empty()) {
+            appendField(m_actionPrefix, L"notificationId", m_id);
+            appendField(m_actionPrefix, L"correlationId", m_correlationId);
+            appendField(m_actionPrefix, L"pipe", m_pipeName.native());
+            appendField(m_actionPrefix, L"application", m_application.native());
+            // utf-16 is the default, keep the data unchanged for existing consumers
+            if (m_pipeEncoding == PipeEncoding::Utf8) {
+                appendField(m_actionPrefix, L"encoding", L"utf8");
+            }
+            // read by CallbackFilter, they are not written to the consumer
+            std::wstring list;
+            for (const auto action : m_notifiedActions) {
+                appendListItem(list, NtfyToastActions::getActionString(action));
+            }
+            appendField(m_actionPrefix, L"notify", list);
+            list.clear();
+            for (const auto &field : m_callbackFields) {
+                appendListItem(list, field);
+            }
+            appendField(m_actionPrefix, L"fields", list);
+            appendField(m_actionPrefix, L"version", NTFYTOAST_VERSION);
+        }
+        return m_actionPrefix;
+    }
 
     static HANDLE ctoastEvent()
     {
@@ -107,173 +139,175 @@ public:
         }();
         return _event;
     }
-
-    ComPtr<IToastNotificationHistory> getHistory()
-    {
-        ComPtr<IToastNotificationManagerStatics2> toastStatics2;
-        if (ST_CHECK_RESULT(m_toastManager.As(&toastStatics2))) {
-            ComPtr<IToastNotificationHistory> nativeHistory;
-            ST_CHECK_RESULT(toastStatics2->get_History(&nativeHistory));
-            return nativeHistory;
-        }
-        return {};
-    }
 };
 
-NtfyToasts::NtfyToasts(const std::wstring &appID) : d(new NtfyToastsPrivate(this, appID))
+NtfyToasts::NtfyToasts(const std::wstring &appID, std::shared_ptr<ToastBackend> backend)
+    : d(new NtfyToastsPrivate(this, appID, std::move(backend)))
 {
-    Utils::registerActivator();
 }
 
 NtfyToasts::~NtfyToasts()
 {
-    Utils::unregisterActivator();
     delete d;
 }
 
 HRESULT NtfyToasts::displayToast(const std::wstring &title, const std::wstring &body,
                                   const std::filesystem::path &image)
 {
+    const auto start = std::chrono::steady_clock::now();
+
     // asume that we fail
     d->m_action = NtfyToastActions::Actions::Error;
 
-    d->m_title = title;
-    d->m_body = body;
-    d->m_image = std::filesystem::absolute(image);
-
-    /*
-        Templates   : https://learn.microsoft.com/en-us/uwp/api/windows.ui.notifications.toasttemplatetype?view=winrt-26100#fields
-
-        Structure:
-            toast:      The launch attribute of this element defines what arguments will be passed back to your app when the user clicks your toast, allowing you to deep link into the correct content that the toast was displaying. To learn more, see Send a local app notification.
-            visual:     This element represents visual portion of the toast, including the generic binding that contains text and images.
-            actions:    This element represents interactive portion of the toast, including inputs and actions.
-            audio:      This element specifies the audio played when the toast is shown to the user.
-    */
-
-    if (!d->m_image.empty()) {
-        ST_RETURN_ON_ERROR(d->m_toastManager->GetTemplateContent(ToastTemplateType_ToastImageAndText02, &d->m_toastXml));
-    } else {
-        ST_RETURN_ON_ERROR(d->m_toastManager->GetTemplateContent(ToastTemplateType_ToastText02, &d->m_toastXml));
-    }
-
-    ComPtr<ABI::Windows::Data::Xml::Dom::IXmlNodeList> rootList;
-    ST_RETURN_ON_ERROR(
-            d->m_toastXml->GetElementsByTagName(HStringReference(L"toast").Get(), &rootList));
-
-    ComPtr<IXmlNode> root;
-    ST_RETURN_ON_ERROR(rootList->Item(0, &root));
-    ComPtr<IXmlNamedNodeMap> rootAttributes;
-    ST_RETURN_ON_ERROR(root->get_Attributes(&rootAttributes));
-
-    const auto data = formatAction(NtfyToastActions::Actions::Clicked);
-    ST_RETURN_ON_ERROR(addAttribute(L"launch", rootAttributes.Get(), data));
-
-    /*
-        activationType 	Decides the type of activation that will be used when the user interacts with a specific action.
-
-            "foreground"    - Default value. Your foreground app is launched.
-            "background"    - Your corresponding background task is triggered, and you can execute code in the background without interrupting the user.
-            "protocol"      - Launch a different app using protocol activation.
-    */
-
-    ST_RETURN_ON_ERROR(addAttribute(L"activationType", rootAttributes.Get(), L"protocol"));
-
-    /*
-        If -persistent is provided in arguments, notification will stay on screen until dismissed by user.
-
-        scenario? = "reminder" | "alarm" | "incomingCall" | "urgent" 
-    */
-
-    if (d->m_persistent) {
-        ST_RETURN_ON_ERROR(addAttribute(L"scenario", rootAttributes.Get(), L"incomingCall"));
-    }
-
-    ST_RETURN_ON_ERROR(addAttribute(L"duration", rootAttributes.Get(),
-                                    d->m_duration == Duration::Short ? L"short" : L"long"));
-    // Adding buttons
-    if (!d->m_buttons.empty()) {
-        setButtons(root);
-    } else if (d->m_textbox) {
-        setTextBox(root);
-    }
-    
-    ComPtr<ABI::Windows::Data::Xml::Dom::IXmlElement> audioElement;
-    ST_RETURN_ON_ERROR(
-            d->m_toastXml->CreateElement(HStringReference(L"audio").Get(), &audioElement));
-
-    ComPtr<IXmlNode> audioNodeTmp;
-    ST_RETURN_ON_ERROR(audioElement.As(&audioNodeTmp));
-
-    ComPtr<IXmlNode> audioNode;
-    ST_RETURN_ON_ERROR(root->AppendChild(audioNodeTmp.Get(), &audioNode));
-
-    ComPtr<IXmlNamedNodeMap> attributes;
-    ST_RETURN_ON_ERROR(audioNode->get_Attributes(&attributes));
-    ST_RETURN_ON_ERROR(addAttribute(L"src", attributes.Get()));
-    ST_RETURN_ON_ERROR(addAttribute(L"silent", attributes.Get()));
-
-    //    printXML();
+    const auto xml = render(title, body, image);
+    printXML(xml);
 
-    if (!d->m_image.empty()) {
-        ST_RETURN_ON_ERROR(setImage());
-    }
-
-    ST_RETURN_ON_ERROR(setSound());
+    // the activator must be known before the toast can be activated
+    d->m_backend->registerActivator();
+    ST_RETURN_ON_ERROR(createToast(xml));
+    d->m_action = NtfyToastActions::Actions::Clicked;
 
-    ST_RETURN_ON_ERROR(setTextValues());
+    d->m_shownAt = std::chrono::steady_clock::now();
+    setShownAt(d->m_shownAt);
+    Metrics::instance().recordShow(
+            std::chrono::duration_cast<std::chrono::microseconds>(d->m_shownAt - start));
+    return S_OK;
+}
 
-    /*
-    std::wcerr  << L" --- " << d->m_toastXml << std::endl;
-    */
+ToastSubmission NtfyToasts::submission(const std::wstring &title, const std::wstring &body,
+                                       const std::filesystem::path &image) const
+{
+    ToastSubmission out;
+    out.request = { d->m_appID, d->m_id, d->m_group, render(title, body, image),
+                    d->m_expirationTime };
+    out.priority = priority();
+    return out;
+}
 
-    printXML();
-    ST_RETURN_ON_ERROR(createToast());
-    d->m_action = NtfyToastActions::Actions::Clicked;
-    return S_OK;
+std::wstring NtfyToasts::render(const std::wstring &title, const std::wstring &body,
+                                const std::filesystem::path &image) const
+{
+    d->m_title = title;
+    d->m_body = body;
+    d->m_image = image.empty() ? image : std::filesystem::absolute(image);
+    d->m_submittedAt = CallbackFormat::timestamp(std::chrono::steady_clock::now());
+
+    ToastContent content;
+    content.title = d->m_title;
+    content.body = d->m_body;
+    content.image = d->m_image.native();
+    content.sound = d->m_sound;
+    content.buttons = d->m_buttons;
+    content.silent = d->m_silent;
+    content.textBox = d->m_textbox;
+    content.persistent = d->m_persistent;
+    content.longDuration = d->m_duration == Duration::Long;
+    return content.render(d->actionPrefix(), d->m_submittedAt);
 }
 
 NtfyToastActions::Actions NtfyToasts::userAction()
 {
-    if (d->m_eventHanlder.Get()) {
-        HANDLE event = d->m_eventHanlder.Get()->event();
-        if (WaitForSingleObject(event, EVENT_TIMEOUT) == WAIT_TIMEOUT) {
-            d->m_action = NtfyToastActions::Actions::Error;
+    if (d->m_eventHanlder) {
+        HANDLE event = d->m_eventHanlder->event();
+
+        if (d->m_expirationTime) {
+            d->m_timers.schedule(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                         d->m_expirationTime->time_since_epoch()),
+                                 TimerWheel::Kind::Expire);
         } else {
-            d->m_action = d->m_eventHanlder.Get()->userAction();
+            d->m_timers.schedule(d->m_timers.now() + std::chrono::milliseconds(EVENT_TIMEOUT),
+                                 TimerWheel::Kind::Timeout);
+        }
+
+        bool waiting = true;
+        while (waiting) {
+            const auto next = d->m_timers.nextDeadline();
+            const DWORD timeout = next
+                    ? static_cast<DWORD>(std::max<int64_t>(0, (*next - d->m_timers.now()).count()))
+                    : INFINITE;
+            if (WaitForSingleObject(event, timeout) == WAIT_OBJECT_0) {
+                d->m_action = d->m_eventHanlder->userAction();
+                break;
+            }
+            for (const auto &timer : d->m_timers.advance()) {
+                if (timer.kind == TimerWheel::Kind::Expire) {
+                    tLog << L"The toast expired";
+                    d->m_action = NtfyToastActions::Actions::Hidden;
+                    waiting = false;
+                } else if (timer.kind == TimerWheel::Kind::Timeout) {
+                    d->m_action = NtfyToastActions::Actions::Error;
+                    waiting = false;
+                }
+            }
         }
+        Metrics::instance().recordAction(
+                d->m_action,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - d->m_shownAt));
         // the initial value is NtfyToastActions::Actions::Hidden so if no action happend when we
         // end up here, a hide was requested
         if (d->m_action == NtfyToastActions::Actions::Hidden) {
-            d->m_notifier->Hide(d->m_notification.Get());
+            d->m_backend->hide(d->m_appID, d->m_id, d->m_group);
             tLog << L"The application hid the toast using ToastNotifier.hide()";
         }
-        CloseHandle(event);
     }
     return d->m_action;
 }
 
-bool NtfyToasts::closeNotification()
+namespace {
+// a running instance owns the toast, it closes it when its event is signalled
+bool closeShownToast(const std::wstring &id)
 {
     std::wstringstream eventName;
-    eventName << L"ToastEvent" << d->m_id;
-
+    eventName << L"ToastEvent" << id;
     HANDLE event = OpenEventW(EVENT_ALL_ACCESS, FALSE, eventName.str().c_str());
-    if (event) {
-        SetEvent(event);
-        return true;
+    if (!event) {
+        return false;
     }
-    if (auto history = d->getHistory()) {
-        if (ST_CHECK_RESULT(history->RemoveGroupedTagWithId(
-                    HStringReference(d->m_id.c_str()).Get(), HStringReference(L"NtfyToast").Get(),
-                    HStringReference(d->m_appID.c_str()).Get()))) {
-            return true;
-        }
+    SetEvent(event);
+    CloseHandle(event);
+    return true;
+}
+}
+
+bool NtfyToasts::closeNotification()
+{
+    // the history is only needed if no instance owns the toast
+    if (closeShownToast(d->m_id) || d->m_backend->remove(d->m_appID, d->m_id, d->m_group)) {
+        return true;
     }
     tLog << "Notification " << d->m_id << " does not exist";
     return false;
 }
 
+size_t NtfyToasts::closeNotifications(const std::vector<std::wstring> &ids)
+{
+    const auto missing = ToastCommands::closeNotifications(*d->m_backend, d->m_appID,
+                                                           d->m_group, ids, closeShownToast);
+    for (const auto &id : missing) {
+        tLog << "No notification matches " << id;
+    }
+    return ids.size() - missing.size();
+}
+
+bool NtfyToasts::closeGroup(const std::wstring &group)
+{
+    if (d->m_backend->removeGroup(d->m_appID, group)) {
+        return true;
+    }
+    tLog << "Failed to close the notifications of group " << group;
+    return false;
+}
+
+bool NtfyToasts::clearNotifications()
+{
+    if (d->m_backend->clear(d->m_appID)) {
+        return true;
+    }
+    tLog << "Failed to clear the notifications of " << d->m_appID;
+    return false;
+}
+
 void NtfyToasts::setSound(const std::wstring &soundFile)
 {
     d->m_sound = soundFile;
@@ -289,10 +323,16 @@ void NtfyToasts::setPersistent(bool persistent)
     d->m_persistent = persistent;
 }
 
+SubmissionPriority NtfyToasts::priority() const
+{
+    return d->m_persistent ? SubmissionPriority::High : SubmissionPriority::Normal;
+}
+
 void NtfyToasts::setId(const std::wstring &id)
 {
     if (!id.empty()) {
         d->m_id = id;
+        d->m_actionPrefix.clear();
     }
 }
 
@@ -301,6 +341,18 @@ std::wstring NtfyToasts::id() const
     return d->m_id;
 }
 
+void NtfyToasts::setGroup(const std::wstring &group)
+{
+    if (!group.empty()) {
+        d->m_group = group;
+    }
+}
+
+std::wstring NtfyToasts::group() const
+{
+    return d->m_group;
+}
+
 void NtfyToasts::setButtons(const std::wstring &buttons)
 {
     d->m_buttons = buttons;
@@ -311,257 +363,87 @@ void NtfyToasts::setTextBoxEnabled(bool textBoxEnabled)
     d->m_textbox = textBoxEnabled;
 }
 
-// Set the value of the "src" attribute of the "image" node
-HRESULT NtfyToasts::setImage()
+std::shared_ptr<ToastBackend> NtfyToasts::backend() const
 {
-    ComPtr<IXmlNodeList> nodeList;
-    ST_RETURN_ON_ERROR(
-            d->m_toastXml->GetElementsByTagName(HStringReference(L"image").Get(), &nodeList));
-
-    ComPtr<IXmlNode> imageNode;
-    ST_RETURN_ON_ERROR(nodeList->Item(0, &imageNode));
-
-    ComPtr<IXmlNamedNodeMap> attributes;
-    ST_RETURN_ON_ERROR(imageNode->get_Attributes(&attributes));
-
-    ComPtr<IXmlNode> srcAttribute;
+    return d->m_backend;
+}
 
+void NtfyToasts::printXML(const std::wstring &xml) const
+{
     /*
-    ST_RETURN_ON_ERROR(attributes->GetNamedItem(HStringReference(L"placement").Get(), &srcAttribute));
-    setNodeValueString(HStringReference(L"hero").Get(), srcAttribute.Get());
+        debug > print xml
+        std::wcerr << xml << std::endl;
     */
 
-    ST_RETURN_ON_ERROR(attributes->GetNamedItem(HStringReference(L"src").Get(), &srcAttribute));
-    return setNodeValueString(HStringReference(d->m_image.wstring().c_str()).Get(), srcAttribute.Get());
+    tLog << L"------------------------\n\t\t\t" << xml << L"\n\t\t" << L"------------------------";
 }
 
-HRESULT NtfyToasts::setSound()
+std::filesystem::path NtfyToasts::pipeName() const
 {
-    ComPtr<IXmlNodeList> nodeList;
-    ST_RETURN_ON_ERROR(
-            d->m_toastXml->GetElementsByTagName(HStringReference(L"audio").Get(), &nodeList));
-
-    ComPtr<IXmlNode> audioNode;
-    ST_RETURN_ON_ERROR(nodeList->Item(0, &audioNode));
-
-    ComPtr<IXmlNamedNodeMap> attributes;
-
-    ST_RETURN_ON_ERROR(audioNode->get_Attributes(&attributes));
-    ComPtr<IXmlNode> srcAttribute;
-
-    ST_RETURN_ON_ERROR(attributes->GetNamedItem(HStringReference(L"src").Get(), &srcAttribute));
-    std::wstring sound;
-    if (d->m_sound.find(L"ms-winsoundevent:") == std::wstring::npos) {
-        sound = L"ms-winsoundevent:";
-        sound.append(d->m_sound);
-    } else {
-        sound = d->m_sound;
-    }
-
-    ST_RETURN_ON_ERROR(
-            setNodeValueString(HStringReference(sound.c_str()).Get(), srcAttribute.Get()));
-
-    ST_RETURN_ON_ERROR(attributes->GetNamedItem(HStringReference(L"silent").Get(), &srcAttribute));
-
-    return setNodeValueString(HStringReference(d->m_silent ? L"true" : L"false").Get(),
-                              srcAttribute.Get());
+    return d->m_pipeName;
 }
 
-// Set the values of each of the text nodes
-HRESULT NtfyToasts::setTextValues()
+void NtfyToasts::setPipeName(const std::filesystem::path &pipeName)
 {
-    ComPtr<IXmlNodeList> nodeList;
-    ST_RETURN_ON_ERROR(
-            d->m_toastXml->GetElementsByTagName(HStringReference(L"text").Get(), &nodeList));
-    
-    // create the title
-    ComPtr<IXmlNode> textNode;
-    ST_RETURN_ON_ERROR(nodeList->Item(0, &textNode));
-    ST_RETURN_ON_ERROR(
-            setNodeValueString(HStringReference(d->m_title.c_str()).Get(), textNode.Get()));
-
-    ST_RETURN_ON_ERROR(nodeList->Item(1, &textNode));
-    return setNodeValueString(HStringReference(d->m_body.c_str()).Get(), textNode.Get());
+    d->m_pipeName = pipeName;
+    d->m_actionPrefix.clear();
 }
 
-HRESULT NtfyToasts::setButtons(ComPtr<IXmlNode> root)
+PipeEncoding NtfyToasts::pipeEncoding() const
 {
-    ComPtr<ABI::Windows::Data::Xml::Dom::IXmlElement> actionsElement;
-    ST_RETURN_ON_ERROR(
-            d->m_toastXml->CreateElement(HStringReference(L"actions").Get(), &actionsElement));
-
-    ComPtr<IXmlNode> actionsNodeTmp;
-    ST_RETURN_ON_ERROR(actionsElement.As(&actionsNodeTmp));
-
-    ComPtr<IXmlNode> actionsNode;
-    ST_RETURN_ON_ERROR(root->AppendChild(actionsNodeTmp.Get(), &actionsNode));
-
-    std::wstring buttonText;
-    std::wstringstream wss(d->m_buttons);
-    while (std::getline(wss, buttonText, L';')) {
-        ST_RETURN_ON_ERROR(createNewActionButton(actionsNode, buttonText));
-    }
-    return S_OK;
+    return d->m_pipeEncoding;
 }
 
-HRESULT NtfyToasts::setTextBox(ComPtr<IXmlNode> root)
+void NtfyToasts::setPipeEncoding(PipeEncoding encoding)
 {
-    ComPtr<ABI::Windows::Data::Xml::Dom::IXmlElement> actionsElement;
-    ST_RETURN_ON_ERROR(
-            d->m_toastXml->CreateElement(HStringReference(L"actions").Get(), &actionsElement));
-
-    ComPtr<IXmlNode> actionsNodeTmp;
-    ST_RETURN_ON_ERROR(actionsElement.As(&actionsNodeTmp));
-
-    ComPtr<IXmlNode> actionsNode;
-    ST_RETURN_ON_ERROR(root->AppendChild(actionsNodeTmp.Get(), &actionsNode));
-
-    ComPtr<ABI::Windows::Data::Xml::Dom::IXmlElement> inputElement;
-    ST_RETURN_ON_ERROR(
-            d->m_toastXml->CreateElement(HStringReference(L"input").Get(), &inputElement));
-
-    ComPtr<IXmlNode> inputNodeTmp;
-    ST_RETURN_ON_ERROR(inputElement.As(&inputNodeTmp));
-
-    ComPtr<IXmlNode> inputNode;
-    ST_RETURN_ON_ERROR(actionsNode->AppendChild(inputNodeTmp.Get(), &inputNode));
-
-    ComPtr<IXmlNamedNodeMap> inputAttributes;
-    ST_RETURN_ON_ERROR(inputNode->get_Attributes(&inputAttributes));
-
-    ST_RETURN_ON_ERROR(addAttribute(L"id", inputAttributes.Get(), L"textBox"));
-    ST_RETURN_ON_ERROR(addAttribute(L"type", inputAttributes.Get(), L"text"));
-    ST_RETURN_ON_ERROR(addAttribute(L"placeHolderContent", inputAttributes.Get(), L"Type a reply"));
-
-    ComPtr<IXmlElement> actionElement;
-    ST_RETURN_ON_ERROR(
-            d->m_toastXml->CreateElement(HStringReference(L"action").Get(), &actionElement));
-
-    ComPtr<IXmlNode> actionNodeTmp;
-    ST_RETURN_ON_ERROR(actionElement.As(&actionNodeTmp));
-
-    ComPtr<IXmlNode> actionNode;
-    ST_RETURN_ON_ERROR(actionsNode->AppendChild(actionNodeTmp.Get(), &actionNode));
-
-    ComPtr<IXmlNamedNodeMap> actionAttributes;
-    ST_RETURN_ON_ERROR(actionNode->get_Attributes(&actionAttributes));
-
-    ST_RETURN_ON_ERROR(addAttribute(L"content", actionAttributes.Get(), L"Send"));
-
-    const auto data = formatAction(NtfyToastActions::Actions::TextEntered);
-
-    ST_RETURN_ON_ERROR(addAttribute(L"arguments", actionAttributes.Get(), data));
-    return addAttribute(L"hint-inputId", actionAttributes.Get(), L"textBox");
+    d->m_pipeEncoding = encoding;
+    d->m_actionPrefix.clear();
 }
 
-HRESULT NtfyToasts::setEventHandler(ComPtr<IToastNotification> toast)
+std::vector<NtfyToastActions::Actions> NtfyToasts::notifiedActions() const
 {
-    // Register the event handlers
-    EventRegistrationToken activatedToken, dismissedToken, failedToken;
-    ComPtr<ToastEventHandler> eventHandler(new ToastEventHandler(*this));
-
-    ST_RETURN_ON_ERROR(toast->add_Activated(eventHandler.Get(), &activatedToken));
-    ST_RETURN_ON_ERROR(toast->add_Dismissed(eventHandler.Get(), &dismissedToken));
-    ST_RETURN_ON_ERROR(toast->add_Failed(eventHandler.Get(), &failedToken));
-    d->m_eventHanlder = eventHandler;
-    return S_OK;
+    return d->m_notifiedActions;
 }
 
-HRESULT NtfyToasts::setNodeValueString(const HSTRING &inputString, IXmlNode *node)
+void NtfyToasts::setNotifiedActions(const std::vector<NtfyToastActions::Actions> &actions)
 {
-    ComPtr<IXmlText> inputText;
-    ST_RETURN_ON_ERROR(d->m_toastXml->CreateTextNode(inputString, &inputText));
-
-    ComPtr<IXmlNode> inputTextNode;
-    ST_RETURN_ON_ERROR(inputText.As(&inputTextNode));
-
-    ComPtr<IXmlNode> pAppendedChild;
-    return node->AppendChild(inputTextNode.Get(), &pAppendedChild);
+    d->m_notifiedActions = actions;
+    d->m_actionPrefix.clear();
 }
 
-HRESULT NtfyToasts::addAttribute(const std::wstring &name, IXmlNamedNodeMap *attributeMap)
+bool NtfyToasts::notifies(NtfyToastActions::Actions action) const
 {
-    ComPtr<ABI::Windows::Data::Xml::Dom::IXmlAttribute> srcAttribute;
-    HRESULT hr =
-            d->m_toastXml->CreateAttribute(HStringReference(name.c_str()).Get(), &srcAttribute);
-
-    if (SUCCEEDED(hr)) {
-        ComPtr<IXmlNode> node;
-        hr = srcAttribute.As(&node);
-        if (SUCCEEDED(hr)) {
-            ComPtr<IXmlNode> pNode;
-            hr = attributeMap->SetNamedItem(node.Get(), &pNode);
-        }
-    }
-    return hr;
+    return CallbackFormat::notifies(d->m_notifiedActions, action);
 }
 
-HRESULT NtfyToasts::addAttribute(const std::wstring &name, IXmlNamedNodeMap *attributeMap,
-                                  const std::wstring &value)
+std::vector<std::wstring> NtfyToasts::callbackFields() const
 {
-    ComPtr<ABI::Windows::Data::Xml::Dom::IXmlAttribute> srcAttribute;
-    ST_RETURN_ON_ERROR(
-            d->m_toastXml->CreateAttribute(HStringReference(name.c_str()).Get(), &srcAttribute));
-
-    ComPtr<IXmlNode> node;
-    ST_RETURN_ON_ERROR(srcAttribute.As(&node));
-
-    ComPtr<IXmlNode> pNode;
-    ST_RETURN_ON_ERROR(attributeMap->SetNamedItem(node.Get(), &pNode));
-
-    return setNodeValueString(HStringReference(value.c_str()).Get(), node.Get());
+    return d->m_callbackFields;
 }
 
-HRESULT NtfyToasts::createNewActionButton(ComPtr<IXmlNode> actionsNode, const std::wstring &value)
+void NtfyToasts::setCallbackFields(const std::vector<std::wstring> &fields)
 {
-    ComPtr<ABI::Windows::Data::Xml::Dom::IXmlElement> actionElement;
-    ST_RETURN_ON_ERROR(
-            d->m_toastXml->CreateElement(HStringReference(L"action").Get(), &actionElement));
-
-    ComPtr<IXmlNode> actionNodeTmp;
-    ST_RETURN_ON_ERROR(actionElement.As(&actionNodeTmp));
-
-    ComPtr<IXmlNode> actionNode;
-    ST_RETURN_ON_ERROR(actionsNode->AppendChild(actionNodeTmp.Get(), &actionNode));
-
-    ComPtr<IXmlNamedNodeMap> actionAttributes;
-    ST_RETURN_ON_ERROR(actionNode->get_Attributes(&actionAttributes));
-
-    ST_RETURN_ON_ERROR(addAttribute(L"content", actionAttributes.Get(), value));
-
-    const auto data =
-            formatAction(NtfyToastActions::Actions::ButtonClicked, { { L"button", value } });
-    ST_RETURN_ON_ERROR(addAttribute(L"arguments", actionAttributes.Get(), data));
-
-    return addAttribute(L"activationType", actionAttributes.Get(), L"foreground");
+    d->m_callbackFields = fields;
+    d->m_actionPrefix.clear();
 }
 
-void NtfyToasts::printXML()
+std::wstring NtfyToasts::correlationId() const
 {
-    ComPtr<ABI::Windows::Data::Xml::Dom::IXmlNodeSerializer> s;
-    ComPtr<ABI::Windows::Data::Xml::Dom::IXmlDocument> ss(d->m_toastXml);
-    ss.As(&s);
-    HSTRING string;
-    s->GetXml(&string);
-
-    PCWSTR str = WindowsGetStringRawBuffer(string, nullptr);
-
-    /*
-        debug > print xml
-        std::wcerr << str << std::endl;
-    */
-
-    tLog << L"------------------------\n\t\t\t" << str << L"\n\t\t" << L"------------------------";
+    return d->m_correlationId;
 }
 
-std::filesystem::path NtfyToasts::pipeName() const
+void NtfyToasts::setCorrelationId(const std::wstring &correlationId)
 {
-    return d->m_pipeName;
+    d->m_correlationId = correlationId;
+    d->m_actionPrefix.clear();
 }
 
-void NtfyToasts::setPipeName(const std::filesystem::path &pipeName)
+void NtfyToasts::setShownAt(std::chrono::steady_clock::time_point shownAt)
 {
-    d->m_pipeName = pipeName;
+    d->m_shownAtTicks.store(shownAt.time_since_epoch().count(), std::memory_order_release);
+    if (d->m_callbacks) {
+        d->m_callbacks->setShownAt(shownAt);
+    }
 }
 
 std::filesystem::path NtfyToasts::application() const
@@ -572,6 +454,7 @@ std::filesystem::path NtfyToasts::application() const
 void NtfyToasts::setApplication(const std::filesystem::path &application)
 {
     d->m_application = application;
+    d->m_actionPrefix.clear();
 }
 
 void NtfyToasts::setDuration(Duration duration)
@@ -584,68 +467,61 @@ Duration NtfyToasts::duration() const
     return d->m_duration;
 }
 
-std::wstring NtfyToasts::formatAction(
-        const NtfyToastActions::Actions &action,
-        const std::vector<std::pair<std::wstring_view, std::wstring_view>> &extraData) const
+std::optional<std::chrono::system_clock::time_point> NtfyToasts::expirationTime() const
 {
-    const auto pipe = d->m_pipeName.wstring();
-    const auto application = d->m_application.wstring();
-    std::vector<std::pair<std::wstring_view, std::wstring_view>> data = {
-        { L"action", NtfyToastActions::getActionString(action) },
-        { L"notificationId", std::wstring_view(d->m_id) },
-        { L"pipe", std::wstring_view(pipe) },
-        { L"application", std::wstring_view(application) }
-    };
-    data.insert(data.end(), extraData.cbegin(), extraData.cend());
-    return Utils::formatData(data);
+    return d->m_expirationTime;
 }
 
-// Create and display the toast
-HRESULT NtfyToasts::createToast()
+void NtfyToasts::setExpirationTime(const std::chrono::system_clock::time_point &expirationTime)
 {
-    ST_RETURN_ON_ERROR(d->m_toastManager->CreateToastNotifierWithId(
-            HStringReference(d->m_appID.c_str()).Get(), &d->m_notifier));
-
-    ComPtr<IToastNotificationFactory> factory;
-    ST_RETURN_ON_ERROR(GetActivationFactory(
-            HStringReference(RuntimeClass_Windows_UI_Notifications_ToastNotification).Get(),
-            &factory));
-
-    ST_RETURN_ON_ERROR(factory->CreateToastNotification(d->m_toastXml.Get(), &d->m_notification));
-
-    ComPtr<Notifications::IToastNotification2> toastV2;
+    d->m_expirationTime = expirationTime;
+}
 
-    if (SUCCEEDED(d->m_notification.As(&toastV2))) {
-        ST_RETURN_ON_ERROR(toastV2->put_Tag(HStringReference(d->m_id.c_str()).Get()));
-        ST_RETURN_ON_ERROR(toastV2->put_Group(HStringReference(L"NtfyToast").Get()));
-    }
+std::wstring NtfyToasts::formatAction(const NtfyToastActions::Actions &action,
+                                      ActionData extraData) const
+{
+    const AllocationScope scope(AllocationPath::FormatAction);
+    std::wstring out;
+    CallbackFormat::appendAction(out, action, d->actionPrefix(), d->m_submittedAt,
+                                 d->m_shownAtTicks.load(std::memory_order_acquire), extraData,
+                                 true);
+    return out;
+}
 
+// Create and display the toast
+HRESULT NtfyToasts::createToast(const std::wstring &xml)
+{
     std::wstring error;
-    NotificationSetting setting = NotificationSetting_Enabled;
-
-    if (!ST_CHECK_RESULT(d->m_notifier->get_Setting(&setting))) {
-        tLog << "Failed to retreive NotificationSettings ensure your appId is registered";
-    }
-
-    switch (setting) {
-    case NotificationSetting_Enabled:
-        ST_RETURN_ON_ERROR(setEventHandler(d->m_notification));
+    std::shared_ptr<ToastEventSink> sink;
+
+    switch (d->m_backend->setting(d->m_appID)) {
+    case ToastSetting::Enabled:
+        // resolved here, the events only read the copy
+        d->m_callbacks = std::make_shared<ToastCallbackFormatter>(
+                d->m_id, d->actionPrefix(), d->m_submittedAt, d->m_notifiedActions,
+                useFalbackMode());
+        d->m_eventHanlder = std::make_shared<ToastEventHandler>(d->m_callbacks);
+        sink = d->m_eventHanlder;
         break;
 
-    case NotificationSetting_DisabledForApplication:
+    case ToastSetting::DisabledForApplication:
         error = L"DisabledForApplication";
+        Metrics::instance().recordDisabled(Metrics::DisabledReason::ForApplication);
         break;
 
-    case NotificationSetting_DisabledForUser:
+    case ToastSetting::DisabledForUser:
         error = L"DisabledForUser";
+        Metrics::instance().recordDisabled(Metrics::DisabledReason::ForUser);
         break;
 
-    case NotificationSetting_DisabledByGroupPolicy:
+    case ToastSetting::DisabledByGroupPolicy:
         error = L"DisabledByGroupPolicy";
+        Metrics::instance().recordDisabled(Metrics::DisabledReason::ByGroupPolicy);
         break;
 
-    case NotificationSetting_DisabledByManifest:
+    case ToastSetting::DisabledByManifest:
         error = L"DisabledByManifest";
+        Metrics::instance().recordDisabled(Metrics::DisabledReason::ByManifest);
         break;
 
     }
@@ -657,7 +533,9 @@ HRESULT NtfyToasts::createToast()
         tLog << err.str();
         std::wcerr << err.str() << std::endl;
     }
-    return d->m_notifier->Show(d->m_notification.Get());
+
+    const ToastRequest request { d->m_appID, d->m_id, d->m_group, xml, d->m_expirationTime };
+    return d->m_backend->show(request, sink) ? S_OK : E_FAIL;
 }
 
 std::wstring NtfyToasts::version()
@@ -665,32 +543,45 @@ std::wstring NtfyToasts::version()
     return NTFYTOAST_VERSION;
 }
 
+namespace {
+// read by the callbacks of all toasts, which run on threads of the notification platform
+std::shared_ptr<CallbackSink> &processCallbackSink()
+{
+    static std::shared_ptr<CallbackSink> sink = std::make_shared<PipeCallbackSink>();
+    return sink;
+}
+}
+
+std::shared_ptr<CallbackSink> NtfyToasts::callbackSink()
+{
+    return std::atomic_load(&processCallbackSink());
+}
+
+void NtfyToasts::setCallbackSink(std::shared_ptr<CallbackSink> sink)
+{
+    std::atomic_store(&processCallbackSink(),
+                      sink ? std::move(sink) : std::make_shared<PipeCallbackSink>());
+}
+
 HRESULT NtfyToasts::backgroundCallback(const std::wstring &appUserModelId,
                                         const std::wstring &invokedArgs, const std::wstring &msg)
 {
+    const AllocationScope scope(AllocationPath::Callback);
     tLog << "CToastNotificationActivationCallback::Activate: " << appUserModelId << " : "
          << invokedArgs << " : " << msg;
-    const auto dataMap = Utils::splitData(invokedArgs);
+    const auto dataMap = CallbackFormat::splitData(invokedArgs);
     const auto action = NtfyToastActions::getAction(dataMap.at(L"action"));
+    // the arguments were rendered with submittedAt, the activator does not know when the
+    // toast was shown
     std::wstring dataString;
+    dataString.reserve(invokedArgs.size() + msg.size() + 64);
+    dataString.append(invokedArgs);
+    CallbackFormat::appendTimestamp(dataString, L"actedAt", std::chrono::steady_clock::now());
     if (action == NtfyToastActions::Actions::TextEntered) {
-        std::wstringstream sMsg;
-        sMsg << invokedArgs << L"text=" << msg;
-        dataString = sMsg.str();
-    } else {
-        dataString = invokedArgs;
-    }
-    const auto pipe = dataMap.find(L"pipe");
-    if (pipe != dataMap.cend()) {
-        if (!Utils::writePipe(pipe->second, dataString)) {
-            const auto app = dataMap.find(L"application");
-            if (app != dataMap.cend()) {
-                if (Utils::startProcess(app->second)) {
-                    Utils::writePipe(pipe->second, dataString, true);
-                }
-            }
-        }
+        // the text is the last field, it may contain ';'
+        dataString.append(L"text=").append(msg);
     }
+    callbackSink()->write(dataString);
 
     tLog << dataString;
     if (!SetEvent(NtfyToastsPrivate::ctoastEvent())) {
@@ -708,5 +599,6 @@ void NtfyToasts::waitForCallbackActivation()
 
 bool NtfyToasts::useFalbackMode() const
 {
-    return d->m_useFallbackMode;
-}
\ No newline at end of file
+    // the backend caches the result, this is called for every event
+    return !d->m_backend->isRegistered(d->m_appID);
+}
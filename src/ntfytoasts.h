@@ -23,7 +23,12 @@
 
 #pragma once
 
+#include "callbackformat.h"
 #include "ntfytoastactions.h"
+#include "submissionqueue.h"
+#include "toastbackend.h"
+#include "toastdispatcher.h"
+#include "utf8.h"
 #include "libntfytoast_export.h"
 
 #include <sdkddkver.h>
@@ -43,7 +48,12 @@
 #include <wrl/implements.h>
 #include <windows.ui.notifications.h>
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <initializer_list>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -59,6 +69,8 @@ using namespace ABI::Windows::Data::Xml::Dom;
     they interact with it; you must specify the notification as an alarm.
 */
 
+class CallbackSink;
+
 enum class Duration {
     Short,
     Long
@@ -72,36 +84,132 @@ public:
     static HRESULT backgroundCallback(const std::wstring &appUserModelId,
                                       const std::wstring &invokedArgs, const std::wstring &msg);
 
-    NtfyToasts(const std::wstring &appID);
+    /**
+     * Receives the callbacks of all toasts of this process, by default a PipeCallbackSink.
+     * Set it before the first toast is shown.
+     */
+    static std::shared_ptr<CallbackSink> callbackSink();
+    static void setCallbackSink(std::shared_ptr<CallbackSink> sink);
+
+    /**
+     * Without a backend a WinToastBackend is used.
+     * A backend can be shared between toasts, it keeps the resources it created.
+     */
+    NtfyToasts(const std::wstring &appID, std::shared_ptr<ToastBackend> backend = {});
     ~NtfyToasts();
 
     HRESULT displayToast(const std::wstring &title, const std::wstring &body,
                          const std::filesystem::path &image);
 
     NtfyToastActions::Actions userAction();
+
+    /**
+     * The toast as a submission for a ToastDispatcher, which shows many toasts without
+     * blocking in userAction(). The id is used as tag, set a distinct id per toast.
+     * The setters are not synchronised, threads submitting concurrently use one NtfyToasts
+     * each and share the dispatcher.
+     */
+    ToastSubmission submission(const std::wstring &title, const std::wstring &body,
+                               const std::filesystem::path &image) const;
     bool closeNotification();
 
+    /**
+     * Close the toasts with the given ids in the group of this toast.
+     * A toast owned by a running instance is closed by that instance, the others are
+     * removed from the Action Center. An id with * or ? is a pattern that closes every
+     * toast of the group in the Action Center whose tag matches, the history is read once
+     * for all patterns. Returns the number of ids that closed at least one toast.
+     */
+    size_t closeNotifications(const std::vector<std::wstring> &ids);
+
+    // remove all toasts of a group, respectively of the app id, from the Action Center
+    bool closeGroup(const std::wstring &group);
+    bool clearNotifications();
+
     void setSound(const std::wstring &soundFile);
     void setSilent(bool silent);
     void setPersistent(bool persistent);
+
+    /**
+     * Persistent toasts are shown as incoming calls, they go into the high priority lane
+     * of a SubmissionQueue.
+     */
+    SubmissionPriority priority() const;
     void setId(const std::wstring &id);
     std::wstring id() const;
 
+    /**
+     * Toasts of a group can be closed together, the default group is NtfyToast.
+     */
+    void setGroup(const std::wstring &group);
+    std::wstring group() const;
+
     void setButtons(const std::wstring &buttons);
     void setTextBoxEnabled(bool textBoxEnabled);
 
     std::filesystem::path pipeName() const;
     void setPipeName(const std::filesystem::path &pipeName);
 
+    /**
+     * The encoding of the callbacks written to the pipe.
+     * It is part of the action data, so callbacks from the Action Center use it too.
+     */
+    PipeEncoding pipeEncoding() const;
+    void setPipeEncoding(PipeEncoding encoding);
+
+    /**
+     * The actions written to the consumer, all of them if the list is empty.
+     * Most consumers only need the clicks, buttons and replies while dismissals, timeouts
+     * and hides make up most of the traffic.
+     */
+    std::vector<NtfyToastActions::Actions> notifiedActions() const;
+    void setNotifiedActions(const std::vector<NtfyToastActions::Actions> &actions);
+    bool notifies(NtfyToastActions::Actions action) const;
+
+    /**
+     * The fields of the callbacks besides action, all of them if the list is empty.
+     * The pipe and the application are still used to deliver the callback.
+     */
+    std::vector<std::wstring> callbackFields() const;
+    void setCallbackFields(const std::vector<std::wstring> &fields);
+
     std::filesystem::path application() const;
     void setApplication(const std::filesystem::path &application);
 
+    /**
+     * An id of the producer, passed on in the arguments and the callbacks of the toast so
+     * consumers can match a callback to the request that caused it. It must not contain ';'.
+     */
+    std::wstring correlationId() const;
+    void setCorrelationId(const std::wstring &correlationId);
+
+    /**
+     * When the toast was shown, the callbacks carry it as shownAt. displayToast() sets it,
+     * a ToastDispatcher reports it in the ToastResult of a submission.
+     */
+    void setShownAt(std::chrono::steady_clock::time_point shownAt);
+
     Duration duration() const;
     void setDuration(Duration duration);
 
+    /**
+     * The toast is hidden once the expiration time is reached.
+     * Without an expiration time we wait for a minute for the user to react.
+     * The expiration time is also passed to Windows, so the toast is removed from the
+     * Action Center even if we no longer wait for it.
+     */
+    std::optional<std::chrono::system_clock::time_point> expirationTime() const;
+    void setExpirationTime(const std::chrono::system_clock::time_point &expirationTime);
+
+    using ActionData = CallbackFormat::ActionData;
+
+    /**
+     * The callback of an action, the fields shared by all actions of the toast are
+     * encoded once and reused until the id, the pipe, the application or the encoding change.
+     * Callbacks carry submittedAt, shownAt and actedAt, see CallbackFormat::appendTimestamp().
+     */
     std::wstring formatAction(const NtfyToastActions::Actions &action,
-                              const std::vector<std::pair<std::wstring_view, std::wstring_view>>
-                                      &extraData = {}) const;
+                              ActionData extraData = {}) const;
 
     /**
      * Returns true if the appID is not properly registered
@@ -111,25 +219,14 @@ public:
 
     bool useFalbackMode() const;
 
+    std::shared_ptr<ToastBackend> backend() const;
+
 private:
-    HRESULT createToast();
-    HRESULT setImage();
-    HRESULT setSound();
-    HRESULT setTextValues();
-    HRESULT setButtons(ComPtr<IXmlNode> root);
-    HRESULT setTextBox(ComPtr<IXmlNode> root);
-    HRESULT setEventHandler(
-            Microsoft::WRL::ComPtr<ABI::Windows::UI::Notifications::IToastNotification> toast);
-    HRESULT setNodeValueString(const HSTRING &onputString,
-                               ABI::Windows::Data::Xml::Dom::IXmlNode *node);
-    HRESULT addAttribute(const std::wstring &name,
-                         ABI::Windows::Data::Xml::Dom::IXmlNamedNodeMap *attributeMap);
-    HRESULT addAttribute(const std::wstring &name,
-                         ABI::Windows::Data::Xml::Dom::IXmlNamedNodeMap *attributeMap,
-                         const std::wstring &value);
-    HRESULT createNewActionButton(ComPtr<IXmlNode> actionsNode, const std::wstring &value);
-
-    void printXML();
+    HRESULT createToast(const std::wstring &xml);
+    std::wstring render(const std::wstring &title, const std::wstring &body,
+                        const std::filesystem::path &image) const;
+
+    void printXML(const std::wstring &xml) const;
 
     friend class NtfyToastsPrivate;
     NtfyToastsPrivate *d;
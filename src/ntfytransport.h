@@ -0,0 +1,75 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/*
+    The HTTP client of NtfySubscriber, one GET request per connection.
+
+    WinHttpTransport is used on Windows, SocketTransport speaks plain HTTP on the other
+    platforms and in the tests.
+*/
+
+class NtfyTransport
+{
+public:
+    struct Endpoint
+    {
+        std::wstring host;
+        uint16_t port = 0;
+        bool secure = true;
+    };
+
+    class Request
+    {
+    public:
+        virtual ~Request() = default;
+
+        /**
+         * Sends the request and reads the head of the response.
+         * Returns the status code, 0 if no response arrived.
+         */
+        virtual int send() = 0;
+
+        /**
+         * Reads the next part of the body, transfer encodings already removed.
+         * Returns 0 at the end of the body, once the connection dropped or was aborted.
+         */
+        virtual size_t read(char *data, size_t size) = 0;
+
+        // may be called from any thread, a blocking send() or read() returns right away
+        virtual void abort() = 0;
+
+        // why send() or read() failed, for the log
+        virtual std::wstring error() const = 0;
+    };
+
+    virtual ~NtfyTransport() = default;
+
+    // path is the path and query of the url, e.g. /alerts/json?since=sPs71M8A2T
+    virtual std::unique_ptr<Request> open(const Endpoint &endpoint, const std::wstring &path) = 0;
+};
@@ -0,0 +1,109 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#include "packedresources.h"
+#include "lz4block.h"
+
+#include <cstdint>
+
+namespace {
+constexpr char PACK_MAGIC[4] = { 'N', 'T', 'P', 'K' };
+constexpr size_t HEADER_SIZE = 12;
+// resources are at most a few hundred kilobytes
+constexpr uint32_t MAX_SIZE = 64 * 1024 * 1024;
+}
+
+std::string PackedResources::pack(std::string_view data)
+{
+    auto out = pack(data, Compressed);
+    // not worth the decompression on first use
+    if (out.size() - HEADER_SIZE > data.size() - data.size() / 8) {
+        out = pack(data, Stored);
+    }
+    return out;
+}
+
+std::string PackedResources::pack(std::string_view data, Method method)
+{
+    std::string out(PACK_MAGIC, sizeof(PACK_MAGIC));
+    const auto size = static_cast<uint32_t>(data.size());
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>((size >> shift) & 0xff));
+    }
+    out.push_back(static_cast<char>(method));
+    out.append(3, '\0');
+    if (method == Compressed) {
+        out.append(Lz4Block::compress(data));
+    } else {
+        out.append(data);
+    }
+    return out;
+}
+
+bool PackedResources::unpack(std::string_view packed, std::string &buffer,
+                             std::string_view &out)
+{
+    if (packed.size() < HEADER_SIZE
+        || packed.compare(0, sizeof(PACK_MAGIC), PACK_MAGIC, sizeof(PACK_MAGIC)) != 0) {
+        return false;
+    }
+    uint32_t size = 0;
+    for (int i = 0; i < 4; ++i) {
+        size |= static_cast<uint32_t>(static_cast<uint8_t>(packed[4 + i])) << (8 * i);
+    }
+    const auto method = static_cast<uint8_t>(packed[8]);
+    const auto data = packed.substr(HEADER_SIZE);
+
+    if (method == Stored) {
+        if (data.size() != size) {
+            return false;
+        }
+        out = data;
+        return true;
+    }
+    if (method != Compressed || size > MAX_SIZE) {
+        return false;
+    }
+    buffer.resize(size);
+    if (!Lz4Block::decompress(data, buffer.data(), buffer.size())) {
+        buffer.clear();
+        return false;
+    }
+    out = buffer;
+    return true;
+}
+
+PackedResources::PackedResources(Lookup lookup) : m_lookup(std::move(lookup)) { }
+
+std::string_view PackedResources::open(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_cache.find(name);
+    if (it != m_cache.cend()) {
+        return it->second.data;
+    }
+    // the map does not move its values, the views into the buffers stay valid
+    auto &entry = m_cache[name];
+    if (!unpack(m_lookup(name), entry.buffer, entry.data)) {
+        entry.data = {};
+    }
+    return entry.data;
+}
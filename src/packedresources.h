@@ -0,0 +1,82 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/*
+    Resources embedded in the packed form written by ntfytoast-pack at build time.
+
+    A packed resource starts with a header
+        char[4]     magic "NTPK"
+        uint32      size of the resource, little endian
+        uint8       method, 0 stored, 1 compressed with Lz4Block
+        char[3]     reserved
+    followed by the data. Resources that do not get smaller by at least an eighth, like the
+    PNG icons, are stored and opened without a copy. The others are decompressed on first
+    use and kept, so a process only pays for the resources it uses.
+*/
+
+class PackedResources
+{
+public:
+    enum Method : uint8_t {
+        Stored = 0,
+        Compressed = 1
+    };
+
+    // the packed resource, an empty view if there is no resource with that name
+    using Lookup = std::function<std::string_view(const std::string &name)>;
+
+    static std::string pack(std::string_view data);
+    static std::string pack(std::string_view data, Method method);
+
+    /**
+     * Points out to the unpacked data, compressed data is decompressed into buffer and
+     * stored data is a view into packed. Returns false if packed is malformed.
+     */
+    static bool unpack(std::string_view packed, std::string &buffer, std::string_view &out);
+
+    explicit PackedResources(Lookup lookup);
+
+    /**
+     * The resource, valid as long as this instance. An empty view if it does not exist
+     * or is malformed. Thread safe.
+     */
+    std::string_view open(const std::string &name);
+
+private:
+    struct Entry
+    {
+        std::string buffer;
+        std::string_view data;
+    };
+
+    Lookup m_lookup;
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_cache;
+};
@@ -0,0 +1,375 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "sockettransport.h"
+#include "utf8.h"
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+
+namespace {
+constexpr size_t ReadSize = 64 * 1024;
+// a status line, header or chunk size that does not end within this is no HTTP
+constexpr size_t MaxLine = 64 * 1024;
+
+bool startsWithNoCase(std::string_view value, std::string_view prefix)
+{
+    return value.size() >= prefix.size()
+            && std::equal(prefix.cbegin(), prefix.cend(), value.cbegin(), [](char a, char b) {
+                   return std::tolower(static_cast<unsigned char>(a))
+                           == std::tolower(static_cast<unsigned char>(b));
+               });
+}
+
+std::string_view trim(std::string_view value)
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+class SocketRequest : public NtfyTransport::Request
+{
+public:
+    SocketRequest(const NtfyTransport::Endpoint &endpoint, const std::wstring &path,
+                  std::chrono::milliseconds receiveTimeout)
+        : m_endpoint(endpoint), m_path(Utf8::fromWide(path)), m_receiveTimeout(receiveTimeout)
+    {
+    }
+
+    ~SocketRequest() override
+    {
+        // only closed here, abort() must not close a descriptor another thread still reads
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+
+    int send() override
+    {
+        if (m_endpoint.secure) {
+            m_error = L"https is not supported by SocketTransport";
+            return 0;
+        }
+        if (!connect() || !writeRequest()) {
+            return 0;
+        }
+
+        std::string line;
+        if (!readLine(line)) {
+            return 0;
+        }
+        // HTTP/1.1 200 OK
+        const auto space = line.find(' ');
+        int status = 0;
+        if (!startsWithNoCase(line, "HTTP/") || space == std::string::npos
+            || std::from_chars(line.data() + space + 1, line.data() + line.size(), status).ec
+                    != std::errc()) {
+            m_error = L"Invalid status line: " + Utf8::toWide(line);
+            return 0;
+        }
+
+        m_body = Body::UntilClose;
+        while (readLine(line) && !line.empty()) {
+            const auto colon = line.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            const std::string_view name = trim(std::string_view(line).substr(0, colon));
+            const std::string_view value = trim(std::string_view(line).substr(colon + 1));
+            if (name.size() == 17 && startsWithNoCase(name, "transfer-encoding")) {
+                if (value.find("chunked") != std::string_view::npos) {
+                    m_body = Body::Chunked;
+                }
+            } else if (name.size() == 14 && startsWithNoCase(name, "content-length")
+                       && m_body != Body::Chunked) {
+                if (std::from_chars(value.data(), value.data() + value.size(), m_remaining).ec
+                    == std::errc()) {
+                    m_body = Body::Length;
+                }
+            }
+        }
+        if (!line.empty() || !m_error.empty()) {
+            return 0;
+        }
+        m_finished = m_body == Body::Length && m_remaining == 0;
+        return status;
+    }
+
+    size_t read(char *data, size_t size) override
+    {
+        if (m_finished || size == 0) {
+            return 0;
+        }
+        if (m_body == Body::Chunked && m_remaining == 0 && !nextChunk()) {
+            return 0;
+        }
+        if (available() == 0 && !receive()) {
+            // the end of the connection is the end of a body without a length
+            if (m_body != Body::UntilClose && m_error.empty()) {
+                m_error = L"The connection closed within the body";
+            }
+            m_finished = true;
+            return 0;
+        }
+        size_t count = std::min(size, available());
+        if (m_body != Body::UntilClose) {
+            count = static_cast<size_t>(std::min<uint64_t>(count, m_remaining));
+            m_remaining -= count;
+            m_finished = m_body == Body::Length && m_remaining == 0;
+        }
+        std::memcpy(data, m_buffer.data() + m_position, count);
+        m_position += count;
+        return count;
+    }
+
+    void abort() override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_aborted = true;
+        if (m_fd >= 0) {
+            // wakes up a blocking connect or recv
+            shutdown(m_fd, SHUT_RDWR);
+        }
+    }
+
+    std::wstring error() const override
+    {
+        return m_error;
+    }
+
+private:
+    enum class Body {
+        UntilClose,
+        Length,
+        Chunked
+    };
+
+    bool connect()
+    {
+        addrinfo hints {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *addresses = nullptr;
+        const std::string host = Utf8::fromWide(m_endpoint.host);
+        const int result = getaddrinfo(host.c_str(), std::to_string(m_endpoint.port).c_str(),
+                                       &hints, &addresses);
+        if (result != 0) {
+            m_error = L"Failed to resolve " + m_endpoint.host + L": "
+                    + Utf8::toWide(gai_strerror(result));
+            return false;
+        }
+        int error = 0;
+        for (const addrinfo *address = addresses; address; address = address->ai_next) {
+            const int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (fd < 0) {
+                error = errno;
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_aborted) {
+                    close(fd);
+                    error = ECANCELED;
+                    break;
+                }
+                m_fd = fd;
+            }
+            if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+                break;
+            }
+            error = errno;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_fd = -1;
+            close(fd);
+        }
+        freeaddrinfo(addresses);
+        if (m_fd < 0) {
+            m_error = L"Failed to connect to " + m_endpoint.host + L": "
+                    + Utf8::toWide(std::strerror(error));
+            return false;
+        }
+
+        timeval timeout {};
+        timeout.tv_sec = static_cast<time_t>(m_receiveTimeout.count() / 1000);
+        timeout.tv_usec = static_cast<suseconds_t>(m_receiveTimeout.count() % 1000 * 1000);
+        setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return true;
+    }
+
+    bool writeRequest()
+    {
+        std::string host = Utf8::fromWide(m_endpoint.host);
+        if (host.find(':') != std::string::npos) {
+            host = "[" + host + "]";
+        }
+        if (m_endpoint.port != 80) {
+            host += ":" + std::to_string(m_endpoint.port);
+        }
+        const std::string request = "GET " + m_path + " HTTP/1.1\r\nHost: " + host
+                + "\r\nUser-Agent: NtfyToast\r\nAccept: application/x-ndjson\r\n"
+                  "Connection: close\r\n\r\n";
+        for (size_t sent = 0; sent < request.size();) {
+            const ssize_t n =
+                    ::send(m_fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                m_error = L"Failed to send the request: " + Utf8::toWide(std::strerror(errno));
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    size_t available() const
+    {
+        return m_buffer.size() - m_position;
+    }
+
+    // appends what arrives to the buffer, false once the connection ended
+    bool receive()
+    {
+        m_buffer.erase(0, m_position);
+        m_position = 0;
+        const size_t size = m_buffer.size();
+        m_buffer.resize(size + ReadSize);
+        ssize_t n;
+        do {
+            n = recv(m_fd, m_buffer.data() + size, ReadSize, 0);
+        } while (n < 0 && errno == EINTR);
+        m_buffer.resize(size + static_cast<size_t>(std::max<ssize_t>(n, 0)));
+
+        bool aborted;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            aborted = m_aborted;
+        }
+        if (aborted) {
+            m_error = L"The request was aborted";
+            return false;
+        }
+        if (n < 0) {
+            m_error = errno == EAGAIN || errno == EWOULDBLOCK
+                    ? L"Nothing received within the receive timeout"
+                    : L"Failed to receive: " + Utf8::toWide(std::strerror(errno));
+            return false;
+        }
+        return n > 0;
+    }
+
+    // the next line without its CRLF
+    bool readLine(std::string &line)
+    {
+        size_t searched = 0;
+        for (;;) {
+            const std::string_view unread(m_buffer.data() + m_position, available());
+            const auto end = unread.find("\r\n", searched);
+            if (end != std::string_view::npos) {
+                line.assign(unread.substr(0, end));
+                m_position += end + 2;
+                return true;
+            }
+            if (unread.size() > MaxLine) {
+                m_error = L"A line of the response is too long";
+                return false;
+            }
+            searched = unread.empty() ? 0 : unread.size() - 1;
+            if (!receive()) {
+                if (m_error.empty()) {
+                    m_error = L"The connection closed within a line of the response";
+                }
+                return false;
+            }
+        }
+    }
+
+    // reads the size line of the next chunk, false after the last one
+    bool nextChunk()
+    {
+        std::string line;
+        // the CRLF that ends the data of the previous chunk
+        if ((m_chunks++ > 0 && (!readLine(line) || !line.empty())) || !readLine(line)) {
+            if (m_error.empty()) {
+                m_error = L"Invalid chunk";
+            }
+            m_finished = true;
+            return false;
+        }
+        // extensions after ; are ignored
+        if (std::from_chars(line.data(), line.data() + line.size(), m_remaining, 16).ec
+            != std::errc()) {
+            m_error = L"Invalid chunk size: " + Utf8::toWide(line);
+            m_finished = true;
+            return false;
+        }
+        // the trailer after the last chunk is not read, the connection is not reused
+        m_finished = m_remaining == 0;
+        return !m_finished;
+    }
+
+    const NtfyTransport::Endpoint m_endpoint;
+    const std::string m_path;
+    const std::chrono::milliseconds m_receiveTimeout;
+
+    // m_fd is only changed by the thread of the request, abort() reads it under the mutex
+    std::mutex m_mutex;
+    int m_fd = -1;
+    bool m_aborted = false;
+
+    std::string m_buffer;
+    size_t m_position = 0;
+    Body m_body = Body::UntilClose;
+    // of the content length or of the current chunk
+    uint64_t m_remaining = 0;
+    uint64_t m_chunks = 0;
+    bool m_finished = false;
+    std::wstring m_error;
+};
+}
+
+SocketTransport::SocketTransport(std::chrono::milliseconds receiveTimeout)
+    : m_receiveTimeout(receiveTimeout)
+{
+}
+
+std::unique_ptr<NtfyTransport::Request> SocketTransport::open(const Endpoint &endpoint,
+                                                              const std::wstring &path)
+{
+    return std::make_unique<SocketRequest>(endpoint, path, m_receiveTimeout);
+}
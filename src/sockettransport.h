@@ -0,0 +1,46 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "ntfytransport.h"
+
+#include <chrono>
+
+/*
+    NtfyTransport over a plain TCP socket, HTTP/1.1 without TLS.
+
+    Reads chunked and Content-Length bodies as well as bodies that end with the connection.
+    A request to a secure endpoint fails, https needs WinHttpTransport.
+*/
+
+class SocketTransport : public NtfyTransport
+{
+public:
+    // a connection that stays silent for longer is dead, ntfy sends a keepalive every 45s
+    explicit SocketTransport(std::chrono::milliseconds receiveTimeout = std::chrono::minutes(2));
+
+    std::unique_ptr<Request> open(const Endpoint &endpoint, const std::wstring &path) override;
+
+private:
+    const std::chrono::milliseconds m_receiveTimeout;
+};
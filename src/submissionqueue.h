@@ -0,0 +1,283 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+/*
+    Bounded multi producer queue in front of the notifier.
+
+    Toasts are submitted into one of two lanes, the high priority lane is always drained
+    first and, when the queue is full, a high priority toast may push out a normal one but
+    never the other way round. During an alert storm we rather drop chatter than a page.
+
+    Drop policies, applied once the queue is full:
+        DropOldest      the oldest toast of the lane is dropped
+        DropNewest      the submitted toast is rejected
+        Coalesce        a queued toast with the same key is replaced in place (even if the
+                        queue is not full), otherwise the oldest toast is dropped
+*/
+
+enum class SubmissionPriority {
+    Normal,
+    High
+};
+
+enum class DropPolicy {
+    DropOldest,
+    DropNewest,
+    Coalesce
+};
+
+struct Admission
+{
+    enum class Result {
+        Accepted,
+        Coalesced,
+        Rejected,
+        Closed
+    };
+
+    Result result;
+    // an older toast was dropped to make room
+    bool evicted = false;
+    // the queue reached its high watermark, producers should slow down
+    bool backpressure = false;
+
+    bool accepted() const { return result == Result::Accepted || result == Result::Coalesced; }
+};
+
+struct SubmissionQueueStats
+{
+    size_t normalDepth = 0;
+    size_t highDepth = 0;
+    uint64_t accepted = 0;
+    uint64_t coalesced = 0;
+    uint64_t evicted = 0;
+    uint64_t rejected = 0;
+};
+
+template<typename T, typename Key = std::wstring>
+class SubmissionQueue
+{
+public:
+    explicit SubmissionQueue(size_t capacity, DropPolicy policy = DropPolicy::DropOldest)
+        : m_capacity(std::max<size_t>(capacity, 1)),
+          m_highWatermark(std::max<size_t>(m_capacity * 3 / 4, 1)),
+          m_policy(policy)
+    {
+    }
+
+    /**
+     * Never blocks, the result tells the producer what happened to its toast.
+     * Toasts with an empty key are never coalesced.
+     * If dropped is given it receives the toast that was evicted or replaced, so its
+     * owner can be told.
+     */
+    Admission push(T item, SubmissionPriority priority = SubmissionPriority::Normal,
+                   const Key &key = {}, std::optional<T> *dropped = nullptr)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_closed) {
+            return { Admission::Result::Closed };
+        }
+
+        Lane &lane = m_lanes[static_cast<size_t>(priority)];
+        Admission out { Admission::Result::Accepted };
+
+        if (m_policy == DropPolicy::Coalesce && !(key == Key {})) {
+            const auto it = lane.index.find(key);
+            if (it != lane.index.end()) {
+                if (dropped) {
+                    *dropped = std::move(it->second->item);
+                }
+                it->second->item = std::move(item);
+                ++m_coalesced;
+                out.result = Admission::Result::Coalesced;
+                out.backpressure = sizeLocked() >= m_highWatermark;
+                return out;
+            }
+        }
+
+        if (sizeLocked() >= m_capacity) {
+            Lane &normal = m_lanes[static_cast<size_t>(SubmissionPriority::Normal)];
+            if (priority == SubmissionPriority::High && !normal.entries.empty()) {
+                dropOldest(normal, dropped);
+            } else if (m_policy == DropPolicy::DropNewest || lane.entries.empty()) {
+                ++m_rejected;
+                return { Admission::Result::Rejected, false, true };
+            } else {
+                dropOldest(lane, dropped);
+            }
+            out.evicted = true;
+        }
+
+        lane.entries.push_back({ key, std::move(item) });
+        if (m_policy == DropPolicy::Coalesce && !(key == Key {})) {
+            lane.index[key] = std::prev(lane.entries.end());
+        }
+        updateDepth();
+        ++m_accepted;
+        out.backpressure = sizeLocked() >= m_highWatermark;
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return out;
+    }
+
+    /**
+     * Blocks until there is room or the timeout expired, for producers that prefer to
+     * be slowed down over having their toasts dropped.
+     */
+    bool waitForRoom(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_notFull.wait_for(lock, timeout,
+                                  [this] { return m_closed || sizeLocked() < m_capacity; });
+    }
+
+    std::optional<T> pop(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_notEmpty.wait_for(lock, timeout, [this] { return m_closed || sizeLocked() > 0; })) {
+            return {};
+        }
+        return popLocked(lock);
+    }
+
+    std::optional<T> tryPop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return popLocked(lock);
+    }
+
+    // wakes up all waiting consumers and producers, queued toasts can still be popped
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+    size_t depth(SubmissionPriority priority) const
+    {
+        return m_depth[static_cast<size_t>(priority)].load(std::memory_order_relaxed);
+    }
+
+    size_t size() const
+    {
+        return depth(SubmissionPriority::Normal) + depth(SubmissionPriority::High);
+    }
+
+    SubmissionQueueStats stats() const
+    {
+        SubmissionQueueStats out;
+        out.normalDepth = depth(SubmissionPriority::Normal);
+        out.highDepth = depth(SubmissionPriority::High);
+        out.accepted = m_accepted.load(std::memory_order_relaxed);
+        out.coalesced = m_coalesced.load(std::memory_order_relaxed);
+        out.evicted = m_evicted.load(std::memory_order_relaxed);
+        out.rejected = m_rejected.load(std::memory_order_relaxed);
+        return out;
+    }
+
+private:
+    struct Entry
+    {
+        Key key;
+        T item;
+    };
+
+    struct Lane
+    {
+        std::list<Entry> entries;
+        std::unordered_map<Key, typename std::list<Entry>::iterator> index;
+    };
+
+    size_t sizeLocked() const { return m_lanes[0].entries.size() + m_lanes[1].entries.size(); }
+
+    void updateDepth()
+    {
+        for (size_t i = 0; i < 2; ++i) {
+            m_depth[i].store(m_lanes[i].entries.size(), std::memory_order_relaxed);
+        }
+    }
+
+    void dropOldest(Lane &lane, std::optional<T> *dropped)
+    {
+        if (dropped) {
+            *dropped = std::move(lane.entries.front().item);
+        }
+        lane.index.erase(lane.entries.front().key);
+        lane.entries.pop_front();
+        ++m_evicted;
+    }
+
+    std::optional<T> popLocked(std::unique_lock<std::mutex> &lock)
+    {
+        for (auto it = m_lanes.rbegin(); it != m_lanes.rend(); ++it) {
+            Lane &lane = *it;
+            if (!lane.entries.empty()) {
+                Entry entry = std::move(lane.entries.front());
+                lane.entries.pop_front();
+                lane.index.erase(entry.key);
+                updateDepth();
+                lock.unlock();
+                m_notFull.notify_one();
+                return std::move(entry.item);
+            }
+        }
+        return {};
+    }
+
+    const size_t m_capacity;
+    const size_t m_highWatermark;
+    const DropPolicy m_policy;
+
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::array<Lane, 2> m_lanes;
+    bool m_closed = false;
+
+    std::array<std::atomic<size_t>, 2> m_depth {};
+    std::atomic<uint64_t> m_accepted { 0 };
+    std::atomic<uint64_t> m_coalesced { 0 };
+    std::atomic<uint64_t> m_evicted { 0 };
+    std::atomic<uint64_t> m_rejected { 0 };
+};
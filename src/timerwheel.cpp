@@ -0,0 +1,420 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "timerwheel.h"
+
+#include <algorithm>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr char SNAPSHOT_MAGIC[4] = { 'N', 'T', 'W', '1' };
+
+// writes the file to the disk, a rename is only atomic for data that reached it
+bool syncFile(const std::filesystem::path &path)
+{
+#ifdef _WIN32
+    const HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    const bool synced = FlushFileBuffers(file);
+    CloseHandle(file);
+    return synced;
+#else
+    const int fd = open(path.c_str(), O_WRONLY);
+    if (fd < 0) {
+        return false;
+    }
+    const bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+#endif
+}
+
+template<typename T>
+void writeValue(std::ofstream &out, const T &value)
+{
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template<typename T>
+bool readValue(std::ifstream &in, T &value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+// payloads are stored as utf-16 code units independent of the size of wchar_t
+std::u16string toUtf16(const std::wstring &in)
+{
+    if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+        return std::u16string(in.cbegin(), in.cend());
+    } else {
+        std::u16string out;
+        out.reserve(in.size());
+        for (const wchar_t c : in) {
+            const auto cp = static_cast<uint32_t>(c);
+            if (cp > 0xFFFF) {
+                out.push_back(static_cast<char16_t>(0xD800 + ((cp - 0x10000) >> 10)));
+                out.push_back(static_cast<char16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF)));
+            } else {
+                out.push_back(static_cast<char16_t>(cp));
+            }
+        }
+        return out;
+    }
+}
+
+std::wstring fromUtf16(const std::u16string &in)
+{
+    if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+        return std::wstring(in.cbegin(), in.cend());
+    } else {
+        std::wstring out;
+        out.reserve(in.size());
+        for (size_t i = 0; i < in.size(); ++i) {
+            const uint32_t c = in[i];
+            if (c >= 0xD800 && c < 0xDC00 && i + 1 < in.size() && in[i + 1] >= 0xDC00
+                && in[i + 1] < 0xE000) {
+                out.push_back(static_cast<wchar_t>(0x10000 + ((c - 0xD800) << 10)
+                                                   + (in[++i] - 0xDC00)));
+            } else {
+                out.push_back(static_cast<wchar_t>(c));
+            }
+        }
+        return out;
+    }
+}
+}
+
+std::chrono::milliseconds TimerWheel::systemClock()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+}
+
+TimerWheel::TimerWheel(Clock clock, std::chrono::milliseconds resolution)
+    : m_clock(std::move(clock)),
+      m_resolution(std::max(resolution, std::chrono::milliseconds(1))),
+      m_currentTick(toTick(m_clock()))
+{
+    for (auto &level : m_slots) {
+        level.fill(Nil);
+    }
+}
+
+std::chrono::milliseconds TimerWheel::now() const
+{
+    return m_clock();
+}
+
+int64_t TimerWheel::toTick(std::chrono::milliseconds time) const
+{
+    return time.count() / m_resolution.count();
+}
+
+int64_t TimerWheel::toDueTick(std::chrono::milliseconds time) const
+{
+    // round up so a timer never fires before its deadline
+    return (time.count() + m_resolution.count() - 1) / m_resolution.count();
+}
+
+TimerWheel::TimerId TimerWheel::makeId(uint32_t index) const
+{
+    // the generation protects against cancelling a recycled node with a stale id
+    return (static_cast<uint64_t>(m_nodes[index].generation) << 32) | (index + 1);
+}
+
+TimerWheel::TimerId TimerWheel::schedule(std::chrono::milliseconds deadline, Kind kind,
+                                         const std::wstring &payload)
+{
+    uint32_t index;
+    if (!m_free.empty()) {
+        index = m_free.back();
+        m_free.pop_back();
+    } else {
+        index = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+
+    Node &node = m_nodes[index];
+    node.deadline = deadline;
+    node.expires = toDueTick(deadline);
+    node.payload = payload;
+    node.kind = kind;
+    node.active = true;
+    link(index);
+    ++m_count;
+    return makeId(index);
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+    const uint64_t index = (id & 0xFFFFFFFF) - 1;
+    if (id == InvalidTimer || index >= m_nodes.size()) {
+        return false;
+    }
+    const Node &node = m_nodes[index];
+    if (!node.active || node.generation != (id >> 32)) {
+        return false;
+    }
+    unlink(static_cast<uint32_t>(index));
+    release(static_cast<uint32_t>(index));
+    return true;
+}
+
+void TimerWheel::link(uint32_t index)
+{
+    Node &node = m_nodes[index];
+
+    int64_t expires = std::max(node.expires, m_currentTick);
+    int64_t delta = expires - m_currentTick;
+
+    // beyond the range of the top level, park it there and re-cascade later
+    constexpr int64_t maxDelta = (int64_t(1) << (SlotBits * LevelCount)) - 1;
+    if (delta > maxDelta) {
+        delta = maxDelta;
+        expires = m_currentTick + maxDelta;
+    }
+
+    size_t level = 0;
+    while (level + 1 < LevelCount && delta >= (int64_t(1) << (SlotBits * (level + 1)))) {
+        ++level;
+    }
+
+    const auto slot = static_cast<uint16_t>((expires >> (SlotBits * level)) & SlotMask);
+    uint32_t &head = m_slots[level][slot];
+
+    node.level = static_cast<uint8_t>(level);
+    node.slot = slot;
+    node.prev = Nil;
+    node.next = head;
+    if (head != Nil) {
+        m_nodes[head].prev = index;
+    }
+    head = index;
+}
+
+void TimerWheel::unlink(uint32_t index)
+{
+    Node &node = m_nodes[index];
+    if (node.prev != Nil) {
+        m_nodes[node.prev].next = node.next;
+    } else {
+        m_slots[node.level][node.slot] = node.next;
+    }
+    if (node.next != Nil) {
+        m_nodes[node.next].prev = node.prev;
+    }
+    node.prev = node.next = Nil;
+}
+
+void TimerWheel::release(uint32_t index)
+{
+    Node &node = m_nodes[index];
+    node.active = false;
+    node.payload.clear();
+    ++node.generation;
+    m_free.push_back(index);
+    --m_count;
+}
+
+void TimerWheel::cascade(size_t level)
+{
+    const auto slot = static_cast<size_t>((m_currentTick >> (SlotBits * level)) & SlotMask);
+    if (slot == 0 && level + 1 < LevelCount) {
+        cascade(level + 1);
+    }
+
+    uint32_t index = m_slots[level][slot];
+    m_slots[level][slot] = Nil;
+    while (index != Nil) {
+        const uint32_t next = m_nodes[index].next;
+        link(index);
+        index = next;
+    }
+}
+
+std::vector<TimerWheel::Timer> TimerWheel::advance()
+{
+    std::vector<Timer> out;
+    const int64_t target = toTick(m_clock());
+
+    while (m_currentTick <= target) {
+        if (m_count == 0) {
+            m_currentTick = target + 1;
+            break;
+        }
+
+        const auto slot = static_cast<size_t>(m_currentTick & SlotMask);
+        if (slot == 0) {
+            cascade(1);
+        }
+
+        uint32_t index = m_slots[0][slot];
+        m_slots[0][slot] = Nil;
+        while (index != Nil) {
+            Node &node = m_nodes[index];
+            const uint32_t next = node.next;
+            out.push_back({ makeId(index), node.kind, node.deadline, std::move(node.payload) });
+            release(index);
+            index = next;
+        }
+        ++m_currentTick;
+    }
+
+    std::stable_sort(out.begin(), out.end(),
+                     [](const Timer &a, const Timer &b) { return a.deadline < b.deadline; });
+    return out;
+}
+
+std::optional<std::chrono::milliseconds> TimerWheel::nextDeadline() const
+{
+    if (m_count == 0) {
+        return {};
+    }
+
+    std::optional<std::chrono::milliseconds> out;
+    for (size_t level = 0; level < LevelCount; ++level) {
+        const auto start = static_cast<size_t>((m_currentTick >> (SlotBits * level)) & SlotMask);
+        // the slots of a level are ordered by time, the first occupied one holds its minimum.
+        // Above the first level the current slot was emptied by the cascade, anything linked
+        // into it since then wrapped around and is a full revolution away, so it comes last.
+        const size_t first = level == 0 ? 0 : 1;
+        for (size_t i = first; i < first + SlotCount; ++i) {
+            uint32_t index = m_slots[level][(start + i) & SlotMask];
+            if (index == Nil) {
+                continue;
+            }
+            for (; index != Nil; index = m_nodes[index].next) {
+                const auto due = m_nodes[index].expires * m_resolution;
+                if (!out || due < *out) {
+                    out = due;
+                }
+            }
+            break;
+        }
+    }
+    return out;
+}
+
+std::vector<TimerWheel::Timer> TimerWheel::pending() const
+{
+    std::vector<Timer> out;
+    out.reserve(m_count);
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        const Node &node = m_nodes[i];
+        if (node.active) {
+            out.push_back({ makeId(static_cast<uint32_t>(i)), node.kind, node.deadline,
+                            node.payload });
+        }
+    }
+    return out;
+}
+
+size_t TimerWheel::size() const
+{
+    return m_count;
+}
+
+bool TimerWheel::empty() const
+{
+    return m_count == 0;
+}
+
+bool TimerWheel::save(const std::filesystem::path &path) const
+{
+    auto tmp = path;
+    tmp += L".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        writeValue(out, static_cast<uint32_t>(m_count));
+        for (const auto &node : m_nodes) {
+            if (!node.active) {
+                continue;
+            }
+            const auto payload = toUtf16(node.payload);
+            writeValue(out, static_cast<int64_t>(node.deadline.count()));
+            writeValue(out, static_cast<uint8_t>(node.kind));
+            writeValue(out, static_cast<uint32_t>(payload.size()));
+            out.write(reinterpret_cast<const char *>(payload.data()),
+                      payload.size() * sizeof(char16_t));
+        }
+        out.flush();
+        if (!out) {
+            return false;
+        }
+    }
+    if (!syncFile(tmp)) {
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(tmp, path, error);
+    return !error;
+}
+
+bool TimerWheel::load(const std::filesystem::path &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    uint32_t count;
+    if (!in.read(magic, sizeof(magic))
+        || !std::equal(std::begin(magic), std::end(magic), std::begin(SNAPSHOT_MAGIC))
+        || !readValue(in, count)) {
+        return false;
+    }
+
+    // the sizes are checked against the rest of the file before anything is allocated
+    std::error_code error;
+    const auto fileSize = std::filesystem::file_size(path, error);
+    if (error) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        int64_t deadline;
+        uint8_t kind;
+        uint32_t size;
+        if (!readValue(in, deadline) || !readValue(in, kind) || !readValue(in, size)
+            || kind > static_cast<uint8_t>(Kind::Timeout)
+            || size > (fileSize - static_cast<uint64_t>(in.tellg())) / sizeof(char16_t)) {
+            return false;
+        }
+        std::u16string payload(size, 0);
+        if (!in.read(reinterpret_cast<char *>(payload.data()), size * sizeof(char16_t))) {
+            return false;
+        }
+        schedule(std::chrono::milliseconds(deadline), static_cast<Kind>(kind),
+                 fromUtf16(payload));
+    }
+    return true;
+}
@@ -0,0 +1,150 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+/*
+    Hierarchical timer wheel used for scheduled displays (-at / -in) and per toast
+    expiry deadlines.
+
+    Four levels of 256 slots each, the first level advances once per resolution tick.
+    Timers are kept in intrusive doubly linked lists inside a node pool, so schedule()
+    and cancel() are O(1) regardless of how many timers are pending. Timers further
+    away than the top level can cover are parked in the last level and re-cascaded.
+
+    The clock is injectable so the wheel can be driven deterministically.
+*/
+
+class TimerWheel
+{
+public:
+    using Clock = std::function<std::chrono::milliseconds()>;
+    using TimerId = uint64_t;
+
+    enum class Kind : uint8_t {
+        Display,
+        Expire,
+        Timeout
+    };
+
+    struct Timer
+    {
+        TimerId id;
+        Kind kind;
+        std::chrono::milliseconds deadline;
+        std::wstring payload;
+    };
+
+    static constexpr TimerId InvalidTimer = 0;
+
+    // milliseconds since the unix epoch
+    static std::chrono::milliseconds systemClock();
+
+    explicit TimerWheel(Clock clock = systemClock,
+                        std::chrono::milliseconds resolution = std::chrono::milliseconds(100));
+
+    std::chrono::milliseconds now() const;
+
+    TimerId schedule(std::chrono::milliseconds deadline, Kind kind,
+                     const std::wstring &payload = {});
+    bool cancel(TimerId id);
+
+    /**
+     * Moves the wheel to the current time of the clock and returns all timers that
+     * are due, in deadline order per tick.
+     */
+    std::vector<Timer> advance();
+
+    /**
+     * The time at which the earliest pending timer becomes due, used to compute how long
+     * the caller may sleep. Deadlines are rounded up to the resolution, timers never fire
+     * early.
+     */
+    std::optional<std::chrono::milliseconds> nextDeadline() const;
+
+    /**
+     * All pending timers, in no particular order.
+     */
+    std::vector<Timer> pending() const;
+
+    size_t size() const;
+    bool empty() const;
+
+    /**
+     * Compact binary snapshot of all pending timers.
+     * The file is replaced atomically so a crash never leaves a partial snapshot behind.
+     */
+    bool save(const std::filesystem::path &path) const;
+
+    /**
+     * Schedules all timers of a snapshot, timers that are already overdue fire on the
+     * next advance().
+     */
+    bool load(const std::filesystem::path &path);
+
+private:
+    static constexpr size_t LevelCount = 4;
+    static constexpr size_t SlotBits = 8;
+    static constexpr size_t SlotCount = 1 << SlotBits;
+    static constexpr uint64_t SlotMask = SlotCount - 1;
+    static constexpr uint32_t Nil = UINT32_MAX;
+
+    struct Node
+    {
+        std::chrono::milliseconds deadline;
+        int64_t expires = 0;
+        std::wstring payload;
+        uint32_t prev = Nil;
+        uint32_t next = Nil;
+        uint32_t generation = 0;
+        uint16_t slot = 0;
+        uint8_t level = 0;
+        Kind kind = Kind::Display;
+        bool active = false;
+    };
+
+    int64_t toTick(std::chrono::milliseconds time) const;
+    int64_t toDueTick(std::chrono::milliseconds time) const;
+    void link(uint32_t index);
+    void unlink(uint32_t index);
+    void release(uint32_t index);
+    void cascade(size_t level);
+    TimerId makeId(uint32_t index) const;
+
+    Clock m_clock;
+    std::chrono::milliseconds m_resolution;
+    int64_t m_currentTick;
+    size_t m_count = 0;
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_free;
+    std::array<std::array<uint32_t, SlotCount>, LevelCount> m_slots;
+};
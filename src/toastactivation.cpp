@@ -0,0 +1,43 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "toastactivation.h"
+#include "ntfytoastconsumer.h"
+
+ToastActivation ToastActivation::fromArguments(std::wstring_view arguments)
+{
+    const NtfyToastConsumer::CallbackMessage<wchar_t> message(arguments);
+    ToastActivation out;
+    switch (message.action()) {
+    case NtfyToastActions::Actions::TextEntered:
+        // the text only reaches the activator, see NtfyToasts::backgroundCallback
+        out.action = NtfyToastActions::Actions::TextEntered;
+        break;
+    case NtfyToastActions::Actions::Clicked:
+        out.action = NtfyToastActions::Actions::Clicked;
+        break;
+    default:
+        out.action = NtfyToastActions::Actions::ButtonClicked;
+        out.button = message.value("button");
+    }
+    return out;
+}
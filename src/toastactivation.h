@@ -0,0 +1,46 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "ntfytoastactions.h"
+
+#include <string>
+#include <string_view>
+
+/*
+    What the activation of a toast means for the caller of ntfytoast.
+
+    The launch argument of a toast is a click, the action of the text box a text entry and
+    every other action a button. Every front end decides the same way, whether it waits for
+    a single toast or dispatches many, and whatever backend delivered the event.
+*/
+
+struct ToastActivation
+{
+    NtfyToastActions::Actions action = NtfyToastActions::Actions::Error;
+    // the label of the button for ButtonClicked
+    std::wstring button;
+
+    // arguments is the argument string of the activated element, it must not be empty
+    static ToastActivation fromArguments(std::wstring_view arguments);
+};
@@ -0,0 +1,96 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "toastaggregator.h"
+
+namespace {
+// idle groups are dropped every PRUNE_INTERVAL toasts
+constexpr size_t PRUNE_INTERVAL = 1024;
+}
+
+ToastAggregator::ToastAggregator(Policy policy, TimerWheel::Clock clock)
+    : m_policy(policy), m_clock(std::move(clock))
+{
+}
+
+bool ToastAggregator::add(const std::wstring &group)
+{
+    const auto now = m_clock();
+    if (++m_adds % PRUNE_INTERVAL == 0) {
+        prune(now);
+    }
+
+    auto &g = m_groups[group];
+    if (g.storming) {
+        if (now - g.last < m_policy.window) {
+            g.last = now;
+            return true;
+        }
+        g.storming = false;
+    }
+    g.last = now;
+
+    if (g.arrivals.size() < m_policy.threshold) {
+        g.arrivals.push_back(now);
+        return false;
+    }
+    // more than threshold toasts within the window
+    if (m_policy.threshold == 0 || now - g.arrivals[g.next] < m_policy.window) {
+        g.storming = true;
+        g.arrivals.clear();
+        g.next = 0;
+        return true;
+    }
+    g.arrivals[g.next] = now;
+    g.next = (g.next + 1) % m_policy.threshold;
+    return false;
+}
+
+bool ToastAggregator::storming(const std::wstring &group) const
+{
+    const auto it = m_groups.find(group);
+    return it != m_groups.cend() && it->second.storming
+            && m_clock() - it->second.last < m_policy.window;
+}
+
+size_t ToastAggregator::groups() const
+{
+    const auto now = m_clock();
+    size_t out = 0;
+    for (const auto &g : m_groups) {
+        if (now - g.second.last < m_policy.window) {
+            ++out;
+        }
+    }
+    return out;
+}
+
+void ToastAggregator::prune(std::chrono::milliseconds now)
+{
+    for (auto it = m_groups.begin(); it != m_groups.end();) {
+        if (now - it->second.last >= m_policy.window) {
+            it = m_groups.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,79 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "timerwheel.h"
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+    Detects alert storms per toast group.
+
+    A group storms once more than threshold toasts arrive within window, every further
+    toast of the group belongs into its summary until no toast arrived for a whole window.
+    Only the arrival times of the last threshold toasts are kept per group, so add() is
+    constant time. Idle groups are forgotten from time to time.
+
+    Not thread safe, the ToastDispatcher only uses it from its thread.
+*/
+
+class ToastAggregator
+{
+public:
+    struct Policy
+    {
+        size_t threshold = 10;
+        std::chrono::milliseconds window = std::chrono::seconds(30);
+    };
+
+    explicit ToastAggregator(Policy policy, TimerWheel::Clock clock = TimerWheel::systemClock);
+
+    // true if the toast belongs into the summary of its group
+    bool add(const std::wstring &group);
+
+    bool storming(const std::wstring &group) const;
+
+    // groups with a toast within the last window
+    size_t groups() const;
+
+private:
+    struct Group
+    {
+        // ring buffer, once it is full next is the oldest arrival
+        std::vector<std::chrono::milliseconds> arrivals;
+        size_t next = 0;
+        std::chrono::milliseconds last {};
+        bool storming = false;
+    };
+
+    void prune(std::chrono::milliseconds now);
+
+    const Policy m_policy;
+    TimerWheel::Clock m_clock;
+    std::unordered_map<std::wstring, Group> m_groups;
+    size_t m_adds = 0;
+};
@@ -0,0 +1,130 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "ntfytoastactions.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+/*
+    Receives the events of a displayed toast.
+    The calls may arrive on any thread.
+*/
+
+class ToastEventSink
+{
+public:
+    virtual ~ToastEventSink() = default;
+
+    // arguments is the launch or action argument string of the activated element
+    virtual void activated(const std::wstring &arguments) = 0;
+
+    // reason is one of Hidden, Dismissed or Timedout
+    virtual void dismissed(NtfyToastActions::Actions reason) = 0;
+
+    virtual void failed() = 0;
+};
+
+struct ToastRequest
+{
+    std::wstring appID;
+    std::wstring tag;
+    std::wstring group;
+    std::wstring xml;
+    std::optional<std::chrono::system_clock::time_point> expirationTime;
+};
+
+enum class ToastSetting {
+    Enabled,
+    DisabledForApplication,
+    DisabledForUser,
+    DisabledByGroupPolicy,
+    DisabledByManifest
+};
+
+/*
+    Every expensive resource a backend uses is counted when it is created, so tests can
+    assert that a command only touched what it needed.
+*/
+
+struct ToastBackendCounters
+{
+    std::atomic<uint32_t> runtimeInitializations { 0 };
+    std::atomic<uint32_t> activatorRegistrations { 0 };
+    std::atomic<uint32_t> registrationChecks { 0 };
+    std::atomic<uint32_t> factoryLookups { 0 };
+    std::atomic<uint32_t> notifierCreations { 0 };
+    std::atomic<uint32_t> historyLookups { 0 };
+};
+
+/*
+    The notification system used by NtfyToasts.
+    Implementations create their resources on first use and keep them for later calls.
+*/
+
+class ToastBackend
+{
+public:
+    virtual ~ToastBackend() = default;
+
+    virtual bool initializeRuntime() = 0;
+
+    // route Action Center activations to this process
+    virtual bool registerActivator() = 0;
+
+    // false means the app id has no shortcut, only click actions are available
+    virtual bool isRegistered(const std::wstring &appID) = 0;
+
+    virtual ToastSetting setting(const std::wstring &appID) = 0;
+
+    // sink may be null if nobody is interested in the events
+    virtual bool show(const ToastRequest &request, std::shared_ptr<ToastEventSink> sink) = 0;
+
+    virtual bool hide(const std::wstring &appID, const std::wstring &tag,
+                      const std::wstring &group) = 0;
+
+    // remove a toast from the Action Center
+    virtual bool remove(const std::wstring &appID, const std::wstring &tag,
+                        const std::wstring &group) = 0;
+
+    // the tags of the toasts of a group in the Action Center, shown ones included
+    virtual std::vector<std::wstring> tags(const std::wstring &appID,
+                                           const std::wstring &group) = 0;
+
+    // remove all toasts of a group from the Action Center
+    virtual bool removeGroup(const std::wstring &appID, const std::wstring &group) = 0;
+
+    // remove all toasts of the app id from the Action Center
+    virtual bool clear(const std::wstring &appID) = 0;
+
+    const ToastBackendCounters &counters() const { return m_counters; }
+
+protected:
+    ToastBackendCounters m_counters;
+};
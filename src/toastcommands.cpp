@@ -0,0 +1,105 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "toastcommands.h"
+#include "arguments.h"
+#include "toastbackend.h"
+#include "config.h"
+
+#include <optional>
+#include <ostream>
+
+namespace {
+bool closeTag(ToastBackend &backend, const std::wstring &appID, const std::wstring &group,
+              const std::wstring &tag, const ToastCommands::CloseShown &closeShown)
+{
+    return (closeShown && closeShown(tag)) || backend.remove(appID, tag, group);
+}
+}
+
+namespace ToastCommands {
+void version(std::wostream &out)
+{
+    out << std::endl
+        << std::endl
+        << L"---------------------------------------------------------------------" << std::endl
+        << L" Version ................ v" << NTFYTOAST_VERSION << std::endl
+        << L" ToastActivatorCLSID .... " << NTFYTOAST_CALLBACK_GUID << std::endl
+        << L"---------------------------------------------------------------------" << std::endl
+        << std::endl
+        << L" Copyright 2024-2024 Aetherinox" << std::endl
+        << L" Copyright 2013-2019 Hannah von Reth <vonreth@kde.org>" << std::endl
+        << std::endl
+        << L" NtfyToast is free software: you can redistribute it and/or modify" << std::endl
+        << L" it under the terms of the GNU Lesser General Public License as published by"
+        << std::endl
+        << L" the Free Software Foundation, either version 3 of the License, or" << std::endl
+        << L" any later version." << std::endl;
+}
+
+void help(std::wostream &out, std::wstring_view error, std::wstring_view helpText)
+{
+    if (!error.empty()) {
+        out << error << std::endl;
+    } else {
+        out << L"Welcome to NtfyToast " << NTFYTOAST_VERSION << "." << std::endl
+            << L"A command line application capable of creating Windows Toast notifications."
+            << std::endl;
+    }
+    out << helpText << std::endl;
+}
+
+std::vector<std::wstring> closeNotifications(ToastBackend &backend, const std::wstring &appID,
+                                             const std::wstring &group,
+                                             const std::vector<std::wstring> &ids,
+                                             const CloseShown &closeShown)
+{
+    std::vector<std::wstring> missing;
+    std::optional<std::vector<std::wstring>> tags;
+    for (const auto &id : ids) {
+        if (id.empty()) {
+            missing.push_back(id);
+            continue;
+        }
+        if (!Arguments::isTagPattern(id)) {
+            if (!closeTag(backend, appID, group, id, closeShown)) {
+                missing.push_back(id);
+            }
+            continue;
+        }
+        if (!tags) {
+            tags = backend.tags(appID, group);
+        }
+        bool matched = false;
+        for (const auto &tag : *tags) {
+            if (Arguments::matchesTagPattern(id, tag)
+                && closeTag(backend, appID, group, tag, closeShown)) {
+                matched = true;
+            }
+        }
+        if (!matched) {
+            missing.push_back(id);
+        }
+    }
+    return missing;
+}
+}
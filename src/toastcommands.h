@@ -0,0 +1,63 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ToastBackend;
+
+/*
+    The commands of ntfytoast that do not show a toast, independent of the platform so they
+    run against a LoopbackBackend in the tests. -v and -h need nothing of the backend, the
+    commands that manage toasts shown before only its history. The counters of the backend
+    show what a command touched.
+
+    A toast owned by a running instance is closed by that instance, closeShown is asked
+    first. The others are removed from the Action Center. An id with * or ? is a pattern,
+    see Arguments::matchesTagPattern, that closes every toast of the group whose tag
+    matches. The history is read once for all patterns of a call.
+*/
+
+namespace ToastCommands {
+// -v, the version and the license
+void version(std::wostream &out);
+
+// -h, the error replaces the welcome line if it is not empty
+void help(std::wostream &out, std::wstring_view error, std::wstring_view helpText);
+
+// true if a running instance closed the toast of the tag
+using CloseShown = std::function<bool(const std::wstring &tag)>;
+
+/**
+ * Closes the toasts of ids in group. Returns the ids that did not close any toast, empty
+ * ids included.
+ */
+std::vector<std::wstring> closeNotifications(ToastBackend &backend, const std::wstring &appID,
+                                             const std::wstring &group,
+                                             const std::vector<std::wstring> &ids,
+                                             const CloseShown &closeShown = {});
+}
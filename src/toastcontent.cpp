@@ -0,0 +1,202 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "toastcontent.h"
+#include "allocationcounter.h"
+#include "callbackformat.h"
+#include "toastxml.h"
+
+#include <algorithm>
+
+namespace {
+constexpr std::wstring_view SoundScheme = L"ms-winsoundevent:";
+
+class Renderer
+{
+public:
+    Renderer(const ToastContent &content, std::wstring_view actionPrefix,
+             std::wstring_view submittedAt)
+        : m_content(content), m_actionPrefix(actionPrefix), m_submittedAt(submittedAt)
+    {
+    }
+
+    std::wstring render();
+
+private:
+    // valid until the next call, all actions of the toast share one buffer
+    std::wstring_view arguments(NtfyToastActions::Actions action,
+                                CallbackFormat::ActionData extraData = {});
+
+    void renderVisual();
+    void renderAudio();
+    void renderButtons();
+    void renderTextBox();
+
+    const ToastContent &m_content;
+    const std::wstring_view m_actionPrefix;
+    const std::wstring_view m_submittedAt;
+    ToastXmlWriter m_xml;
+    std::wstring m_arguments;
+};
+
+std::wstring Renderer::render()
+{
+    /*
+        Templates   : https://learn.microsoft.com/en-us/uwp/api/windows.ui.notifications.toasttemplatetype?view=winrt-26100#fields
+
+        Structure:
+            toast:      The launch attribute of this element defines what arguments will be passed back to your app when the user clicks your toast, allowing you to deep link into the correct content that the toast was displaying. To learn more, see Send a local app notification.
+            visual:     This element represents visual portion of the toast, including the generic binding that contains text and images.
+            actions:    This element represents interactive portion of the toast, including inputs and actions.
+            audio:      This element specifies the audio played when the toast is shown to the user.
+    */
+
+    m_xml.startElement(L"toast");
+    m_xml.attribute(L"launch", arguments(NtfyToastActions::Actions::Clicked));
+
+    /*
+        activationType 	Decides the type of activation that will be used when the user interacts with a specific action.
+
+            "foreground"    - Default value. Your foreground app is launched.
+            "background"    - Your corresponding background task is triggered, and you can execute code in the background without interrupting the user.
+            "protocol"      - Launch a different app using protocol activation.
+    */
+
+    m_xml.attribute(L"activationType", L"protocol");
+
+    /*
+        If -persistent is provided in arguments, notification will stay on screen until dismissed by user.
+
+        scenario? = "reminder" | "alarm" | "incomingCall" | "urgent" 
+    */
+
+    if (m_content.persistent) {
+        m_xml.attribute(L"scenario", L"incomingCall");
+    }
+
+    m_xml.attribute(L"duration", m_content.longDuration ? L"long" : L"short");
+
+    renderVisual();
+
+    // Adding buttons
+    if (!m_content.buttons.empty()) {
+        renderButtons();
+    } else if (m_content.textBox) {
+        renderTextBox();
+    }
+
+    renderAudio();
+    m_xml.endElement();
+    return m_xml.xml();
+}
+
+std::wstring_view Renderer::arguments(NtfyToastActions::Actions action,
+                                      CallbackFormat::ActionData extraData)
+{
+    m_arguments.clear();
+    CallbackFormat::appendAction(m_arguments, action, m_actionPrefix, m_submittedAt, 0,
+                                 extraData, false);
+    return m_arguments;
+}
+
+void Renderer::renderVisual()
+{
+    m_xml.startElement(L"visual");
+    m_xml.startElement(L"binding");
+    m_xml.attribute(L"template",
+                    m_content.image.empty() ? L"ToastText02" : L"ToastImageAndText02");
+
+    if (!m_content.image.empty()) {
+        m_xml.emptyElement(L"image", { { L"id", L"1" }, { L"src", m_content.image } });
+    }
+
+    // the title and the body
+    m_xml.startElement(L"text");
+    m_xml.attribute(L"id", L"1");
+    m_xml.text(m_content.title);
+    m_xml.endElement();
+
+    m_xml.startElement(L"text");
+    m_xml.attribute(L"id", L"2");
+    m_xml.text(m_content.body);
+    m_xml.endElement();
+
+    m_xml.endElement();
+    m_xml.endElement();
+}
+
+void Renderer::renderAudio()
+{
+    // the scheme is prepended in the buffer of the arguments, it is free by now
+    std::wstring_view sound = m_content.sound;
+    if (sound.find(SoundScheme) == std::wstring_view::npos) {
+        m_arguments.assign(SoundScheme);
+        m_arguments.append(sound);
+        sound = m_arguments;
+    }
+    m_xml.emptyElement(L"audio",
+                       { { L"src", sound }, { L"silent", m_content.silent ? L"true" : L"false" } });
+}
+
+void Renderer::renderButtons()
+{
+    m_xml.startElement(L"actions");
+
+    std::wstring_view buttons = m_content.buttons;
+    while (!buttons.empty()) {
+        const auto end = std::min(buttons.find(L';'), buttons.size());
+        const auto buttonText = buttons.substr(0, end);
+        buttons.remove_prefix(std::min(end + 1, buttons.size()));
+
+        const auto data = arguments(NtfyToastActions::Actions::ButtonClicked,
+                                    { { L"button", buttonText } });
+        m_xml.emptyElement(L"action",
+                           { { L"content", buttonText },
+                             { L"arguments", data },
+                             { L"activationType", L"foreground" } });
+    }
+    m_xml.endElement();
+}
+
+void Renderer::renderTextBox()
+{
+    m_xml.startElement(L"actions");
+    m_xml.emptyElement(L"input",
+                       { { L"id", L"textBox" },
+                         { L"type", L"text" },
+                         { L"placeHolderContent", L"Type a reply" } });
+
+    const auto data = arguments(NtfyToastActions::Actions::TextEntered);
+    m_xml.emptyElement(L"action",
+                       { { L"content", L"Send" },
+                         { L"arguments", data },
+                         { L"hint-inputId", L"textBox" } });
+    m_xml.endElement();
+}
+}
+
+std::wstring ToastContent::render(std::wstring_view actionPrefix,
+                                  std::wstring_view submittedAt) const
+{
+    const AllocationScope scope(AllocationPath::Render);
+    return Renderer(*this, actionPrefix, submittedAt).render();
+}
@@ -0,0 +1,53 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/*
+    What a toast of ntfytoast shows, rendered to the toast xml.
+
+    The fields are views, typically of the settings of a NtfyToasts, and must outlive the
+    call to render(). The launch argument of the toast and the arguments of its buttons and
+    text box carry the data of their action, see CallbackFormat::appendAction.
+*/
+
+struct ToastContent
+{
+    std::wstring_view title;
+    std::wstring_view body;
+    // an absolute path, empty without an image
+    std::wstring_view image;
+    // a name like Notification.Default, with or without the ms-winsoundevent: scheme
+    std::wstring_view sound = L"Notification.Default";
+    // separated by ';', they replace the text box
+    std::wstring_view buttons;
+    bool silent = false;
+    bool textBox = false;
+    bool persistent = false;
+    bool longDuration = false;
+
+    // actionPrefix holds the fields shared by all actions of the toast
+    std::wstring render(std::wstring_view actionPrefix, std::wstring_view submittedAt) const;
+};
@@ -0,0 +1,567 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "toastdispatcher.h"
+#include "toastactivation.h"
+#include "metrics.h"
+#include "toastxml.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+constexpr wchar_t SUMMARY_TAG[] = L"NtfyToastSummary";
+
+std::wstring defaultSummaryXml(const std::wstring &group, size_t count)
+{
+    const auto n = std::to_wstring(count);
+    ToastXmlWriter xml;
+    xml.startElement(L"toast");
+    xml.attribute(L"launch",
+                  L"action=" + NtfyToastActions::getActionString(NtfyToastActions::Actions::Clicked)
+                          + L";group=" + group + L";count=" + n + L";");
+    xml.startElement(L"visual");
+    xml.startElement(L"binding");
+    xml.attribute(L"template", L"ToastText01");
+    xml.startElement(L"text");
+    xml.attribute(L"id", L"1");
+    xml.text(n + (count == 1 ? L" alert from " : L" alerts from ") + group);
+    xml.endElement();
+    xml.endElement();
+    xml.endElement();
+    // updates of the summary should not ring for every alert of the storm
+    xml.emptyElement(L"audio", { { L"silent", L"true" } });
+    xml.endElement();
+    return xml.xml();
+}
+}
+
+struct ToastDispatcher::Toast
+{
+    ToastHandle handle = 0;
+    ToastSubmission submission;
+    std::promise<ToastResult> promise;
+    std::atomic<bool> cancelled { false };
+    std::atomic<bool> completed { false };
+
+    // only used by the dispatcher thread
+    TimerWheel::TimerId timer = TimerWheel::InvalidTimer;
+    std::optional<std::chrono::steady_clock::time_point> shownAt;
+};
+
+/*
+    Shared with the sinks, which may outlive the dispatcher.
+
+    Events and commands are pushed onto a lock free stack, the dispatcher thread takes all
+    of them at once and restores their order. Producers only touch the mutex if the
+    dispatcher thread is parked, so posting from many threads does not serialise on it.
+*/
+
+struct ToastDispatcher::Channel
+{
+    struct Node
+    {
+        Event event;
+        Node *next = nullptr;
+    };
+
+    std::atomic<Node *> head { nullptr };
+    // a toast was submitted
+    std::atomic<bool> notified { false };
+    std::atomic<bool> stopped { false };
+    std::atomic<bool> sleeping { false };
+
+    // only used to park the dispatcher thread
+    std::mutex mutex;
+    std::condition_variable wakeup;
+
+    // submitted toasts, to find queued toasts by handle
+    std::mutex toastsMutex;
+    std::unordered_map<ToastHandle, std::weak_ptr<Toast>> toasts;
+
+    ~Channel()
+    {
+        Node *node = head.exchange(nullptr);
+        while (node) {
+            delete std::exchange(node, node->next);
+        }
+    }
+
+    void post(Event event)
+    {
+        Node *node = new Node { std::move(event), head.load(std::memory_order_relaxed) };
+        while (!head.compare_exchange_weak(node->next, node)) {
+        }
+        wake();
+    }
+
+    void wake()
+    {
+        // pairs with the store in park(), either the dispatcher sees the new command or
+        // we see that it sleeps
+        if (sleeping.load()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+            }
+            wakeup.notify_one();
+        }
+    }
+
+    bool ready() const { return head.load() || notified.load() || stopped.load(); }
+
+    void park(const std::optional<std::chrono::milliseconds> &timeout)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        sleeping = true;
+        if (timeout) {
+            wakeup.wait_for(lock, *timeout, [this] { return ready(); });
+        } else {
+            wakeup.wait(lock, [this] { return ready(); });
+        }
+        sleeping = false;
+    }
+
+    // the events in the order they were posted
+    void take(std::vector<Event> &out)
+    {
+        Node *node = head.exchange(nullptr, std::memory_order_acquire);
+        Node *reversed = nullptr;
+        while (node) {
+            Node *next = node->next;
+            node->next = reversed;
+            reversed = node;
+            node = next;
+        }
+        while (reversed) {
+            out.push_back(std::move(reversed->event));
+            delete std::exchange(reversed, reversed->next);
+        }
+    }
+};
+
+class ToastDispatcher::Sink : public ToastEventSink
+{
+public:
+    Sink(std::weak_ptr<Channel> channel, ToastHandle handle)
+        : m_channel(std::move(channel)), m_handle(handle)
+    {
+    }
+
+    void activated(const std::wstring &arguments) override
+    {
+        post(Event::Type::Activated, NtfyToastActions::Actions::Clicked, arguments);
+    }
+
+    void dismissed(NtfyToastActions::Actions reason) override
+    {
+        post(Event::Type::Dismissed, reason);
+    }
+
+    void failed() override { post(Event::Type::Failed, NtfyToastActions::Actions::Error); }
+
+private:
+    void post(Event::Type type, NtfyToastActions::Actions reason,
+              const std::wstring &arguments = {})
+    {
+        if (const auto channel = m_channel.lock()) {
+            channel->post({ m_handle, type, reason, arguments });
+        }
+    }
+
+    const std::weak_ptr<Channel> m_channel;
+    const ToastHandle m_handle;
+};
+
+ToastDispatcher::ToastDispatcher(std::shared_ptr<ToastBackend> backend)
+    : ToastDispatcher(std::move(backend), Options())
+{
+}
+
+ToastDispatcher::ToastDispatcher(std::shared_ptr<ToastBackend> backend, Options options)
+    : m_backend(std::move(backend)),
+      m_options(std::move(options)),
+      m_queue(m_options.queueCapacity, m_options.dropPolicy),
+      m_channel(std::make_shared<Channel>()),
+      m_timers(m_options.clock)
+{
+    if (m_options.aggregation) {
+        m_aggregator.emplace(*m_options.aggregation, m_options.clock);
+    }
+}
+
+ToastDispatcher::~ToastDispatcher()
+{
+    stop();
+}
+
+void ToastDispatcher::start()
+{
+    if (!m_thread.joinable() && !m_channel->stopped) {
+        m_thread = std::thread([this] { run(); });
+    }
+}
+
+void ToastDispatcher::stop()
+{
+    // later submissions are rejected, the rest is completed by the dispatcher thread
+    m_queue.close();
+    if (m_channel->stopped.exchange(true)) {
+        return;
+    }
+    if (!m_thread.joinable()) {
+        if (m_pending == 0) {
+            return;
+        }
+        // never started, the thread only completes what was submitted
+        m_thread = std::thread([this] { run(); });
+    }
+    m_channel->wake();
+    m_thread.join();
+}
+
+ToastTicket ToastDispatcher::submit(ToastSubmission submission)
+{
+    const auto key = submission.request.tag;
+    return submit(std::move(submission), key);
+}
+
+ToastTicket ToastDispatcher::submit(ToastSubmission submission, const std::wstring &coalescingKey)
+{
+    auto toast = std::make_shared<Toast>();
+    toast->handle = ++m_nextHandle;
+    toast->submission = std::move(submission);
+
+    ToastTicket ticket;
+    ticket.handle = toast->handle;
+    ticket.result = toast->promise.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(m_channel->toastsMutex);
+        m_channel->toasts[toast->handle] = toast;
+    }
+    ++m_pending;
+
+    std::optional<std::shared_ptr<Toast>> dropped;
+    const auto priority = toast->submission.priority;
+    ticket.admission = m_queue.push(toast, priority, coalescingKey, &dropped);
+    if (!ticket.admission.accepted()) {
+        complete(toast, result(NtfyToastActions::Actions::Error));
+    }
+    if (dropped) {
+        // a replaced toast was superseded, an evicted one was lost
+        complete(*dropped,
+                 result(ticket.admission.result == Admission::Result::Coalesced
+                                ? NtfyToastActions::Actions::Hidden
+                                : NtfyToastActions::Actions::Error));
+    }
+    wake();
+    return ticket;
+}
+
+void ToastDispatcher::cancel(ToastHandle handle)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_channel->toastsMutex);
+        const auto it = m_channel->toasts.find(handle);
+        if (it == m_channel->toasts.cend()) {
+            return;
+        }
+        // a queued toast is completed once it is popped
+        if (const auto toast = it->second.lock()) {
+            toast->cancelled = true;
+        }
+    }
+    m_channel->post({ handle, Event::Type::Cancel, NtfyToastActions::Actions::Hidden, {} });
+}
+
+size_t ToastDispatcher::pending() const
+{
+    return m_pending;
+}
+
+SubmissionQueueStats ToastDispatcher::queueStats() const
+{
+    return m_queue.stats();
+}
+
+void ToastDispatcher::run()
+{
+    std::vector<Event> events;
+    while (true) {
+        std::optional<std::chrono::milliseconds> timeout;
+        if (const auto next = m_timers.nextDeadline()) {
+            timeout = std::max(*next - m_timers.now(), std::chrono::milliseconds::zero());
+        }
+        if (!m_channel->ready()) {
+            m_channel->park(timeout);
+        }
+        if (m_channel->stopped) {
+            drain();
+            return;
+        }
+        m_channel->notified = false;
+        m_channel->take(events);
+
+        for (auto &event : events) {
+            handle(event);
+        }
+        events.clear();
+
+        for (const auto &timer : m_timers.advance()) {
+            expire(timer);
+        }
+
+        while (m_outstanding.size() < m_options.maxOutstanding) {
+            const auto toast = m_queue.tryPop();
+            if (!toast) {
+                break;
+            }
+            show(*toast);
+        }
+    }
+}
+
+void ToastDispatcher::drain()
+{
+    while (const auto toast = m_queue.tryPop()) {
+        complete(*toast, result(NtfyToastActions::Actions::Error));
+    }
+    for (const auto &toast : m_outstanding) {
+        complete(toast.second, result(NtfyToastActions::Actions::Error));
+    }
+    m_outstanding.clear();
+    while (!m_summaries.empty()) {
+        completeSummary(m_summaries.cbegin()->first, result(NtfyToastActions::Actions::Error));
+    }
+}
+
+void ToastDispatcher::show(const std::shared_ptr<Toast> &toast)
+{
+    if (toast->cancelled) {
+        complete(toast, result(NtfyToastActions::Actions::Hidden));
+        return;
+    }
+
+    const auto &request = toast->submission.request;
+    if (m_backend->setting(request.appID) != ToastSetting::Enabled) {
+        complete(toast, result(NtfyToastActions::Actions::Error));
+        return;
+    }
+    m_backend->registerActivator();
+
+    if (m_aggregator && m_aggregator->add(request.group)) {
+        summarize(toast);
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    // events are only handled by this thread, so the toast may be tracked after show()
+    if (!m_backend->show(request, std::make_shared<Sink>(m_channel, toast->handle))) {
+        complete(toast, result(NtfyToastActions::Actions::Error));
+        return;
+    }
+    toast->shownAt = std::chrono::steady_clock::now();
+    Metrics::instance().recordShow(
+            std::chrono::duration_cast<std::chrono::microseconds>(*toast->shownAt - start));
+
+    const auto payload = std::to_wstring(toast->handle);
+    if (request.expirationTime) {
+        // the expiration time is wall clock time, the wheel runs on Options::clock
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                *request.expirationTime - std::chrono::system_clock::now());
+        toast->timer = m_timers.schedule(m_timers.now() + remaining, TimerWheel::Kind::Expire,
+                                         payload);
+    } else if (m_options.timeout) {
+        toast->timer = m_timers.schedule(m_timers.now() + *m_options.timeout,
+                                         TimerWheel::Kind::Timeout, payload);
+    }
+    m_outstanding[toast->handle] = toast;
+}
+
+void ToastDispatcher::handle(Event &event)
+{
+    const auto it = m_outstanding.find(event.handle);
+    if (it == m_outstanding.cend()) {
+        handleSummary(event);
+        return;
+    }
+    const auto toast = it->second;
+    m_outstanding.erase(it);
+    m_timers.cancel(toast->timer);
+
+    if (event.type == Event::Type::Cancel) {
+        const auto &request = toast->submission.request;
+        m_backend->hide(request.appID, request.tag, request.group);
+    }
+    complete(toast, result(event));
+}
+
+void ToastDispatcher::summarize(const std::shared_ptr<Toast> &toast)
+{
+    const auto &request = toast->submission.request;
+    auto &summary = m_summaries[request.group];
+    summary.members.push_back(toast);
+
+    // the new summary replaces the shown one, events of the old one are ignored
+    if (summary.handle) {
+        m_summaryGroups.erase(summary.handle);
+        m_timers.cancel(summary.timer);
+    }
+    summary.handle = ++m_nextHandle;
+    summary.appID = request.appID;
+    m_summaryGroups[summary.handle] = request.group;
+
+    const auto count = summary.members.size();
+    const ToastRequest summaryRequest {
+        request.appID, SUMMARY_TAG, request.group,
+        m_options.summaryXml ? m_options.summaryXml(request.group, count)
+                             : defaultSummaryXml(request.group, count),
+        {}
+    };
+    if (!m_backend->show(summaryRequest, std::make_shared<Sink>(m_channel, summary.handle))) {
+        completeSummary(request.group, result(NtfyToastActions::Actions::Error));
+        return;
+    }
+    summary.timer = m_options.timeout
+            ? m_timers.schedule(m_timers.now() + *m_options.timeout, TimerWheel::Kind::Timeout,
+                                std::to_wstring(summary.handle))
+            : TimerWheel::InvalidTimer;
+}
+
+void ToastDispatcher::handleSummary(Event &event)
+{
+    if (event.type == Event::Type::Cancel) {
+        // a toast collected in a summary is completed right away, the summary stays
+        for (auto &summary : m_summaries) {
+            auto &members = summary.second.members;
+            const auto it = std::find_if(members.begin(), members.end(), [&](const auto &t) {
+                return t->handle == event.handle;
+            });
+            if (it != members.end()) {
+                const auto toast = *it;
+                members.erase(it);
+                complete(toast, result(NtfyToastActions::Actions::Hidden));
+                return;
+            }
+        }
+        // otherwise a cancelled toast that is still queued
+        return;
+    }
+    const auto it = m_summaryGroups.find(event.handle);
+    if (it == m_summaryGroups.cend()) {
+        // already completed, or a summary that was replaced
+        return;
+    }
+    const auto group = it->second;
+    completeSummary(group, result(event));
+}
+
+void ToastDispatcher::completeSummary(const std::wstring &group, const ToastResult &result)
+{
+    const auto it = m_summaries.find(group);
+    if (it == m_summaries.cend()) {
+        return;
+    }
+    const auto summary = std::move(it->second);
+    m_summaries.erase(it);
+    m_summaryGroups.erase(summary.handle);
+    m_timers.cancel(summary.timer);
+
+    for (const auto &toast : summary.members) {
+        complete(toast, result);
+    }
+}
+
+ToastResult ToastDispatcher::result(NtfyToastActions::Actions action)
+{
+    ToastResult out;
+    out.action = action;
+    return out;
+}
+
+ToastResult ToastDispatcher::result(Event &event)
+{
+    ToastResult out = result(event.reason);
+    if (event.type == Event::Type::Activated) {
+        if (!event.arguments.empty()) {
+            out.action = ToastActivation::fromArguments(event.arguments).action;
+        }
+        out.arguments = std::move(event.arguments);
+    }
+    return out;
+}
+
+void ToastDispatcher::expire(const TimerWheel::Timer &timer)
+{
+    const auto handle = std::stoull(timer.payload);
+    const auto it = m_outstanding.find(handle);
+    if (it == m_outstanding.cend()) {
+        // nobody reacted to a summary, take it off the screen like Windows would
+        const auto summary = m_summaryGroups.find(handle);
+        if (summary != m_summaryGroups.cend()) {
+            const auto group = summary->second;
+            m_backend->hide(m_summaries[group].appID, SUMMARY_TAG, group);
+            completeSummary(group, result(NtfyToastActions::Actions::Timedout));
+        }
+        return;
+    }
+    const auto toast = it->second;
+    m_outstanding.erase(it);
+
+    if (timer.kind == TimerWheel::Kind::Expire) {
+        const auto &request = toast->submission.request;
+        m_backend->hide(request.appID, request.tag, request.group);
+        complete(toast, result(NtfyToastActions::Actions::Hidden));
+    } else {
+        complete(toast, result(NtfyToastActions::Actions::Error));
+    }
+}
+
+void ToastDispatcher::complete(const std::shared_ptr<Toast> &toast, ToastResult result)
+{
+    if (toast->completed.exchange(true)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_channel->toastsMutex);
+        m_channel->toasts.erase(toast->handle);
+    }
+    --m_pending;
+
+    result.shownAt = toast->shownAt;
+    if (toast->shownAt) {
+        Metrics::instance().recordAction(
+                result.action,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - *toast->shownAt));
+    }
+    if (toast->submission.completion) {
+        toast->submission.completion(toast->handle, result);
+    }
+    toast->promise.set_value(std::move(result));
+}
+
+void ToastDispatcher::wake()
+{
+    m_channel->notified = true;
+    m_channel->wake();
+}
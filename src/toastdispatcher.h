@@ -0,0 +1,206 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "ntfytoastactions.h"
+#include "submissionqueue.h"
+#include "toastaggregator.h"
+#include "timerwheel.h"
+#include "toastbackend.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using ToastHandle = uint64_t;
+
+struct ToastResult
+{
+    NtfyToastActions::Actions action = NtfyToastActions::Actions::Error;
+    // the arguments of the activated element, empty unless the toast was activated
+    std::wstring arguments;
+    // empty if the toast was never shown, see NtfyToasts::setShownAt
+    std::optional<std::chrono::steady_clock::time_point> shownAt;
+};
+
+struct ToastSubmission
+{
+    ToastRequest request;
+    SubmissionPriority priority = SubmissionPriority::Normal;
+    // called on the dispatcher thread, must not block
+    std::function<void(ToastHandle, const ToastResult &)> completion;
+};
+
+struct ToastTicket
+{
+    ToastHandle handle = 0;
+    Admission admission;
+    std::future<ToastResult> result;
+};
+
+/*
+    Asynchronous front end for a ToastBackend.
+
+    submit() never blocks, the toast is queued in a SubmissionQueue and a single dispatcher
+    thread shows it, waits for its events and completes it. Every toast is completed
+    exactly once, through the completion callback and the future of its ticket:
+
+        Clicked, ButtonClicked, TextEntered     the toast was activated
+        Dismissed, Timedout                     the user or Windows dismissed it
+        Hidden                                  it expired, was cancelled or replaced by
+                                                a newer toast with the same coalescing key
+        Error                                   it was rejected, evicted from the queue,
+                                                failed, or nobody reacted within the
+                                                timeout of the Options
+
+    With aggregation the toasts of a storming group are not shown, they are collected in a
+    summary toast of the group which is updated for every new toast. Once the summary is
+    activated or dismissed each collected toast is completed with its result, so the
+    individual toasts still reach their completion. A summary nobody reacted to within the
+    timeout is hidden and its toasts are completed as Timedout.
+
+    The backend is only used from the dispatcher thread. submit() and cancel() may be called
+    from any number of threads, they hand their work to the dispatcher thread without
+    waiting for it.
+*/
+
+class ToastDispatcher
+{
+public:
+    struct Options
+    {
+        size_t queueCapacity = 1024;
+        DropPolicy dropPolicy = DropPolicy::DropOldest;
+        // toasts on screen at the same time, the rest waits in the queue
+        size_t maxOutstanding = 256;
+        // how long to wait for a reaction to a toast without expiration time, without a
+        // timeout a toast is completed by its own events only
+        std::optional<std::chrono::milliseconds> timeout = std::chrono::minutes(1);
+        TimerWheel::Clock clock = TimerWheel::systemClock;
+        // collapse storms into a summary toast per group, off by default
+        std::optional<ToastAggregator::Policy> aggregation;
+        // the xml of a summary, by default "<count> alerts from <group>"
+        std::function<std::wstring(const std::wstring &group, size_t count)> summaryXml;
+    };
+
+    explicit ToastDispatcher(std::shared_ptr<ToastBackend> backend);
+    ToastDispatcher(std::shared_ptr<ToastBackend> backend, Options options);
+    ~ToastDispatcher();
+
+    ToastDispatcher(const ToastDispatcher &) = delete;
+    ToastDispatcher &operator=(const ToastDispatcher &) = delete;
+
+    // starts the dispatcher thread, a stopped dispatcher can not be started again
+    void start();
+
+    /**
+     * Stops the dispatcher thread, before it exits it completes queued and outstanding
+     * toasts with Error. Toasts already on screen stay there, later submissions are
+     * rejected.
+     */
+    void stop();
+
+    /**
+     * With the Coalesce drop policy a queued toast with the same coalescing key is
+     * replaced, by default the tag is used.
+     */
+    ToastTicket submit(ToastSubmission submission);
+    ToastTicket submit(ToastSubmission submission, const std::wstring &coalescingKey);
+
+    // hides a shown toast or drops a queued one, it is completed with Hidden
+    void cancel(ToastHandle handle);
+
+    // toasts that were submitted but not completed yet
+    size_t pending() const;
+    SubmissionQueueStats queueStats() const;
+
+private:
+    struct Toast;
+    struct Event
+    {
+        enum class Type {
+            Activated,
+            Dismissed,
+            Failed,
+            Cancel
+        };
+        ToastHandle handle;
+        Type type;
+        NtfyToastActions::Actions reason;
+        std::wstring arguments;
+    };
+    struct Channel;
+    class Sink;
+
+    struct Summary
+    {
+        // the summary toast currently shown, a new one replaces it for every update
+        ToastHandle handle = 0;
+        // the app the summary is shown for, to hide it once it timed out
+        std::wstring appID;
+        TimerWheel::TimerId timer = TimerWheel::InvalidTimer;
+        std::vector<std::shared_ptr<Toast>> members;
+    };
+
+    void run();
+    // completes everything left once the dispatcher is stopped
+    void drain();
+    void show(const std::shared_ptr<Toast> &toast);
+    void handle(Event &event);
+    void summarize(const std::shared_ptr<Toast> &toast);
+    void handleSummary(Event &event);
+    void completeSummary(const std::wstring &group, const ToastResult &result);
+    static ToastResult result(NtfyToastActions::Actions action);
+    static ToastResult result(Event &event);
+    void expire(const TimerWheel::Timer &timer);
+    void complete(const std::shared_ptr<Toast> &toast, ToastResult result);
+    void wake();
+
+    const std::shared_ptr<ToastBackend> m_backend;
+    const Options m_options;
+
+    SubmissionQueue<std::shared_ptr<Toast>> m_queue;
+    std::shared_ptr<Channel> m_channel;
+    std::atomic<ToastHandle> m_nextHandle { 0 };
+    std::atomic<size_t> m_pending { 0 };
+
+    // only used by the dispatcher thread
+    TimerWheel m_timers;
+    std::unordered_map<ToastHandle, std::shared_ptr<Toast>> m_outstanding;
+    std::optional<ToastAggregator> m_aggregator;
+    std::unordered_map<std::wstring, Summary> m_summaries;
+    // the group of a summary toast by its handle
+    std::unordered_map<ToastHandle, std::wstring> m_summaryGroups;
+
+    std::thread m_thread;
+};
@@ -24,6 +24,8 @@
 #include "ntfytoasts.h"
 #include "toasteventhandler.h"
 #include "utils.h"
+#include "callbacksink.h"
+#include "toastactivation.h"
 
 #include <sstream>
 #include <iostream>
@@ -31,13 +33,11 @@
 #include <algorithm>
 #include <assert.h>
 
-using namespace ABI::Windows::UI::Notifications;
-
-ToastEventHandler::ToastEventHandler(const NtfyToasts &toast)
-    : m_ref(1), m_userAction(NtfyToastActions::Actions::Hidden), m_toast(toast)
+ToastEventHandler::ToastEventHandler(std::shared_ptr<const ToastCallbackFormatter> toast)
+    : m_userAction(NtfyToastActions::Actions::Hidden), m_toast(std::move(toast))
 {
     std::wstringstream eventName;
-    eventName << L"ToastEvent" << m_toast.id();
+    eventName << L"ToastEvent" << m_toast->id();
     m_event = CreateEventW(nullptr, true, false, eventName.str().c_str());
 }
 
@@ -51,97 +51,75 @@ HANDLE ToastEventHandler::event()
     return m_event;
 }
 
-NtfyToastActions::Actions &ToastEventHandler::userAction()
+NtfyToastActions::Actions ToastEventHandler::userAction() const
 {
-    return m_userAction;
+    return m_userAction.load(std::memory_order_acquire);
 }
 
-// DesktopToastActivatedEventHandler
-IFACEMETHODIMP ToastEventHandler::Invoke(_In_ IToastNotification * /*sender*/,
-                                         _In_ IInspectable *args)
+void ToastEventHandler::activated(const std::wstring &arguments)
 {
-    IToastActivatedEventArgs *buttonReply = nullptr;
-    args->QueryInterface(&buttonReply);
-    if (buttonReply == nullptr) {
+    if (arguments.empty()) {
         std::wcerr << L"args is not a IToastActivatedEventArgs" << std::endl;
     } else {
-        HSTRING args;
-        buttonReply->get_Arguments(&args);
-        std::wstring data = WindowsGetStringRawBuffer(args, nullptr);
-        tLog << data;
+        tLog << arguments;
 
-        const auto dataMap = Utils::splitData(data);
-        const auto action = NtfyToastActions::getAction(dataMap.at(L"action"));
-        assert(dataMap.at(L"notificationId") == m_toast.id());
+        const auto activation = ToastActivation::fromArguments(arguments);
+        const auto action = activation.action;
+        assert(CallbackFormat::splitData(arguments).at(L"notificationId") == m_toast->id());
 
         if (action == NtfyToastActions::Actions::TextEntered) {
             // The text is only passed to the named pipe
             tLog << L"The user entered a text.";
-            m_userAction = NtfyToastActions::Actions::TextEntered;
         } else if (action == NtfyToastActions::Actions::Clicked) {
             tLog << L"The user clicked on the toast.";
-            m_userAction = NtfyToastActions::Actions::Clicked;
         } else {
             tLog << L"The user clicked on a toast button.";
-            std::wcout << dataMap.at(L"button") << std::endl;
-            m_userAction = NtfyToastActions::Actions::ButtonClicked;
+            if (!NtfyToasts::callbackSink()->usesStdout()) {
+                std::wcout << activation.button << std::endl;
+            }
         }
-        if (m_toast.useFalbackMode() && !m_toast.pipeName().empty()) {
-            Utils::writePipe(m_toast.pipeName(), m_toast.formatAction(m_userAction));
+        m_userAction.store(action, std::memory_order_release);
+        // otherwise the activator receives the callback, see NtfyToasts::backgroundCallback
+        if (m_toast->fallbackMode()) {
+            m_toast->write(action, *NtfyToasts::callbackSink());
         }
     }
 
     SetEvent(m_event);
-
-    return S_OK;
 }
 
-// DesktopToastDismissedEventHandler
-IFACEMETHODIMP ToastEventHandler::Invoke(_In_ IToastNotification * /* sender */,
-                                         _In_ IToastDismissedEventArgs *e)
+void ToastEventHandler::dismissed(NtfyToastActions::Actions reason)
 {
-    ToastDismissalReason tdr;
-    HRESULT hr = e->get_Reason(&tdr);
-
-    if (SUCCEEDED(hr)) {
-        switch (tdr) {
-
-        case ToastDismissalReason_ApplicationHidden:
-            tLog << L"The application hid the toast using ToastNotifier.hide()";
-            m_userAction = NtfyToastActions::Actions::Hidden;
-            break;
-
-        case ToastDismissalReason_UserCanceled:
-            tLog << L"The user dismissed this toast";
-            m_userAction = NtfyToastActions::Actions::Dismissed;
-            break;
-
-        case ToastDismissalReason_TimedOut:
-            tLog << L"The toast has timed out";
-            m_userAction = NtfyToastActions::Actions::Timedout;
-            break;
-        }
-    }
+    switch (reason) {
+
+    case NtfyToastActions::Actions::Hidden:
+        tLog << L"The application hid the toast using ToastNotifier.hide()";
+        break;
 
-    if (!m_toast.pipeName().empty()) {
-        Utils::writePipe(m_toast.pipeName(), m_toast.formatAction(m_userAction));
+    case NtfyToastActions::Actions::Dismissed:
+        tLog << L"The user dismissed this toast";
+        break;
+
+    case NtfyToastActions::Actions::Timedout:
+        tLog << L"The toast has timed out";
+        break;
+
+    default:
+        break;
     }
+    m_userAction.store(reason, std::memory_order_release);
 
-    SetEvent(m_event);
+    m_toast->write(reason, *NtfyToasts::callbackSink());
 
-    return S_OK;
+    SetEvent(m_event);
 }
 
-// DesktopToastFailedEventHandler
-IFACEMETHODIMP ToastEventHandler::Invoke(_In_ IToastNotification * /* sender */,
-                                         _In_ IToastFailedEventArgs * /* e */)
+void ToastEventHandler::failed()
 {
     std::wcerr << L"NtfyToast encountered an error." << std::endl;
     std::wcerr << L"Please make sure that the app id is set correctly." << std::endl;
     std::wcerr << L"Command Line: " << GetCommandLineW() << std::endl;
-    m_userAction = NtfyToastActions::Actions::Error;
+    m_userAction.store(NtfyToastActions::Actions::Error, std::memory_order_release);
 
     SetEvent(m_event);
-
-    return S_OK;
 }
@@ -23,82 +23,35 @@
 
 #pragma once
 #include "ntfytoasts.h"
+#include "toastbackend.h"
 
-typedef ABI::Windows::Foundation::ITypedEventHandler<
-        ABI::Windows::UI::Notifications::ToastNotification *, ::IInspectable *>
-        DesktopToastActivatedEventHandler;
+#include <atomic>
+#include <memory>
 
-typedef ABI::Windows::Foundation::ITypedEventHandler<
-        ABI::Windows::UI::Notifications::ToastNotification *,
-        ABI::Windows::UI::Notifications::ToastDismissedEventArgs *>
-        DesktopToastDismissedEventHandler;
-
-typedef ABI::Windows::Foundation::ITypedEventHandler<
-        ABI::Windows::UI::Notifications::ToastNotification *,
-        ABI::Windows::UI::Notifications::ToastFailedEventArgs *>
-        DesktopToastFailedEventHandler;
+/*
+    The events arrive on threads of the notification platform while the thread of the toast
+    waits for event(). The action is published before the event is signalled, a late event
+    after a timeout only replaces it atomically.
+    The handler only reads the ToastCallbackFormatter it shares with the toast, the
+    NtfyToasts may be gone by the time an event arrives.
+*/
 
-class ToastEventHandler : public Microsoft::WRL::Implements<DesktopToastActivatedEventHandler,
-                                                            DesktopToastDismissedEventHandler,
-                                                            DesktopToastFailedEventHandler>
+class ToastEventHandler : public ToastEventSink
 {
 
 public:
-    explicit ToastEventHandler::ToastEventHandler(const NtfyToasts &toast);
-    ~ToastEventHandler();
+    explicit ToastEventHandler(std::shared_ptr<const ToastCallbackFormatter> toast);
+    ~ToastEventHandler() override;
 
     HANDLE event();
-    NtfyToastActions::Actions &userAction();
-
-    // DesktopToastActivatedEventHandler
-    IFACEMETHODIMP Invoke(_In_ ABI::Windows::UI::Notifications::IToastNotification *sender,
-                          _In_ IInspectable *args);
-
-    // DesktopToastDismissedEventHandler
-    IFACEMETHODIMP Invoke(_In_ ABI::Windows::UI::Notifications::IToastNotification *sender,
-                          _In_ ABI::Windows::UI::Notifications::IToastDismissedEventArgs *e);
-
-    // DesktopToastFailedEventHandler
-    IFACEMETHODIMP Invoke(_In_ ABI::Windows::UI::Notifications::IToastNotification *sender,
-                          _In_ ABI::Windows::UI::Notifications::IToastFailedEventArgs *e);
-
-    // IUnknown
-    IFACEMETHODIMP_(ULONG) AddRef() { return InterlockedIncrement(&m_ref); }
-
-    IFACEMETHODIMP_(ULONG) Release()
-    {
-        ULONG l = InterlockedDecrement(&m_ref);
-        if (l == 0) {
-            delete this;
-        }
-        return l;
-    }
-
-    IFACEMETHODIMP QueryInterface(_In_ REFIID riid, _COM_Outptr_ void **ppv)
-    {
-        if (IsEqualIID(riid, IID_IUnknown)) {
-            *ppv = static_cast<IUnknown *>(static_cast<DesktopToastActivatedEventHandler *>(this));
-        } else if (IsEqualIID(riid, __uuidof(DesktopToastActivatedEventHandler))) {
-            *ppv = static_cast<DesktopToastActivatedEventHandler *>(this);
-        } else if (IsEqualIID(riid, __uuidof(DesktopToastDismissedEventHandler))) {
-            *ppv = static_cast<DesktopToastDismissedEventHandler *>(this);
-        } else if (IsEqualIID(riid, __uuidof(DesktopToastFailedEventHandler))) {
-            *ppv = static_cast<DesktopToastFailedEventHandler *>(this);
-        } else {
-            *ppv = nullptr;
-        }
-
-        if (*ppv) {
-            reinterpret_cast<IUnknown *>(*ppv)->AddRef();
-            return S_OK;
-        }
+    NtfyToastActions::Actions userAction() const;
 
-        return E_NOINTERFACE;
-    }
+    void activated(const std::wstring &arguments) override;
+    void dismissed(NtfyToastActions::Actions reason) override;
+    void failed() override;
 
 private:
-    ULONG m_ref;
-    NtfyToastActions::Actions m_userAction;
+    std::atomic<NtfyToastActions::Actions> m_userAction;
     HANDLE m_event;
-    const NtfyToasts &m_toast;
+    const std::shared_ptr<const ToastCallbackFormatter> m_toast;
 };
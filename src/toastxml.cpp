@@ -0,0 +1,312 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "toastxml.h"
+
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NTFY_XML_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define NTFY_XML_SSE2 0
+#endif
+
+namespace {
+// attribute values lose literal tab, line feed and carriage return to normalisation
+template<bool Attribute, typename Char>
+inline bool needsEscape(Char c)
+{
+    const auto u = static_cast<std::make_unsigned_t<Char>>(c);
+    return u == '<' || u == '>' || u == '&' || u == '"' || u == '\''
+            || (u < 0x20 && (Attribute || (u != '\t' && u != '\n' && u != '\r')));
+}
+
+#if NTFY_XML_SSE2
+/*
+    Compares 16 bytes at a time against the five special characters and the control
+    characters but tab, line feed and carriage return, which are common in bodies and
+    only need escaping in attribute values. The result has a bit set for every byte of a lane that needs escaping.
+*/
+template<size_t Size>
+class SpecialScanner
+{
+public:
+    SpecialScanner()
+        : m_lt(set1('<')), m_gt(set1('>')), m_amp(set1('&')), m_quot(set1('"')),
+          m_apos(set1('\'')), m_control(set1(Size == 4 ? 0x20 : 0x1f)), m_tab(set1('\t')),
+          m_lf(set1('\n')), m_cr(set1('\r'))
+    {
+    }
+
+    template<bool Attribute>
+    int mask(__m128i v) const
+    {
+        __m128i special = _mm_or_si128(_mm_or_si128(eq(v, m_lt), eq(v, m_gt)),
+                                       _mm_or_si128(eq(v, m_amp), eq(v, m_quot)));
+        special = _mm_or_si128(special, eq(v, m_apos));
+        __m128i control;
+        if constexpr (Size == 1) {
+            control = eq(_mm_subs_epu8(v, m_control), _mm_setzero_si128());
+        } else if constexpr (Size == 2) {
+            control = eq(_mm_subs_epu16(v, m_control), _mm_setzero_si128());
+        } else {
+            // UTF-32 code points are positive, a signed compare works
+            control = _mm_cmplt_epi32(v, m_control);
+        }
+        if constexpr (!Attribute) {
+            const __m128i allowed =
+                    _mm_or_si128(_mm_or_si128(eq(v, m_tab), eq(v, m_lf)), eq(v, m_cr));
+            control = _mm_andnot_si128(allowed, control);
+        }
+        special = _mm_or_si128(special, control);
+        return _mm_movemask_epi8(special);
+    }
+
+private:
+    static __m128i set1(int c)
+    {
+        if constexpr (Size == 1) {
+            return _mm_set1_epi8(static_cast<char>(c));
+        } else if constexpr (Size == 2) {
+            return _mm_set1_epi16(static_cast<short>(c));
+        } else {
+            return _mm_set1_epi32(c);
+        }
+    }
+
+    static __m128i eq(__m128i a, __m128i b)
+    {
+        if constexpr (Size == 1) {
+            return _mm_cmpeq_epi8(a, b);
+        } else if constexpr (Size == 2) {
+            return _mm_cmpeq_epi16(a, b);
+        } else {
+            return _mm_cmpeq_epi32(a, b);
+        }
+    }
+
+    const __m128i m_lt;
+    const __m128i m_gt;
+    const __m128i m_amp;
+    const __m128i m_quot;
+    const __m128i m_apos;
+    const __m128i m_control;
+    const __m128i m_tab;
+    const __m128i m_lf;
+    const __m128i m_cr;
+};
+#endif
+
+// the index of the first character that needs escaping, size if there is none
+template<bool Attribute, typename Char>
+size_t findSpecial(const Char *in, size_t size)
+{
+    size_t i = 0;
+#if NTFY_XML_SSE2
+    constexpr size_t lanes = 16 / sizeof(Char);
+    // set up once, markup calls this for every few characters
+    static const SpecialScanner<sizeof(Char)> scanner;
+    for (; i + 2 * lanes <= size; i += 2 * lanes) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + lanes));
+        const int maskA = scanner.template mask<Attribute>(a);
+        const int maskB = scanner.template mask<Attribute>(b);
+        if ((maskA | maskB) != 0) {
+            const uint32_t mask = static_cast<uint32_t>(maskA) | (uint32_t(maskB) << 16);
+            unsigned long bit = 0;
+#ifdef _MSC_VER
+            _BitScanForward(&bit, mask);
+#else
+            bit = static_cast<unsigned long>(__builtin_ctz(mask));
+#endif
+            return i + bit / sizeof(Char);
+        }
+    }
+#endif
+    for (; i < size && !needsEscape<Attribute>(in[i]); ++i) {
+    }
+    return i;
+}
+
+template<typename String>
+void appendAscii(String &out, const char *ascii)
+{
+    for (; *ascii; ++ascii) {
+        out.push_back(static_cast<typename String::value_type>(*ascii));
+    }
+}
+
+template<bool Attribute, typename String>
+void appendEscaped(String &out, typename String::value_type c)
+{
+    switch (static_cast<std::make_unsigned_t<typename String::value_type>>(c)) {
+    case '<':
+        appendAscii(out, "&lt;");
+        break;
+    case '>':
+        appendAscii(out, "&gt;");
+        break;
+    case '&':
+        appendAscii(out, "&amp;");
+        break;
+    case '"':
+        appendAscii(out, "&quot;");
+        break;
+    case '\'':
+        appendAscii(out, "&apos;");
+        break;
+    case '\t':
+        appendAscii(out, Attribute ? "&#9;" : "\t");
+        break;
+    case '\n':
+        appendAscii(out, Attribute ? "&#10;" : "\n");
+        break;
+    case '\r':
+        appendAscii(out, Attribute ? "&#13;" : "\r");
+        break;
+    default:
+        if (needsEscape<Attribute>(c)) {
+            // other control characters are not allowed in XML 1.0, not even as reference
+            if constexpr (sizeof(c) == 1) {
+                appendAscii(out, "\xEF\xBF\xBD");
+            } else {
+                out.push_back(static_cast<typename String::value_type>(0xFFFD));
+            }
+        } else {
+            out.push_back(c);
+        }
+    }
+}
+
+template<bool Attribute, typename String>
+void escapeTo(String &out, std::basic_string_view<typename String::value_type> value)
+{
+    // labels and titles, too short for the vectors to pay off
+    if (value.size() < 32 / sizeof(typename String::value_type)) {
+        for (const auto c : value) {
+            if (needsEscape<Attribute>(c)) {
+                appendEscaped<Attribute>(out, c);
+            } else {
+                out.push_back(c);
+            }
+        }
+        return;
+    }
+    size_t start = 0;
+    while (start < value.size()) {
+        const size_t special =
+                start + findSpecial<Attribute>(value.data() + start, value.size() - start);
+        out.append(value.data() + start, special - start);
+        if (special == value.size()) {
+            return;
+        }
+        appendEscaped<Attribute>(out, value[special]);
+        start = special + 1;
+    }
+}
+}
+
+void ToastXmlWriter::startElement(std::wstring_view name)
+{
+    closeStartTag();
+    m_xml += L'<';
+    m_xml += name;
+    m_elements.push_back(name);
+    m_startTagOpen = true;
+}
+
+void ToastXmlWriter::attribute(std::wstring_view name, std::wstring_view value)
+{
+    m_xml += L' ';
+    m_xml += name;
+    m_xml += L"=\"";
+    escapeAttribute(m_xml, value);
+    m_xml += L'"';
+}
+
+void ToastXmlWriter::text(std::wstring_view value)
+{
+    closeStartTag();
+    escape(m_xml, value);
+}
+
+void ToastXmlWriter::endElement()
+{
+    if (m_startTagOpen) {
+        m_xml += L"/>";
+        m_startTagOpen = false;
+    } else {
+        m_xml += L"</";
+        m_xml += m_elements.back();
+        m_xml += L'>';
+    }
+    m_elements.pop_back();
+}
+
+void ToastXmlWriter::emptyElement(
+        std::wstring_view name,
+        std::initializer_list<std::pair<std::wstring_view, std::wstring_view>> attributes)
+{
+    startElement(name);
+    for (const auto &a : attributes) {
+        attribute(a.first, a.second);
+    }
+    endElement();
+}
+
+const std::wstring &ToastXmlWriter::xml() const
+{
+    return m_xml;
+}
+
+void ToastXmlWriter::closeStartTag()
+{
+    if (m_startTagOpen) {
+        m_xml += L'>';
+        m_startTagOpen = false;
+    }
+}
+
+void ToastXmlWriter::escape(std::wstring &out, std::wstring_view value)
+{
+    escapeTo<false>(out, value);
+}
+
+void ToastXmlWriter::escape(std::string &out, std::string_view value)
+{
+    escapeTo<false>(out, value);
+}
+
+void ToastXmlWriter::escapeAttribute(std::wstring &out, std::wstring_view value)
+{
+    escapeTo<true>(out, value);
+}
+
+void ToastXmlWriter::escapeAttribute(std::string &out, std::string_view value)
+{
+    escapeTo<true>(out, value);
+}
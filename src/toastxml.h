@@ -0,0 +1,75 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+    Minimal writer for the toast xml.
+    The toast is rendered as text and loaded by the backend in one go instead of building
+    it node by node through the WinRT XML DOM.
+
+    Element names are not copied, they are expected to be literals.
+*/
+
+class ToastXmlWriter
+{
+public:
+    void startElement(std::wstring_view name);
+    void attribute(std::wstring_view name, std::wstring_view value);
+    void text(std::wstring_view value);
+    void endElement();
+
+    // an element with attributes only
+    void emptyElement(std::wstring_view name,
+                      std::initializer_list<std::pair<std::wstring_view, std::wstring_view>>
+                              attributes);
+
+    const std::wstring &xml() const;
+
+    /**
+     * Appends value escaped for text. Control characters other than
+     * tab, line feed and carriage return are replaced with U+FFFD, they are not allowed in
+     * XML. Runs without special characters are found with SSE2 and copied in one go.
+     */
+    static void escape(std::wstring &out, std::wstring_view value);
+    static void escape(std::string &out, std::string_view value);
+
+    /**
+     * Like escape, but tab, line feed and carriage return become character references,
+     * a parser would turn them into spaces in an attribute value.
+     */
+    static void escapeAttribute(std::wstring &out, std::wstring_view value);
+    static void escapeAttribute(std::string &out, std::string_view value);
+
+private:
+    void closeStartTag();
+
+    std::wstring m_xml;
+    std::vector<std::wstring_view> m_elements;
+    bool m_startTagOpen = false;
+};
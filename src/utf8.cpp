@@ -0,0 +1,326 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "utf8.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NTFY_UTF8_SSE2 1
+#include <emmintrin.h>
+#else
+#define NTFY_UTF8_SSE2 0
+#endif
+
+namespace {
+constexpr uint32_t REPLACEMENT = 0xFFFD;
+
+inline bool isHighSurrogate(uint32_t c)
+{
+    return c >= 0xD800 && c <= 0xDBFF;
+}
+
+inline bool isLowSurrogate(uint32_t c)
+{
+    return c >= 0xDC00 && c <= 0xDFFF;
+}
+
+inline char *putCodePoint(char *out, uint32_t c)
+{
+    if (c < 0x80) {
+        *out++ = static_cast<char>(c);
+    } else if (c < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (c >> 6));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        *out++ = static_cast<char>(0xE0 | (c >> 12));
+        *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+        *out++ = static_cast<char>(0xF0 | (c >> 18));
+        *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    }
+    return out;
+}
+
+inline char16_t *putUtf16(char16_t *out, uint32_t c)
+{
+    if (c < 0x10000) {
+        *out++ = static_cast<char16_t>(c);
+    } else {
+        *out++ = static_cast<char16_t>(0xD800 + ((c - 0x10000) >> 10));
+        *out++ = static_cast<char16_t>(0xDC00 + ((c - 0x10000) & 0x3FF));
+    }
+    return out;
+}
+
+// copies the leading ASCII of in to out, returns the number of copied code units
+size_t copyAscii(const char16_t *in, size_t size, char *out)
+{
+    size_t i = 0;
+#if NTFY_UTF8_SSE2
+    const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8));
+        const __m128i high = _mm_and_si128(_mm_or_si128(a, b), nonAscii);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(a, b));
+    }
+#endif
+    for (; i < size && in[i] < 0x80; ++i) {
+        out[i] = static_cast<char>(in[i]);
+    }
+    return i;
+}
+
+size_t copyAscii(const char *in, size_t size, char16_t *out)
+{
+    size_t i = 0;
+#if NTFY_UTF8_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        if (_mm_movemask_epi8(v) != 0) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+#endif
+    for (; i < size && static_cast<unsigned char>(in[i]) < 0x80; ++i) {
+        out[i] = static_cast<char16_t>(in[i]);
+    }
+    return i;
+}
+
+/*
+    Decodes one UTF-8 sequence starting at in[i].
+    On malformed input the maximal invalid prefix is consumed and REPLACEMENT returned,
+    as recommended by the Unicode standard (3.9, U+FFFD substitution of maximal subparts).
+*/
+uint32_t decodeSequence(const unsigned char *in, size_t size, size_t &i, bool &valid)
+{
+    const unsigned char lead = in[i++];
+    valid = false;
+
+    size_t length;
+    uint32_t c;
+    unsigned char lower = 0x80;
+    unsigned char upper = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 1;
+        c = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 2;
+        c = lead & 0x0F;
+        // no overlong encodings and no surrogates
+        if (lead == 0xE0) {
+            lower = 0xA0;
+        } else if (lead == 0xED) {
+            upper = 0x9F;
+        }
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 3;
+        c = lead & 0x07;
+        // no overlong encodings and nothing above U+10FFFF
+        if (lead == 0xF0) {
+            lower = 0x90;
+        } else if (lead == 0xF4) {
+            upper = 0x8F;
+        }
+    } else {
+        return REPLACEMENT;
+    }
+
+    for (size_t n = 0; n < length; ++n) {
+        if (i >= size || in[i] < lower || in[i] > upper) {
+            return REPLACEMENT;
+        }
+        c = (c << 6) | (in[i++] & 0x3F);
+        lower = 0x80;
+        upper = 0xBF;
+    }
+    valid = true;
+    return c;
+}
+
+// out needs room for 3 bytes per code unit
+size_t encode(const char16_t *in, size_t size, char *out, size_t &replaced)
+{
+    char *const begin = out;
+    size_t i = 0;
+    while (i < size) {
+        const size_t ascii = copyAscii(in + i, size - i, out);
+        i += ascii;
+        out += ascii;
+
+        // handle the non ASCII part until the next ASCII character
+        while (i < size && in[i] >= 0x80) {
+            uint32_t c = in[i++];
+            if (isHighSurrogate(c) && i < size && isLowSurrogate(in[i])) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (in[i++] - 0xDC00);
+            } else if (isHighSurrogate(c) || isLowSurrogate(c)) {
+                c = REPLACEMENT;
+                ++replaced;
+            }
+            out = putCodePoint(out, c);
+        }
+    }
+    return static_cast<size_t>(out - begin);
+}
+
+// out needs room for one code unit per byte
+size_t decode(const char *in, size_t size, char16_t *out, size_t &replaced)
+{
+    const auto bytes = reinterpret_cast<const unsigned char *>(in);
+    char16_t *const begin = out;
+    size_t i = 0;
+    while (i < size) {
+        const size_t ascii = copyAscii(in + i, size - i, out);
+        i += ascii;
+        out += ascii;
+
+        while (i < size && bytes[i] >= 0x80) {
+            bool valid;
+            const uint32_t c = decodeSequence(bytes, size, i, valid);
+            if (!valid) {
+                ++replaced;
+            }
+            out = putUtf16(out, c);
+        }
+    }
+    return static_cast<size_t>(out - begin);
+}
+}
+
+namespace Utf8 {
+std::string fromUtf16(std::u16string_view in, size_t *replaced)
+{
+    size_t count = 0;
+    std::string out(in.size() * 3, '\0');
+    out.resize(encode(in.data(), in.size(), out.data(), count));
+    if (replaced) {
+        *replaced = count;
+    }
+    return out;
+}
+
+std::u16string toUtf16(std::string_view in, size_t *replaced)
+{
+    size_t count = 0;
+    std::u16string out(in.size(), u'\0');
+    out.resize(decode(in.data(), in.size(), out.data(), count));
+    if (replaced) {
+        *replaced = count;
+    }
+    return out;
+}
+
+std::string fromWide(std::wstring_view in, size_t *replaced)
+{
+    if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+        return fromUtf16(
+                std::u16string_view(reinterpret_cast<const char16_t *>(in.data()), in.size()),
+                replaced);
+    } else {
+        size_t count = 0;
+        std::string out(in.size() * 4, '\0');
+        char *it = out.data();
+        for (const wchar_t w : in) {
+            uint32_t c = static_cast<uint32_t>(w);
+            if (c > 0x10FFFF || isHighSurrogate(c) || isLowSurrogate(c)) {
+                c = REPLACEMENT;
+                ++count;
+            }
+            it = putCodePoint(it, c);
+        }
+        out.resize(static_cast<size_t>(it - out.data()));
+        if (replaced) {
+            *replaced = count;
+        }
+        return out;
+    }
+}
+
+std::wstring toWide(std::string_view in, size_t *replaced)
+{
+    if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+        std::wstring out(in.size(), L'\0');
+        size_t count = 0;
+        out.resize(decode(in.data(), in.size(), reinterpret_cast<char16_t *>(out.data()), count));
+        if (replaced) {
+            *replaced = count;
+        }
+        return out;
+    } else {
+        const auto utf16 = toUtf16(in, replaced);
+        std::wstring out;
+        out.reserve(utf16.size());
+        for (size_t i = 0; i < utf16.size(); ++i) {
+            uint32_t c = utf16[i];
+            // toUtf16 only produces valid pairs
+            if (isHighSurrogate(c)) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (utf16[++i] - 0xDC00);
+            }
+            out.push_back(static_cast<wchar_t>(c));
+        }
+        return out;
+    }
+}
+
+bool isValid(std::u16string_view in)
+{
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (isHighSurrogate(in[i]) && i + 1 < in.size() && isLowSurrogate(in[i + 1])) {
+            ++i;
+        } else if (isHighSurrogate(in[i]) || isLowSurrogate(in[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isValid(std::string_view in)
+{
+    const auto bytes = reinterpret_cast<const unsigned char *>(in.data());
+    size_t i = 0;
+    while (i < in.size()) {
+        if (bytes[i] < 0x80) {
+            ++i;
+            continue;
+        }
+        bool valid;
+        decodeSequence(bytes, in.size(), i, valid);
+        if (!valid) {
+            return false;
+        }
+    }
+    return true;
+}
+}
@@ -0,0 +1,58 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*
+    Encoding of the data written to the callback pipe.
+    Utf16 is the native wchar_t layout and stays the default for existing consumers.
+*/
+
+enum class PipeEncoding {
+    Utf16,
+    Utf8
+};
+
+/*
+    UTF-16 <-> UTF-8 transcoding.
+
+    Runs of ASCII are converted 16 code units at a time with SSE2 where available, the
+    rest falls back to a scalar loop. Invalid input never fails the conversion: unpaired
+    surrogates, as they can show up in text replies, and malformed UTF-8 sequences are
+    replaced with U+FFFD. If replaced is given it receives the number of replacements.
+*/
+
+namespace Utf8 {
+std::string fromUtf16(std::u16string_view in, size_t *replaced = nullptr);
+std::u16string toUtf16(std::string_view in, size_t *replaced = nullptr);
+
+// wchar_t is UTF-16 on Windows and UTF-32 elsewhere
+std::string fromWide(std::wstring_view in, size_t *replaced = nullptr);
+std::wstring toWide(std::string_view in, size_t *replaced = nullptr);
+
+bool isValid(std::u16string_view in);
+bool isValid(std::string_view in);
+}
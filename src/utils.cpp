@@ -23,11 +23,16 @@
 
 #include "utils.h"
 #include "ntfytoasts.h"
+#include "metrics.h"
+#include "callbackspool.h"
+#include "callbackrecorder.h"
 
 #include <wrl/client.h>
 #include <wrl/implements.h>
 #include <wrl/module.h>
 
+#include <optional>
+
 using namespace Microsoft::WRL;
 
 namespace {
@@ -58,29 +63,6 @@ void unregisterActivator()
     }
 }
 
-std::unordered_map<std::wstring_view, std::wstring_view> splitData(const std::wstring_view &data)
-{
-    std::unordered_map<std::wstring_view, std::wstring_view> out;
-    size_t start = 0;
-    for (size_t end = data.find(L";", start); end != std::wstring::npos;
-        start = end + 1, end = data.find(L";", start)) {
-
-        if (start == end) {
-            end = data.size();
-        }
-
-        const std::wstring_view tmp(data.data() + start, end - start);
-        const auto pos = tmp.find(L"=");
-
-        if (pos > 0) {
-            out[tmp.substr(0, pos)] = tmp.substr(pos + 1);
-        }
-
-        // tLog << L"'" << tmp.substr(0, pos) << L"' = '" << tmp.substr(pos + 1) << L"'";
-    }
-    return out;
-}
-
 const std::filesystem::path &selfLocate()
 {
     static const std::filesystem::path path = [] {
@@ -105,8 +87,20 @@ const std::filesystem::path &selfLocate()
     return path;
 }
 
-bool writePipe(const std::filesystem::path &pipe, const std::wstring &data, bool wait)
+bool writePipe(const std::filesystem::path &pipe, const std::wstring &data, bool wait,
+               PipeEncoding encoding)
 {
+    const auto start = std::chrono::steady_clock::now();
+    const auto recordWrite = [&](bool success) {
+        const auto writeTime = std::chrono::steady_clock::now() - start;
+        Metrics::instance().recordPipeWrite(
+                std::chrono::duration_cast<std::chrono::microseconds>(writeTime), success);
+        if (const auto recorder = CallbackRecorder::instance()) {
+            recorder->record(pipe.wstring(), data, encoding, success, start, writeTime);
+        }
+        return success;
+    };
+
     if (wait) {
         WaitNamedPipe(pipe.wstring().c_str(), 20000);
     }
@@ -116,30 +110,99 @@ bool writePipe(const std::filesystem::path &pipe, const std::wstring &data, bool
 
     if (hPipe != INVALID_HANDLE_VALUE) {
         DWORD written;
-        const DWORD toWrite = static_cast<DWORD>(data.size() * sizeof(wchar_t));
-        WriteFile(hPipe, data.c_str(), toWrite, &written, nullptr);
-        const bool success = written == toWrite;
+        bool success;
+        if (encoding == PipeEncoding::Utf8) {
+            // the data is terminated by a single null byte instead of a null wchar_t
+            std::string utf8 = Utf8::fromWide(data);
+            utf8.push_back('\0');
+            const DWORD toWrite = static_cast<DWORD>(utf8.size());
+            WriteFile(hPipe, utf8.data(), toWrite, &written, nullptr);
+            success = written == toWrite;
+        } else {
+            const DWORD toWrite = static_cast<DWORD>(data.size() * sizeof(wchar_t));
+            WriteFile(hPipe, data.c_str(), toWrite, &written, nullptr);
+            success = written == toWrite;
+            WriteFile(hPipe, nullptr, sizeof(wchar_t), &written, nullptr);
+        }
         tLog << (success ? L"Wrote: " : L"Failed to write: ") << data << " to " << pipe;
-        WriteFile(hPipe, nullptr, sizeof(wchar_t), &written, nullptr);
         CloseHandle(hPipe);
 
-        return success;
+        return recordWrite(success);
     }
 
     tLog << L"Failed to open pipe: " << pipe << L" data: " << data;
 
+    return recordWrite(false);
+}
+
+namespace {
+size_t deliverSpooled(CallbackSpool &spool, const std::filesystem::path &pipe)
+{
+    const auto delivered = spool.deliver(
+            [](const CallbackSpool::Callback &callback) {
+                return writePipe(callback.pipe, callback.data, false, callback.encoding);
+            },
+            pipe.wstring());
+    if (delivered > 0) {
+        tLog << L"Delivered" << delivered << L"spooled callbacks to" << pipe;
+    }
+    return delivered;
+}
+}
+
+bool writeCallback(const std::filesystem::path &pipe, const std::wstring &data,
+                   PipeEncoding encoding, const std::filesystem::path &application)
+{
+    // the spool is mapped only if it holds callbacks or this one has to be spooled
+    std::optional<CallbackSpool> spool;
+    const auto deliverPending = [&] {
+        if (spool || CallbackSpool::hasPending()) {
+            if (!spool) {
+                spool.emplace();
+            }
+            deliverSpooled(*spool, pipe);
+        }
+    };
+    deliverPending();
+    if (writePipe(pipe, data, false, encoding)) {
+        return true;
+    }
+    if (!application.empty() && startProcess(application)) {
+        WaitNamedPipe(pipe.wstring().c_str(), 20000);
+        deliverPending();
+        if (writePipe(pipe, data, false, encoding)) {
+            return true;
+        }
+    }
+    if (!spool) {
+        spool.emplace();
+    }
+    if (spool->append(pipe.wstring(), data, encoding)) {
+        tLog << L"Spooled the callback until" << pipe << L"is available";
+    }
     return false;
 }
 
-bool startProcess(const std::filesystem::path &app)
+size_t deliverSpooledCallbacks(const std::filesystem::path &pipe)
+{
+    CallbackSpool spool;
+    return deliverSpooled(spool, pipe);
+}
+
+bool startProcess(const std::filesystem::path &app, const std::wstring &arguments)
 {
     STARTUPINFO info = {};
     info.cb = sizeof(info);
     PROCESS_INFORMATION pInfo = {};
     const auto application = app.wstring();
+    std::wstring commandLine = application;
+
+    if (!arguments.empty()) {
+        commandLine = L"\"" + application + L"\" " + arguments;
+    }
 
-    if (!CreateProcess(const_cast<wchar_t *>(application.c_str()),
-                       const_cast<wchar_t *>(application.c_str()), nullptr, nullptr, false,
+    if (!CreateProcess(const_cast<wchar_t *>(application.c_str()), commandLine.data(), nullptr,
+                       nullptr, false,
                        DETACHED_PROCESS | INHERIT_PARENT_AFFINITY | CREATE_NO_WINDOW, nullptr,
                        nullptr, &info, &pInfo)) {
         tLog << L"Failed to start: " << app;
@@ -159,24 +222,6 @@ bool startProcess(const std::filesystem::path &app)
     return status == STILL_ACTIVE;
 }
 
-std::wstring formatData(const std::vector<std::pair<std::wstring_view, std::wstring_view>> &data)
-{
-    std::wstringstream out;
-    const auto add = [&](const std::pair<std::wstring_view, std::wstring_view> &p) {
-        if (!p.second.empty()) {
-            out << p.first << L"=" << p.second << L";";
-        }
-    };
-
-    for (const auto &p : data) {
-        add(p);
-    }
-
-    add({ L"version", NtfyToasts::version() });
-
-    return out.str();
-}
-
 std::wstring formatWinError(unsigned long errorCode)
 {
     wchar_t *error = nullptr;
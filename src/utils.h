@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include "utf8.h"
+
 #include <comdef.h>
 #include <filesystem>
 #include <sstream>
@@ -69,14 +71,22 @@ namespace Utils {
 bool registerActivator();
 void unregisterActivator();
 
-std::unordered_map<std::wstring_view, std::wstring_view> splitData(const std::wstring_view &data);
-
 const std::filesystem::path &selfLocate();
 
-std::wstring formatData(const std::vector<std::pair<std::wstring_view, std::wstring_view>> &data);
+bool writePipe(const std::filesystem::path &pipe, const std::wstring &data, bool wait = false,
+               PipeEncoding encoding = PipeEncoding::Utf16);
+bool startProcess(const std::filesystem::path &app, const std::wstring &arguments = {});
+
+/**
+ * Writes a callback to its consumer, callbacks the consumer missed before are written first.
+ * If the pipe does not exist the application is started, if that is not possible either
+ * the callback is kept in the CallbackSpool until the pipe is back.
+ */
+bool writeCallback(const std::filesystem::path &pipe, const std::wstring &data,
+                   PipeEncoding encoding, const std::filesystem::path &application = {});
 
-bool writePipe(const std::filesystem::path &pipe, const std::wstring &data, bool wait = false);
-bool startProcess(const std::filesystem::path &app);
+// writes the spooled callbacks of pipe, returns the number of delivered callbacks
+size_t deliverSpooledCallbacks(const std::filesystem::path &pipe);
 
 inline bool checkResult(const char *file, const long line, const char *func, const HRESULT &hr)
 {
@@ -0,0 +1,161 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "winhttptransport.h"
+#include "ntfytoasts.h"
+#include "utils.h"
+
+#include <winhttp.h>
+
+#include <atomic>
+
+namespace {
+// ntfy sends a keepalive every 45 seconds, a silent connection is dead
+constexpr int ReceiveTimeout = 2 * 60 * 1000;
+// the request after abort(), it is closed and never opened again
+const HINTERNET Aborted = INVALID_HANDLE_VALUE;
+
+class WinHttpRequest : public NtfyTransport::Request
+{
+public:
+    WinHttpRequest(HINTERNET session, const NtfyTransport::Endpoint &endpoint,
+                   const std::wstring &path)
+        : m_session(session), m_endpoint(endpoint), m_path(path)
+    {
+    }
+
+    ~WinHttpRequest() override
+    {
+        const auto request = m_request.exchange(nullptr);
+        if (request && request != Aborted) {
+            WinHttpCloseHandle(request);
+        }
+        if (m_connection) {
+            WinHttpCloseHandle(m_connection);
+        }
+    }
+
+    int send() override
+    {
+        if (!m_session) {
+            return fail(L"No http session");
+        }
+        m_connection = WinHttpConnect(m_session, m_endpoint.host.c_str(), m_endpoint.port, 0);
+        if (!m_connection) {
+            return fail(L"Failed to connect to " + m_endpoint.host);
+        }
+        const HINTERNET request = WinHttpOpenRequest(
+                m_connection, L"GET", m_path.c_str(), nullptr, WINHTTP_NO_REFERER,
+                WINHTTP_DEFAULT_ACCEPT_TYPES, m_endpoint.secure ? WINHTTP_FLAG_SECURE : 0);
+        if (!request) {
+            return fail(L"Failed to open " + m_path);
+        }
+        HINTERNET expected = nullptr;
+        if (!m_request.compare_exchange_strong(expected, request)) {
+            // aborted before the request existed
+            WinHttpCloseHandle(request);
+            return fail(L"The request was aborted");
+        }
+
+        // abort() closes the request, which aborts a blocking call
+        if (!WinHttpSendRequest(request, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
+                                WINHTTP_NO_REQUEST_DATA, 0, 0, 0)
+            || !WinHttpReceiveResponse(request, nullptr)) {
+            return fail(L"Request to " + m_endpoint.host + m_path + L" failed");
+        }
+        DWORD status = 0;
+        DWORD size = sizeof(status);
+        if (!WinHttpQueryHeaders(request, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+                                 WINHTTP_HEADER_NAME_BY_INDEX, &status, &size,
+                                 WINHTTP_NO_HEADER_INDEX)) {
+            return fail(L"No status code");
+        }
+        return static_cast<int>(status);
+    }
+
+    size_t read(char *data, size_t size) override
+    {
+        const HINTERNET request = m_request.load();
+        DWORD read = 0;
+        if (!request || request == Aborted
+            || !WinHttpReadData(request, data, static_cast<DWORD>(size), &read)) {
+            fail(L"Failed to read from " + m_endpoint.host + m_path);
+            return 0;
+        }
+        return read;
+    }
+
+    void abort() override
+    {
+        // a request that does not exist yet is never opened
+        const auto request = m_request.exchange(Aborted);
+        if (request && request != Aborted) {
+            WinHttpCloseHandle(request);
+        }
+    }
+
+    std::wstring error() const override
+    {
+        return m_error;
+    }
+
+private:
+    int fail(const std::wstring &message)
+    {
+        m_error = message + L": " + Utils::formatWinError(GetLastError());
+        return 0;
+    }
+
+    const HINTERNET m_session;
+    const NtfyTransport::Endpoint m_endpoint;
+    const std::wstring m_path;
+    HINTERNET m_connection = nullptr;
+    // Aborted once abort() was called
+    std::atomic<HINTERNET> m_request { nullptr };
+    std::wstring m_error;
+};
+}
+
+WinHttpTransport::WinHttpTransport()
+    : m_session(WinHttpOpen((L"NtfyToast/" + NtfyToasts::version()).c_str(),
+                            WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME,
+                            WINHTTP_NO_PROXY_BYPASS, 0))
+{
+    if (!m_session) {
+        tLog << L"Failed to open a http session:" << Utils::formatWinError(GetLastError());
+        return;
+    }
+    WinHttpSetTimeouts(m_session, 0, 30 * 1000, 30 * 1000, ReceiveTimeout);
+}
+
+WinHttpTransport::~WinHttpTransport()
+{
+    if (m_session) {
+        WinHttpCloseHandle(m_session);
+    }
+}
+
+std::unique_ptr<NtfyTransport::Request> WinHttpTransport::open(const Endpoint &endpoint,
+                                                               const std::wstring &path)
+{
+    return std::make_unique<WinHttpRequest>(m_session, endpoint, path);
+}
@@ -0,0 +1,45 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "ntfytransport.h"
+
+/*
+    NtfyTransport on WinHTTP, with the proxy settings of the system and https.
+*/
+
+class WinHttpTransport : public NtfyTransport
+{
+public:
+    WinHttpTransport();
+    ~WinHttpTransport() override;
+
+    WinHttpTransport(const WinHttpTransport &) = delete;
+    WinHttpTransport &operator=(const WinHttpTransport &) = delete;
+
+    std::unique_ptr<Request> open(const Endpoint &endpoint, const std::wstring &path) override;
+
+private:
+    // HINTERNET shared by all requests
+    void *m_session = nullptr;
+};
@@ -0,0 +1,515 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "wintoastbackend.h"
+#include "metrics.h"
+#include "utils.h"
+
+#include <wrl\wrappers\corewrappers.h>
+#include <roapi.h>
+#include <functional>
+#include <iostream>
+
+using namespace Microsoft::WRL;
+using namespace ABI::Windows::UI::Notifications;
+using namespace ABI::Windows::Data::Xml::Dom;
+using namespace Wrappers;
+
+typedef ABI::Windows::Foundation::ITypedEventHandler<ToastNotification *, ::IInspectable *>
+        DesktopToastActivatedEventHandler;
+
+typedef ABI::Windows::Foundation::ITypedEventHandler<ToastNotification *,
+                                                     ToastDismissedEventArgs *>
+        DesktopToastDismissedEventHandler;
+
+typedef ABI::Windows::Foundation::ITypedEventHandler<ToastNotification *, ToastFailedEventArgs *>
+        DesktopToastFailedEventHandler;
+
+namespace {
+
+// Forwards the WinRT toast events to a ToastEventSink, finished is called after the event
+// that ends the toast
+class ToastEventAdapter : public Microsoft::WRL::Implements<DesktopToastActivatedEventHandler,
+                                                            DesktopToastDismissedEventHandler,
+                                                            DesktopToastFailedEventHandler>
+{
+public:
+    ToastEventAdapter(std::shared_ptr<ToastEventSink> sink, std::function<void()> finished)
+        : m_ref(1), m_sink(std::move(sink)), m_finished(std::move(finished))
+    {
+    }
+
+    // DesktopToastActivatedEventHandler
+    IFACEMETHODIMP Invoke(_In_ IToastNotification * /*sender*/, _In_ IInspectable *args)
+    {
+        ComPtr<IToastActivatedEventArgs> buttonReply;
+        std::wstring arguments;
+        if (FAILED(args->QueryInterface(IID_PPV_ARGS(&buttonReply)))) {
+            std::wcerr << L"args is not a IToastActivatedEventArgs" << std::endl;
+        } else {
+            HString data;
+            buttonReply->get_Arguments(data.GetAddressOf());
+            arguments = WindowsGetStringRawBuffer(data.Get(), nullptr);
+        }
+        if (m_sink) {
+            m_sink->activated(arguments);
+        }
+        m_finished();
+        return S_OK;
+    }
+
+    // DesktopToastDismissedEventHandler
+    IFACEMETHODIMP Invoke(_In_ IToastNotification * /* sender */,
+                          _In_ IToastDismissedEventArgs *e)
+    {
+        ToastDismissalReason tdr;
+        NtfyToastActions::Actions reason = NtfyToastActions::Actions::Hidden;
+        if (SUCCEEDED(e->get_Reason(&tdr))) {
+            switch (tdr) {
+            case ToastDismissalReason_ApplicationHidden:
+                reason = NtfyToastActions::Actions::Hidden;
+                break;
+            case ToastDismissalReason_UserCanceled:
+                reason = NtfyToastActions::Actions::Dismissed;
+                break;
+            case ToastDismissalReason_TimedOut:
+                reason = NtfyToastActions::Actions::Timedout;
+                break;
+            }
+        }
+        if (m_sink) {
+            m_sink->dismissed(reason);
+        }
+        m_finished();
+        return S_OK;
+    }
+
+    // DesktopToastFailedEventHandler
+    IFACEMETHODIMP Invoke(_In_ IToastNotification * /* sender */,
+                          _In_ IToastFailedEventArgs * /* e */)
+    {
+        if (m_sink) {
+            m_sink->failed();
+        }
+        m_finished();
+        return S_OK;
+    }
+
+    // IUnknown
+    IFACEMETHODIMP_(ULONG) AddRef() { return InterlockedIncrement(&m_ref); }
+
+    IFACEMETHODIMP_(ULONG) Release()
+    {
+        ULONG l = InterlockedDecrement(&m_ref);
+        if (l == 0) {
+            delete this;
+        }
+        return l;
+    }
+
+    IFACEMETHODIMP QueryInterface(_In_ REFIID riid, _COM_Outptr_ void **ppv)
+    {
+        if (IsEqualIID(riid, IID_IUnknown)) {
+            *ppv = static_cast<IUnknown *>(static_cast<DesktopToastActivatedEventHandler *>(this));
+        } else if (IsEqualIID(riid, __uuidof(DesktopToastActivatedEventHandler))) {
+            *ppv = static_cast<DesktopToastActivatedEventHandler *>(this);
+        } else if (IsEqualIID(riid, __uuidof(DesktopToastDismissedEventHandler))) {
+            *ppv = static_cast<DesktopToastDismissedEventHandler *>(this);
+        } else if (IsEqualIID(riid, __uuidof(DesktopToastFailedEventHandler))) {
+            *ppv = static_cast<DesktopToastFailedEventHandler *>(this);
+        } else {
+            *ppv = nullptr;
+        }
+
+        if (*ppv) {
+            reinterpret_cast<IUnknown *>(*ppv)->AddRef();
+            return S_OK;
+        }
+
+        return E_NOINTERFACE;
+    }
+
+private:
+    ULONG m_ref;
+    std::shared_ptr<ToastEventSink> m_sink;
+    std::function<void()> m_finished;
+};
+
+std::wstring toastKey(const std::wstring &appID, const std::wstring &tag,
+                      const std::wstring &group)
+{
+    return appID + L"\n" + group + L"\n" + tag;
+}
+}
+
+WinToastBackend::WinToastBackend() = default;
+
+WinToastBackend::~WinToastBackend()
+{
+    if (m_activatorRegistered) {
+        Utils::unregisterActivator();
+    }
+    // release all WinRT objects before the runtime goes away, late events find no toast
+    {
+        std::lock_guard<std::mutex> lock(m_toasts->mutex);
+        m_toasts->toasts.clear();
+    }
+    m_history.Reset();
+    m_notifiers.clear();
+    m_notificationFactory.Reset();
+    m_manager.Reset();
+    if (m_ownsRuntime && m_runtimeThread == GetCurrentThreadId()) {
+        Windows::Foundation::Uninitialize();
+    }
+}
+
+bool WinToastBackend::initializeRuntime()
+{
+    if (!m_runtimeInitialized) {
+        m_runtimeInitialized = true;
+        ++m_counters.runtimeInitializations;
+        const HRESULT hr = Windows::Foundation::Initialize(RO_INIT_MULTITHREADED);
+        // the host might have initialised the thread already, with a different apartment
+        m_ownsRuntime = SUCCEEDED(hr);
+        m_runtimeThread = GetCurrentThreadId();
+        if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) {
+            ST_CHECK_RESULT(hr);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WinToastBackend::registerActivator()
+{
+    if (!m_activatorRegistered && initializeRuntime()) {
+        ++m_counters.activatorRegistrations;
+        m_activatorRegistered = Utils::registerActivator();
+    }
+    return m_activatorRegistered;
+}
+
+bool WinToastBackend::isRegistered(const std::wstring &appID)
+{
+    // checked once per app id, concurrent callers wait for the first one
+    std::lock_guard<std::mutex> lock(m_registeredMutex);
+    const auto it = m_registered.find(appID);
+    if (it != m_registered.cend()) {
+        return it->second;
+    }
+    ++m_counters.registrationChecks;
+
+    // called from any thread, the runtime belongs to the thread that shows the toasts and
+    // the shell only needs COM on the calling one
+    const HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    bool registered = false;
+    {
+        ComPtr<IShellItem> app;
+        registered = SUCCEEDED(SHCreateItemFromParsingName(
+                std::wstring(L"shell:AppsFolder\\" + appID).data(), nullptr,
+                IID_PPV_ARGS(&app)));
+    }
+    if (SUCCEEDED(com)) {
+        CoUninitialize();
+    }
+    if (!registered) {
+        tLog << "AppUserModelId:" << appID
+             << " is not properly registered. Using fallback mode. Only click actions will be "
+                "availible";
+        Metrics::instance().recordFallbackMode();
+    }
+    m_registered[appID] = registered;
+    return registered;
+}
+
+ComPtr<IToastNotificationManagerStatics> WinToastBackend::manager()
+{
+    if (!m_manager && initializeRuntime()) {
+        ++m_counters.factoryLookups;
+        HRESULT hr = Windows::Foundation::GetActivationFactory(
+                HStringReference(RuntimeClass_Windows_UI_Notifications_ToastNotificationManager)
+                        .Get(),
+                &m_manager);
+        if (!SUCCEEDED(hr)) {
+            std::wcerr << L"NtfyToasts: Failed to register com Factory, please make sure you "
+                          L"correctly initialised with RO_INIT_MULTITHREADED"
+                       << std::endl;
+        }
+    }
+    return m_manager;
+}
+
+ComPtr<IToastNotificationFactory> WinToastBackend::notificationFactory()
+{
+    if (!m_notificationFactory && initializeRuntime()) {
+        ++m_counters.factoryLookups;
+        ST_CHECK_RESULT(Windows::Foundation::GetActivationFactory(
+                HStringReference(RuntimeClass_Windows_UI_Notifications_ToastNotification).Get(),
+                &m_notificationFactory));
+    }
+    return m_notificationFactory;
+}
+
+ComPtr<IToastNotifier> WinToastBackend::notifier(const std::wstring &appID)
+{
+    auto &notifier = m_notifiers[appID];
+    if (!notifier) {
+        if (const auto toastManager = manager()) {
+            ++m_counters.notifierCreations;
+            ST_CHECK_RESULT(toastManager->CreateToastNotifierWithId(
+                    HStringReference(appID.c_str()).Get(), &notifier));
+        }
+    }
+    return notifier;
+}
+
+ComPtr<IToastNotificationHistory> WinToastBackend::history()
+{
+    if (!m_history) {
+        ComPtr<IToastNotificationManagerStatics2> toastStatics2;
+        const auto toastManager = manager();
+        if (toastManager && ST_CHECK_RESULT(toastManager.As(&toastStatics2))) {
+            ++m_counters.historyLookups;
+            ST_CHECK_RESULT(toastStatics2->get_History(&m_history));
+        }
+    }
+    return m_history;
+}
+
+ToastSetting WinToastBackend::setting(const std::wstring &appID)
+{
+    NotificationSetting setting = NotificationSetting_Enabled;
+    const auto toastNotifier = notifier(appID);
+    if (!toastNotifier || !ST_CHECK_RESULT(toastNotifier->get_Setting(&setting))) {
+        tLog << "Failed to retreive NotificationSettings ensure your appId is registered";
+    }
+
+    switch (setting) {
+    case NotificationSetting_DisabledForApplication:
+        return ToastSetting::DisabledForApplication;
+    case NotificationSetting_DisabledForUser:
+        return ToastSetting::DisabledForUser;
+    case NotificationSetting_DisabledByGroupPolicy:
+        return ToastSetting::DisabledByGroupPolicy;
+    case NotificationSetting_DisabledByManifest:
+        return ToastSetting::DisabledByManifest;
+    default:
+        return ToastSetting::Enabled;
+    }
+}
+
+HRESULT WinToastBackend::createXml(const std::wstring &xml, ComPtr<IXmlDocument> &document)
+{
+    ComPtr<IInspectable> inspectable;
+    ST_RETURN_ON_ERROR(RoActivateInstance(
+            HStringReference(RuntimeClass_Windows_Data_Xml_Dom_XmlDocument).Get(), &inspectable));
+    ST_RETURN_ON_ERROR(inspectable.As(&document));
+
+    ComPtr<IXmlDocumentIO> documentIO;
+    ST_RETURN_ON_ERROR(document.As(&documentIO));
+    return documentIO->LoadXml(HStringReference(xml.c_str()).Get());
+}
+
+HRESULT WinToastBackend::setExpirationTime(
+        const std::chrono::system_clock::time_point &expirationTime,
+        ComPtr<IToastNotification> notification)
+{
+    // DateTime counts 100ns intervals since 1601-01-01
+    constexpr int64_t EPOCH_OFFSET = 116444736000000000LL;
+    ABI::Windows::Foundation::DateTime dateTime;
+    dateTime.UniversalTime =
+            std::chrono::duration_cast<std::chrono::duration<int64_t, std::ratio<1, 10000000>>>(
+                    expirationTime.time_since_epoch())
+                    .count()
+            + EPOCH_OFFSET;
+
+    ComPtr<ABI::Windows::Foundation::IPropertyValueStatics> propertyValues;
+    ST_RETURN_ON_ERROR(Windows::Foundation::GetActivationFactory(
+            HStringReference(RuntimeClass_Windows_Foundation_PropertyValue).Get(),
+            &propertyValues));
+
+    ComPtr<IInspectable> value;
+    ST_RETURN_ON_ERROR(propertyValues->CreateDateTime(dateTime, &value));
+
+    ComPtr<ABI::Windows::Foundation::IReference<ABI::Windows::Foundation::DateTime>> expiration;
+    ST_RETURN_ON_ERROR(value.As(&expiration));
+    return notification->put_ExpirationTime(expiration.Get());
+}
+
+bool WinToastBackend::show(const ToastRequest &request, std::shared_ptr<ToastEventSink> sink)
+{
+    const auto toastNotifier = notifier(request.appID);
+    const auto factory = notificationFactory();
+    if (!toastNotifier || !factory) {
+        return false;
+    }
+
+    ComPtr<IXmlDocument> document;
+    if (!ST_CHECK_RESULT(createXml(request.xml, document))) {
+        return false;
+    }
+
+    ComPtr<IToastNotification> notification;
+    if (!ST_CHECK_RESULT(factory->CreateToastNotification(document.Get(), &notification))) {
+        return false;
+    }
+
+    if (request.expirationTime
+        && !ST_CHECK_RESULT(setExpirationTime(*request.expirationTime, notification))) {
+        return false;
+    }
+
+    ComPtr<IToastNotification2> toastV2;
+    if (SUCCEEDED(notification.As(&toastV2))) {
+        if (!ST_CHECK_RESULT(toastV2->put_Tag(HStringReference(request.tag.c_str()).Get()))
+            || !ST_CHECK_RESULT(
+                    toastV2->put_Group(HStringReference(request.group.c_str()).Get()))) {
+            return false;
+        }
+    }
+
+    const auto key = toastKey(request.appID, request.tag, request.group);
+    ShownToast toast;
+    toast.notification = notification;
+    {
+        std::lock_guard<std::mutex> lock(m_toasts->mutex);
+        toast.serial = ++m_toasts->nextSerial;
+    }
+
+    // Register the event handlers, also without a sink, they remove the toast again
+    ComPtr<ToastEventAdapter> adapter;
+    adapter.Attach(new ToastEventAdapter(
+            std::move(sink),
+            [toasts = std::weak_ptr<ShownToasts>(m_toasts), key, serial = toast.serial] {
+                if (const auto shownToasts = toasts.lock()) {
+                    shownToasts->finished(key, serial);
+                }
+            }));
+    if (!ST_CHECK_RESULT(notification->add_Activated(adapter.Get(), &toast.activatedToken))
+        || !ST_CHECK_RESULT(notification->add_Dismissed(adapter.Get(), &toast.dismissedToken))
+        || !ST_CHECK_RESULT(notification->add_Failed(adapter.Get(), &toast.failedToken))) {
+        return false;
+    }
+
+    // known before Show(), the events may arrive before it returns
+    {
+        std::lock_guard<std::mutex> lock(m_toasts->mutex);
+        m_toasts->toasts[key] = toast;
+    }
+    if (!ST_CHECK_RESULT(toastNotifier->Show(notification.Get()))) {
+        m_toasts->finished(key, toast.serial);
+        return false;
+    }
+    return true;
+}
+
+void WinToastBackend::ShownToasts::finished(const std::wstring &key, uint64_t serial)
+{
+    ShownToast toast;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = toasts.find(key);
+        if (it == toasts.end() || it->second.serial != serial) {
+            return;
+        }
+        toast = std::move(it->second);
+        toasts.erase(it);
+    }
+    // releases the adapter and with it the sink, a toast kept in the Action Center would
+    // hold on to them otherwise
+    toast.notification->remove_Activated(toast.activatedToken);
+    toast.notification->remove_Dismissed(toast.dismissedToken);
+    toast.notification->remove_Failed(toast.failedToken);
+}
+
+bool WinToastBackend::hide(const std::wstring &appID, const std::wstring &tag,
+                           const std::wstring &group)
+{
+    ComPtr<IToastNotification> notification;
+    {
+        std::lock_guard<std::mutex> lock(m_toasts->mutex);
+        const auto it = m_toasts->toasts.find(toastKey(appID, tag, group));
+        if (it == m_toasts->toasts.cend()) {
+            return false;
+        }
+        notification = it->second.notification;
+    }
+    // the dismissed event of the hide removes the toast
+    const auto toastNotifier = notifier(appID);
+    return toastNotifier && ST_CHECK_RESULT(toastNotifier->Hide(notification.Get()));
+}
+
+bool WinToastBackend::remove(const std::wstring &appID, const std::wstring &tag,
+                             const std::wstring &group)
+{
+    const auto toastHistory = history();
+    return toastHistory
+            && ST_CHECK_RESULT(toastHistory->RemoveGroupedTagWithId(
+                    HStringReference(tag.c_str()).Get(), HStringReference(group.c_str()).Get(),
+                    HStringReference(appID.c_str()).Get()));
+}
+
+std::vector<std::wstring> WinToastBackend::tags(const std::wstring &appID,
+                                                const std::wstring &group)
+{
+    std::vector<std::wstring> out;
+    ComPtr<IToastNotificationHistory2> toastHistory;
+    const auto history1 = history();
+    ComPtr<ABI::Windows::Foundation::Collections::IVectorView<ToastNotification *>> toasts;
+    if (!history1 || !ST_CHECK_RESULT(history1.As(&toastHistory))
+        || !ST_CHECK_RESULT(toastHistory->GetHistoryWithId(
+                HStringReference(appID.c_str()).Get(), &toasts))) {
+        return out;
+    }
+    unsigned size = 0;
+    ST_CHECK_RESULT(toasts->get_Size(&size));
+    for (unsigned i = 0; i < size; ++i) {
+        ComPtr<IToastNotification> toast;
+        ComPtr<IToastNotification2> toast2;
+        HString tag;
+        HString toastGroup;
+        if (!ST_CHECK_RESULT(toasts->GetAt(i, &toast)) || !ST_CHECK_RESULT(toast.As(&toast2))
+            || !ST_CHECK_RESULT(toast2->get_Tag(tag.GetAddressOf()))
+            || !ST_CHECK_RESULT(toast2->get_Group(toastGroup.GetAddressOf()))) {
+            continue;
+        }
+        if (group == WindowsGetStringRawBuffer(toastGroup.Get(), nullptr)) {
+            out.emplace_back(WindowsGetStringRawBuffer(tag.Get(), nullptr));
+        }
+    }
+    return out;
+}
+
+bool WinToastBackend::removeGroup(const std::wstring &appID, const std::wstring &group)
+{
+    const auto toastHistory = history();
+    return toastHistory
+            && ST_CHECK_RESULT(toastHistory->RemoveGroupWithId(
+                    HStringReference(group.c_str()).Get(), HStringReference(appID.c_str()).Get()));
+}
+
+bool WinToastBackend::clear(const std::wstring &appID)
+{
+    const auto toastHistory = history();
+    return toastHistory
+            && ST_CHECK_RESULT(toastHistory->ClearWithId(HStringReference(appID.c_str()).Get()));
+}
@@ -0,0 +1,117 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include "toastbackend.h"
+#include "ntfytoasts.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/*
+    ToastBackend on top of Windows.UI.Notifications.
+
+    Nothing is created up front: the Windows Runtime, the activator registration, the
+    activation factories, the notifiers and the history are set up by the first call that
+    needs them. -v and -h never touch the runtime and -close only opens the history if
+    the toast is not owned by a running process. The history is opened once, closing many
+    toasts or a whole group reuses it.
+*/
+
+class LIBNTFYTOAST_EXPORT WinToastBackend : public ToastBackend
+{
+public:
+    WinToastBackend();
+    ~WinToastBackend() override;
+
+    bool initializeRuntime() override;
+    bool registerActivator() override;
+    bool isRegistered(const std::wstring &appID) override;
+    ToastSetting setting(const std::wstring &appID) override;
+    bool show(const ToastRequest &request, std::shared_ptr<ToastEventSink> sink) override;
+    bool hide(const std::wstring &appID, const std::wstring &tag,
+              const std::wstring &group) override;
+    bool remove(const std::wstring &appID, const std::wstring &tag,
+                const std::wstring &group) override;
+    std::vector<std::wstring> tags(const std::wstring &appID,
+                                   const std::wstring &group) override;
+    bool removeGroup(const std::wstring &appID, const std::wstring &group) override;
+    bool clear(const std::wstring &appID) override;
+
+private:
+    ComPtr<ABI::Windows::UI::Notifications::IToastNotificationManagerStatics> manager();
+    ComPtr<ABI::Windows::UI::Notifications::IToastNotificationFactory> notificationFactory();
+    ComPtr<ABI::Windows::UI::Notifications::IToastNotifier> notifier(const std::wstring &appID);
+    ComPtr<ABI::Windows::UI::Notifications::IToastNotificationHistory> history();
+
+    HRESULT createXml(const std::wstring &xml,
+                      ComPtr<ABI::Windows::Data::Xml::Dom::IXmlDocument> &document);
+    HRESULT setExpirationTime(
+            const std::chrono::system_clock::time_point &expirationTime,
+            ComPtr<ABI::Windows::UI::Notifications::IToastNotification> notification);
+
+    bool m_runtimeInitialized = false;
+    bool m_ownsRuntime = false;
+    // the runtime is initialised per thread, e.g. on the thread of a ToastDispatcher
+    DWORD m_runtimeThread = 0;
+    bool m_activatorRegistered = false;
+
+    // called for every toast, possibly from several threads of the C interface, the lock
+    // is held during the check
+    std::mutex m_registeredMutex;
+    std::unordered_map<std::wstring, bool> m_registered;
+    ComPtr<ABI::Windows::UI::Notifications::IToastNotificationManagerStatics> m_manager;
+    ComPtr<ABI::Windows::UI::Notifications::IToastNotificationFactory> m_notificationFactory;
+    std::unordered_map<std::wstring, ComPtr<ABI::Windows::UI::Notifications::IToastNotifier>>
+            m_notifiers;
+    ComPtr<ABI::Windows::UI::Notifications::IToastNotificationHistory> m_history;
+
+    struct ShownToast
+    {
+        ComPtr<ABI::Windows::UI::Notifications::IToastNotification> notification;
+        EventRegistrationToken activatedToken {};
+        EventRegistrationToken dismissedToken {};
+        EventRegistrationToken failedToken {};
+        // a toast shown again with the same key replaces the entry, only the latest removes it
+        uint64_t serial = 0;
+    };
+
+    /*
+        The toasts on screen by app id, group and tag, needed to hide them.
+        The events of a toast arrive on threads of the notification platform, the first
+        activation, dismissal or failure removes the toast and its handlers, so the table
+        does not grow with every toast of a long running process.
+    */
+    struct ShownToasts
+    {
+        std::mutex mutex;
+        std::unordered_map<std::wstring, ShownToast> toasts;
+        uint64_t nextSerial = 0;
+
+        void finished(const std::wstring &key, uint64_t serial);
+    };
+
+    std::shared_ptr<ShownToasts> m_toasts = std::make_shared<ShownToasts>();
+};
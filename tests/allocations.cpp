@@ -0,0 +1,175 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "arguments.h"
+#include "callbackformat.h"
+#include "callbacksink.h"
+#include "check.h"
+#include "metrics.h"
+#include "toastcontent.h"
+
+#include <algorithm>
+#include <cstdio>
+
+/*
+    The allocation budgets of the hot paths, per AllocationScope. Built against the library
+    with NTFYTOAST_COUNT_ALLOCATIONS, a budget that is exceeded fails the test.
+*/
+
+using Actions = NtfyToastActions::Actions;
+
+namespace {
+constexpr int Rounds = 100;
+
+// a callback as ntfytoast writes it
+const std::wstring Callback =
+        L"action=buttonClicked;notificationId=4711;correlationId=build-42;"
+        L"pipe=\\\\.\\pipe\\ntfy-desktop;"
+        L"application=C:\\Program Files\\ntfy-desktop\\ntfy-desktop.exe;version=0.9.0;"
+        L"submittedAt=183274928;shownAt=183275011;actedAt=183279640;button=Acknowledge;";
+const std::wstring Prefix = L"notificationId=4711;correlationId=build-42;"
+                            L"pipe=\\\\.\\pipe\\ntfy-desktop;"
+                            L"application=C:\\Program Files\\ntfy-desktop\\ntfy-desktop.exe;"
+                            L"version=0.9.0;";
+
+class NullSink : public CallbackSink
+{
+public:
+    bool write(const std::wstring &data) override
+    {
+        written += data.size();
+        return true;
+    }
+
+    size_t written = 0;
+};
+
+// the allocations per scope of path while f runs Rounds times, after a first run that may
+// initialize statics
+template<typename F>
+double allocationsPerScope(AllocationPath path, F &&f)
+{
+    f();
+    const auto &metrics = Metrics::instance();
+    const auto allocations = metrics.allocations(path).allocations;
+    const auto scopes = metrics.allocationScopes(path);
+    for (int i = 0; i < Rounds; ++i) {
+        f();
+    }
+    const auto newScopes = metrics.allocationScopes(path) - scopes;
+    CHECK_EQ(newScopes, uint64_t(Rounds));
+    return static_cast<double>(metrics.allocations(path).allocations - allocations)
+            / static_cast<double>(std::max<uint64_t>(newScopes, 1));
+}
+
+void checkBudget(const char *name, double allocations, double budget)
+{
+    if (!NtfyTest::check(allocations <= budget, name, __FILE__, __LINE__)) {
+        std::fprintf(stderr, "    %.2f allocations, the budget is %.0f\n", allocations, budget);
+    }
+}
+
+void splitData()
+{
+    size_t fields = 0;
+    const auto allocations = allocationsPerScope(AllocationPath::SplitData, [&] {
+        fields += CallbackFormat::splitData(Callback).size();
+    });
+    CHECK_EQ(fields, size_t(10 * (Rounds + 1)));
+    // the bucket array and a node per field
+    checkBudget("SplitData", allocations, 11);
+}
+
+void formatAction()
+{
+    ToastCallbackFormatter formatter(L"4711", Prefix, L"183274928", {}, false);
+    formatter.setShownAt(std::chrono::steady_clock::now());
+    const auto allocations = allocationsPerScope(AllocationPath::FormatAction, [&] {
+        NtfyTest::check(!formatter.formatAction(Actions::Clicked).empty(), "formatAction",
+                        __FILE__, __LINE__);
+    });
+    // the returned string
+    checkBudget("FormatAction", allocations, 1);
+}
+
+void parseArguments()
+{
+    std::chrono::milliseconds total(0);
+    const auto allocations = allocationsPerScope(AllocationPath::ParseArguments, [&] {
+        const AllocationScope scope(AllocationPath::ParseArguments);
+        for (const auto value : { L"90", L"5m", L"1h30m", L"2d" }) {
+            total += Arguments::parseDuration(value).value_or(std::chrono::milliseconds(0));
+        }
+    });
+    CHECK(total == (std::chrono::seconds(90) + std::chrono::minutes(95) + std::chrono::hours(48))
+                    * (Rounds + 1));
+    checkBudget("ParseArguments", allocations, 0);
+}
+
+void render()
+{
+    ToastContent content;
+    content.title = L"Backup finished";
+    content.body = L"The backup of /srv/data finished in 42 minutes & 3 seconds.";
+    content.image = L"C:\\Users\\me\\AppData\\Local\\Temp\\ntfytoast.png";
+    content.buttons = L"Open;Dismiss;Snooze";
+    size_t size = 0;
+    const auto allocations = allocationsPerScope(AllocationPath::Render, [&] {
+        size += content.render(Prefix, L"183274928").size();
+    });
+    CHECK(size > 0);
+    // the xml growing in place, the stack of open elements, the buffer of the arguments and
+    // the returned copy
+    checkBudget("Render", allocations, 13);
+}
+
+void callback()
+{
+    ToastCallbackFormatter formatter(L"4711", Prefix, L"183274928",
+                                     { Actions::Clicked, Actions::ButtonClicked }, false);
+    NullSink sink;
+    const auto allocations = allocationsPerScope(AllocationPath::Callback, [&] {
+        NtfyTest::check(formatter.write(Actions::Clicked, sink), "write", __FILE__, __LINE__);
+    });
+    CHECK(sink.written > 0);
+    checkBudget("Callback", allocations, 1);
+
+    // an action the consumer did not ask for is not even formatted
+    const auto filtered = allocationsPerScope(AllocationPath::Callback, [&] {
+        NtfyTest::check(formatter.write(Actions::Dismissed, sink), "write", __FILE__, __LINE__);
+    });
+    checkBudget("Callback, filtered", filtered, 0);
+}
+}
+
+int main()
+{
+    if (!CHECK(AllocationCounter::enabled())) {
+        return NtfyTest::result();
+    }
+    splitData();
+    formatAction();
+    parseArguments();
+    render();
+    callback();
+    return NtfyTest::result();
+}
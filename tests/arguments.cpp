@@ -0,0 +1,98 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "arguments.h"
+#include "check.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+void parsesDurations()
+{
+    CHECK(Arguments::parseDuration(L"90") == 90s);
+    CHECK(Arguments::parseDuration(L"1h30m") == 90min);
+    CHECK(Arguments::parseDuration(L"2d") == 48h);
+    CHECK(!Arguments::parseDuration(L""));
+    CHECK(!Arguments::parseDuration(L"5x"));
+    CHECK(!Arguments::parseDuration(L"m"));
+    CHECK(!Arguments::parseDuration(L"99999999999999999999"));
+    // digits that fit but overflow once scaled to milliseconds, alone or in the sum
+    CHECK(!Arguments::parseDuration(L"99999999999999d"));
+    CHECK(!Arguments::parseDuration(L"9223372036854776s"));
+    CHECK(Arguments::parseDuration(L"9223372036854775") == 9223372036854775s);
+    CHECK(!Arguments::parseDuration(L"9223372036854775s1s"));
+    CHECK(Arguments::parseDuration(L"106751991167d") == 106751991167 * 24h);
+    CHECK(!Arguments::parseDuration(L"106751991167d1d"));
+}
+
+void parsesTimes()
+{
+    const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+
+    // a date is taken as it is, formatTime writes what parseTime reads
+    const auto date = Arguments::parseTime(L"2030-06-15T08:30:15");
+    CHECK(date && *date > now);
+    CHECK(date && Arguments::formatTime(*date) == L"2030-06-15T08:30:15");
+    const auto minutes = Arguments::parseTime(L"2030-06-15T08:30");
+    CHECK(minutes && date && *date - *minutes == 15s);
+
+    // a time of day is the next time the clock shows it, within a day
+    for (const auto *time : { L"00:00", L"12:00:30", L"23:59" }) {
+        const auto next = Arguments::parseTime(time);
+        CHECK(next && *next > now - 1s && *next <= now + 24h + 1h);
+        CHECK(next && Arguments::formatTime(*next).find(time) == 11);
+    }
+
+    for (const auto *invalid : { L"", L"noon", L"12", L"12:00x", L"2030-06-15", L"2030-06-15T08",
+                                 L"25:00" }) {
+        CHECK(!Arguments::parseTime(invalid));
+    }
+}
+
+void matchesTagPatterns()
+{
+    CHECK(!Arguments::isTagPattern(L"build-1"));
+    CHECK(Arguments::isTagPattern(L"build-*"));
+    CHECK(Arguments::isTagPattern(L"job-??"));
+
+    CHECK(Arguments::matchesTagPattern(L"build-*", L"build-"));
+    CHECK(Arguments::matchesTagPattern(L"build-*", L"build-42"));
+    CHECK(!Arguments::matchesTagPattern(L"build-*", L"rebuild-42"));
+    CHECK(Arguments::matchesTagPattern(L"*-42", L"rebuild-42"));
+    CHECK(Arguments::matchesTagPattern(L"job-??", L"job-01"));
+    CHECK(!Arguments::matchesTagPattern(L"job-??", L"job-1"));
+    CHECK(!Arguments::matchesTagPattern(L"job-??", L"job-001"));
+    CHECK(Arguments::matchesTagPattern(L"*", L""));
+    CHECK(Arguments::matchesTagPattern(L"a*b*c", L"aXbYbZc"));
+    CHECK(!Arguments::matchesTagPattern(L"a*b*c", L"aXbYbZ"));
+    CHECK(Arguments::matchesTagPattern(L"**x", L"yyx"));
+}
+}
+
+int main()
+{
+    parsesDurations();
+    parsesTimes();
+    matchesTagPatterns();
+    return NtfyTest::result();
+}
@@ -0,0 +1,160 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "callbackformat.h"
+#include "check.h"
+
+#include <thread>
+
+using namespace std::chrono_literals;
+using Actions = NtfyToastActions::Actions;
+
+namespace {
+std::chrono::steady_clock::time_point at(std::chrono::milliseconds ms)
+{
+    return std::chrono::steady_clock::time_point(ms);
+}
+
+// the value of a field, empty if it is missing
+std::wstring field(const std::wstring &data, const std::wstring &key)
+{
+    const auto start = data.find(key + L"=");
+    if (start != 0 && (start == std::wstring::npos || data[start - 1] != L';')) {
+        return {};
+    }
+    const auto value = start + key.size() + 1;
+    return data.substr(value, data.find(L';', value) - value);
+}
+
+void skipsEmptyFields()
+{
+    std::wstring out;
+    CallbackFormat::appendField(out, L"a", L"1");
+    CallbackFormat::appendField(out, L"b", L"");
+    CallbackFormat::appendField(out, L"c", L"x y");
+    CHECK(out == L"a=1;c=x y;");
+
+    std::wstring list;
+    CallbackFormat::appendListItem(list, L"clicked");
+    CallbackFormat::appendListItem(list, L"dismissed");
+    CHECK(list == L"clicked,dismissed");
+}
+
+void formatsTimestamps()
+{
+    std::wstring out;
+    CallbackFormat::appendTimestamp(out, L"t", at(0ms));
+    CallbackFormat::appendTimestamp(out, L"u", at(1234567890123ms));
+    CallbackFormat::appendTimestamp(out, L"v", at(-5ms));
+    CHECK(out == L"t=0;u=1234567890123;v=0;");
+    CHECK(CallbackFormat::timestamp(at(1234567890123ms)) == L"1234567890123");
+    CHECK(CallbackFormat::timestamp(at(-5ms)) == L"0");
+}
+
+void emptyListNotifiesEverything()
+{
+    CHECK(CallbackFormat::notifies({}, Actions::Dismissed));
+    CHECK(CallbackFormat::notifies({ Actions::Clicked, Actions::Dismissed }, Actions::Dismissed));
+    CHECK(!CallbackFormat::notifies({ Actions::Clicked }, Actions::Dismissed));
+}
+
+void argumentsCarryNoCallbackTimes()
+{
+    std::wstring out;
+    CallbackFormat::appendAction(out, Actions::ButtonClicked, L"notificationId=7;", L"1000", 42,
+                                 { { L"button", L"OK" }, { L"empty", L"" } }, false);
+    CHECK(out == L"action=buttonClicked;notificationId=7;submittedAt=1000;button=OK;");
+}
+
+void callbacksCarryTimes()
+{
+    const auto before = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch());
+    std::wstring out = L"keep;";
+    CallbackFormat::appendAction(out, Actions::Clicked, L"notificationId=7;", L"1000",
+                                 at(2000ms).time_since_epoch().count(), {}, true);
+    const std::wstring start = L"keep;action=clicked;notificationId=7;submittedAt=1000;";
+    CHECK(out.compare(0, start.size(), start) == 0);
+    CHECK(field(out, L"shownAt") == L"2000");
+    const auto actedAt = std::stoll(field(out, L"actedAt"));
+    CHECK(actedAt >= before.count());
+
+    // without a shown time the field is left out
+    out.clear();
+    CallbackFormat::appendAction(out, Actions::Dismissed, {}, {}, 0, {}, true);
+    CHECK(field(out, L"shownAt").empty());
+    CHECK(!field(out, L"actedAt").empty());
+}
+
+void formatterMatchesToast()
+{
+    ToastCallbackFormatter formatter(L"7", L"notificationId=7;pipe=\\\\.\\pipe\\x;", L"1000",
+                                     { Actions::Clicked }, true);
+    CHECK(formatter.id() == L"7");
+    CHECK(formatter.fallbackMode());
+    CHECK(formatter.notifies(Actions::Clicked));
+    CHECK(!formatter.notifies(Actions::Dismissed));
+
+    auto data = formatter.formatAction(Actions::Clicked);
+    CHECK(field(data, L"shownAt").empty());
+    CHECK(field(data, L"pipe") == L"\\\\.\\pipe\\x");
+    formatter.setShownAt(at(3000ms));
+    data = formatter.formatAction(Actions::Clicked);
+    CHECK(field(data, L"shownAt") == L"3000");
+}
+
+// the events of a toast may arrive on several threads while it is marked shown
+void formatterIsShared()
+{
+    ToastCallbackFormatter formatter(L"7", L"notificationId=7;", L"1000", {}, false);
+    std::vector<std::thread> threads;
+    std::atomic<int> bad { 0 };
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 2000; ++i) {
+                const auto data = formatter.formatAction(Actions::Clicked);
+                const auto shownAt = field(data, L"shownAt");
+                if (!shownAt.empty() && shownAt != L"3000") {
+                    ++bad;
+                }
+            }
+        });
+    }
+    formatter.setShownAt(at(3000ms));
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    CHECK_EQ(bad.load(), 0);
+}
+}
+
+int main()
+{
+    skipsEmptyFields();
+    formatsTimestamps();
+    emptyListNotifiesEverything();
+    argumentsCarryNoCallbackTimes();
+    callbacksCarryTimes();
+    formatterMatchesToast();
+    formatterIsShared();
+    return NtfyTest::result();
+}
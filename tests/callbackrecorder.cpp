@@ -0,0 +1,291 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "callbackrecorder.h"
+#include "check.h"
+#include "ntfytoastconsumer.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+using namespace std::chrono_literals;
+
+namespace {
+const std::wstring Pipe = L"\\\\.\\pipe\\ntfytoast-test";
+const std::wstring Clicked = L"action=clicked;notificationId=1;pipe=\\\\.\\pipe\\ntfytoast-test;"
+                             L"text=caf\u00e9;";
+const std::wstring Dismissed = L"action=dismissed;notificationId=2;";
+
+class TempLog
+{
+public:
+    explicit TempLog(const char *name)
+        : path(std::filesystem::temp_directory_path()
+               / (std::string("ntfytoast-test-") + name + ".ntcb"))
+    {
+        std::filesystem::remove(path);
+    }
+    ~TempLog() { std::filesystem::remove(path); }
+
+    const std::filesystem::path path;
+};
+
+std::string readBytes(const std::filesystem::path &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeBytes(const std::filesystem::path &path, const std::string &bytes)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+size_t count(const std::string &text, const std::string &part)
+{
+    size_t n = 0;
+    for (auto pos = text.find(part); pos != std::string::npos; pos = text.find(part, pos + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+CallbackRecorder::Clock::time_point at(std::chrono::microseconds time)
+{
+    return CallbackRecorder::Clock::time_point(time);
+}
+
+// writes the two callbacks, the first one is delivered, the second one failed
+void recordBoth(const std::filesystem::path &path)
+{
+    CallbackRecorder recorder(path);
+    CHECK(recorder.isOpen());
+    CHECK(recorder.record(Pipe, Clicked, PipeEncoding::Utf8, true, at(123456789us), 250us));
+    CHECK(recorder.record(L"\\\\.\\pipe\\other", Dismissed, PipeEncoding::Utf16, false,
+                          at(123999999us), 3s));
+    CHECK_EQ(recorder.recorded(), 2u);
+}
+
+// every field of a record survives the round trip
+void roundTrip()
+{
+    const TempLog log("recorder");
+    recordBoth(log.path);
+
+    CallbackRecording recording(log.path);
+    CHECK(recording.isOpen());
+    CallbackRecording::Callback callback;
+    CHECK(recording.next(callback));
+    CHECK(callback.time == 123456789us);
+    CHECK(callback.writeTime == 250us);
+    CHECK(callback.encoding == PipeEncoding::Utf8);
+    CHECK(callback.delivered);
+    CHECK_EQ(callback.pipe, "\\\\.\\pipe\\ntfytoast-test");
+    CHECK_EQ(callback.data, Utf8::fromWide(Clicked));
+
+    CHECK(recording.next(callback));
+    CHECK(callback.time == 123999999us);
+    CHECK(callback.writeTime == 3s);
+    CHECK(callback.encoding == PipeEncoding::Utf16);
+    CHECK(!callback.delivered);
+    CHECK_EQ(callback.pipe, "\\\\.\\pipe\\other");
+    CHECK_EQ(callback.data, "action=dismissed;notificationId=2;");
+
+    CHECK(!recording.next(callback));
+    CHECK(!recording.truncated());
+
+    // a second recorder appends without writing the magic again
+    {
+        CallbackRecorder recorder(log.path);
+        CHECK(recorder.record(Pipe, Clicked, PipeEncoding::Utf16, true, at(124000000us), 1us));
+    }
+    CallbackRecording appended(log.path);
+    size_t records = 0;
+    while (appended.next(callback)) {
+        ++records;
+    }
+    CHECK_EQ(records, 3u);
+    CHECK(!appended.truncated());
+    CHECK_EQ(count(readBytes(log.path), "NTCBLOG"), 1u);
+}
+
+// the pipe is only stored if it is not the pipe field of the data
+void elidesPipe()
+{
+    const std::wstring other = L"\\\\.\\pipe\\ntfytoast-tesT";
+    const TempLog same("recorder-same");
+    const TempLog stored("recorder-stored");
+    CallbackRecorder(same.path).record(Pipe, Clicked, PipeEncoding::Utf8, true, at(1us), 1us);
+    CallbackRecorder(stored.path).record(other, Clicked, PipeEncoding::Utf8, true, at(1us), 1us);
+
+    // the name and its length
+    const auto sameBytes = readBytes(same.path);
+    const auto storedBytes = readBytes(stored.path);
+    CHECK_EQ(storedBytes.size() - sameBytes.size(), Utf8::fromWide(other).size() + 1);
+    CHECK_EQ(count(sameBytes, "ntfytoast-test"), 1u);
+    CHECK_EQ(count(storedBytes, "ntfytoast-tesT"), 1u);
+
+    CallbackRecording::Callback callback;
+    CallbackRecording sameRecording(same.path);
+    CHECK(sameRecording.next(callback));
+    CHECK_EQ(callback.pipe, Utf8::fromWide(Pipe));
+    CallbackRecording storedRecording(stored.path);
+    CHECK(storedRecording.next(callback));
+    CHECK_EQ(callback.pipe, Utf8::fromWide(other));
+}
+
+// a record that can not be read ends the log, a file without the magic is no log
+void rejectsCorruptLogs()
+{
+    const TempLog log("recorder-corrupt");
+    const std::string magic("NTCBLOG\x01", 8);
+
+    for (const std::string &bytes : { std::string(), std::string("NTCB"),
+                                      std::string("NTCBLOG\x02", 8), std::string("ntfytoast") }) {
+        writeBytes(log.path, bytes);
+        CHECK(!CallbackRecording(log.path).isOpen());
+    }
+    CHECK(!CallbackRecording(log.path.string() + ".missing").isOpen());
+
+    const std::string corrupt[] = {
+        // an empty record
+        std::string(1, '\0'),
+        // larger than any callback
+        "\x80\x80\x80\x08",
+        // a size that does not end
+        std::string(11, '\xff'),
+        // the size is larger than the rest of the file
+        "\x10\x01\x01\x00",
+        // no flags
+        "\x02\x01\x01",
+        // the pipe name is longer than the record
+        "\x05\x01\x01\x00\x40x",
+    };
+    for (const auto &record : corrupt) {
+        writeBytes(log.path, magic + record);
+        CallbackRecording recording(log.path);
+        CHECK(recording.isOpen());
+        CallbackRecording::Callback callback;
+        CHECK(!recording.next(callback));
+        CHECK(recording.truncated());
+    }
+
+    // the records before a torn one are read
+    std::filesystem::remove(log.path);
+    recordBoth(log.path);
+    const auto bytes = readBytes(log.path);
+    writeBytes(log.path, bytes.substr(0, bytes.size() - 1));
+    CallbackRecording recording(log.path);
+    CallbackRecording::Callback callback;
+    CHECK(recording.next(callback));
+    CHECK_EQ(callback.data, Utf8::fromWide(Clicked));
+    CHECK(!recording.next(callback));
+    CHECK(recording.truncated());
+}
+
+#ifndef _WIN32
+int run(const std::string &command)
+{
+    const int status = std::system((command + " > /dev/null 2>&1").c_str());
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// ntfytoast-replay writes the recorded callbacks to a consumer
+void replays(const std::string &replay)
+{
+    const TempLog log("replay");
+    recordBoth(log.path);
+    const auto address =
+            (std::filesystem::temp_directory_path() / "ntfytoast-test-replay.sock").string();
+
+    std::mutex mutex;
+    std::vector<std::string> received;
+    NtfyToastConsumer::CallbackServer<char> server(
+            address, [&](const NtfyToastConsumer::CallbackMessage<char> &message) {
+                std::lock_guard<std::mutex> lock(mutex);
+                received.emplace_back(message.raw());
+            });
+    std::thread thread([&] { CHECK(server.run()); });
+    while (!std::filesystem::exists(address)) {
+        std::this_thread::sleep_for(1ms);
+    }
+    const auto waitFor = [&](size_t n) {
+        for (int i = 0; i < 500; ++i) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (received.size() >= n) {
+                    return;
+                }
+            }
+            std::this_thread::sleep_for(10ms);
+        }
+    };
+
+    const std::string command = replay + " " + log.path.string() + " -address " + address;
+    // only the delivered callback, the failed one was retried from the spool
+    CHECK_EQ(run(command + " -speed max"), 0);
+    waitFor(1);
+    // everything, the second callback in UTF-8 although it was written in UTF-16
+    CHECK_EQ(run(command + " -speed 1000 -all -encoding utf8"), 0);
+    waitFor(3);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(received
+              == std::vector<std::string>({ Utf8::fromWide(Clicked), Utf8::fromWide(Clicked),
+                                            "action=dismissed;notificationId=2;" }));
+    }
+
+    CHECK_EQ(run(command + " -list"), 0);
+    CHECK_EQ(run(replay + " " + address), 1);
+    server.stop();
+    thread.join();
+    std::filesystem::remove(address);
+}
+#endif
+}
+
+// with the path of ntfytoast-replay the replay is tested as well
+int main(int argc, char **argv)
+{
+    roundTrip();
+    elidesPipe();
+    rejectsCorruptLogs();
+#ifndef _WIN32
+    if (argc > 1) {
+        replays(argv[1]);
+    }
+#else
+    (void)argc;
+    (void)argv;
+#endif
+    return NtfyTest::result();
+}
@@ -0,0 +1,111 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "callbacksink.h"
+#include "check.h"
+
+#include <cstdio>
+#include <string>
+
+namespace {
+const std::wstring prefix = L"notificationId=42;pipe=\\\\.\\pipe\\ntfy;version=0.9.0;";
+
+std::wstring filtered(const std::wstring &data)
+{
+    std::wstring out = L"stale";
+    return CallbackFilter::apply(data, out) ? out : L"<dropped>";
+}
+
+void passesUnfilteredData()
+{
+    const auto data = L"action=clicked;" + prefix;
+    CHECK(filtered(data) == data);
+    CHECK(filtered(L"action=textEntered;text=a;b=c") == L"action=textEntered;text=a;b=c");
+}
+
+void dropsActionsNobodyAskedFor()
+{
+    const auto notify = L"notify=clicked,buttonClicked;" + prefix;
+    CHECK(filtered(L"action=clicked;" + notify) == L"action=clicked;" + prefix);
+    CHECK(filtered(L"action=buttonClicked;button=OK;" + notify)
+          == L"action=buttonClicked;button=OK;" + prefix);
+    CHECK(filtered(L"action=dismissed;" + notify) == L"<dropped>");
+    // whole list items only
+    CHECK(filtered(L"action=click;" + notify) == L"<dropped>");
+    CHECK(filtered(L"action=buttonClick;" + notify) == L"<dropped>");
+}
+
+void keepsRequestedFieldsInOrder()
+{
+    const auto data = L"action=buttonClicked;notificationId=42;button=OK;fields=button,"
+                      L"notificationId;version=0.9.0;";
+    CHECK(filtered(data) == L"action=buttonClicked;notificationId=42;button=OK;");
+    // the action is always kept
+    CHECK(filtered(L"action=clicked;fields=version;notificationId=1;version=0.9.0;")
+          == L"action=clicked;version=0.9.0;");
+}
+
+void keepsTheTextReplyLast()
+{
+    const auto reply = L"action=textEntered;notificationId=7;fields=text;text=yes; a=b";
+    CHECK(filtered(reply) == L"action=textEntered;text=yes; a=b");
+    CHECK(filtered(L"action=textEntered;notificationId=7;fields=notificationId;text=yes")
+          == L"action=textEntered;notificationId=7;");
+    CHECK(filtered(L"action=textEntered;notify=textEntered;text=a=b;c")
+          == L"action=textEntered;text=a=b;c");
+}
+
+void jsonLinesAreFiltered()
+{
+    FILE *file = std::tmpfile();
+    CHECK(file != nullptr);
+    if (!file) {
+        return;
+    }
+    JsonLinesCallbackSink sink(file);
+    CHECK(sink.write(L"action=dismissed;notify=clicked;notificationId=1;"));
+    CHECK(sink.write(L"action=clicked;notify=clicked;fields=button;notificationId=2;"));
+    CHECK(sink.write(L"action=textEntered;notificationId=3;text=\"quoted\"\n"));
+
+    std::rewind(file);
+    std::string out;
+    char buffer[256];
+    for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+        out.append(buffer, n);
+    }
+    std::fclose(file);
+    CHECK(out
+          == "{\"action\":\"clicked\"}\n"
+             "{\"action\":\"textEntered\",\"notificationId\":\"3\","
+             "\"text\":\"\\\"quoted\\\"\\n\"}\n");
+}
+}
+
+int main()
+{
+    passesUnfilteredData();
+    dropsActionsNobodyAskedFor();
+    keepsRequestedFieldsInOrder();
+    keepsTheTextReplyLast();
+    jsonLinesAreFiltered();
+    return NtfyTest::result();
+}
@@ -0,0 +1,179 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "callbackspool.h"
+#include "check.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+// the records start behind the 64 byte header, each with a 24 byte frame
+constexpr std::streamoff FirstPayload = 64 + 24;
+
+class TempSpool
+{
+public:
+    explicit TempSpool(const char *name)
+        : path(std::filesystem::temp_directory_path()
+               / (std::string("ntfytoast-test-") + name + ".spool"))
+    {
+        std::filesystem::remove(path);
+    }
+    ~TempSpool() { std::filesystem::remove(path); }
+
+    const std::filesystem::path path;
+};
+
+std::vector<std::wstring> deliverAll(CallbackSpool &spool, const std::wstring &pipe = {})
+{
+    std::vector<std::wstring> out;
+    spool.deliver(
+            [&](const CallbackSpool::Callback &callback) {
+                out.push_back(callback.data);
+                return true;
+            },
+            pipe);
+    return out;
+}
+
+void corrupt(const std::filesystem::path &path, std::streamoff offset)
+{
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekg(offset);
+    const char byte = static_cast<char>(file.get() ^ 0x5a);
+    file.seekp(offset);
+    file.put(byte);
+}
+
+void keepsCallbacksAcrossInstances()
+{
+    TempSpool temp("reopen");
+    CHECK(!CallbackSpool::hasPending(temp.path));
+    {
+        CallbackSpool spool(temp.path, 4096);
+        CHECK(spool.isOpen());
+        CHECK(!CallbackSpool::hasPending(temp.path));
+        CHECK(spool.append(L"pipe-a", L"first", PipeEncoding::Utf8));
+        CHECK(spool.append(L"pipe-b", L"second", PipeEncoding::Utf16));
+        CHECK(spool.append(L"pipe-a", L"third", PipeEncoding::Utf8));
+    }
+    CHECK(CallbackSpool::hasPending(temp.path));
+
+    CallbackSpool spool(temp.path);
+    CHECK_EQ(spool.pending(), size_t(3));
+    CHECK(deliverAll(spool, L"pipe-a") == (std::vector<std::wstring> { L"first", L"third" }));
+    CHECK(CallbackSpool::hasPending(temp.path));
+    std::vector<PipeEncoding> encodings;
+    spool.deliver([&](const CallbackSpool::Callback &callback) {
+        encodings.push_back(callback.encoding);
+        return true;
+    });
+    CHECK(encodings == std::vector<PipeEncoding> { PipeEncoding::Utf16 });
+    CHECK_EQ(spool.pending(), size_t(0));
+    CHECK(!CallbackSpool::hasPending(temp.path));
+}
+
+void keepsOrderWhenDeliveryFails()
+{
+    TempSpool temp("order");
+    CallbackSpool spool(temp.path, 4096);
+    for (const auto *data : { L"1", L"2", L"3" }) {
+        CHECK(spool.append(L"pipe", data, PipeEncoding::Utf16));
+    }
+    std::vector<std::wstring> seen;
+    CHECK_EQ(spool.deliver([&](const CallbackSpool::Callback &callback) {
+        seen.push_back(callback.data);
+        return callback.data != L"2";
+    }),
+             size_t(1));
+    // the pipe is skipped after its first failure, 3 stays behind 2
+    CHECK(seen == (std::vector<std::wstring> { L"1", L"2" }));
+    CHECK(deliverAll(spool) == (std::vector<std::wstring> { L"2", L"3" }));
+}
+
+void tornRecordEndsTheSpool()
+{
+    TempSpool temp("torn");
+    {
+        CallbackSpool spool(temp.path, 4096);
+        for (const auto *data : { L"intact", L"torn", L"lost" }) {
+            CHECK(spool.append(L"pipe", data, PipeEncoding::Utf16));
+        }
+    }
+    // the payload of the first record holds two counts and 10 characters, framed to 8 bytes
+    const std::streamoff first = (24 + 8 + 10 * sizeof(wchar_t) + 7) / 8 * 8;
+    corrupt(temp.path, FirstPayload + first + 10);
+
+    CallbackSpool spool(temp.path);
+    CHECK(deliverAll(spool) == std::vector<std::wstring> { L"intact" });
+    CHECK_EQ(spool.pending(), size_t(0));
+    // the ring is usable after the recovery
+    CHECK(spool.append(L"pipe", L"next", PipeEncoding::Utf16));
+    CHECK(deliverAll(spool) == std::vector<std::wstring> { L"next" });
+}
+
+void corruptHeadLeavesAnEmptySpool()
+{
+    TempSpool temp("head");
+    {
+        CallbackSpool spool(temp.path, 4096);
+        CHECK(spool.append(L"pipe", L"gone", PipeEncoding::Utf16));
+    }
+    corrupt(temp.path, FirstPayload);
+    CallbackSpool spool(temp.path);
+    CHECK(spool.isOpen());
+    CHECK_EQ(spool.pending(), size_t(0));
+}
+
+void dropsTheOldestWhenFull()
+{
+    TempSpool temp("full");
+    CallbackSpool spool(temp.path, 1024);
+    const std::wstring data(100, L'x');
+    for (int i = 0; i < 20; ++i) {
+        CHECK(spool.append(L"pipe", data + std::to_wstring(i), PipeEncoding::Utf16));
+    }
+    const auto pending = spool.pending();
+    CHECK(pending > 0 && pending < 20);
+    CHECK_EQ(spool.dropped() + pending, uint64_t(20));
+
+    const auto delivered = deliverAll(spool);
+    CHECK_EQ(delivered.size(), pending);
+    CHECK(!delivered.empty() && delivered.back() == data + L"19");
+    // a callback larger than the ring is refused
+    CHECK(!spool.append(L"pipe", std::wstring(1024, L'x'), PipeEncoding::Utf16));
+}
+}
+
+int main()
+{
+    keepsCallbacksAcrossInstances();
+    keepsOrderWhenDeliveryFails();
+    tornRecordEndsTheSpool();
+    corruptHeadLeavesAnEmptySpool();
+    dropsTheOldestWhenFull();
+    return NtfyTest::result();
+}
@@ -0,0 +1,139 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "loopbackbackend.h"
+#include "ntfytoastcmanager.h"
+
+#include <cstring>
+
+namespace {
+ntfytoast_manager *createManager(const LoopbackBackend::Options &options)
+{
+    return createToastManager(L"NtfyToast.Test", std::make_shared<LoopbackBackend>(options),
+                              [](const std::wstring &appID, const std::wstring &id,
+                                 const ntfytoast_toast &) {
+                                  ToastSubmission submission;
+                                  submission.request = { appID, id, L"test",
+                                                         L"<toast><visual/></toast>", {} };
+                                  return submission;
+                              });
+}
+
+LoopbackBackend::Options idleUser()
+{
+    LoopbackBackend::Options options;
+    options.clicks = 0;
+    options.buttons = 0;
+    options.replies = 0;
+    options.dismissals = 0;
+    return options;
+}
+
+ntfytoast_handle submit(ntfytoast_manager *manager)
+{
+    ntfytoast_toast toast;
+    ntfytoast_toast_init(&toast);
+    toast.title = "Title";
+    toast.body = "Message";
+    ntfytoast_handle handle = 0;
+    CHECK_EQ(ntfytoast_submit(manager, &toast, &handle), NTFYTOAST_OK);
+    return handle;
+}
+
+// a newer caller passes a larger struct, the fields it added are left alone
+void resultKeepsStructSize()
+{
+    struct Extended
+    {
+        ntfytoast_result result;
+        uint64_t later;
+    };
+
+    const auto manager = createManager(idleUser());
+    const auto handle = submit(manager);
+    CHECK_EQ(ntfytoast_cancel(manager, handle), NTFYTOAST_OK);
+
+    ntfytoast_result uninitialized;
+    std::memset(&uninitialized, 0, sizeof(uninitialized));
+    CHECK_EQ(ntfytoast_poll(manager, &uninitialized), NTFYTOAST_ERROR_INVALID_ARGUMENT);
+
+    Extended extended;
+    ntfytoast_result_init(&extended.result);
+    extended.result.struct_size = sizeof(Extended);
+    extended.later = 0x5EED;
+    CHECK_EQ(ntfytoast_wait(manager, handle, 5000, &extended.result), NTFYTOAST_OK);
+    CHECK_EQ(extended.result.struct_size, uint32_t(sizeof(Extended)));
+    CHECK_EQ(extended.result.handle, handle);
+    CHECK_EQ(extended.result.action, NTFYTOAST_ACTION_HIDDEN);
+    CHECK_EQ(extended.later, uint64_t(0x5EED));
+    ntfytoast_result_free(&extended.result);
+    ntfytoast_manager_free(manager);
+}
+
+// nobody polls, only the newest results are kept
+void unclaimedResultsAreBounded()
+{
+    auto options = idleUser();
+    options.setting = ToastSetting::DisabledForUser;
+    const auto manager = createManager(options);
+    ntfytoast_handle last = 0;
+    for (int i = 0; i < NTFYTOAST_MAX_RESULTS + 100; ++i) {
+        last = submit(manager);
+    }
+
+    ntfytoast_result result;
+    ntfytoast_result_init(&result);
+    CHECK_EQ(ntfytoast_wait(manager, last, 5000, &result), NTFYTOAST_OK);
+    CHECK_EQ(result.action, NTFYTOAST_ACTION_ERROR);
+    size_t kept = 0;
+    while (ntfytoast_poll(manager, &result) == NTFYTOAST_OK) {
+        ntfytoast_result_free(&result);
+        ++kept;
+    }
+    CHECK_EQ(kept, size_t(NTFYTOAST_MAX_RESULTS - 1));
+    ntfytoast_manager_free(manager);
+}
+
+void invalidArguments()
+{
+    ntfytoast_result result;
+    ntfytoast_result_init(&result);
+    CHECK_EQ(ntfytoast_cancel(nullptr, 1), NTFYTOAST_ERROR_INVALID_ARGUMENT);
+    CHECK_EQ(ntfytoast_poll(nullptr, &result), NTFYTOAST_ERROR_INVALID_ARGUMENT);
+    CHECK_EQ(ntfytoast_wait(nullptr, 1, 0, &result), NTFYTOAST_ERROR_INVALID_ARGUMENT);
+    ntfytoast_manager_free(nullptr);
+
+    ntfytoast_manager *manager = nullptr;
+    CHECK_EQ(ntfytoast_manager_create("NtfyToast.Test", &manager),
+             NTFYTOAST_ERROR_UNSUPPORTED);
+    CHECK(manager == nullptr);
+}
+}
+
+int main()
+{
+    resultKeepsStructSize();
+    unclaimedResultsAreBounded();
+    invalidArguments();
+    return NtfyTest::result();
+}
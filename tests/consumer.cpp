@@ -0,0 +1,209 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "callbackclient.h"
+#include "check.h"
+#include "ntfytoastconsumer.h"
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NtfyToastConsumer;
+using namespace std::chrono_literals;
+
+namespace {
+const std::string Clicked = "action=clicked;notificationId=7;correlationId=job-1;"
+                            "submittedAt=1000;shownAt=1250;actedAt=4000;";
+const std::string Reply = "action=textEntered;notificationId=8;text=a;b=c;\n";
+
+template<typename Char>
+std::basic_string<Char> widen(const std::string &in)
+{
+    return std::basic_string<Char>(in.cbegin(), in.cend());
+}
+
+template<typename Char>
+std::string narrow(std::basic_string_view<Char> in)
+{
+    std::string out;
+    for (const Char c : in) {
+        out.push_back(static_cast<char>(c));
+    }
+    return out;
+}
+
+void message()
+{
+    const CallbackMessage<char> clicked(Clicked);
+    CHECK(clicked.action() == NtfyToastActions::Actions::Clicked);
+    CHECK(clicked.notificationId() == "7");
+    CHECK(clicked.correlationId() == "job-1");
+    CHECK(clicked.value("pipe").empty());
+    CHECK(clicked.timestamp("shownAt") == std::optional(1250ms));
+    CHECK(!clicked.timestamp("missing"));
+
+    // the text reply is the last field and may contain the separators
+    const CallbackMessage<char> reply(Reply);
+    CHECK(reply.action() == NtfyToastActions::Actions::TextEntered);
+    CHECK(reply.value("text") == "a;b=c;\n");
+    CHECK(reply.value("b").empty());
+
+    CHECK(CallbackMessage<char>("action=unknown;").action() == NtfyToastActions::Actions::Error);
+    CHECK(!CallbackMessage<char>("actedAt=12a;").timestamp("actedAt"));
+    CHECK(!CallbackMessage<char>("actedAt=1234567890123456789;").timestamp("actedAt"));
+    CHECK(CallbackMessage<char>(";;=x;a=;").value("a").empty());
+}
+
+// every way of splitting two messages into two chunks, views and copies alike
+template<typename Char>
+void splitAnywhere()
+{
+    std::basic_string<Char> stream = widen<Char>(Clicked);
+    stream.push_back(0);
+    stream += widen<Char>(Reply);
+    stream.push_back(0);
+    const char *bytes = reinterpret_cast<const char *>(stream.data());
+    const size_t size = stream.size() * sizeof(Char);
+
+    for (size_t split = 0; split <= size; ++split) {
+        CallbackDecoder<Char> decoder;
+        std::vector<std::string> messages;
+        const auto collect = [&](const CallbackMessage<Char> &message) {
+            messages.push_back(narrow<Char>(message.raw()));
+        };
+        size_t count = decoder.feed(bytes, split, collect);
+        count += decoder.feed(bytes + split, size - split, collect);
+        CHECK_EQ(count, 2u);
+        CHECK_EQ(decoder.buffered(), 0u);
+        CHECK(messages == std::vector<std::string>({ Clicked, Reply }));
+    }
+}
+
+template<typename Char>
+void byteByByte()
+{
+    std::basic_string<Char> stream;
+    for (int i = 0; i < 3; ++i) {
+        stream += widen<Char>(Clicked);
+        stream.push_back(0);
+    }
+    const char *bytes = reinterpret_cast<const char *>(stream.data());
+    CallbackDecoder<Char> decoder;
+    size_t count = 0;
+    for (size_t i = 0; i < stream.size() * sizeof(Char); ++i) {
+        count += decoder.feed(bytes + i, 1, [](const CallbackMessage<Char> &message) {
+            CHECK(narrow<Char>(message.raw()) == Clicked);
+        });
+    }
+    CHECK_EQ(count, 3u);
+}
+
+void misalignedChunk()
+{
+    std::u16string stream = widen<char16_t>(Clicked);
+    stream.push_back(0);
+    std::vector<char> buffer(stream.size() * 2 + 1);
+    std::memcpy(buffer.data() + 1, stream.data(), stream.size() * 2);
+    CallbackDecoder<char16_t> decoder;
+    size_t count = decoder.feed(buffer.data() + 1, stream.size() * 2,
+                                [](const CallbackMessage<char16_t> &message) {
+                                    CHECK(narrow<char16_t>(message.raw()) == Clicked);
+                                });
+    CHECK_EQ(count, 1u);
+}
+
+// ntfytoast closes the connection after the callback, the terminator is optional
+void finishWithoutTerminator()
+{
+    CallbackDecoder<char> decoder;
+    std::string received;
+    const auto collect = [&](const CallbackMessage<char> &message) {
+        received = std::string(message.raw());
+    };
+    CHECK_EQ(decoder.feed(Clicked.data(), Clicked.size(), collect), 0u);
+    CHECK_EQ(decoder.buffered(), Clicked.size());
+    CHECK_EQ(decoder.finish(collect), 1u);
+    CHECK(received == Clicked);
+    CHECK_EQ(decoder.finish(collect), 0u);
+}
+
+#ifndef _WIN32
+// the address is the path of a Unix domain socket, a named pipe on Windows
+void server()
+{
+    const auto address =
+            (std::filesystem::temp_directory_path() / "ntfytoast-test-consumer.sock").string();
+    std::mutex mutex;
+    std::vector<std::string> received;
+    CallbackServer<char> server(address, [&](const CallbackMessage<char> &message) {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.emplace_back(message.raw());
+    });
+    std::thread thread([&] { CHECK(server.run()); });
+
+    // one connection per callback, like ntfytoast, with and without terminator
+    bool sent = false;
+    for (int attempt = 0; attempt < 100 && !sent; ++attempt) {
+        sent = sendCallback(address, Clicked.c_str(), Clicked.size() + 1);
+        if (!sent) {
+            std::this_thread::sleep_for(10ms);
+        }
+    }
+    CHECK(sent);
+    CHECK(sendCallback(address, Reply.c_str(), Reply.size()));
+    const std::string two = Clicked + '\0' + Clicked + '\0';
+    CHECK(sendCallback(address, two.data(), two.size()));
+
+    for (int i = 0; i < 500; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (received.size() >= 4) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    server.stop();
+    thread.join();
+    CHECK(received == std::vector<std::string>({ Clicked, Reply, Clicked, Clicked }));
+    CHECK(!std::filesystem::exists(address));
+}
+#endif
+}
+
+int main()
+{
+    message();
+    splitAnywhere<char>();
+    splitAnywhere<char16_t>();
+    byteByByte<char>();
+    byteByByte<char16_t>();
+    misalignedChunk();
+    finishWithoutTerminator();
+#ifndef _WIN32
+    server();
+#endif
+    return NtfyTest::result();
+}
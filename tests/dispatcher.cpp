@@ -0,0 +1,211 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "loopbackbackend.h"
+#include "toastdispatcher.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+using namespace std::chrono_literals;
+using Actions = NtfyToastActions::Actions;
+
+namespace {
+// the user never reacts, toasts only leave the screen when they time out
+LoopbackBackend::Options idleUser()
+{
+    LoopbackBackend::Options options;
+    options.clicks = 0;
+    options.buttons = 0;
+    options.replies = 0;
+    options.dismissals = 0;
+    return options;
+}
+
+ToastSubmission submission(const std::wstring &tag)
+{
+    ToastSubmission out;
+    out.request = { L"NtfyToast.Test", tag, L"test", L"<toast><visual/></toast>", {} };
+    return out;
+}
+
+bool ready(std::future<ToastResult> &result, std::chrono::milliseconds timeout = 5s)
+{
+    return result.wait_for(timeout) == std::future_status::ready;
+}
+
+// the expiration time is wall clock time, the dispatcher must not mix it with its own clock
+void expiresOnInjectedClock()
+{
+    ToastDispatcher::Options options;
+    // far from the system clock, a deadline taken from the epoch would never be reached
+    options.clock = [] {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                + 1000h;
+    };
+    ToastDispatcher dispatcher(std::make_shared<LoopbackBackend>(idleUser()), options);
+    dispatcher.start();
+
+    auto toast = submission(L"expire");
+    toast.request.expirationTime = std::chrono::system_clock::now() + 100ms;
+    auto ticket = dispatcher.submit(std::move(toast));
+    CHECK(ready(ticket.result));
+    if (ready(ticket.result, 0ms)) {
+        const auto result = ticket.result.get();
+        CHECK(result.action == Actions::Hidden);
+        CHECK(result.shownAt.has_value());
+    }
+}
+
+void rejectsDisabledApp()
+{
+    auto options = idleUser();
+    options.setting = ToastSetting::DisabledForUser;
+    ToastDispatcher dispatcher(std::make_shared<LoopbackBackend>(options));
+    dispatcher.start();
+
+    auto ticket = dispatcher.submit(submission(L"disabled"));
+    CHECK(ready(ticket.result));
+    if (ready(ticket.result, 0ms)) {
+        const auto result = ticket.result.get();
+        CHECK(result.action == Actions::Error);
+        CHECK(!result.shownAt.has_value());
+    }
+}
+
+void cancelHidesToast()
+{
+    const auto backend = std::make_shared<LoopbackBackend>(idleUser());
+    ToastDispatcher dispatcher(backend);
+    dispatcher.start();
+
+    auto ticket = dispatcher.submit(submission(L"cancel"));
+    while (backend->active() == 0 && dispatcher.pending() == 1) {
+        std::this_thread::sleep_for(1ms);
+    }
+    dispatcher.cancel(ticket.handle);
+    CHECK(ready(ticket.result));
+    if (ready(ticket.result, 0ms)) {
+        CHECK(ticket.result.get().action == Actions::Hidden);
+    }
+    CHECK_EQ(dispatcher.pending(), 0u);
+}
+
+void timesOutWithoutReaction()
+{
+    ToastDispatcher::Options options;
+    options.timeout = 50ms;
+    ToastDispatcher dispatcher(std::make_shared<LoopbackBackend>(idleUser()), options);
+    dispatcher.start();
+
+    auto ticket = dispatcher.submit(submission(L"timeout"));
+    CHECK(ready(ticket.result));
+    if (ready(ticket.result, 0ms)) {
+        CHECK(ticket.result.get().action == Actions::Error);
+    }
+}
+
+// the subscription toasts of ntfytoast wait for the user as long as the toast is shown
+void waitsWithoutTimeout()
+{
+    LoopbackBackend::Options user;
+    user.clicks = 1;
+    user.reaction = LoopbackBackend::Distribution::fixed(200ms);
+    ToastDispatcher::Options options;
+    options.timeout.reset();
+    ToastDispatcher dispatcher(std::make_shared<LoopbackBackend>(user), options);
+    dispatcher.start();
+
+    auto ticket = dispatcher.submit(submission(L"late"));
+    CHECK(ready(ticket.result));
+    if (ready(ticket.result, 0ms)) {
+        CHECK(ticket.result.get().action == Actions::Clicked);
+    }
+}
+
+// the completions run on the dispatcher thread, also for a dispatcher that never started
+void stopCompletesQueuedToasts()
+{
+    for (const bool started : { true, false }) {
+        ToastDispatcher::Options options;
+        options.maxOutstanding = 1;
+        ToastDispatcher dispatcher(std::make_shared<LoopbackBackend>(idleUser()), options);
+        if (started) {
+            dispatcher.start();
+        }
+
+        std::mutex mutex;
+        std::vector<std::thread::id> threads;
+        std::vector<ToastTicket> tickets;
+        for (int i = 0; i < 16; ++i) {
+            auto toast = submission(L"stop" + std::to_wstring(i));
+            toast.completion = [&](ToastHandle, const ToastResult &) {
+                std::lock_guard<std::mutex> lock(mutex);
+                threads.push_back(std::this_thread::get_id());
+            };
+            tickets.push_back(dispatcher.submit(std::move(toast)));
+        }
+        dispatcher.stop();
+        for (auto &ticket : tickets) {
+            CHECK(ready(ticket.result, 0ms));
+            if (ready(ticket.result, 0ms)) {
+                CHECK(ticket.result.get().action == Actions::Error);
+            }
+        }
+        CHECK_EQ(dispatcher.pending(), 0u);
+        CHECK_EQ(threads.size(), tickets.size());
+        CHECK(std::find(threads.cbegin(), threads.cend(), std::this_thread::get_id())
+              == threads.cend());
+    }
+}
+
+// a stopped dispatcher stays stopped, it rejects new toasts
+void stopIsFinal()
+{
+    ToastDispatcher dispatcher(std::make_shared<LoopbackBackend>(idleUser()));
+    dispatcher.start();
+    dispatcher.stop();
+    dispatcher.start();
+    auto ticket = dispatcher.submit(submission(L"late"));
+    CHECK(!ticket.admission.accepted());
+    CHECK(ready(ticket.result, 0ms));
+    if (ready(ticket.result, 0ms)) {
+        CHECK(ticket.result.get().action == Actions::Error);
+    }
+    dispatcher.stop();
+}
+}
+
+int main()
+{
+    expiresOnInjectedClock();
+    rejectsDisabledApp();
+    cancelHidesToast();
+    timesOutWithoutReaction();
+    waitsWithoutTimeout();
+    stopCompletesQueuedToasts();
+    stopIsFinal();
+    return NtfyTest::result();
+}
@@ -0,0 +1,304 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "loopbackbackend.h"
+#include "toastcontent.h"
+
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+
+using namespace std::chrono_literals;
+using Actions = NtfyToastActions::Actions;
+
+namespace {
+// a second of the simulation takes a millisecond
+constexpr double TimeScale = 0.001;
+
+struct Seen
+{
+    std::chrono::steady_clock::time_point at;
+    Actions action = Actions::Clicked;
+    std::wstring arguments;
+};
+
+class RecordingSink : public ToastEventSink
+{
+public:
+    void activated(const std::wstring &arguments) override
+    {
+        add({ std::chrono::steady_clock::now(), Actions::Clicked, arguments });
+    }
+
+    void dismissed(Actions reason) override
+    {
+        add({ std::chrono::steady_clock::now(), reason, {} });
+    }
+
+    void failed() override
+    {
+        add({ std::chrono::steady_clock::now(), Actions::Error, {} });
+    }
+
+    // waits for count events, false if they do not arrive in time
+    bool wait(size_t count, std::chrono::milliseconds timeout = 5s)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_wakeup.wait_for(lock, timeout, [&] { return m_seen.size() >= count; });
+    }
+
+    std::vector<Seen> seen()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_seen;
+    }
+
+private:
+    void add(Seen seen)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_seen.push_back(std::move(seen));
+        }
+        m_wakeup.notify_all();
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::vector<Seen> m_seen;
+};
+
+LoopbackBackend::Options user(double clicks, double buttons, double replies, double dismissals)
+{
+    LoopbackBackend::Options options;
+    options.clicks = clicks;
+    options.buttons = buttons;
+    options.replies = replies;
+    options.dismissals = dismissals;
+    options.timeScale = TimeScale;
+    return options;
+}
+
+ToastRequest request(const std::wstring &tag, const ToastContent &content)
+{
+    const auto xml = content.render(L"notificationId=" + tag + L";", L"1000");
+    return { L"NtfyToast.Test", tag, L"test", xml, {} };
+}
+
+ToastContent plain()
+{
+    ToastContent content;
+    content.title = L"Backup";
+    content.body = L"Disk full";
+    return content;
+}
+
+// the same seed gives the same samples, their shape matches the distribution
+void seededDistributions()
+{
+    using Distribution = LoopbackBackend::Distribution;
+    const Distribution distributions[] = { Distribution::fixed(5ms),
+                                           Distribution::uniform(1ms, 3ms),
+                                           Distribution::exponential(2ms),
+                                           Distribution::logNormal(4ms, 0.5) };
+    for (const auto &distribution : distributions) {
+        std::mt19937_64 a(42);
+        std::mt19937_64 b(42);
+        for (int i = 0; i < 100; ++i) {
+            CHECK(distribution.sample(a) == distribution.sample(b));
+        }
+    }
+
+    constexpr int Samples = 100000;
+    std::mt19937_64 random(42);
+    CHECK(distributions[0].sample(random) == 5ms);
+
+    std::chrono::microseconds min = 1h;
+    std::chrono::microseconds max = 0us;
+    for (int i = 0; i < Samples; ++i) {
+        const auto sample = distributions[1].sample(random);
+        min = std::min(min, sample);
+        max = std::max(max, sample);
+    }
+    CHECK(min >= 1ms && min < 1100us);
+    CHECK(max <= 3ms && max > 2900us);
+
+    double sum = 0;
+    for (int i = 0; i < Samples; ++i) {
+        sum += static_cast<double>(distributions[2].sample(random).count());
+    }
+    CHECK(std::abs(sum / Samples - 2000) < 50);
+
+    int below = 0;
+    for (int i = 0; i < Samples; ++i) {
+        below += distributions[3].sample(random) < 4ms;
+    }
+    CHECK(std::abs(below - Samples / 2) < Samples / 50);
+}
+
+// the shares of the reactions follow the options, two backends with one seed agree
+void seededReactions()
+{
+    constexpr size_t Toasts = 1000;
+    std::vector<Seen> runs[2];
+    for (auto &run : runs) {
+        auto options = user(0.3, 0.2, 0.1, 0.3);
+        options.reaction = LoopbackBackend::Distribution::fixed(0us);
+        options.seed = 7;
+        LoopbackBackend backend(options);
+        ToastContent content = plain();
+        content.buttons = L"Yes;No;";
+        for (size_t i = 0; i < Toasts; ++i) {
+            const auto sink = std::make_shared<RecordingSink>();
+            backend.show(request(std::to_wstring(i), content), sink);
+            CHECK(sink->wait(1));
+            run.push_back(sink->seen().front());
+        }
+    }
+    size_t clicked = 0;
+    size_t buttons = 0;
+    size_t dismissed = 0;
+    size_t timedOut = 0;
+    for (size_t i = 0; i < Toasts; ++i) {
+        CHECK(runs[0][i].action == runs[1][i].action);
+        CHECK(runs[0][i].arguments == runs[1][i].arguments);
+        const auto &seen = runs[0][i];
+        if (seen.action == Actions::Dismissed) {
+            ++dismissed;
+        } else if (seen.action == Actions::Timedout) {
+            ++timedOut;
+        } else if (seen.arguments.find(L"action=buttonClicked;") != std::wstring::npos) {
+            ++buttons;
+        } else {
+            // without a text box a reply is a click
+            ++clicked;
+        }
+    }
+    const auto near = [](size_t count, double share) {
+        return std::abs(static_cast<double>(count) / Toasts - share) < 0.05;
+    };
+    CHECK(near(clicked, 0.4));
+    CHECK(near(buttons, 0.2));
+    CHECK(near(dismissed, 0.3));
+    CHECK(near(timedOut, 0.1));
+}
+
+// a toast nobody reacts to times out after 7 seconds, 25 with duration="long", scaled
+void timeoutsScale()
+{
+    auto options = user(0, 0, 0, 0);
+    options.timeScale = 0.01;
+    LoopbackBackend backend(options);
+
+    ToastContent longContent = plain();
+    longContent.longDuration = true;
+    const auto shortSink = std::make_shared<RecordingSink>();
+    const auto longSink = std::make_shared<RecordingSink>();
+    const auto start = std::chrono::steady_clock::now();
+    backend.show(request(L"short", plain()), shortSink);
+    backend.show(request(L"long", longContent), longSink);
+
+    CHECK(shortSink->wait(1));
+    CHECK(longSink->wait(1));
+    const auto shortSeen = shortSink->seen();
+    const auto longSeen = longSink->seen();
+    if (!shortSeen.empty() && !longSeen.empty()) {
+        CHECK(shortSeen[0].action == Actions::Timedout);
+        CHECK(longSeen[0].action == Actions::Timedout);
+        CHECK(shortSeen[0].at - start >= 70ms);
+        CHECK(shortSeen[0].at - start < 250ms);
+        CHECK(longSeen[0].at - start >= 250ms);
+    }
+    // a toast that timed out stays in the Action Center
+    CHECK_EQ(backend.active(), 0u);
+    CHECK_EQ(backend.history(L"NtfyToast.Test"), 2u);
+    CHECK_EQ(backend.stats().timedOut, 2u);
+}
+
+// an incoming call stays on screen until it is hidden
+void incomingCallStays()
+{
+    LoopbackBackend backend(user(0, 0, 0, 0));
+    ToastContent content = plain();
+    content.persistent = true;
+    const auto sink = std::make_shared<RecordingSink>();
+    backend.show(request(L"call", content), sink);
+
+    // a plain toast times out after 7ms
+    CHECK(!sink->wait(1, 100ms));
+    CHECK_EQ(backend.active(), 1u);
+
+    CHECK(backend.hide(L"NtfyToast.Test", L"call", L"test"));
+    CHECK(sink->wait(1));
+    const auto seen = sink->seen();
+    CHECK(!seen.empty() && seen[0].action == Actions::Hidden);
+    CHECK_EQ(backend.active(), 0u);
+    CHECK_EQ(backend.stats().hidden, 1u);
+}
+
+// the events carry the launch, button and text box arguments of the xml
+void activationArguments()
+{
+    const auto react = [](LoopbackBackend::Options options, const ToastContent &content) {
+        options.reaction = LoopbackBackend::Distribution::fixed(0us);
+        LoopbackBackend backend(options);
+        const auto sink = std::make_shared<RecordingSink>();
+        backend.show(request(L"42", content), sink);
+        sink->wait(1);
+        const auto seen = sink->seen();
+        return seen.empty() ? Seen() : seen[0];
+    };
+
+    const auto clicked = react(user(1, 0, 0, 0), plain());
+    CHECK(clicked.action == Actions::Clicked);
+    CHECK(clicked.arguments.rfind(L"action=clicked;notificationId=42;", 0) == 0);
+
+    ToastContent withButtons = plain();
+    withButtons.buttons = L"Tom & Jerry;";
+    const auto button = react(user(0, 1, 0, 0), withButtons);
+    CHECK(button.arguments.rfind(L"action=buttonClicked;notificationId=42;", 0) == 0);
+    // unescaped like Windows passes it
+    CHECK(button.arguments.find(L"button=Tom & Jerry;") != std::wstring::npos);
+
+    ToastContent withTextBox = plain();
+    withTextBox.textBox = true;
+    const auto reply = react(user(0, 0, 1, 0), withTextBox);
+    CHECK(reply.arguments.rfind(L"action=textEntered;notificationId=42;", 0) == 0);
+
+    const auto dismissed = react(user(0, 0, 0, 1), plain());
+    CHECK(dismissed.action == Actions::Dismissed);
+    CHECK(dismissed.arguments.empty());
+}
+}
+
+int main()
+{
+    seededDistributions();
+    seededReactions();
+    timeoutsScale();
+    incomingCallStays();
+    activationArguments();
+    return NtfyTest::result();
+}
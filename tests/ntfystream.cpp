@@ -0,0 +1,141 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "ntfystream.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+const std::string message =
+        R"({"id":"sPs71M8A2T","time":1700000000,"event":"message","topic":"backups",)"
+        R"("priority":4,"tags":["warning",{"nested":"}"}],)"
+        R"("title":"Backup \"nightly\"","message":"Disk is 95% full\nclean up",)"
+        R"("click":"https://example.com/disk","attachment":{"name":"a]b","size":12}})"
+        "\n";
+
+struct Seen
+{
+    std::string id;
+    std::string event;
+    std::string title;
+    int priority = 0;
+    int64_t time = 0;
+};
+
+std::vector<Seen> feed(NtfyStreamParser &parser, const std::string &stream, size_t chunk)
+{
+    std::vector<Seen> out;
+    for (size_t pos = 0; pos < stream.size(); pos += chunk) {
+        parser.feed(stream.data() + pos, std::min(chunk, stream.size() - pos),
+                    [&](const NtfyMessage &m) {
+                        // the views are only valid in the handler
+                        out.push_back({ std::string(m.id), std::string(m.event),
+                                        std::string(m.title), m.priority, m.time });
+                    });
+    }
+    return out;
+}
+
+void parsesMessage()
+{
+    NtfyMessage m;
+    CHECK(NtfyStreamParser::parse(message, m));
+    CHECK(m.id == "sPs71M8A2T");
+    CHECK(m.event == "message");
+    CHECK(m.topic == "backups");
+    CHECK(m.title == R"(Backup \"nightly\")");
+    CHECK(m.click == "https://example.com/disk");
+    CHECK_EQ(m.priority, 4);
+    CHECK_EQ(m.time, int64_t(1700000000));
+    CHECK(NtfyMessage::text(m.title) == L"Backup \"nightly\"");
+    CHECK(NtfyMessage::text(m.message) == L"Disk is 95% full\nclean up");
+
+    NtfyMessage empty;
+    CHECK(NtfyStreamParser::parse("{}", empty));
+    CHECK_EQ(empty.priority, 3);
+    CHECK(!NtfyStreamParser::parse("", empty));
+    CHECK(!NtfyStreamParser::parse(R"({"id":"x")", empty));
+    CHECK(!NtfyStreamParser::parse(R"({"tags":["open)", empty));
+}
+
+void decodesEscapes()
+{
+    CHECK(NtfyMessage::text("plain") == L"plain");
+    CHECK(NtfyMessage::text(R"(a\/b\\c\tz)") == L"a/b\\c\tz");
+    CHECK(NtfyMessage::text(R"(caf\u00e9)") == L"caf\u00e9");
+    CHECK(NtfyMessage::text("caf\xc3\xa9") == L"caf\u00e9");
+    CHECK(NtfyMessage::text(R"(\ud83d\udd14)") == L"\U0001F514");
+    // an unpaired surrogate
+    CHECK(NtfyMessage::text(R"(\ud83d!)") == L"\ufffd!");
+    CHECK(NtfyMessage::text(R"(\u12)") == L"u12");
+}
+
+void readsLinesSplitAcrossChunks()
+{
+    const std::string stream = R"({"event":"open","id":"o"})"
+                               "\n\n"
+            + message + R"({"event":"keepalive","id":"k"})" + "\n" + message;
+    for (const size_t chunk : { size_t(1), size_t(7), size_t(64), stream.size() }) {
+        NtfyStreamParser parser;
+        const auto seen = feed(parser, stream, chunk);
+        CHECK_EQ(seen.size(), size_t(4));
+        if (seen.size() == 4) {
+            CHECK(seen[0].event == "open");
+            CHECK(seen[1].id == "sPs71M8A2T" && seen[1].priority == 4);
+            CHECK(seen[1].title == R"(Backup \"nightly\")");
+            CHECK(seen[2].event == "keepalive");
+            CHECK(seen[3].time == 1700000000);
+        }
+        CHECK_EQ(parser.invalid(), uint64_t(0));
+    }
+}
+
+void countsInvalidLines()
+{
+    NtfyStreamParser parser;
+    const auto seen = feed(parser, "<html>\n \r\n{\"id\":\n" + message, 4096);
+    CHECK_EQ(seen.size(), size_t(1));
+    CHECK_EQ(parser.invalid(), uint64_t(2));
+}
+
+void resetDropsPartialLine()
+{
+    NtfyStreamParser parser;
+    CHECK(feed(parser, message.substr(0, 40), 4096).empty());
+    parser.reset();
+    const auto seen = feed(parser, message, 4096);
+    CHECK_EQ(seen.size(), size_t(1));
+    CHECK_EQ(parser.invalid(), uint64_t(0));
+}
+}
+
+int main()
+{
+    parsesMessage();
+    decodesEscapes();
+    readsLinesSplitAcrossChunks();
+    countsInvalidLines();
+    resetDropsPartialLine();
+    return NtfyTest::result();
+}
@@ -0,0 +1,320 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "ntfysubscriber.h"
+#include "sockettransport.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace {
+struct Response
+{
+    std::string data;
+    // keep the connection open until the client closes it
+    bool hold = false;
+};
+
+/*
+    Stands in for an ntfy server on 127.0.0.1, the n-th connection gets the n-th response
+    and is closed afterwards. Connections beyond the responses are closed right away.
+*/
+class StandInServer
+{
+public:
+    explicit StandInServer(std::vector<Response> responses) : m_responses(std::move(responses))
+    {
+        m_socket = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t size = sizeof(address);
+        if (bind(m_socket, reinterpret_cast<sockaddr *>(&address), size) != 0
+            || listen(m_socket, 8) != 0
+            || getsockname(m_socket, reinterpret_cast<sockaddr *>(&address), &size) != 0) {
+            std::perror("stand-in server");
+        }
+        m_port = ntohs(address.sin_port);
+        m_thread = std::thread([this] { serve(); });
+    }
+
+    ~StandInServer()
+    {
+        m_stopped = true;
+        shutdown(m_socket, SHUT_RDWR);
+        m_thread.join();
+        close(m_socket);
+    }
+
+    std::wstring url() const
+    {
+        return L"http://127.0.0.1:" + std::to_wstring(m_port);
+    }
+
+    // the request lines in the order they arrived
+    std::vector<std::string> requests() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_requests;
+    }
+
+    std::vector<std::chrono::steady_clock::time_point> arrivals() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_arrivals;
+    }
+
+private:
+    void serve()
+    {
+        while (!m_stopped) {
+            const int client = accept(m_socket, nullptr, nullptr);
+            if (client < 0) {
+                continue;
+            }
+            std::string head;
+            char buffer[4096];
+            while (head.find("\r\n\r\n") == std::string::npos) {
+                const ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    break;
+                }
+                head.append(buffer, static_cast<size_t>(n));
+            }
+            size_t index;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_requests.push_back(head.substr(0, head.find("\r\n")));
+                m_arrivals.push_back(std::chrono::steady_clock::now());
+                index = m_requests.size() - 1;
+            }
+            if (index < m_responses.size()) {
+                const auto &response = m_responses[index];
+                send(client, response.data.data(), response.data.size(), MSG_NOSIGNAL);
+                while (response.hold && recv(client, buffer, sizeof(buffer), 0) > 0) {
+                }
+            }
+            close(client);
+        }
+    }
+
+    const std::vector<Response> m_responses;
+    int m_socket = -1;
+    uint16_t m_port = 0;
+    std::atomic<bool> m_stopped { false };
+    mutable std::mutex m_mutex;
+    std::vector<std::string> m_requests;
+    std::vector<std::chrono::steady_clock::time_point> m_arrivals;
+    std::thread m_thread;
+};
+
+std::string chunk(const std::string &data)
+{
+    char size[16];
+    std::snprintf(size, sizeof(size), "%zx\r\n", data.size());
+    return size + data + "\r\n";
+}
+
+std::string chunked(int status = 200)
+{
+    return "HTTP/1.1 " + std::to_string(status)
+            + " OK\r\nContent-Type: application/x-ndjson\r\nTransfer-Encoding: chunked\r\n\r\n";
+}
+
+std::string status(int status)
+{
+    return "HTTP/1.1 " + std::to_string(status) + " Error\r\nContent-Length: 0\r\n\r\n";
+}
+
+std::string message(const std::string &id)
+{
+    return R"({"id":")" + id + R"(","time":1700000000,"event":"message","topic":"alerts",)"
+            R"("message":"disk full"})" "\n";
+}
+
+std::filesystem::path freshCursorDir()
+{
+    const auto dir = std::filesystem::temp_directory_path() / "ntfytoast-test-subscriber";
+    std::filesystem::remove_all(dir);
+    return dir;
+}
+
+NtfySubscriber::Options options(const std::filesystem::path &cursorDir)
+{
+    NtfySubscriber::Options out;
+    out.cursorDir = cursorDir;
+    out.minBackoff = 10ms;
+    out.maxBackoff = 40ms;
+    return out;
+}
+
+std::string readFile(const std::filesystem::path &path)
+{
+    std::ifstream in(path);
+    std::string out;
+    std::getline(in, out);
+    return out;
+}
+
+// the connection drops within a chunk, the next request resumes after the last message
+void resumesAfterDrop()
+{
+    const auto dir = freshCursorDir();
+    const std::string second = message("m2");
+    StandInServer server({
+            // the second message is split between two chunks, the connection drops within
+            // the third
+            { chunked() + chunk(message("m1") + second.substr(0, 10)) + chunk(second.substr(10))
+              + "40\r\n" R"({"id":"m3","event":"mes)" },
+            { chunked() + chunk(message("m4")) + chunk("") },
+    });
+
+    std::vector<std::string> ids;
+    NtfySubscriber subscriber(server.url(), { L"alerts", L"backups" },
+                              std::make_shared<SocketTransport>(), options(dir));
+    const bool ok = subscriber.run([&](const NtfyMessage &m) {
+        ids.emplace_back(m.id);
+        if (m.id == "m4") {
+            // saved once the data of the first connection was handled
+            CHECK_EQ(readFile(subscriber.cursorFile()), "m2");
+            subscriber.stop();
+        }
+    });
+    CHECK(ok);
+    CHECK(ids == std::vector<std::string>({ "m1", "m2", "m4" }));
+    const auto requests = server.requests();
+    CHECK_EQ(requests.size(), 2u);
+    if (requests.size() == 2) {
+        CHECK_EQ(requests[0], "GET /alerts,backups/json HTTP/1.1");
+        CHECK_EQ(requests[1], "GET /alerts,backups/json?since=m2 HTTP/1.1");
+    }
+    CHECK_EQ(subscriber.cursor(), "m4");
+    CHECK_EQ(readFile(subscriber.cursorFile()), "m4");
+
+    // the next run starts where this one ended
+    StandInServer restarted({
+            { "HTTP/1.1 200 OK\r\nContent-Length: 17\r\n\r\n" R"({"event":"open"})" "\n" },
+    });
+    // the cursor file belongs to the url, the port of the new server is another one
+    std::filesystem::copy_file(subscriber.cursorFile(),
+                               NtfySubscriber(restarted.url(), { L"alerts", L"backups" },
+                                              std::make_shared<SocketTransport>(), options(dir))
+                                       .cursorFile());
+    NtfySubscriber next(restarted.url(), { L"alerts", L"backups" },
+                        std::make_shared<SocketTransport>(), options(dir));
+    CHECK_EQ(next.cursor(), "m4");
+    CHECK(next.run([&](const NtfyMessage &m) {
+        if (m.event == "open") {
+            next.stop();
+        }
+    }));
+    const auto resumed = restarted.requests();
+    CHECK(!resumed.empty() && resumed[0] == "GET /alerts,backups/json?since=m4 HTTP/1.1");
+    std::filesystem::remove_all(dir);
+}
+
+// a 4xx does not go away by asking again, rate limiting does
+void failsOnClientErrors()
+{
+    const auto dir = freshCursorDir();
+    {
+        StandInServer server({ { status(404) } });
+        NtfySubscriber subscriber(server.url(), { L"alerts" },
+                                  std::make_shared<SocketTransport>(), options(dir));
+        CHECK(!subscriber.run([](const NtfyMessage &) {}));
+        CHECK_EQ(server.requests().size(), 1u);
+    }
+    {
+        StandInServer server({ { status(429) }, { status(503) }, { status(403) } });
+        NtfySubscriber subscriber(server.url(), { L"alerts" },
+                                  std::make_shared<SocketTransport>(), options(dir));
+        CHECK(!subscriber.run([](const NtfyMessage &) {}));
+        CHECK_EQ(server.requests().size(), 3u);
+    }
+    NtfySubscriber invalid(L"ftp://example.com", { L"alerts" },
+                           std::make_shared<SocketTransport>(), options(dir));
+    CHECK(!invalid.run([](const NtfyMessage &) {}));
+    std::filesystem::remove_all(dir);
+}
+
+// the delay between two attempts doubles up to maxBackoff
+void backsOff()
+{
+    const auto dir = freshCursorDir();
+    StandInServer server({ { status(503) }, { status(503) }, { status(503) },
+                           { status(503) }, { status(503) }, { status(404) } });
+    NtfySubscriber subscriber(server.url(), { L"alerts" }, std::make_shared<SocketTransport>(),
+                              options(dir));
+    CHECK(!subscriber.run([](const NtfyMessage &) {}));
+
+    const auto arrivals = server.arrivals();
+    CHECK_EQ(arrivals.size(), 6u);
+    const std::chrono::milliseconds expected[] = { 10ms, 20ms, 40ms, 40ms, 40ms };
+    for (size_t i = 1; i < arrivals.size() && i <= std::size(expected); ++i) {
+        CHECK(arrivals[i] - arrivals[i - 1] >= expected[i - 1]);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+// stop() returns from a read that waits for the server
+void stopAbortsRead()
+{
+    const auto dir = freshCursorDir();
+    StandInServer server({ { chunked() + chunk(R"({"event":"open"})" "\n"), true } });
+    NtfySubscriber subscriber(server.url(), { L"alerts" }, std::make_shared<SocketTransport>(),
+                              options(dir));
+    std::atomic<bool> opened { false };
+    std::atomic<bool> ok { false };
+    std::thread reader([&] {
+        ok = subscriber.run([&](const NtfyMessage &m) { opened = m.event == "open"; });
+    });
+    while (!opened) {
+        std::this_thread::sleep_for(1ms);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    subscriber.stop();
+    reader.join();
+    CHECK(ok);
+    CHECK(std::chrono::steady_clock::now() - start < 1s);
+    CHECK_EQ(server.requests().size(), 1u);
+    std::filesystem::remove_all(dir);
+}
+}
+
+int main()
+{
+    resumesAfterDrop();
+    failsOnClientErrors();
+    backsOff();
+    stopAbortsRead();
+    return NtfyTest::result();
+}
@@ -0,0 +1,182 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "lz4block.h"
+#include "packedresources.h"
+
+#include <map>
+#include <random>
+#include <string>
+
+namespace {
+std::string randomBytes(size_t size, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::string out(size, '\0');
+    for (auto &c : out) {
+        c = static_cast<char>(random());
+    }
+    return out;
+}
+
+std::string text(size_t size)
+{
+    std::string out;
+    for (int i = 0; out.size() < size; ++i) {
+        out += "Usage: ntfytoast -t <title> -m <message> " + std::to_string(i % 17) + "\n";
+    }
+    out.resize(size);
+    return out;
+}
+
+bool roundTrips(const std::string &in)
+{
+    const auto compressed = Lz4Block::compress(in);
+    std::string out(in.size(), '\0');
+    return Lz4Block::decompress(compressed, out.data(), out.size()) && out == in;
+}
+
+void lz4RoundTrips()
+{
+    CHECK(roundTrips(""));
+    CHECK(roundTrips("a"));
+    CHECK(roundTrips("abcdefghijkl"));
+    CHECK(roundTrips(std::string(13, 'x')));
+    CHECK(roundTrips(std::string(100000, 'x')));
+    CHECK(roundTrips(text(4117)));
+    CHECK(roundTrips(text(300000)));
+    CHECK(roundTrips(randomBytes(70000, 1)));
+    // matches further back than the 64 KiB window
+    CHECK(roundTrips(randomBytes(70000, 2) + randomBytes(70000, 2)));
+
+    CHECK(Lz4Block::compress(std::string(100000, 'x')).size() < 1000);
+    CHECK(Lz4Block::compress(text(300000)).size() < 300000 / 8);
+}
+
+void lz4RejectsMalformedInput()
+{
+    const auto in = text(4096);
+    const auto compressed = Lz4Block::compress(in);
+    std::string out(in.size(), '\0');
+
+    // the size has to match exactly
+    CHECK(!Lz4Block::decompress(compressed, out.data(), out.size() - 1));
+    std::string larger(in.size() + 1, '\0');
+    CHECK(!Lz4Block::decompress(compressed, larger.data(), larger.size()));
+    CHECK(!Lz4Block::decompress(compressed.substr(0, compressed.size() / 2), out.data(),
+                                out.size()));
+    CHECK(!Lz4Block::decompress({}, out.data(), out.size()));
+
+    // a match that points before the start of the output
+    const std::string before = { '\x10', 'a', '\x05', '\x00', '\x00' };
+    std::string small(20, '\0');
+    CHECK(!Lz4Block::decompress(before, small.data(), small.size()));
+
+    // garbage must not crash, whatever it decodes to
+    for (uint32_t seed = 0; seed < 200; ++seed) {
+        const auto garbage = randomBytes(64 + seed, seed);
+        Lz4Block::decompress(garbage, out.data(), out.size());
+    }
+}
+
+void packsWhatGetsSmaller()
+{
+    const auto png = randomBytes(2000, 3);
+    const auto packedPng = PackedResources::pack(png);
+    CHECK_EQ(packedPng.size(), png.size() + 12);
+    CHECK_EQ(static_cast<int>(packedPng[8]), static_cast<int>(PackedResources::Stored));
+
+    const auto help = text(4117);
+    const auto packedHelp = PackedResources::pack(help);
+    CHECK(packedHelp.size() < help.size() / 2);
+    CHECK_EQ(static_cast<int>(packedHelp[8]), static_cast<int>(PackedResources::Compressed));
+
+    std::string buffer;
+    std::string_view out;
+    CHECK(PackedResources::unpack(packedPng, buffer, out));
+    // stored data is not copied
+    CHECK(out == png && out.data() == packedPng.data() + 12);
+    CHECK(PackedResources::unpack(packedHelp, buffer, out));
+    CHECK(out == help);
+}
+
+void unpackRejectsMalformedHeaders()
+{
+    const auto packed = PackedResources::pack(text(1000), PackedResources::Compressed);
+    std::string buffer;
+    std::string_view out;
+    CHECK(!PackedResources::unpack(packed.substr(0, 11), buffer, out));
+
+    auto magic = packed;
+    magic[0] = 'X';
+    CHECK(!PackedResources::unpack(magic, buffer, out));
+
+    auto method = packed;
+    method[8] = 7;
+    CHECK(!PackedResources::unpack(method, buffer, out));
+
+    // a size beyond the limit is not allocated
+    auto huge = packed;
+    huge[7] = '\x7f';
+    CHECK(!PackedResources::unpack(huge, buffer, out));
+
+    auto stored = PackedResources::pack("abc", PackedResources::Stored);
+    stored.pop_back();
+    CHECK(!PackedResources::unpack(stored, buffer, out));
+}
+
+void opensOnFirstUse()
+{
+    const std::map<std::string, std::string> files = {
+        { "help.txt", PackedResources::pack(text(4117)) },
+        { "broken", "NTPK" },
+    };
+    std::map<std::string, int> lookups;
+    PackedResources resources([&](const std::string &name) -> std::string_view {
+        ++lookups[name];
+        const auto it = files.find(name);
+        return it == files.cend() ? std::string_view() : std::string_view(it->second);
+    });
+
+    const auto help = resources.open("help.txt");
+    CHECK(help == text(4117));
+    // decompressed once, the view stays valid after other resources were opened
+    CHECK(resources.open("missing").empty());
+    CHECK(resources.open("broken").empty());
+    CHECK(resources.open("help.txt").data() == help.data());
+    CHECK_EQ(lookups["help.txt"], 1);
+    CHECK_EQ(lookups["missing"], 1);
+    CHECK(resources.open("missing").empty());
+    CHECK_EQ(lookups["missing"], 1);
+}
+}
+
+int main()
+{
+    lz4RoundTrips();
+    lz4RejectsMalformedInput();
+    packsWhatGetsSmaller();
+    unpackRejectsMalformedHeaders();
+    opensOnFirstUse();
+    return NtfyTest::result();
+}
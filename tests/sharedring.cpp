@@ -0,0 +1,210 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "ntfytoastconsumer.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace NtfyToastConsumer;
+using namespace std::chrono_literals;
+
+namespace {
+constexpr size_t Capacity = 4096;
+
+#ifdef __linux__
+std::string shmPath(const std::string &name)
+{
+    return "/dev/shm/ntfytoast-ring-ntfytoast-test-ring-" + name;
+}
+#endif
+
+// a ring stays in the shared memory for the next consumer, every test starts with a new one
+SharedRing::Address freshAddress(const std::string &name)
+{
+#ifdef _WIN32
+    return L"\\\\.\\pipe\\ntfytoast-test-ring-" + std::wstring(name.cbegin(), name.cend());
+#else
+#ifdef __linux__
+    std::remove(shmPath(name).c_str());
+#endif
+    return "/tmp/ntfytoast-test-ring-" + name;
+#endif
+}
+
+std::vector<std::string> drainAll(SharedRing &ring)
+{
+    std::vector<std::string> out;
+    ring.drain([&](const char *data, size_t size) { out.emplace_back(data, size); });
+    return out;
+}
+
+void attach()
+{
+    const auto address = freshAddress("attach");
+    CHECK(!SharedRing::create(address, 1000));
+    CHECK(!SharedRing::create(address, 2048));
+    auto consumer = SharedRing::create(address, Capacity);
+    CHECK(consumer);
+    auto producer = SharedRing::open(address);
+    CHECK(producer && producer->attached());
+
+    // a restarted consumer finds the records of the previous one
+    CHECK(producer->push("one", 3));
+    consumer.reset();
+    CHECK(!producer->attached());
+    CHECK(!producer->push("two", 3));
+    CHECK(!SharedRing::open(address));
+    consumer = SharedRing::create(address, Capacity);
+    CHECK(producer->attached());
+    CHECK(drainAll(*consumer) == std::vector<std::string>({ "one" }));
+
+    // one of another capacity replaces the ring
+    consumer.reset();
+    consumer = SharedRing::create(address, Capacity * 2);
+    CHECK(!producer->attached());
+    CHECK(SharedRing::open(address));
+}
+
+// records of every size, many times around the ring
+void wrapAround()
+{
+    const auto address = freshAddress("wrap");
+    auto consumer = SharedRing::create(address, Capacity);
+    auto producer = SharedRing::open(address);
+    std::vector<std::string> sent;
+    std::vector<std::string> received;
+    for (size_t i = 0; i < 2000; ++i) {
+        const std::string record(i % 301, static_cast<char>('a' + i % 26));
+        CHECK(producer->push(record.data(), record.size()));
+        sent.push_back(record);
+        if (i % 7 == 6) {
+            const auto drained = drainAll(*consumer);
+            received.insert(received.end(), drained.cbegin(), drained.cend());
+        }
+    }
+    const auto drained = drainAll(*consumer);
+    received.insert(received.end(), drained.cbegin(), drained.cend());
+    CHECK(received == sent);
+    CHECK(consumer->empty());
+}
+
+void full()
+{
+    const auto address = freshAddress("full");
+    auto consumer = SharedRing::create(address, Capacity);
+    auto producer = SharedRing::open(address);
+    const std::string big(Capacity / 2, 'x');
+    CHECK(!producer->push(big.data(), big.size()));
+
+    const std::string record(100, 'r');
+    size_t pushed = 0;
+    while (producer->push(record.data(), record.size())) {
+        ++pushed;
+    }
+    CHECK_EQ(pushed, Capacity / 104);
+    CHECK_EQ(drainAll(*consumer).size(), pushed);
+    CHECK(producer->push(record.data(), record.size()));
+}
+
+void threads()
+{
+    const auto address = freshAddress("threads");
+    auto consumer = SharedRing::create(address, Capacity);
+    constexpr size_t Records = 20000;
+    std::thread producer([&] {
+        auto ring = SharedRing::open(address);
+        for (size_t i = 0; i < Records; ++i) {
+            const std::string record = std::to_string(i);
+            while (!ring->push(record.data(), record.size())) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    size_t next = 0;
+    bool ordered = true;
+    while (next < Records) {
+        consumer->drain([&](const char *data, size_t size) {
+            ordered = ordered && std::string(data, size) == std::to_string(next);
+            ++next;
+        });
+        consumer->wait(100ms);
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK_EQ(next, Records);
+}
+
+#ifdef __linux__
+// any process may write to the ring, a size that does not fit must not be read past
+void corruptSize()
+{
+    for (const uint32_t size : { uint32_t(0x7fffffff), uint32_t(Capacity), uint32_t(1000),
+                                 uint32_t(0xffffffff) }) {
+        const auto address = freshAddress("corrupt");
+        auto consumer = SharedRing::create(address, Capacity);
+        auto producer = SharedRing::open(address);
+        const std::string marker = "corrupt-me-please";
+        CHECK(producer->push(marker.data(), marker.size()));
+        CHECK(producer->push("next", 4));
+
+        std::fstream file(shmPath("corrupt"), std::ios::in | std::ios::out | std::ios::binary);
+        const std::string memory((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+        const size_t position = memory.find(marker);
+        if (!CHECK(position != std::string::npos && position >= sizeof(size))) {
+            return;
+        }
+        file.seekp(static_cast<std::streamoff>(position - sizeof(size)));
+        file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+        file.close();
+
+        size_t calls = 0;
+        CHECK_EQ(consumer->drain([&](const char *, size_t) { ++calls; }), 0u);
+        CHECK_EQ(calls, 0u);
+        CHECK(consumer->empty());
+        CHECK(producer->push("after", 5));
+        CHECK(drainAll(*consumer) == std::vector<std::string>({ "after" }));
+    }
+}
+#endif
+}
+
+int main()
+{
+    attach();
+    wrapAround();
+    full();
+    threads();
+#ifdef __linux__
+    corruptSize();
+    for (const char *name : { "attach", "wrap", "full", "threads", "corrupt" }) {
+        std::remove(shmPath(name).c_str());
+    }
+#endif
+    return NtfyTest::result();
+}
@@ -0,0 +1,181 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "loopbackbackend.h"
+#include "ntfytoastcmanager.h"
+#include "toastdispatcher.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+/*
+    Built with ThreadSanitizer, the checks only make sure the work really ran concurrently
+    and every toast was completed once.
+*/
+
+namespace {
+constexpr int Producers = 8;
+constexpr int ToastsPerProducer = 250;
+constexpr int AppIDs = 4;
+
+const wchar_t *const Xml = L"<toast launch=\"action=clicked;\"><visual/></toast>";
+
+std::wstring appID(int i)
+{
+    return L"NtfyToast.Stress" + std::to_wstring(i % AppIDs);
+}
+
+// a user that reacts within milliseconds, toasts time out after 7ms
+LoopbackBackend::Options busyUser()
+{
+    LoopbackBackend::Options options;
+    options.reaction = LoopbackBackend::Distribution::exponential(3ms);
+    options.timeScale = 0.001;
+    return options;
+}
+
+void submitFromManyThreads()
+{
+    const auto backend = std::make_shared<LoopbackBackend>(busyUser());
+    ToastDispatcher::Options options;
+    options.queueCapacity = Producers * ToastsPerProducer;
+    options.maxOutstanding = 64;
+    ToastDispatcher dispatcher(backend, options);
+    dispatcher.start();
+
+    // indexed by handle, the handles are handed out from 1 on
+    std::vector<std::atomic<int>> completions(Producers * ToastsPerProducer + 1);
+    std::atomic<int> ready { 0 };
+    std::vector<std::thread> producers;
+    std::vector<int> unfinished(Producers, 0);
+    for (int p = 0; p < Producers; ++p) {
+        producers.emplace_back([&, p] {
+            ++ready;
+            while (ready < Producers) {
+                std::this_thread::yield();
+            }
+            std::vector<std::future<ToastResult>> results;
+            for (int i = 0; i < ToastsPerProducer; ++i) {
+                // the fallback check of NtfyToasts runs on the producer threads
+                backend->isRegistered(appID(p + i));
+
+                ToastSubmission submission;
+                submission.request = { appID(p), std::to_wstring(p) + L"-" + std::to_wstring(i),
+                                       L"stress", Xml, {} };
+                submission.completion = [&](ToastHandle handle, const ToastResult &) {
+                    if (handle < completions.size()) {
+                        ++completions[handle];
+                    }
+                };
+                auto ticket = dispatcher.submit(std::move(submission));
+                if (i % 8 == 0) {
+                    dispatcher.cancel(ticket.handle);
+                }
+                results.push_back(std::move(ticket.result));
+                // read while the dispatcher thread completes toasts
+                static_cast<void>(dispatcher.pending());
+            }
+            for (auto &result : results) {
+                if (result.wait_for(30s) != std::future_status::ready) {
+                    ++unfinished[p];
+                }
+            }
+        });
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    dispatcher.stop();
+
+    for (int p = 0; p < Producers; ++p) {
+        CHECK_EQ(unfinished[p], 0);
+    }
+    int once = 0;
+    for (size_t handle = 1; handle < completions.size(); ++handle) {
+        once += completions[handle] == 1 ? 1 : 0;
+    }
+    CHECK_EQ(once, Producers * ToastsPerProducer);
+    CHECK_EQ(dispatcher.pending(), 0u);
+    CHECK_EQ(backend->counters().registrationChecks.load(), uint32_t(AppIDs));
+    const auto stats = backend->stats();
+    CHECK(stats.shown > 0 && stats.activated > 0);
+}
+
+void submitThroughTheCInterface()
+{
+    const auto manager = createToastManager(
+            L"NtfyToast.Stress", std::make_shared<LoopbackBackend>(busyUser()),
+            [](const std::wstring &app, const std::wstring &id, const ntfytoast_toast &) {
+                ToastSubmission submission;
+                submission.request = { app, id, L"stress", Xml, {} };
+                return submission;
+            });
+
+    std::vector<int> failures(Producers, 0);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < Producers; ++p) {
+        threads.emplace_back([&, p] {
+            ntfytoast_toast toast;
+            ntfytoast_toast_init(&toast);
+            toast.title = "Stress";
+            toast.body = "Message";
+            for (int i = 0; i < ToastsPerProducer / 5; ++i) {
+                ntfytoast_handle handle = 0;
+                if (ntfytoast_submit(manager, &toast, &handle) != NTFYTOAST_OK) {
+                    ++failures[p];
+                    continue;
+                }
+                if (i % 4 == 0) {
+                    ntfytoast_cancel(manager, handle);
+                }
+                ntfytoast_result result;
+                ntfytoast_result_init(&result);
+                if (ntfytoast_wait(manager, handle, 30000, &result) != NTFYTOAST_OK
+                    || result.handle != handle) {
+                    ++failures[p];
+                }
+                ntfytoast_result_free(&result);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ntfytoast_manager_free(manager);
+    for (int p = 0; p < Producers; ++p) {
+        CHECK_EQ(failures[p], 0);
+    }
+}
+}
+
+int main()
+{
+    submitFromManyThreads();
+    submitThroughTheCInterface();
+    return NtfyTest::result();
+}
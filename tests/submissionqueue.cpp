@@ -0,0 +1,185 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "submissionqueue.h"
+
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+void highLaneIsDrainedFirst()
+{
+    SubmissionQueue<int> queue(8);
+    queue.push(1);
+    queue.push(2, SubmissionPriority::High);
+    queue.push(3);
+    CHECK_EQ(queue.tryPop(), std::optional(2));
+    CHECK_EQ(queue.tryPop(), std::optional(1));
+    CHECK_EQ(queue.tryPop(), std::optional(3));
+    CHECK(!queue.tryPop());
+}
+
+void dropOldest()
+{
+    SubmissionQueue<int> queue(2, DropPolicy::DropOldest);
+    CHECK(queue.push(1).accepted());
+    CHECK(queue.push(2).accepted());
+    std::optional<int> dropped;
+    const auto admission = queue.push(3, SubmissionPriority::Normal, {}, &dropped);
+    CHECK(admission.result == Admission::Result::Accepted);
+    CHECK(admission.evicted);
+    CHECK(admission.backpressure);
+    CHECK_EQ(dropped, std::optional(1));
+    CHECK_EQ(queue.tryPop(), std::optional(2));
+    CHECK_EQ(queue.stats().evicted, 1u);
+}
+
+void dropNewest()
+{
+    SubmissionQueue<int> queue(2, DropPolicy::DropNewest);
+    queue.push(1);
+    queue.push(2);
+    const auto admission = queue.push(3);
+    CHECK(admission.result == Admission::Result::Rejected);
+    CHECK(admission.backpressure);
+    CHECK_EQ(queue.stats().rejected, 1u);
+    CHECK_EQ(queue.tryPop(), std::optional(1));
+}
+
+void highEvictsNormalButNotTheOtherWayRound()
+{
+    SubmissionQueue<int> queue(2, DropPolicy::DropNewest);
+    queue.push(1);
+    queue.push(2, SubmissionPriority::High);
+    std::optional<int> dropped;
+    CHECK(queue.push(3, SubmissionPriority::High, {}, &dropped).evicted);
+    CHECK_EQ(dropped, std::optional(1));
+    CHECK_EQ(queue.depth(SubmissionPriority::High), 2u);
+    CHECK(!queue.push(4).accepted());
+
+    SubmissionQueue<int> oldest(1, DropPolicy::DropOldest);
+    oldest.push(1, SubmissionPriority::High);
+    // the normal lane is empty, there is nothing it may push out
+    CHECK(oldest.push(2).result == Admission::Result::Rejected);
+    CHECK_EQ(oldest.tryPop(), std::optional(1));
+}
+
+void coalesce()
+{
+    SubmissionQueue<int> queue(3, DropPolicy::Coalesce);
+    queue.push(1, SubmissionPriority::Normal, L"build");
+    queue.push(2, SubmissionPriority::Normal, L"deploy");
+    std::optional<int> dropped;
+    const auto admission = queue.push(3, SubmissionPriority::Normal, L"build", &dropped);
+    CHECK(admission.result == Admission::Result::Coalesced);
+    CHECK_EQ(dropped, std::optional(1));
+    CHECK_EQ(queue.size(), 2u);
+    // replaced in place, it keeps its position
+    CHECK_EQ(queue.tryPop(), std::optional(3));
+
+    // the key is free again once popped, empty keys are never coalesced
+    CHECK(queue.push(4, SubmissionPriority::Normal, L"build").result
+          == Admission::Result::Accepted);
+    CHECK(queue.push(5).result == Admission::Result::Accepted);
+    CHECK(queue.push(6).evicted);
+    CHECK_EQ(queue.stats().coalesced, 1u);
+    CHECK_EQ(queue.tryPop(), std::optional(4));
+    // deploy was evicted, build must not point at it any more
+    CHECK(queue.push(7, SubmissionPriority::Normal, L"deploy").result
+          == Admission::Result::Accepted);
+}
+
+void closeWakesWaiters()
+{
+    SubmissionQueue<int> queue(1);
+    std::thread consumer([&] { CHECK(!queue.pop(10s)); });
+    std::this_thread::sleep_for(20ms);
+    queue.close();
+    consumer.join();
+    CHECK(queue.push(1).result == Admission::Result::Closed);
+    CHECK(queue.waitForRoom(10s));
+}
+
+void waitForRoom()
+{
+    SubmissionQueue<int> queue(1);
+    queue.push(1);
+    CHECK(!queue.waitForRoom(1ms));
+    std::thread consumer([&] {
+        std::this_thread::sleep_for(20ms);
+        queue.tryPop();
+    });
+    CHECK(queue.waitForRoom(10s));
+    consumer.join();
+}
+
+void manyProducersLoseNothing()
+{
+    constexpr int Producers = 8;
+    constexpr int PerProducer = 5000;
+    SubmissionQueue<int> queue(64, DropPolicy::DropNewest);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < Producers; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < PerProducer; ++i) {
+                while (!queue.push(p * PerProducer + i).accepted()) {
+                    queue.waitForRoom(10ms);
+                }
+            }
+        });
+    }
+    std::vector<int> last(Producers, -1);
+    bool ordered = true;
+    for (int received = 0; received < Producers * PerProducer; ++received) {
+        const auto item = queue.pop(10s);
+        if (!CHECK(item)) {
+            break;
+        }
+        // every producer's toasts arrive in the order it submitted them
+        const int producer = *item / PerProducer;
+        ordered = ordered && *item > last[producer];
+        last[producer] = *item;
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    CHECK(ordered);
+    CHECK_EQ(queue.size(), 0u);
+    CHECK_EQ(queue.stats().accepted, uint64_t(Producers * PerProducer));
+}
+}
+
+int main()
+{
+    highLaneIsDrainedFirst();
+    dropOldest();
+    dropNewest();
+    highEvictsNormalButNotTheOtherWayRound();
+    coalesce();
+    closeWakesWaiters();
+    waitForRoom();
+    manyProducersLoseNothing();
+    return NtfyTest::result();
+}
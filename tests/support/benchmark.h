@@ -0,0 +1,74 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+/*
+    Helpers for the benchmarks, each benchmark prints one line per measurement in the
+    form "name: value unit" so runs can be compared with a plain diff.
+*/
+
+namespace NtfyBench {
+using Clock = std::chrono::steady_clock;
+
+// keeps the optimizer from dropping a computation whose result is otherwise unused
+template<typename T>
+inline void keep(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+/**
+ * Runs f() iterations times, repeats that rounds times and returns the fastest round in
+ * nanoseconds per iteration.
+ */
+template<typename F>
+double measure(size_t iterations, F &&f, size_t rounds = 5)
+{
+    double best = 0;
+    for (size_t round = 0; round < rounds; ++round) {
+        const auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            f();
+        }
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count()
+                / static_cast<double>(iterations);
+        best = round == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+inline void report(const char *name, double value, const char *unit)
+{
+    std::printf("%s: %.2f %s\n", name, value, unit);
+}
+}
@@ -0,0 +1,192 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "timerwheel.h"
+
+#include <fstream>
+#include <filesystem>
+#include <random>
+
+using namespace std::chrono_literals;
+
+namespace {
+struct ManualClock
+{
+    std::chrono::milliseconds now = 0ms;
+
+    TimerWheel::Clock clock()
+    {
+        return [this] { return now; };
+    }
+};
+
+// a timer on the second level a full revolution away wraps into the current slot
+void nextDeadlineSkipsWrappedSlot()
+{
+    ManualClock clock { 0x180ms };
+    TimerWheel wheel(clock.clock(), 1ms);
+    wheel.schedule(0x10100ms, TimerWheel::Kind::Display);
+    wheel.schedule(0x480ms, TimerWheel::Kind::Display);
+    CHECK_EQ(wheel.nextDeadline(), std::optional(0x480ms));
+}
+
+void nextDeadlineMatchesBruteForce()
+{
+    std::mt19937_64 random(26);
+    for (int run = 0; run < 200; ++run) {
+        ManualClock clock { std::chrono::milliseconds(random() % 0x1000000) };
+        TimerWheel wheel(clock.clock(), 1ms);
+        std::optional<std::chrono::milliseconds> expected;
+        for (int i = 0; i < 8; ++i) {
+            // spread over all levels
+            const auto deadline =
+                    clock.now + std::chrono::milliseconds(2 + (random() >> (36 + random() % 28)));
+            wheel.schedule(deadline, TimerWheel::Kind::Expire);
+            expected = expected ? std::min(*expected, deadline) : deadline;
+        }
+        // move forward without firing anything so the slots cascade
+        clock.now += (*expected - clock.now) / 2;
+        CHECK(wheel.advance().empty());
+        CHECK_EQ(wheel.nextDeadline(), expected);
+    }
+}
+
+void firesInDeadlineOrder()
+{
+    ManualClock clock;
+    TimerWheel wheel(clock.clock(), 100ms);
+    wheel.schedule(250ms, TimerWheel::Kind::Display, L"b");
+    wheel.schedule(120ms, TimerWheel::Kind::Display, L"a");
+    wheel.schedule(70000ms, TimerWheel::Kind::Expire, L"c");
+
+    clock.now = 150ms;
+    auto due = wheel.advance();
+    CHECK(due.empty());
+    // rounded up to the resolution, never early
+    CHECK_EQ(wheel.nextDeadline(), std::optional(200ms));
+
+    clock.now = 300ms;
+    due = wheel.advance();
+    CHECK_EQ(due.size(), 2u);
+    if (due.size() == 2) {
+        CHECK(due[0].payload == L"a");
+        CHECK(due[1].payload == L"b");
+    }
+
+    clock.now = 70000ms;
+    due = wheel.advance();
+    CHECK_EQ(due.size(), 1u);
+    CHECK(wheel.empty());
+    CHECK(!wheel.nextDeadline());
+}
+
+void cancelIgnoresStaleIds()
+{
+    ManualClock clock;
+    TimerWheel wheel(clock.clock(), 1ms);
+    const auto first = wheel.schedule(10ms, TimerWheel::Kind::Timeout);
+    CHECK(wheel.cancel(first));
+    CHECK(!wheel.cancel(first));
+    // reuses the node, the old id must not cancel it
+    const auto second = wheel.schedule(20ms, TimerWheel::Kind::Timeout);
+    CHECK(!wheel.cancel(first));
+    CHECK_EQ(wheel.size(), 1u);
+    CHECK(wheel.cancel(second));
+    CHECK(!wheel.cancel(TimerWheel::InvalidTimer));
+    CHECK(wheel.empty());
+}
+
+void farTimersAreRecascaded()
+{
+    ManualClock clock;
+    TimerWheel wheel(clock.clock(), 1ms);
+    // on the top level, cascaded down through all levels before it fires
+    const auto deadline = std::chrono::milliseconds((int64_t(1) << 24) + 0x10203);
+    wheel.schedule(deadline, TimerWheel::Kind::Display);
+    clock.now = deadline - 1ms;
+    CHECK(wheel.advance().empty());
+    clock.now = deadline;
+    CHECK_EQ(wheel.advance().size(), 1u);
+}
+
+void snapshotRoundTrip()
+{
+    const auto path = std::filesystem::temp_directory_path() / "ntfytoast-test-timerwheel.bin";
+    ManualClock clock;
+    {
+        TimerWheel wheel(clock.clock(), 1ms);
+        wheel.schedule(500ms, TimerWheel::Kind::Display, L"-t title -m \U0001F514");
+        wheel.schedule(90000ms, TimerWheel::Kind::Expire, L"toast");
+        CHECK(wheel.save(path));
+    }
+    clock.now = 1000ms;
+    TimerWheel wheel(clock.clock(), 1ms);
+    CHECK(wheel.load(path));
+    CHECK_EQ(wheel.size(), 2u);
+    // the overdue timer fires right away
+    const auto due = wheel.advance();
+    CHECK_EQ(due.size(), 1u);
+    if (!due.empty()) {
+        CHECK(due[0].payload == L"-t title -m \U0001F514");
+        CHECK(due[0].kind == TimerWheel::Kind::Display);
+    }
+    std::filesystem::remove(path);
+    CHECK(!wheel.load(path));
+}
+
+// a payload size larger than the rest of the file fails the load instead of allocating it
+void corruptSnapshot()
+{
+    const auto path = std::filesystem::temp_directory_path() / "ntfytoast-test-corrupt.bin";
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        const uint32_t count = 1;
+        const int64_t deadline = 0;
+        const uint8_t kind = 0;
+        const uint32_t size = 0xfffffff0;
+        out.write("NTW1", 4);
+        out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        out.write(reinterpret_cast<const char *>(&deadline), sizeof(deadline));
+        out.write(reinterpret_cast<const char *>(&kind), sizeof(kind));
+        out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+        out.write("a\0b\0", 4);
+    }
+    ManualClock clock;
+    TimerWheel wheel(clock.clock(), 1ms);
+    CHECK(!wheel.load(path));
+    CHECK(wheel.empty());
+    std::filesystem::remove(path);
+}
+}
+
+int main()
+{
+    nextDeadlineSkipsWrappedSlot();
+    nextDeadlineMatchesBruteForce();
+    firesInDeadlineOrder();
+    cancelIgnoresStaleIds();
+    farTimersAreRecascaded();
+    snapshotRoundTrip();
+    corruptSnapshot();
+    return NtfyTest::result();
+}
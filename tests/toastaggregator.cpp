@@ -0,0 +1,206 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "loopbackbackend.h"
+#include "toastaggregator.h"
+#include "toastdispatcher.h"
+
+#include <thread>
+
+using namespace std::chrono_literals;
+using Actions = NtfyToastActions::Actions;
+
+namespace {
+struct ManualClock
+{
+    std::chrono::milliseconds now = 0ms;
+
+    TimerWheel::Clock clock()
+    {
+        return [this] { return now; };
+    }
+};
+
+ToastAggregator::Policy policy(size_t threshold, std::chrono::milliseconds window)
+{
+    ToastAggregator::Policy out;
+    out.threshold = threshold;
+    out.window = window;
+    return out;
+}
+
+// the toast after threshold toasts within the window starts the storm, per group
+void stormsAboveThreshold()
+{
+    ManualClock clock;
+    ToastAggregator aggregator(policy(3, 10s), clock.clock());
+    for (int i = 0; i < 3; ++i) {
+        CHECK(!aggregator.add(L"build-farm"));
+        clock.now += 1s;
+    }
+    CHECK(!aggregator.storming(L"build-farm"));
+    CHECK(aggregator.add(L"build-farm"));
+    CHECK(aggregator.storming(L"build-farm"));
+
+    CHECK(!aggregator.add(L"backup"));
+    CHECK(!aggregator.storming(L"backup"));
+    CHECK_EQ(aggregator.groups(), 2u);
+
+    // without a threshold every toast goes into the summary
+    ToastAggregator always(policy(0, 10s), clock.clock());
+    CHECK(always.add(L"build-farm"));
+}
+
+// only the toasts within the last window count
+void windowSlides()
+{
+    ManualClock clock;
+    ToastAggregator aggregator(policy(3, 10s), clock.clock());
+    for (const auto at : { 0ms, 5000ms, 10000ms, 11000ms }) {
+        clock.now = at;
+        CHECK(!aggregator.add(L"build-farm"));
+    }
+    // the toasts at 5s, 10s and 11s are within the window of this one
+    clock.now = 12s;
+    CHECK(aggregator.add(L"build-farm"));
+}
+
+// a storm lasts as long as its toasts arrive within a window of each other
+void stormEnds()
+{
+    ManualClock clock;
+    ToastAggregator aggregator(policy(2, 10s), clock.clock());
+    for (int i = 0; i < 3; ++i) {
+        aggregator.add(L"build-farm");
+    }
+    CHECK(aggregator.storming(L"build-farm"));
+
+    // every toast of the storm extends it
+    for (int i = 0; i < 5; ++i) {
+        clock.now += 9s;
+        CHECK(aggregator.add(L"build-farm"));
+    }
+
+    clock.now += 10s;
+    CHECK(!aggregator.storming(L"build-farm"));
+    CHECK_EQ(aggregator.groups(), 0u);
+    // the next storm needs threshold toasts again
+    CHECK(!aggregator.add(L"build-farm"));
+    CHECK(!aggregator.add(L"build-farm"));
+    CHECK(aggregator.add(L"build-farm"));
+}
+
+LoopbackBackend::Options idleUser()
+{
+    LoopbackBackend::Options options;
+    options.clicks = 0;
+    options.buttons = 0;
+    options.replies = 0;
+    options.dismissals = 0;
+    return options;
+}
+
+ToastSubmission submission(const std::wstring &tag)
+{
+    ToastSubmission out;
+    out.request = { L"NtfyToast.Test", tag, L"build-farm", L"<toast><visual/></toast>", {} };
+    return out;
+}
+
+bool ready(std::future<ToastResult> &result, std::chrono::milliseconds timeout = 5s)
+{
+    return result.wait_for(timeout) == std::future_status::ready;
+}
+
+// nobody reacted to the summary, it leaves the screen and its toasts time out
+void summaryTimesOut()
+{
+    const auto backend = std::make_shared<LoopbackBackend>(idleUser());
+    ToastDispatcher::Options options;
+    options.timeout = 100ms;
+    options.aggregation = policy(1, 1h);
+    ToastDispatcher dispatcher(backend, options);
+    dispatcher.start();
+
+    std::vector<ToastTicket> tickets;
+    for (int i = 0; i < 3; ++i) {
+        tickets.push_back(dispatcher.submit(submission(L"storm" + std::to_wstring(i))));
+    }
+    for (auto &ticket : tickets) {
+        CHECK(ready(ticket.result));
+    }
+    // the first toast was shown on its own, the others collected in the summary
+    CHECK(tickets[0].result.get().action == Actions::Error);
+    for (size_t i = 1; i < tickets.size(); ++i) {
+        const auto result = tickets[i].result.get();
+        CHECK(result.action == Actions::Timedout);
+        CHECK(!result.shownAt.has_value());
+    }
+    CHECK_EQ(backend->stats().hidden, 1u);
+    CHECK_EQ(backend->active(), 1u);
+    CHECK_EQ(dispatcher.pending(), 0u);
+}
+
+// a cancelled toast leaves the summary, the others stay in it
+void cancelLeavesSummary()
+{
+    const auto backend = std::make_shared<LoopbackBackend>(idleUser());
+    ToastDispatcher::Options options;
+    options.timeout.reset();
+    options.aggregation = policy(1, 1h);
+    ToastDispatcher dispatcher(backend, options);
+    dispatcher.start();
+
+    std::vector<ToastTicket> tickets;
+    for (int i = 0; i < 3; ++i) {
+        tickets.push_back(dispatcher.submit(submission(L"storm" + std::to_wstring(i))));
+    }
+    // the first toast and two versions of the summary
+    while (backend->stats().shown < 3) {
+        std::this_thread::sleep_for(1ms);
+    }
+    dispatcher.cancel(tickets[1].handle);
+    CHECK(ready(tickets[1].result));
+    if (ready(tickets[1].result, 0ms)) {
+        CHECK(tickets[1].result.get().action == Actions::Hidden);
+    }
+    CHECK(!ready(tickets[2].result, 50ms));
+    CHECK_EQ(dispatcher.pending(), 2u);
+
+    dispatcher.stop();
+    CHECK(ready(tickets[2].result, 0ms));
+    if (ready(tickets[2].result, 0ms)) {
+        CHECK(tickets[2].result.get().action == Actions::Error);
+    }
+}
+}
+
+int main()
+{
+    stormsAboveThreshold();
+    windowSlides();
+    stormEnds();
+    summaryTimesOut();
+    cancelLeavesSummary();
+    return NtfyTest::result();
+}
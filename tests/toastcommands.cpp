@@ -0,0 +1,150 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "loopbackbackend.h"
+#include "toastcommands.h"
+
+#include <algorithm>
+#include <array>
+#include <sstream>
+
+using namespace std::chrono_literals;
+
+namespace {
+using Tags = std::vector<std::wstring>;
+
+// a user that never reacts, the toasts stay in the history
+std::unique_ptr<LoopbackBackend> backendWithToasts()
+{
+    LoopbackBackend::Options options;
+    options.clicks = options.buttons = options.replies = options.dismissals = 0;
+    options.reaction = LoopbackBackend::Distribution::fixed(1h);
+    auto backend = std::make_unique<LoopbackBackend>(options);
+    for (const auto &[tag, group] : { std::pair(L"build-1", L"ci"), std::pair(L"build-2", L"ci"),
+                                      std::pair(L"deploy-1", L"ci"),
+                                      std::pair(L"build-3", L"other") }) {
+        CHECK(backend->show({ L"app", tag, group, L"<toast/>", {} }, nullptr));
+    }
+    return backend;
+}
+
+using Counters = std::array<uint32_t, 6>;
+
+Counters counters(const ToastBackend &backend)
+{
+    const auto &c = backend.counters();
+    return { c.runtimeInitializations, c.activatorRegistrations, c.registrationChecks,
+             c.factoryLookups,         c.notifierCreations,      c.historyLookups };
+}
+
+Tags sorted(Tags tags)
+{
+    std::sort(tags.begin(), tags.end());
+    return tags;
+}
+
+void closesIds()
+{
+    const auto backend = backendWithToasts();
+    const Tags ids { L"build-1", L"build-3", L"", L"none" };
+    const auto missing = ToastCommands::closeNotifications(*backend, L"app", L"ci", ids);
+    // build-3 is in another group
+    CHECK(missing == (Tags { L"build-3", L"", L"none" }));
+    CHECK(sorted(backend->tags(L"app", L"ci")) == (Tags { L"build-2", L"deploy-1" }));
+    CHECK(backend->tags(L"app", L"other") == Tags { L"build-3" });
+}
+
+void closesPatterns()
+{
+    const auto backend = backendWithToasts();
+    CHECK(backend->tags(L"other app", L"ci").empty());
+    const auto missing = ToastCommands::closeNotifications(*backend, L"app", L"ci",
+                                                           { L"build-*", L"*-9", L"build-?" });
+    // the toasts of the first pattern are gone when the third one looks for them
+    CHECK(missing == (Tags { L"*-9", L"build-?" }));
+    CHECK_EQ(backend->history(L"app"), size_t(2));
+    CHECK(backend->tags(L"app", L"ci") == Tags { L"deploy-1" });
+    CHECK(backend->tags(L"app", L"other") == Tags { L"build-3" });
+}
+
+// a toast of a running instance is closed by it, the history is left alone
+void asksRunningInstanceFirst()
+{
+    const auto backend = backendWithToasts();
+    Tags asked;
+    const auto closeShown = [&](const std::wstring &tag) {
+        asked.push_back(tag);
+        return tag == L"build-2" || tag == L"running";
+    };
+    const auto missing = ToastCommands::closeNotifications(
+            *backend, L"app", L"ci", { L"running", L"build-*", L"deploy-1" }, closeShown);
+    CHECK(missing.empty());
+    CHECK(asked.size() == 4 && asked.front() == L"running" && asked.back() == L"deploy-1");
+    CHECK(sorted(backend->tags(L"app", L"ci")) == (Tags { L"build-2" }));
+}
+
+// -v and -h touch nothing of the backend, the commands on shown toasts only its history
+void touchesOnlyWhatItNeeds()
+{
+    {
+        LoopbackBackend backend;
+        std::wstringstream out;
+        ToastCommands::version(out);
+        ToastCommands::help(out, L"", L"-t <title string>");
+        ToastCommands::help(out, L"Unknown argument: -x", L"-t <title string>");
+        CHECK(out.str().find(L"Version") != std::wstring::npos);
+        CHECK(out.str().find(L"Unknown argument: -x\n-t <title string>") != std::wstring::npos);
+        CHECK(counters(backend) == Counters {});
+    }
+    {
+        // the toast belongs to a running instance
+        LoopbackBackend backend;
+        const auto missing = ToastCommands::closeNotifications(
+                backend, L"app", L"", { L"1" }, [](const std::wstring &) { return true; });
+        CHECK(missing.empty());
+        CHECK(counters(backend) == Counters {});
+    }
+
+    const auto backend = backendWithToasts();
+    Counters expected = counters(*backend);
+    CHECK_EQ(expected[4], 1u);
+    CHECK_EQ(expected[5], 0u);
+    ToastCommands::closeNotifications(*backend, L"app", L"ci", { L"build-1", L"deploy-*" });
+    ToastCommands::closeNotifications(*backend, L"app", L"ci", { L"build-*" });
+    CHECK(backend->removeGroup(L"app", L"other"));
+    CHECK(backend->clear(L"app"));
+    // the history is created once and reused
+    expected[5] = 1;
+    CHECK(counters(*backend) == expected);
+    CHECK_EQ(backend->history(L"app"), 0u);
+}
+}
+
+int main()
+{
+    closesIds();
+    closesPatterns();
+    asksRunningInstanceFirst();
+    touchesOnlyWhatItNeeds();
+    return NtfyTest::result();
+}
@@ -0,0 +1,99 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "toastcontent.h"
+
+namespace {
+size_t count(const std::wstring &text, std::wstring_view part)
+{
+    size_t n = 0;
+    for (auto pos = text.find(part); pos != std::wstring::npos; pos = text.find(part, pos + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+void rendersText()
+{
+    ToastContent content;
+    content.title = L"Backup <done>";
+    content.body = L"Tom & Jerry";
+    const auto xml = content.render(L"notificationId=7;", L"1000");
+    CHECK(xml.rfind(L"<toast launch=\"action=clicked;notificationId=7;submittedAt=1000;\"", 0)
+          == 0);
+    CHECK(count(xml, L"template=\"ToastText02\"") == 1);
+    CHECK(count(xml, L"<text id=\"1\">Backup &lt;done&gt;</text>") == 1);
+    CHECK(count(xml, L"<text id=\"2\">Tom &amp; Jerry</text>") == 1);
+    CHECK(count(xml, L"duration=\"short\"") == 1);
+    CHECK(count(xml, L"scenario=") == 0);
+    CHECK(count(xml, L"<audio src=\"ms-winsoundevent:Notification.Default\" silent=\"false\"/>")
+          == 1);
+    CHECK(count(xml, L"<actions>") == 0);
+}
+
+void rendersButtons()
+{
+    ToastContent content;
+    content.title = L"t";
+    content.body = L"b";
+    content.image = L"C:\\image.png";
+    content.sound = L"ms-winsoundevent:Notification.Mail";
+    content.buttons = L"Yes;No;";
+    // buttons replace the text box
+    content.textBox = true;
+    content.silent = true;
+    content.persistent = true;
+    content.longDuration = true;
+    const auto xml = content.render(L"notificationId=7;", L"1000");
+    CHECK(count(xml, L"template=\"ToastImageAndText02\"") == 1);
+    CHECK(count(xml, L"<image id=\"1\" src=\"C:\\image.png\"/>") == 1);
+    CHECK(count(xml, L"scenario=\"incomingCall\"") == 1);
+    CHECK(count(xml, L"duration=\"long\"") == 1);
+    CHECK(count(xml, L"<action content=\"Yes\" arguments=\"action=buttonClicked;"
+                     L"notificationId=7;submittedAt=1000;button=Yes;\"")
+          == 1);
+    CHECK(count(xml, L"button=No;") == 1);
+    CHECK(count(xml, L"<action ") == 2);
+    CHECK(count(xml, L"<input ") == 0);
+    CHECK(count(xml, L"<audio src=\"ms-winsoundevent:Notification.Mail\" silent=\"true\"/>")
+          == 1);
+}
+
+void rendersTextBox()
+{
+    ToastContent content;
+    content.textBox = true;
+    const auto xml = content.render(L"notificationId=7;", L"1000");
+    CHECK(count(xml, L"<input id=\"textBox\"") == 1);
+    CHECK(count(xml, L"arguments=\"action=textEntered;notificationId=7;submittedAt=1000;\"")
+          == 1);
+}
+}
+
+int main()
+{
+    rendersText();
+    rendersButtons();
+    rendersTextBox();
+    return NtfyTest::result();
+}
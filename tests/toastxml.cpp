@@ -0,0 +1,198 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "toastxml.h"
+
+#include <random>
+#include <string>
+
+namespace {
+// one character at a time, what the vectorised scan has to agree with
+template<bool Attribute, typename String>
+String reference(const String &value)
+{
+    using Char = typename String::value_type;
+    String out;
+    for (const Char c : value) {
+        const auto u = static_cast<std::make_unsigned_t<Char>>(c);
+        const char *entity = u == '<' ? "&lt;"
+                : u == '>'            ? "&gt;"
+                : u == '&'            ? "&amp;"
+                : u == '"'            ? "&quot;"
+                : u == '\''           ? "&apos;"
+                : !Attribute          ? nullptr
+                : u == '\t'           ? "&#9;"
+                : u == '\n'           ? "&#10;"
+                : u == '\r'           ? "&#13;"
+                                      : nullptr;
+        if (entity) {
+            for (; *entity; ++entity) {
+                out.push_back(static_cast<Char>(*entity));
+            }
+        } else if (u < 0x20 && u != '\t' && u != '\n' && u != '\r') {
+            if constexpr (sizeof(Char) == 1) {
+                out += "\xEF\xBF\xBD";
+            } else {
+                out.push_back(static_cast<Char>(0xFFFD));
+            }
+        } else {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
+
+template<bool Attribute, typename String>
+String escaped(const String &value)
+{
+    String out;
+    if constexpr (Attribute) {
+        ToastXmlWriter::escapeAttribute(out, value);
+    } else {
+        ToastXmlWriter::escape(out, value);
+    }
+    return out;
+}
+
+template<typename String>
+String escaped(const String &value)
+{
+    return escaped<false>(value);
+}
+
+void escapesSpecialCharacters()
+{
+    CHECK(escaped(std::wstring(L"Tom & Jerry")) == L"Tom &amp; Jerry");
+    CHECK(escaped(std::wstring(L"<a href=\"x\">'y'</a>"))
+          == L"&lt;a href=&quot;x&quot;&gt;&apos;y&apos;&lt;/a&gt;");
+    CHECK(escaped(std::wstring(L"tab\tline\ncr\r")) == L"tab\tline\ncr\r");
+    CHECK(escaped(std::wstring(L"bell\x07")) == L"bell\xFFFD");
+    CHECK(escaped(std::wstring(L"caf\u00e9 \u65e5\u672c")) == L"caf\u00e9 \u65e5\u672c");
+    CHECK(escaped(std::string("caf\xc3\xa9 & \x01")) == "caf\xc3\xa9 &amp; \xEF\xBF\xBD");
+    CHECK(escaped(std::wstring()).empty());
+}
+
+void escapesWhitespaceInAttributes()
+{
+    CHECK(escaped<true>(std::wstring(L"tab\tline\ncr\r")) == L"tab&#9;line&#10;cr&#13;");
+    CHECK(escaped<true>(std::string("a\r\nb")) == "a&#13;&#10;b");
+    CHECK(escaped<true>(std::wstring(L"bell\x07 & \"")) == L"bell\xFFFD &amp; &quot;");
+    const std::wstring longValue = std::wstring(40, L'a') + L"\n" + std::wstring(40, L'b');
+    CHECK(escaped<true>(longValue)
+          == std::wstring(40, L'a') + L"&#10;" + std::wstring(40, L'b'));
+
+    ToastXmlWriter writer;
+    writer.startElement(L"toast");
+    writer.attribute(L"launch", L"body=one\ntwo\t;");
+    writer.text(L"one\ntwo");
+    writer.endElement();
+    CHECK(writer.xml() == L"<toast launch=\"body=one&#10;two&#9;;\">one\ntwo</toast>");
+}
+
+// every special character at every position of the vector lanes and the scalar tail
+template<bool Attribute, typename String>
+void matchesReferenceAtEveryPosition()
+{
+    using Char = typename String::value_type;
+    const Char specials[] = { '<', '>', '&', '"', '\'', 0x01, 0x1f, '\t', '\n', '\r', 0x20,
+                              0x7f };
+    for (size_t size = 1; size <= 80; ++size) {
+        for (size_t pos = 0; pos < size; ++pos) {
+            for (const Char special : specials) {
+                String value(size, static_cast<Char>('a'));
+                value[pos] = special;
+                if (!CHECK(escaped<Attribute>(value) == reference<Attribute>(value))) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+template<bool Attribute, typename String>
+void matchesReferenceOnRandomText()
+{
+    using Char = typename String::value_type;
+    std::mt19937 random(7);
+    for (int round = 0; round < 2000; ++round) {
+        String value(random() % 300, Char());
+        for (auto &c : value) {
+            // mostly text, some specials and controls, some beyond ASCII
+            const auto r = random() % 100;
+            const uint32_t beyond = sizeof(Char) == 1 ? 0x80 : 0xD000;
+            if (r < 80) {
+                c = static_cast<Char>('a' + r % 26);
+            } else if (r < 90) {
+                c = static_cast<Char>("<>&\"'"[r % 5]);
+            } else if (r < 95) {
+                c = static_cast<Char>(r % 32);
+            } else {
+                c = static_cast<Char>(0x80 + random() % beyond);
+            }
+        }
+        if (!CHECK(escaped<Attribute>(value) == reference<Attribute>(value))) {
+            return;
+        }
+    }
+}
+
+void writesElements()
+{
+    ToastXmlWriter writer;
+    writer.startElement(L"toast");
+    writer.attribute(L"launch", L"action=clicked;a=\"b\";");
+    writer.startElement(L"visual");
+    writer.startElement(L"binding");
+    writer.attribute(L"template", L"ToastText02");
+    writer.startElement(L"text");
+    writer.attribute(L"id", L"1");
+    writer.text(L"1 < 2");
+    writer.endElement();
+    writer.endElement();
+    writer.endElement();
+    writer.emptyElement(L"audio", { { L"silent", L"true" } });
+    writer.startElement(L"actions");
+    writer.endElement();
+    writer.endElement();
+    CHECK(writer.xml()
+          == L"<toast launch=\"action=clicked;a=&quot;b&quot;;\"><visual>"
+             L"<binding template=\"ToastText02\"><text id=\"1\">1 &lt; 2</text></binding>"
+             L"</visual><audio silent=\"true\"/><actions/></toast>");
+}
+}
+
+int main()
+{
+    escapesSpecialCharacters();
+    escapesWhitespaceInAttributes();
+    matchesReferenceAtEveryPosition<false, std::wstring>();
+    matchesReferenceAtEveryPosition<false, std::string>();
+    matchesReferenceAtEveryPosition<true, std::wstring>();
+    matchesReferenceAtEveryPosition<true, std::string>();
+    matchesReferenceOnRandomText<false, std::wstring>();
+    matchesReferenceOnRandomText<false, std::string>();
+    matchesReferenceOnRandomText<true, std::wstring>();
+    matchesReferenceOnRandomText<true, std::string>();
+    writesElements();
+    return NtfyTest::result();
+}
@@ -0,0 +1,128 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "check.h"
+#include "referenceutf8.h"
+#include "utf8.h"
+
+#include <random>
+
+namespace {
+void roundTrip()
+{
+    const std::u16string text = u"Build #42 failed: Größe überschritten, ビルド失敗 \U0001F525";
+    const auto utf8 = Utf8::fromUtf16(text);
+    CHECK(utf8 == u8"Build #42 failed: Größe überschritten, ビルド失敗 \U0001F525");
+    size_t replaced = 1;
+    CHECK(Utf8::toUtf16(utf8, &replaced) == text);
+    CHECK_EQ(replaced, 0u);
+    CHECK(Utf8::isValid(utf8));
+    CHECK(Utf8::isValid(text));
+
+    CHECK(Utf8::toWide(Utf8::fromWide(L"Größe \U0001F525")) == L"Größe \U0001F525");
+    CHECK(Utf8::fromUtf16(u"").empty());
+    CHECK(Utf8::toUtf16("").empty());
+}
+
+// text replies may end up with half of a surrogate pair
+void unpairedSurrogates()
+{
+    size_t replaced = 0;
+    CHECK(Utf8::fromUtf16(std::u16string(u"a\xD83D") + u"b", &replaced) == "a\xEF\xBF\xBD" "b");
+    CHECK_EQ(replaced, 1u);
+    CHECK(Utf8::fromUtf16(std::u16string(1, u'\xDE00') + u"\xD83D", &replaced)
+          == "\xEF\xBF\xBD\xEF\xBF\xBD");
+    CHECK_EQ(replaced, 2u);
+    CHECK(!Utf8::isValid(std::u16string(1, u'\xDE00')));
+}
+
+void malformedUtf8()
+{
+    const struct
+    {
+        std::string_view in;
+        std::u16string_view out;
+        size_t replaced;
+    } cases[] = {
+        // overlong
+        { "\xC0\xAF", u"��", 2 },
+        { "\xE0\x80\xAF", u"���", 3 },
+        // encoded surrogate
+        { "\xED\xA0\x80", u"���", 3 },
+        // above U+10FFFF
+        { "\xF4\x90\x80\x80", u"����", 4 },
+        // truncated, the maximal subpart is replaced once
+        { "a\xE2\x82", u"a�", 1 },
+        { "\xF0\x9F\x94z", u"�z", 1 },
+        // stray continuation byte
+        { "\x80z", u"�z", 1 },
+    };
+    for (const auto &c : cases) {
+        size_t replaced = 0;
+        CHECK(Utf8::toUtf16(c.in, &replaced) == c.out);
+        CHECK_EQ(replaced, c.replaced);
+        CHECK(!Utf8::isValid(c.in));
+    }
+}
+
+// the vector path copies 16 code units at a time, non ASCII at every offset of a block
+void asciiRunBoundaries()
+{
+    for (size_t length = 0; length < 48; ++length) {
+        for (size_t position = 0; position <= length; ++position) {
+            const std::u16string text = std::u16string(position, u'x') + u'\u00e9'
+                    + std::u16string(length - position, u'x');
+            CHECK(Utf8::fromUtf16(text) == ReferenceUtf8::fromUtf16(text));
+            const auto utf8 = ReferenceUtf8::fromUtf16(text);
+            CHECK(Utf8::toUtf16(utf8) == text);
+        }
+    }
+}
+
+void matchesReference()
+{
+    std::mt19937 random(31);
+    for (int run = 0; run < 2000; ++run) {
+        std::u16string utf16(random() % 64, u'\0');
+        std::string bytes(random() % 64, '\0');
+        for (auto &c : utf16) {
+            // mostly ASCII with some of everything else, surrogates included
+            c = static_cast<char16_t>(random() % 4 ? random() % 0x80 : random() % 0x10000);
+        }
+        for (auto &c : bytes) {
+            c = static_cast<char>(random() % 4 ? random() % 0x80 : random() % 0x100);
+        }
+        CHECK(Utf8::fromUtf16(utf16) == ReferenceUtf8::fromUtf16(utf16));
+        CHECK(Utf8::toUtf16(bytes) == ReferenceUtf8::toUtf16(bytes));
+    }
+}
+}
+
+int main()
+{
+    roundTrip();
+    unpairedSurrogates();
+    malformedUtf8();
+    asciiRunBoundaries();
+    matchesReference();
+    return NtfyTest::result();
+}
@@ -0,0 +1,73 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+/*
+    Writes a callback the way ntfytoast does, one connection per callback.
+
+    On Windows the address is the name of the pipe, elsewhere the path of a Unix domain
+    socket. The data is sent as is, it has to include the terminator of its encoding.
+*/
+
+inline bool sendCallback(const std::string &address, const char *data, size_t size)
+{
+#ifdef _WIN32
+    const std::wstring pipe(address.begin(), address.end());
+    const HANDLE file =
+            CreateFileW(pipe.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    DWORD written = 0;
+    const bool ok = WriteFile(file, data, static_cast<DWORD>(size), &written, nullptr)
+            && written == size;
+    CloseHandle(file);
+    return ok;
+#else
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    sockaddr_un target {};
+    target.sun_family = AF_UNIX;
+    std::snprintf(target.sun_path, sizeof(target.sun_path), "%s", address.c_str());
+    bool ok = connect(fd, reinterpret_cast<sockaddr *>(&target), sizeof(target)) == 0;
+    for (size_t sent = 0; ok && sent < size;) {
+        const ssize_t n = ::write(fd, data + sent, size - sent);
+        ok = n > 0;
+        sent += ok ? static_cast<size_t>(n) : 0;
+    }
+    close(fd);
+    return ok;
+#endif
+}
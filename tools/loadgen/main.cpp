@@ -0,0 +1,509 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+/*
+    ntfytoast-loadgen
+
+    Drives a ToastDispatcher at a fixed rate from several producer threads against a
+    LoopbackBackend, and receives the callbacks with the CallbackServer of
+    ntfytoastconsumer.h like a consumer application would. Reports the latency from submit
+    to show and from show to the arrival of the callback.
+
+    Submit times are taken from the schedule, not from the moment the producer got to it,
+    so a stalled producer shows up in the latencies instead of hiding them.
+
+    Exits with 1 if a toast was not completed or a callback did not arrive, a short run is
+    the smoke test of the dispatcher under load.
+*/
+
+#include "callbackclient.h"
+#include "callbackrecorder.h"
+#include "loopbackbackend.h"
+#include "metrics.h"
+#include "ntfytoastconsumer.h"
+#include "toastdispatcher.h"
+#include "toastxml.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    double rate = 50;
+    std::chrono::milliseconds duration = 10s;
+    size_t concurrency = 4;
+    size_t queueCapacity = 1024;
+    size_t maxOutstanding = 256;
+    // how long the dispatcher waits for a reaction
+    std::chrono::milliseconds timeout = 60s;
+    // the time the consumer needs for a callback
+    std::chrono::microseconds consumerDelay = 0us;
+    bool longDuration = false;
+    bool textBox = false;
+    LoopbackBackend::Options notifier;
+    std::string address;
+    std::string record;
+};
+
+// records when a toast was shown, the id is its tag
+class MeasuredBackend : public LoopbackBackend
+{
+public:
+    MeasuredBackend(LoopbackBackend::Options options, std::vector<std::atomic<int64_t>> &shownAt,
+                    Clock::time_point start)
+        : LoopbackBackend(std::move(options)), m_shownAt(shownAt), m_start(start)
+    {
+    }
+
+    bool show(const ToastRequest &request, std::shared_ptr<ToastEventSink> sink) override
+    {
+        const bool out = LoopbackBackend::show(request, std::move(sink));
+        m_shownAt[std::stoul(request.tag)] =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start)
+                        .count();
+        return out;
+    }
+
+private:
+    std::vector<std::atomic<int64_t>> &m_shownAt;
+    const Clock::time_point m_start;
+};
+
+/*
+    Sends the callbacks of completed toasts to the consumer.
+    The completion runs on the dispatcher thread and must not block, so they are queued.
+*/
+
+class CallbackWriter
+{
+public:
+    CallbackWriter(std::string address, std::shared_ptr<CallbackRecorder> recorder)
+        : m_address(std::move(address)),
+          m_recorder(std::move(recorder)),
+          m_thread([this] { run(); })
+    {
+    }
+
+    ~CallbackWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopped = true;
+        }
+        m_wakeup.notify_one();
+        m_thread.join();
+    }
+
+    void post(std::string data)
+    {
+        ++posted;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(data));
+        }
+        m_wakeup.notify_one();
+    }
+
+    std::atomic<uint64_t> posted { 0 };
+    std::atomic<uint64_t> sent { 0 };
+    std::atomic<uint64_t> failed { 0 };
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_wakeup.wait(lock, [this] { return m_stopped || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            const auto data = std::move(m_queue.front());
+            m_queue.pop_front();
+            lock.unlock();
+            // the null character terminates the callback
+            const auto before = Clock::now();
+            const bool ok = sendCallback(m_address, data.c_str(), data.size() + 1);
+            ++(ok ? sent : failed);
+            if (m_recorder) {
+                m_recorder->record(std::wstring(m_address.begin(), m_address.end()),
+                                   std::wstring(data.begin(), data.end()), PipeEncoding::Utf8,
+                                   ok, before, Clock::now() - before);
+            }
+            lock.lock();
+        }
+    }
+
+    const std::string m_address;
+    const std::shared_ptr<CallbackRecorder> m_recorder;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::deque<std::string> m_queue;
+    bool m_stopped = false;
+    std::thread m_thread;
+};
+
+// like NtfyToasts renders it, with the buttons OK and Later or a text box
+std::wstring toastXml(size_t id, const Options &options)
+{
+    const auto arguments = [&](const wchar_t *action) {
+        return L"action=" + std::wstring(action) + L";notificationId=" + std::to_wstring(id)
+                + L";pipe=" + std::wstring(options.address.begin(), options.address.end())
+                + L";version=0.9.0;";
+    };
+    ToastXmlWriter xml;
+    xml.startElement(L"toast");
+    xml.attribute(L"launch", arguments(L"clicked"));
+    xml.attribute(L"duration", options.longDuration ? L"long" : L"short");
+    xml.startElement(L"visual");
+    xml.startElement(L"binding");
+    xml.attribute(L"template", L"ToastGeneric");
+    xml.startElement(L"text");
+    xml.text(L"Load test");
+    xml.endElement();
+    xml.startElement(L"text");
+    xml.text(L"Toast " + std::to_wstring(id) + L" of the load generator");
+    xml.endElement();
+    xml.endElement();
+    xml.endElement();
+    xml.startElement(L"actions");
+    if (options.textBox) {
+        xml.emptyElement(L"input", { { L"id", L"textBox" }, { L"type", L"text" } });
+        xml.emptyElement(L"action",
+                         { { L"content", L"Send" },
+                           { L"arguments", arguments(L"textEntered") },
+                           { L"hint-inputId", L"textBox" } });
+    } else {
+        for (const auto button : { L"OK", L"Later" }) {
+            xml.emptyElement(L"action",
+                             { { L"content", button },
+                               { L"arguments", arguments(L"buttonClicked") + L"button=" + button
+                                         + L";" },
+                               { L"activationType", L"foreground" } });
+        }
+    }
+    xml.endElement();
+    xml.endElement();
+    return xml.xml();
+}
+
+std::string narrow(const std::wstring &in)
+{
+    // the callbacks of the simulated user are ASCII
+    return std::string(in.begin(), in.end());
+}
+
+void printLatency(const char *name, const Histogram &histogram)
+{
+    std::printf("%-18s %8llu %10lldus %10lldus %10lldus %10lldus\n", name,
+                static_cast<unsigned long long>(histogram.count()),
+                static_cast<long long>(histogram.percentile(50).count()),
+                static_cast<long long>(histogram.percentile(99).count()),
+                static_cast<long long>(histogram.percentile(99.9).count()),
+                static_cast<long long>(histogram.percentile(100).count()));
+}
+
+void help()
+{
+    std::fprintf(
+            stderr,
+            "Usage: ntfytoast-loadgen [options]\n"
+            "  -rate <toasts/s>          submitted toasts per second, default 50\n"
+            "  -duration <s>             how long to submit, default 10\n"
+            "  -concurrency <threads>    producer threads, default 4\n"
+            "  -queue <toasts>           capacity of the submission queue, default 1024\n"
+            "  -outstanding <toasts>     toasts on screen at the same time, default 256\n"
+            "  -show <us>                time the notifier needs to show a toast, default 2000\n"
+            "  -reaction <ms>            median time until the user reacts, default 2000\n"
+            "  -tail <sigma>             spread of the reaction time, default 1\n"
+            "  -timescale <factor>       speed of the simulated time, default 0.1\n"
+            "  -long                     long toasts, 25s instead of 7s on screen\n"
+            "  -textbox                  toasts with a text box instead of buttons\n"
+            "  -timeout <ms>             time the dispatcher waits for a result, default 60000\n"
+            "  -consumer <us>            time the consumer needs per callback, default 0\n"
+            "  -mix <click,button,reply,dismiss>\n"
+            "                            share of each reaction, default 0.3,0.2,0.1,0.3\n"
+            "  -seed <n>                 seed of the simulated user, default 42\n"
+            "  -address <pipe|socket>    address of the built-in consumer\n"
+            "  -record <file>            record the callbacks for ntfytoast-replay\n");
+}
+
+bool parse(int argc, char **argv, Options &options)
+{
+    auto &notifier = options.notifier;
+    notifier.showLatency = LoopbackBackend::Distribution::fixed(2ms);
+    auto reaction = std::chrono::microseconds(2s);
+    double tail = 1;
+    notifier.timeScale = 0.1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-long") {
+            options.longDuration = true;
+            continue;
+        } else if (arg == "-textbox") {
+            options.textBox = true;
+            continue;
+        } else if (arg == "-h" || i + 1 >= argc) {
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "-rate") {
+            options.rate = std::stod(value);
+        } else if (arg == "-duration") {
+            options.duration = std::chrono::milliseconds(
+                    static_cast<int64_t>(std::stod(value) * 1000));
+        } else if (arg == "-concurrency") {
+            options.concurrency = std::max<size_t>(1, std::stoul(value));
+        } else if (arg == "-queue") {
+            options.queueCapacity = std::stoul(value);
+        } else if (arg == "-outstanding") {
+            options.maxOutstanding = std::stoul(value);
+        } else if (arg == "-show") {
+            notifier.showLatency = LoopbackBackend::Distribution::fixed(
+                    std::chrono::microseconds(std::stoll(value)));
+        } else if (arg == "-reaction") {
+            reaction = std::chrono::milliseconds(std::stoll(value));
+        } else if (arg == "-tail") {
+            tail = std::stod(value);
+        } else if (arg == "-timescale") {
+            notifier.timeScale = std::stod(value);
+        } else if (arg == "-seed") {
+            notifier.seed = std::stoull(value);
+        } else if (arg == "-timeout") {
+            options.timeout = std::chrono::milliseconds(std::stoll(value));
+        } else if (arg == "-consumer") {
+            options.consumerDelay = std::chrono::microseconds(std::stoll(value));
+        } else if (arg == "-mix") {
+            if (std::sscanf(value.c_str(), "%lf,%lf,%lf,%lf", &notifier.clicks,
+                            &notifier.buttons, &notifier.replies, &notifier.dismissals)
+                != 4) {
+                return false;
+            }
+        } else if (arg == "-address") {
+            options.address = value;
+        } else if (arg == "-record") {
+            options.record = value;
+        } else {
+            return false;
+        }
+    }
+    notifier.reaction = LoopbackBackend::Distribution::logNormal(reaction, tail);
+    return options.rate > 0;
+}
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    try {
+        if (!parse(argc, argv, options)) {
+            help();
+            return 1;
+        }
+    } catch (const std::exception &) {
+        help();
+        return 1;
+    }
+    if (options.address.empty()) {
+#ifdef _WIN32
+        options.address = "\\\\.\\pipe\\ntfytoast-loadgen";
+#else
+        options.address =
+                (std::filesystem::temp_directory_path() / "ntfytoast-loadgen.sock").string();
+#endif
+    }
+
+    const auto total = static_cast<size_t>(
+            options.rate * std::chrono::duration<double>(options.duration).count());
+    std::vector<std::atomic<int64_t>> submittedAt(total);
+    std::vector<std::atomic<int64_t>> shownAt(total);
+
+    Histogram submitLatency;
+    Histogram showLatency;
+    Histogram callbackLatency;
+    std::array<std::atomic<uint64_t>, 7> results {};
+    std::atomic<uint64_t> received { 0 };
+
+    const auto start = Clock::now() + 100ms;
+    const auto elapsed = [&] {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    };
+
+    // the consumer, receives the callbacks as ntfytoast would write them with -pipeEncoding utf8
+    NtfyToastConsumer::CallbackServer<char> consumer(
+#ifdef _WIN32
+            std::wstring(options.address.begin(), options.address.end()),
+#else
+            options.address,
+#endif
+            [&](const NtfyToastConsumer::CallbackMessage<char> &message) {
+                const auto id = std::stoul(std::string(message.value("notificationId")));
+                if (id < total) {
+                    callbackLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::nanoseconds(elapsed() - shownAt[id])));
+                }
+                ++received;
+                if (options.consumerDelay.count() > 0) {
+                    std::this_thread::sleep_for(options.consumerDelay);
+                }
+            });
+    std::thread consumerThread([&] {
+        if (!consumer.run()) {
+            std::fprintf(stderr, "Failed to listen on %s\n", options.address.c_str());
+        }
+    });
+
+    std::shared_ptr<CallbackRecorder> recorder;
+    if (!options.record.empty()) {
+        recorder = std::make_shared<CallbackRecorder>(options.record);
+        if (!recorder->isOpen()) {
+            std::fprintf(stderr, "Failed to open %s\n", options.record.c_str());
+            return 1;
+        }
+    }
+    CallbackWriter writer(options.address, recorder);
+    auto notifier = std::make_shared<MeasuredBackend>(options.notifier, shownAt, start);
+
+    ToastDispatcher::Options dispatcherOptions;
+    dispatcherOptions.queueCapacity = options.queueCapacity;
+    dispatcherOptions.maxOutstanding = options.maxOutstanding;
+    dispatcherOptions.timeout = options.timeout;
+    ToastDispatcher dispatcher(notifier, dispatcherOptions);
+    dispatcher.start();
+
+    std::atomic<uint64_t> rejected { 0 };
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < options.concurrency; ++p) {
+        producers.emplace_back([&, p] {
+            for (size_t id = p; id < total; id += options.concurrency) {
+                const auto due = start
+                        + std::chrono::duration_cast<Clock::duration>(
+                                         std::chrono::duration<double>(id / options.rate));
+                std::this_thread::sleep_until(due);
+                submittedAt[id] =
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(due - start).count();
+
+                ToastSubmission submission;
+                submission.request = { L"Ntfy.LoadGen", std::to_wstring(id), L"loadgen",
+                                       toastXml(id, options), {} };
+                submission.completion = [&, id](ToastHandle, const ToastResult &result) {
+                    const auto action = static_cast<size_t>(result.action) + 1;
+                    if (action < results.size()) {
+                        ++results[action];
+                    }
+                    if (shownAt[id] != 0) {
+                        showLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::nanoseconds(shownAt[id] - submittedAt[id])));
+                    }
+                    // like ntfytoast, nothing is written if nobody reacted
+                    if (!result.arguments.empty()) {
+                        writer.post(narrow(result.arguments));
+                    } else if (result.action != NtfyToastActions::Actions::Error) {
+                        writer.post("action="
+                                    + narrow(NtfyToastActions::getActionString(result.action))
+                                    + ";notificationId=" + std::to_string(id) + ";");
+                    }
+                };
+
+                const auto before = Clock::now();
+                const auto ticket = dispatcher.submit(std::move(submission));
+                submitLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                        Clock::now() - before));
+                if (!ticket.admission.accepted()) {
+                    ++rejected;
+                }
+            }
+        });
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    const double submitSeconds =
+            std::chrono::duration<double>(Clock::now() - start).count();
+
+    // give the last toasts the time to complete and their callbacks to arrive
+    const auto deadline = Clock::now() + options.timeout + 1s;
+    while (Clock::now() < deadline
+           && (dispatcher.pending() > 0 || writer.sent + writer.failed < writer.posted
+               || received < writer.sent)) {
+        std::this_thread::sleep_for(10ms);
+    }
+    dispatcher.stop();
+    consumer.stop();
+    consumerThread.join();
+
+    const auto stats = dispatcher.queueStats();
+    std::printf("submitted %zu toasts in %.2fs (%.1f/s) from %zu threads\n", total,
+                submitSeconds, total / submitSeconds, options.concurrency);
+    std::printf("queue     accepted %llu rejected %llu evicted %llu\n",
+                static_cast<unsigned long long>(stats.accepted),
+                static_cast<unsigned long long>(rejected.load()),
+                static_cast<unsigned long long>(stats.evicted));
+    std::printf("results  ");
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i] > 0) {
+            const auto action = static_cast<NtfyToastActions::Actions>(static_cast<int>(i) - 1);
+            std::printf(" %s %llu",
+                        action == NtfyToastActions::Actions::Error
+                                ? "error"
+                                : narrow(NtfyToastActions::getActionString(action)).c_str(),
+                        static_cast<unsigned long long>(results[i].load()));
+        }
+    }
+    std::printf("\ncallbacks sent %llu failed %llu received %llu\n\n",
+                static_cast<unsigned long long>(writer.sent.load()),
+                static_cast<unsigned long long>(writer.failed.load()),
+                static_cast<unsigned long long>(received.load()));
+    std::printf("%-18s %8s %12s %12s %12s %12s\n", "latency", "count", "p50", "p99", "p999",
+                "max");
+    printLatency("submit()", submitLatency);
+    printLatency("submit -> show", showLatency);
+    printLatency("show -> callback", callbackLatency);
+
+    // every toast is completed once, rejected ones included, and no callback got lost
+    uint64_t completed = 0;
+    for (const auto &count : results) {
+        completed += count;
+    }
+    if (completed != total || writer.failed > 0 || received != writer.sent) {
+        std::fprintf(stderr, "\ncompleted %llu of %zu toasts, %llu callbacks got lost\n",
+                     static_cast<unsigned long long>(completed), total,
+                     static_cast<unsigned long long>(writer.posted - received));
+        return 1;
+    }
+    return 0;
+}
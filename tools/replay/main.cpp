@@ -0,0 +1,282 @@
+/*
+    Copyright 2024-2024 Aetherinox
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+/*
+    ntfytoast-replay
+
+    Writes the callbacks of a log recorded with -record to a consumer again, with the
+    pauses of the recording, N times faster or as fast as possible. Every callback uses
+    its own connection like ntfytoast does, several writers reproduce callbacks of
+    concurrent ntfytoast processes. Reports how long the consumer took to accept the
+    callbacks compared to the recording, and how far the replay fell behind the schedule.
+
+    Only delivered callbacks are replayed by default, a failed write is retried from the
+    spool later and that retry is part of the log as well.
+*/
+
+#include "callbackclient.h"
+#include "callbackrecorder.h"
+#include "metrics.h"
+#include "utf8.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    std::string log;
+    // 0 replays as fast as possible
+    double speed = 1;
+    size_t concurrency = 1;
+    std::string address;
+    std::optional<PipeEncoding> encoding;
+    bool all = false;
+    bool list = false;
+};
+
+struct Callback
+{
+    // since the first callback of the log
+    std::chrono::microseconds time;
+    std::chrono::microseconds recordedWriteTime;
+    std::string address;
+    // including the terminator
+    std::string bytes;
+};
+
+std::string encode(const std::string &data, PipeEncoding encoding)
+{
+    if (encoding == PipeEncoding::Utf8) {
+        return std::string(data.c_str(), data.size() + 1);
+    }
+    // UTF-16 as ntfytoast writes it on Windows, terminated by a null wchar_t
+    const auto utf16 = Utf8::toUtf16(data);
+    return std::string(reinterpret_cast<const char *>(utf16.c_str()),
+                       (utf16.size() + 1) * sizeof(char16_t));
+}
+
+void printLatency(const char *name, const Histogram &histogram)
+{
+    std::printf("%-18s %8llu %10lldus %10lldus %10lldus %10lldus\n", name,
+                static_cast<unsigned long long>(histogram.count()),
+                static_cast<long long>(histogram.percentile(50).count()),
+                static_cast<long long>(histogram.percentile(99).count()),
+                static_cast<long long>(histogram.percentile(99.9).count()),
+                static_cast<long long>(histogram.percentile(100).count()));
+}
+
+void help()
+{
+    std::fprintf(
+            stderr,
+            "Usage: ntfytoast-replay <log> [options]\n"
+            "  -speed <factor|max>       replay N times faster, default 1\n"
+            "  -concurrency <writers>    callbacks written at the same time, default 1\n"
+            "  -address <pipe|socket>    the consumer, by default the recorded pipe on Windows\n"
+            "  -encoding <utf8|utf16>    encoding of the callbacks, by default the recorded one\n"
+            "  -all                      also replay callbacks the consumer did not accept\n"
+            "  -list                     print the callbacks of the log instead\n");
+}
+
+bool parse(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-all") {
+            options.all = true;
+            continue;
+        } else if (arg == "-list") {
+            options.list = true;
+            continue;
+        } else if (arg == "-h") {
+            return false;
+        } else if (arg[0] != '-' && options.log.empty()) {
+            options.log = arg;
+            continue;
+        } else if (i + 1 >= argc) {
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "-speed") {
+            options.speed = value == "max" ? 0 : std::stod(value);
+            if (options.speed < 0) {
+                return false;
+            }
+        } else if (arg == "-concurrency") {
+            options.concurrency = std::max<size_t>(1, std::stoul(value));
+        } else if (arg == "-address") {
+            options.address = value;
+        } else if (arg == "-encoding") {
+            if (value == "utf8") {
+                options.encoding = PipeEncoding::Utf8;
+            } else if (value == "utf16") {
+                options.encoding = PipeEncoding::Utf16;
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return !options.log.empty();
+}
+
+int list(CallbackRecording &recording)
+{
+    CallbackRecording::Callback callback;
+    std::optional<std::chrono::microseconds> first;
+    while (recording.next(callback)) {
+        if (!first) {
+            first = callback.time;
+        }
+        std::printf("%12.3fms %8lldus %-9s %-5s %s %s\n",
+                    (callback.time - *first).count() / 1000.0,
+                    static_cast<long long>(callback.writeTime.count()),
+                    callback.delivered ? "delivered" : "failed",
+                    callback.encoding == PipeEncoding::Utf8 ? "utf8" : "utf16",
+                    callback.pipe.c_str(), callback.data.c_str());
+    }
+    if (recording.truncated()) {
+        std::fprintf(stderr, "The log ends with a torn record\n");
+    }
+    return 0;
+}
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    try {
+        if (!parse(argc, argv, options)) {
+            help();
+            return 1;
+        }
+    } catch (const std::exception &) {
+        help();
+        return 1;
+    }
+
+    CallbackRecording recording(options.log);
+    if (!recording.isOpen()) {
+        std::fprintf(stderr, "%s is no callback log\n", options.log.c_str());
+        return 1;
+    }
+    if (options.list) {
+        return list(recording);
+    }
+
+    // everything is encoded up front, reading the log must not slow down the replay
+    std::vector<Callback> callbacks;
+    uint64_t skipped = 0;
+    std::optional<std::chrono::microseconds> first;
+    CallbackRecording::Callback recorded;
+    while (recording.next(recorded)) {
+        if (!recorded.delivered && !options.all) {
+            ++skipped;
+            continue;
+        }
+        if (!first) {
+            first = recorded.time;
+        }
+#ifndef _WIN32
+        // the recorded names are Windows pipes
+        if (options.address.empty()) {
+            std::fprintf(stderr, "Pass the socket of the consumer with -address\n");
+            return 1;
+        }
+#endif
+        callbacks.push_back({ recorded.time - *first, recorded.writeTime,
+                              options.address.empty() ? recorded.pipe : options.address,
+                              encode(recorded.data, options.encoding.value_or(recorded.encoding)) });
+    }
+    if (recording.truncated()) {
+        std::fprintf(stderr, "The log ends with a torn record, replaying the records before it\n");
+    }
+
+    Histogram recordedWrites;
+    Histogram replayedWrites;
+    Histogram lag;
+    std::atomic<size_t> next { 0 };
+    std::atomic<uint64_t> failed { 0 };
+    const auto start = Clock::now();
+    const auto due = [&](const Callback &callback) {
+        if (options.speed == 0) {
+            return start;
+        }
+        return start
+                + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double, std::micro>(callback.time.count()
+                                                                  / options.speed));
+    };
+
+    std::vector<std::thread> writers;
+    for (size_t w = 0; w < options.concurrency; ++w) {
+        writers.emplace_back([&] {
+            for (size_t i = next++; i < callbacks.size(); i = next++) {
+                const auto &callback = callbacks[i];
+                const auto at = due(callback);
+                std::this_thread::sleep_until(at);
+                const auto before = Clock::now();
+                if (!sendCallback(callback.address, callback.bytes.data(),
+                                  callback.bytes.size())) {
+                    ++failed;
+                }
+                const auto after = Clock::now();
+                replayedWrites.record(
+                        std::chrono::duration_cast<std::chrono::microseconds>(after - before));
+                recordedWrites.record(callback.recordedWriteTime);
+                if (options.speed != 0) {
+                    lag.record(std::chrono::duration_cast<std::chrono::microseconds>(before - at));
+                }
+            }
+        });
+    }
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const double span = callbacks.empty()
+            ? 0
+            : std::chrono::duration<double>(callbacks.back().time).count();
+
+    std::printf("replayed %zu callbacks in %.2fs (%.1f/s), recorded in %.2fs\n",
+                callbacks.size(), seconds, callbacks.size() / std::max(seconds, 1e-9), span);
+    std::printf("failed   %llu, skipped %llu not delivered\n\n",
+                static_cast<unsigned long long>(failed.load()),
+                static_cast<unsigned long long>(skipped));
+    std::printf("%-18s %8s %12s %12s %12s %12s\n", "latency", "count", "p50", "p99", "p999",
+                "max");
+    printLatency("write (recorded)", recordedWrites);
+    printLatency("write (replay)", replayedWrites);
+    if (options.speed != 0) {
+        printLatency("behind schedule", lag);
+    }
+    return failed > 0 ? 2 : 0;
+}